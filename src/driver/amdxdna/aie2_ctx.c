@@ -3,6 +3,7 @@
  * Copyright (C) 2024-2025, Advanced Micro Devices, Inc.
  */
 
+#include <linux/log2.h>
 #include <linux/timekeeping.h>
 #include <drm/drm_syncobj.h>
 
@@ -16,6 +17,18 @@ bool force_cmdlist;
 module_param(force_cmdlist, bool, 0600);
 MODULE_PARM_DESC(force_cmdlist, "Force use command list (Default false)");
 
+static bool tx_batch;
+module_param(tx_batch, bool, 0600);
+MODULE_PARM_DESC(tx_batch, "Notify firmware once for back to back jobs (Default false)");
+
+static bool direct_submit;
+module_param(direct_submit, bool, 0444);
+MODULE_PARM_DESC(direct_submit, "Send jobs without dependency from the submit ioctl (Default false)");
+
+static uint ctx_max_cmds = 32;
+module_param(ctx_max_cmds, uint, 0444);
+MODULE_PARM_DESC(ctx_max_cmds, "Max outstanding commands a context can ask for, up to 128 (Default 32)");
+
 static void aie2_job_release(struct kref *ref)
 {
 	struct amdxdna_sched_job *job;
@@ -27,7 +40,7 @@ static void aie2_job_release(struct kref *ref)
 	if (job->out_fence)
 		dma_fence_put(job->out_fence);
 
-	kfree(job);
+	amdxdna_sched_job_free(ctx->client->xdna, job);
 
 	atomic64_inc(&ctx->job_free_cnt);
 	wake_up(&ctx->priv->job_free_waitq);
@@ -54,7 +67,7 @@ aie2_ctx_dump(struct amdxdna_dev *xdna, struct amdxdna_ctx *ctx)
 
 	XDNA_ERR(xdna, "Dumping ctx %s, sub=%lld, comp=%lld", ctx->name, sub, comp);
 	mutex_lock(&ctx->priv->io_lock);
-	for (int i = 0; i < CTX_MAX_CMDS; i++) {
+	for (int i = 0; i < ctx->priv->num_cmds; i++) {
 		struct amdxdna_sched_job *j;
 
 		j = ctx->priv->pending[i];
@@ -83,7 +96,7 @@ void aie2_dump_ctx(struct amdxdna_client *client)
 	srcu_read_unlock(&client->ctx_srcu, idx);
 }
 
-static void aie2_ctx_wait_for_idle(struct amdxdna_ctx *ctx)
+void aie2_ctx_wait_for_idle(struct amdxdna_ctx *ctx)
 {
 	struct dma_fence *fence;
 
@@ -111,6 +124,15 @@ void aie2_ctx_disconnect(struct amdxdna_ctx *ctx, bool wait)
 	mutex_unlock(&xdna->dev_handle->aie2_lock);
 }
 
+int aie2_ctx_config_cu(struct amdxdna_ctx *ctx)
+{
+#ifdef AMDXDNA_DEVEL
+	if (priv_load)
+		return aie2_legacy_config_cu(ctx);
+#endif
+	return aie2_config_cu(ctx);
+}
+
 int aie2_ctx_connect(struct amdxdna_ctx *ctx)
 {
 	struct amdxdna_dev *xdna = ctx->client->xdna;
@@ -124,24 +146,11 @@ int aie2_ctx_connect(struct amdxdna_ctx *ctx)
 	if (ret)
 		goto unlock_and_err;
 
-#ifdef AMDXDNA_DEVEL
-	if (priv_load) {
-		ret = aie2_legacy_config_cu(ctx);
-		if (ret) {
-			XDNA_ERR(xdna, "Legacy config cu failed, ret %d", ret);
-			goto failed;
-		}
-		goto skip_config_cu;
-	}
-#endif
-	ret = aie2_config_cu(ctx);
+	ret = aie2_ctx_config_cu(ctx);
 	if (ret) {
 		XDNA_ERR(xdna, "Config cu failed, ret %d", ret);
 		goto failed;
 	}
-#ifdef AMDXDNA_DEVEL
-skip_config_cu:
-#endif
 	mutex_unlock(&xdna->dev_handle->aie2_lock);
 	return 0;
 
@@ -152,6 +161,212 @@ unlock_and_err:
 	return ret;
 }
 
+static bool aie2_job_use_cmdlist(struct amdxdna_sched_job *job)
+{
+	if (job->opcode != OP_USER)
+		return false;
+
+	return force_cmdlist || amdxdna_cmd_get_op(job->cmd_bo) == ERT_CMD_CHAIN;
+}
+
+/*
+ * Each job in flight holds one command buffer or one unsealed chain, and
+ * sealed_cnt, counted before a chain takes its buffer, holds the others to
+ * CTX_MAX_SEALED_CHAINS. Buffers are given back before job_sem is, so the
+ * free list is never empty for a job holding a job_sem count or a counted
+ * chain.
+ */
+static struct amdxdna_gem_obj *aie2_cmd_buf_take(struct amdxdna_ctx_priv *priv)
+{
+	struct amdxdna_gem_obj *abo = NULL;
+
+	spin_lock(&priv->cmd_buf_lock);
+	if (priv->cmd_buf_free)
+		abo = priv->cmd_buf[--priv->cmd_buf_free];
+	spin_unlock(&priv->cmd_buf_lock);
+	return abo;
+}
+
+static void aie2_cmd_buf_give(struct amdxdna_ctx_priv *priv, struct amdxdna_gem_obj *abo)
+{
+	spin_lock(&priv->cmd_buf_lock);
+	priv->cmd_buf[priv->cmd_buf_free++] = abo;
+	spin_unlock(&priv->cmd_buf_lock);
+}
+
+static int aie2_cmd_buf_get(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job)
+{
+	job->cmd_buf = aie2_cmd_buf_take(ctx->priv);
+	if (drm_WARN_ON(&ctx->client->xdna->ddev, !job->cmd_buf))
+		return -EBUSY;
+	return 0;
+}
+
+static int aie2_cmd_bufs_alloc(struct amdxdna_ctx *ctx)
+{
+	struct amdxdna_drm_create_bo args = {
+		.flags = 0,
+		.type = AMDXDNA_BO_DEV,
+		.vaddr = 0,
+		.size = MAX_CHAIN_CMDBUF_SIZE,
+	};
+	struct amdxdna_client *client = ctx->client;
+	struct amdxdna_ctx_priv *priv = ctx->priv;
+	struct amdxdna_gem_obj *abo;
+	u32 i;
+
+	for (i = 0; i < priv->cmd_buf_cnt; i++) {
+		abo = amdxdna_drm_create_dev_bo(&client->xdna->ddev, &args, client->filp);
+		if (IS_ERR(abo))
+			goto free_bufs;
+		priv->cmd_buf[i] = abo;
+	}
+	priv->cmd_buf_free = priv->cmd_buf_cnt;
+	XDNA_DBG(client->xdna, "%s %d command bufs from 0x%llx", ctx->name,
+		 priv->cmd_buf_cnt, priv->cmd_buf[0]->mem.dev_addr);
+	return 0;
+
+free_bufs:
+	while (i--)
+		drm_gem_object_put(to_gobj(priv->cmd_buf[i]));
+	return PTR_ERR(abo);
+}
+
+static void aie2_sealed_chain_release(struct kref *ref)
+{
+	struct amdxdna_sealed_chain *sc;
+	u32 i;
+
+	sc = container_of(ref, struct amdxdna_sealed_chain, refcnt);
+	for (i = 0; i < sc->count; i++) {
+		if (sc->slots[i].abo)
+			amdxdna_gem_put_obj(sc->slots[i].abo);
+	}
+	if (sc->buf)
+		aie2_cmd_buf_give(sc->ctx->priv, sc->buf);
+	amdxdna_gem_put_obj(sc->cmd_abo);
+	kfree(sc);
+}
+
+static void aie2_sealed_chain_put(struct amdxdna_sealed_chain *sc)
+{
+	kref_put(&sc->refcnt, aie2_sealed_chain_release);
+}
+
+/*
+ * The chain BO still lists the sub-commands it was sealed with. A handle
+ * closed and reused since then names another BO, so compare the BOs, and
+ * their payload sizes which fix the slot layout.
+ */
+static bool aie2_sealed_chain_match(struct amdxdna_client *client,
+				    struct amdxdna_sealed_chain *sc)
+{
+	struct amdxdna_cmd_chain *payload;
+	struct amdxdna_gem_obj *abo;
+	u32 payload_len;
+	bool match;
+	u32 i;
+
+	payload = amdxdna_cmd_get_payload(sc->cmd_abo, &payload_len);
+	if (!payload || payload->command_count != sc->count ||
+	    payload_len < struct_size(payload, data, sc->count))
+		return false;
+
+	for (i = 0; i < sc->count; i++) {
+		struct aie2_sealed_slot *slot = &sc->slots[i];
+
+		if ((u32)payload->data[i] != slot->hdl)
+			return false;
+
+		abo = amdxdna_gem_get_obj(client, slot->hdl, AMDXDNA_BO_CMD);
+		if (!abo)
+			return false;
+		match = abo == slot->abo;
+		amdxdna_gem_put_obj(abo);
+		if (!match)
+			return false;
+
+		if (!amdxdna_cmd_get_payload(slot->abo, &payload_len) ||
+		    payload_len != slot->payload_len)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Returns the sealed chain of the command BO with a reference held, or NULL
+ * if the job has to encode the chain by itself.
+ */
+static struct amdxdna_sealed_chain *
+aie2_sealed_chain_get(struct amdxdna_ctx *ctx, struct amdxdna_gem_obj *cmd_abo)
+{
+	struct amdxdna_ctx_priv *priv = ctx->priv;
+	struct amdxdna_sealed_chain *sc, *found = NULL;
+
+	spin_lock(&priv->sealed_lock);
+	list_for_each_entry(sc, &priv->sealed_list, node) {
+		if (sc->cmd_abo != cmd_abo)
+			continue;
+
+		if (!atomic_cmpxchg(&sc->busy, 0, 1)) {
+			kref_get(&sc->refcnt);
+			found = sc;
+		}
+		break;
+	}
+	spin_unlock(&priv->sealed_lock);
+
+	/* Handle lookups take the GEM table lock, match outside sealed_lock */
+	if (found && !aie2_sealed_chain_match(ctx->client, found)) {
+		atomic_set_release(&found->busy, 0);
+		aie2_sealed_chain_put(found);
+		found = NULL;
+	}
+	return found;
+}
+
+static void aie2_cmd_buf_put(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job)
+{
+	struct amdxdna_ctx_priv *priv = ctx->priv;
+
+	if (job->sealed) {
+		atomic_set_release(&job->sealed->busy, 0);
+		aie2_sealed_chain_put(job->sealed);
+		job->sealed = NULL;
+		return;
+	}
+
+	if (!job->cmd_buf)
+		return;
+
+	aie2_cmd_buf_give(priv, job->cmd_buf);
+	job->cmd_buf = NULL;
+}
+
+/*
+ * A job failing to send or a NOOP completes while jobs before it may still
+ * run in firmware. The status page only moves over seqs whose jobs are all
+ * done, so it never shows a command done before the ones ahead of it.
+ */
+static void aie2_ctx_status_advance(struct amdxdna_ctx *ctx, u64 seq)
+{
+	struct amdxdna_ctx_priv *priv = ctx->priv;
+	u64 submitted, done;
+
+	if (!ctx->status)
+		return;
+
+	spin_lock(&priv->status_lock);
+	/* Pairs with the release in aie2_cmd_submit(), pending is set first */
+	submitted = smp_load_acquire(&ctx->submitted);
+	done = priv->status_done;
+	while (done < submitted && !READ_ONCE(priv->pending[get_job_idx(priv, done)]))
+		done++;
+	priv->status_done = done;
+	amdxdna_ctx_status_update(ctx, done, seq);
+	spin_unlock(&priv->status_lock);
+}
+
 static void
 aie2_sched_notify(struct amdxdna_sched_job *job)
 {
@@ -167,8 +382,10 @@ aie2_sched_notify(struct amdxdna_sched_job *job)
 	job->job_done = true;
 	dma_fence_signal(fence);
 	aie2_rq_yield(ctx);
-	idx = get_job_idx(job->seq);
-	ctx->priv->pending[idx] = NULL;
+	idx = get_job_idx(ctx->priv, job->seq);
+	WRITE_ONCE(ctx->priv->pending[idx], NULL);
+	aie2_ctx_status_advance(ctx, job->seq);
+	aie2_cmd_buf_put(ctx, job);
 	up(&job->ctx->priv->job_sem);
 	dma_fence_put(fence);
 	mmput_async(job->mm);
@@ -280,45 +497,73 @@ out:
 	return ret;
 }
 
-static struct dma_fence *
-aie2_sched_job_run(struct drm_sched_job *sched_job)
+/*
+ * The next job of the context runs right after this one if another job is
+ * queued and no queued job was submitted with a dependency. Both counts are
+ * kept by the submit path. The job semaphore keeps queued plus running jobs
+ * within the scheduler credit limit, so credits never hold it back.
+ * This is only a hint, the mailbox notifies firmware in time regardless.
+ */
+static bool aie2_sched_next_job_ready(struct amdxdna_ctx *ctx)
 {
-	struct amdxdna_sched_job *job = drm_job_to_xdna_job(sched_job);
-	struct amdxdna_gem_obj *cmd_abo = job->cmd_bo;
-	struct amdxdna_ctx *ctx = job->ctx;
-	struct dma_fence *fence;
-	int ret = 0;
-
-	trace_xdna_job(sched_job, ctx->name, "job run", job->seq, job->opcode);
+	if (!tx_batch)
+		return false;
 
-	if (!mmget_not_zero(job->mm))
-		return ERR_PTR(-ESRCH);
+	return atomic_read(&ctx->priv->sched_queued) > 1 &&
+	       !atomic_read(&ctx->priv->sched_waiting);
+}
 
-	kref_get(&job->refcnt);
-	fence = dma_fence_get(job->fence);
+/* Send the job to firmware, aie2_sched_notify() is called when it is done */
+static int aie2_job_send(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job)
+{
+	struct amdxdna_gem_obj *cmd_abo = job->cmd_bo;
 
 	switch (job->opcode) {
 	case OP_SYNC_BO:
-		ret = aie2_sync_bo(ctx, job, aie2_sched_nocmd_resp_handler);
-		goto out;
+		return aie2_sync_bo(ctx, job, aie2_sched_nocmd_resp_handler);
 	case OP_REG_DEBUG_BO:
 	case OP_UNREG_DEBUG_BO:
-		ret = aie2_config_debug_bo(ctx, job, aie2_sched_nocmd_resp_handler);
-		goto out;
+		return aie2_config_debug_bo(ctx, job, aie2_sched_nocmd_resp_handler);
 	case OP_NOOP:
 		// Call notify since we did not really send it down
 		aie2_sched_notify(job);
-		goto out;
+		return 0;
 	}
 
+	if (job->sealed)
+		return aie2_cmdlist_sealed_execbuf(ctx, job, aie2_sched_cmdlist_resp_handler);
 	if (amdxdna_cmd_get_op(cmd_abo) == ERT_CMD_CHAIN)
-		ret = aie2_cmdlist_multi_execbuf(ctx, job, aie2_sched_cmdlist_resp_handler);
-	else if (force_cmdlist)
-		ret = aie2_cmdlist_single_execbuf(ctx, job, aie2_sched_cmdlist_resp_handler);
-	else
-		ret = aie2_execbuf(ctx, job, aie2_sched_resp_handler);
+		return aie2_cmdlist_multi_execbuf(ctx, job, aie2_sched_cmdlist_resp_handler);
+	if (job->cmd_buf)
+		return aie2_cmdlist_single_execbuf(ctx, job, aie2_sched_cmdlist_resp_handler);
+	return aie2_execbuf(ctx, job, aie2_sched_resp_handler);
+}
 
-out:
+static struct dma_fence *
+aie2_sched_job_run(struct drm_sched_job *sched_job)
+{
+	struct amdxdna_sched_job *job = drm_job_to_xdna_job(sched_job);
+	struct amdxdna_ctx *ctx = job->ctx;
+	struct dma_fence *fence;
+	int ret;
+
+	trace_xdna_job(sched_job, ctx->name, "job run", job->seq, job->opcode);
+	/* Its dependencies are signaled now */
+	if (job->has_deps)
+		atomic_dec(&ctx->priv->sched_waiting);
+
+	if (!mmget_not_zero(job->mm)) {
+		atomic_dec_return_release(&ctx->priv->sched_queued);
+		return ERR_PTR(-ESRCH);
+	}
+
+	kref_get(&job->refcnt);
+	fence = dma_fence_get(job->fence);
+	job->msg_more = aie2_sched_next_job_ready(ctx);
+
+	ret = aie2_job_send(ctx, job);
+	/* Sent, a direct submission may follow it now */
+	atomic_dec_return_release(&ctx->priv->sched_queued);
 	if (ret) {
 		dma_fence_put(job->fence);
 		aie2_job_put(job);
@@ -342,9 +587,10 @@ static void aie2_sched_job_free(struct drm_sched_job *sched_job)
 	if (!job->job_done) {
 		int idx;
 
-		idx = get_job_idx(job->seq);
+		idx = get_job_idx(ctx->priv, job->seq);
 		/* No contention with submit, no lock */
 		ctx->priv->pending[idx] = NULL;
+		aie2_cmd_buf_put(ctx, job);
 		up(&ctx->priv->job_sem);
 	}
 
@@ -485,17 +731,38 @@ int aie2_ctx_init(struct amdxdna_ctx *ctx)
 	struct amdxdna_ctx_priv *priv;
 	struct amdxdna_gem_obj *heap;
 	unsigned int wq_flags;
-	int i, ret;
+	u32 max_cmds, i;
+	int ret;
 
 	priv = kzalloc(sizeof(*ctx->priv), GFP_KERNEL);
 	if (!priv)
 		return -ENOMEM;
 	ctx->priv = priv;
 
+	/* Both limits are power of 2, rounding up never goes beyond max_cmds */
+	max_cmds = clamp_t(u32, ctx_max_cmds, CTX_DEFAULT_CMDS, CTX_MAX_CMDS_LIMIT);
+	max_cmds = rounddown_pow_of_two(max_cmds);
+	if (!ctx->max_cmds)
+		ctx->max_cmds = CTX_DEFAULT_CMDS;
+	priv->num_cmds = roundup_pow_of_two(min(ctx->max_cmds, max_cmds));
+	ctx->max_cmds = priv->num_cmds;
+
+	priv->pending = kcalloc(priv->num_cmds, sizeof(*priv->pending), GFP_KERNEL);
+	priv->cmd_buf_cnt = priv->num_cmds + CTX_MAX_SEALED_CHAINS;
+	priv->cmd_buf = kcalloc(priv->cmd_buf_cnt, sizeof(*priv->cmd_buf), GFP_KERNEL);
+	if (!priv->pending || !priv->cmd_buf) {
+		ret = -ENOMEM;
+		goto free_arrays;
+	}
+	spin_lock_init(&priv->cmd_buf_lock);
+	spin_lock_init(&priv->sealed_lock);
+	spin_lock_init(&priv->status_lock);
+	INIT_LIST_HEAD(&priv->sealed_list);
+
 	ret = aie2_ctx_col_list(ctx);
 	if (ret) {
 		XDNA_ERR(xdna, "Create col list failed, ret %d", ret);
-		goto free_priv;
+		goto free_arrays;
 	}
 
 	mutex_lock(&client->mm_lock);
@@ -509,7 +776,7 @@ int aie2_ctx_init(struct amdxdna_ctx *ctx)
 	drm_gem_object_get(to_gobj(heap));
 	mutex_unlock(&client->mm_lock);
 	priv->heap = heap;
-	sema_init(&priv->job_sem, CTX_MAX_CMDS);
+	sema_init(&priv->job_sem, priv->num_cmds);
 
 	ret = amdxdna_gem_pin(heap);
 	if (ret) {
@@ -517,27 +784,14 @@ int aie2_ctx_init(struct amdxdna_ctx *ctx)
 		goto put_heap;
 	}
 
-	for (i = 0; i < ARRAY_SIZE(priv->cmd_buf); i++) {
-		struct amdxdna_gem_obj *abo;
-		struct amdxdna_drm_create_bo args = {
-			.flags = 0,
-			.type = AMDXDNA_BO_DEV,
-			.vaddr = 0,
-			.size = MAX_CHAIN_CMDBUF_SIZE,
-		};
-
-		abo = amdxdna_drm_create_dev_bo(&xdna->ddev, &args, client->filp);
-		if (IS_ERR(abo)) {
-			ret = PTR_ERR(abo);
-			goto free_cmd_bufs;
-		}
-
-		XDNA_DBG(xdna, "Command buf %d addr 0x%llx size 0x%lx",
-			 i, abo->mem.dev_addr, abo->mem.size);
-		priv->cmd_buf[i] = abo;
+	ret = aie2_cmd_bufs_alloc(ctx);
+	if (ret) {
+		XDNA_ERR(xdna, "Alloc command bufs failed, ret %d", ret);
+		goto unpin_heap;
 	}
 
 	mutex_init(&priv->io_lock);
+	mutex_init(&priv->submit_lock);
 	init_waitqueue_head(&priv->job_free_waitq);
 
 	fs_reclaim_acquire(GFP_KERNEL);
@@ -550,7 +804,8 @@ int aie2_ctx_init(struct amdxdna_ctx *ctx)
 	priv->submit_wq = alloc_workqueue(ctx->name, wq_flags, 1);
 	if (!priv->submit_wq) {
 		XDNA_ERR(xdna, "Failed to alloc submit wq");
-		goto free_cmd_bufs;
+		ret = -ENOMEM;
+		goto put_cmd_bufs;
 	}
 
 	ret = aie2_ctx_syncobj_create(ctx);
@@ -568,25 +823,25 @@ int aie2_ctx_init(struct amdxdna_ctx *ctx)
 	atomic64_set(&priv->job_pending_cnt, 0);
 	init_waitqueue_head(&priv->connect_waitq);
 
-	XDNA_DBG(xdna, "ctx %s init completed", ctx->name);
+	XDNA_DBG(xdna, "ctx %s init completed, max cmds %d", ctx->name, priv->num_cmds);
 	return 0;
 
 destroy_syncobj:
 	aie2_ctx_syncobj_destroy(ctx);
 free_wq:
 	destroy_workqueue(priv->submit_wq);
-free_cmd_bufs:
-	for (i = 0; i < ARRAY_SIZE(priv->cmd_buf); i++) {
-		if (!priv->cmd_buf[i])
-			continue;
+put_cmd_bufs:
+	for (i = 0; i < priv->cmd_buf_cnt; i++)
 		drm_gem_object_put(to_gobj(priv->cmd_buf[i]));
-	}
+unpin_heap:
 	amdxdna_gem_unpin(heap);
 put_heap:
 	drm_gem_object_put(to_gobj(heap));
 free_col_list:
 	kfree(ctx->col_list);
-free_priv:
+free_arrays:
+	kfree(priv->cmd_buf);
+	kfree(priv->pending);
 	kfree(priv);
 	return ret;
 }
@@ -594,13 +849,20 @@ free_priv:
 void aie2_ctx_fini(struct amdxdna_ctx *ctx)
 {
 	struct amdxdna_dev *xdna = ctx->client->xdna;
+	struct amdxdna_sealed_chain *sc, *tmp;
 	int idx;
 
 	aie2_rq_del(&xdna->dev_handle->ctx_rq, ctx);
 
 	destroy_workqueue(ctx->priv->submit_wq);
 	aie2_ctx_syncobj_destroy(ctx);
-	for (idx = 0; idx < ARRAY_SIZE(ctx->priv->cmd_buf); idx++)
+	list_for_each_entry_safe(sc, tmp, &ctx->priv->sealed_list, node) {
+		list_del(&sc->node);
+		aie2_sealed_chain_put(sc);
+	}
+	/* All jobs and chains are freed, every command buffer is back to the free list */
+	drm_WARN_ON(&xdna->ddev, ctx->priv->cmd_buf_free != ctx->priv->cmd_buf_cnt);
+	for (idx = 0; idx < ctx->priv->cmd_buf_free; idx++)
 		drm_gem_object_put(to_gobj(ctx->priv->cmd_buf[idx]));
 	amdxdna_gem_unpin(ctx->priv->heap);
 	drm_gem_object_put(to_gobj(ctx->priv->heap));
@@ -615,7 +877,10 @@ void aie2_ctx_fini(struct amdxdna_ctx *ctx)
 	XDNA_DBG(xdna, "%s total completed jobs %lld",
 		 ctx->name, ctx->completed);
 	mutex_destroy(&ctx->priv->io_lock);
+	mutex_destroy(&ctx->priv->submit_lock);
 	kfree(ctx->col_list);
+	kfree(ctx->priv->cmd_buf);
+	kfree(ctx->priv->pending);
 	kfree(ctx->priv);
 	kfree(ctx->cus);
 }
@@ -736,6 +1001,130 @@ static int aie2_ctx_detach_debug_bo(struct amdxdna_ctx *ctx, u32 bo_hdl)
 	return ret;
 }
 
+static int aie2_ctx_seal_chain(struct amdxdna_ctx *ctx, u32 hdl)
+{
+	struct amdxdna_client *client = ctx->client;
+	struct amdxdna_ctx_priv *priv = ctx->priv;
+	struct amdxdna_dev *xdna = client->xdna;
+	struct amdxdna_sealed_chain *sc, *tmp;
+	struct amdxdna_cmd_chain *payload;
+	struct amdxdna_gem_obj *cmd_abo;
+	u32 payload_len;
+	bool counted = false;
+	u32 count = 0;
+	int ret = 0;
+
+	cmd_abo = amdxdna_gem_get_obj(client, hdl, AMDXDNA_BO_CMD);
+	if (!cmd_abo) {
+		XDNA_ERR(xdna, "Get cmd bo %d failed", hdl);
+		return -EINVAL;
+	}
+
+	payload = amdxdna_cmd_get_payload(cmd_abo, &payload_len);
+	if (payload)
+		count = READ_ONCE(payload->command_count);
+	if (amdxdna_cmd_get_op(cmd_abo) != ERT_CMD_CHAIN || !count ||
+	    payload_len < struct_size(payload, data, count)) {
+		XDNA_ERR(xdna, "Cmd bo %d is not a valid command chain", hdl);
+		amdxdna_gem_put_obj(cmd_abo);
+		return -EINVAL;
+	}
+
+	sc = kzalloc(struct_size(sc, slots, count), GFP_KERNEL);
+	if (!sc) {
+		amdxdna_gem_put_obj(cmd_abo);
+		return -ENOMEM;
+	}
+	sc->count = count;
+	sc->cmd_abo = cmd_abo;
+	sc->ctx = ctx;
+	kref_init(&sc->refcnt);
+
+	/* Count the chain before taking its buffer, see aie2_cmd_buf_take() */
+	spin_lock(&priv->sealed_lock);
+	if (priv->sealed_cnt == CTX_MAX_SEALED_CHAINS)
+		ret = -ENOSPC;
+	else
+		priv->sealed_cnt++;
+	spin_unlock(&priv->sealed_lock);
+	if (ret)
+		goto put_sc;
+	counted = true;
+
+	sc->buf = aie2_cmd_buf_take(priv);
+	if (drm_WARN_ON(&xdna->ddev, !sc->buf)) {
+		ret = -EBUSY;
+		goto put_sc;
+	}
+
+	ret = aie2_cmdlist_seal(client, sc, payload);
+	if (ret)
+		goto put_sc;
+
+	spin_lock(&priv->sealed_lock);
+	list_for_each_entry(tmp, &priv->sealed_list, node) {
+		if (tmp->cmd_abo == cmd_abo) {
+			ret = -EEXIST;
+			break;
+		}
+	}
+	if (!ret)
+		list_add(&sc->node, &priv->sealed_list);
+	spin_unlock(&priv->sealed_lock);
+	if (ret)
+		goto put_sc;
+
+	XDNA_DBG(xdna, "%s sealed cmd bo %d, %d commands, size 0x%x",
+		 ctx->name, hdl, sc->count, sc->size);
+	return 0;
+
+put_sc:
+	XDNA_ERR(xdna, "Seal cmd bo %d failed, ret %d", hdl, ret);
+	aie2_sealed_chain_put(sc);
+	/* Uncount only once the buffer is back */
+	if (counted) {
+		spin_lock(&priv->sealed_lock);
+		priv->sealed_cnt--;
+		spin_unlock(&priv->sealed_lock);
+	}
+	return ret;
+}
+
+static int aie2_ctx_unseal_chain(struct amdxdna_ctx *ctx, u32 hdl)
+{
+	struct amdxdna_sealed_chain *sc, *found = NULL;
+	struct amdxdna_client *client = ctx->client;
+	struct amdxdna_ctx_priv *priv = ctx->priv;
+	struct amdxdna_gem_obj *cmd_abo;
+
+	cmd_abo = amdxdna_gem_get_obj(client, hdl, AMDXDNA_BO_CMD);
+	if (!cmd_abo) {
+		XDNA_ERR(client->xdna, "Get cmd bo %d failed", hdl);
+		return -EINVAL;
+	}
+
+	spin_lock(&priv->sealed_lock);
+	list_for_each_entry(sc, &priv->sealed_list, node) {
+		if (sc->cmd_abo == cmd_abo) {
+			list_del(&sc->node);
+			found = sc;
+			break;
+		}
+	}
+	spin_unlock(&priv->sealed_lock);
+	amdxdna_gem_put_obj(cmd_abo);
+
+	if (!found)
+		return -ENOENT;
+
+	/* A job in flight holds its own reference, and counts for the buffer */
+	aie2_sealed_chain_put(found);
+	spin_lock(&priv->sealed_lock);
+	priv->sealed_cnt--;
+	spin_unlock(&priv->sealed_lock);
+	return 0;
+}
+
 int aie2_ctx_config(struct amdxdna_ctx *ctx, u32 type, u64 value, void *buf, u32 size)
 {
 	struct amdxdna_dev *xdna = ctx->client->xdna;
@@ -747,6 +1136,10 @@ int aie2_ctx_config(struct amdxdna_ctx *ctx, u32 type, u64 value, void *buf, u32
 		return aie2_ctx_attach_debug_bo(ctx, (u32)value);
 	case DRM_AMDXDNA_CTX_REMOVE_DBG_BUF:
 		return aie2_ctx_detach_debug_bo(ctx, (u32)value);
+	case DRM_AMDXDNA_CTX_SEAL_CHAIN:
+		return aie2_ctx_seal_chain(ctx, (u32)value);
+	case DRM_AMDXDNA_CTX_UNSEAL_CHAIN:
+		return aie2_ctx_unseal_chain(ctx, (u32)value);
 	default:
 		XDNA_DBG(xdna, "Not supported type %d", type);
 		return -EOPNOTSUPP;
@@ -846,6 +1239,90 @@ static int aie2_add_job_dependency(struct amdxdna_sched_job *job, u32 *syncobj_h
 	return ret;
 }
 
+/* The first BO of the job which has its user pages invalidated */
+static struct amdxdna_gem_obj *aie2_job_invalid_bo(struct amdxdna_sched_job *job)
+{
+	struct amdxdna_gem_obj *abo;
+	int i;
+
+	for (i = 0; i < job->bo_cnt; i++) {
+		/* Resident object of the client, no backing store */
+		if (job->bos[i].obj == job->ctx->client->resident_obj)
+			continue;
+		abo = to_xdna_obj(job->bos[i].obj);
+		if (abo->mem.map_invalid)
+			return abo;
+	}
+	return NULL;
+}
+
+/*
+ * A job may skip the DRM scheduler when nothing orders it after another
+ * fence. It has no syncobj dependency and no earlier job of the context is
+ * still waiting in the scheduler. Called with submit_lock held, so only the
+ * scheduler thread changes sched_queued meanwhile and only downwards.
+ */
+static bool aie2_job_is_direct(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
+			       u32 syncobj_cnt)
+{
+	if (!direct_submit || syncobj_cnt || job->opcode != OP_USER)
+		return false;
+
+	return !atomic_read_acquire(&ctx->priv->sched_queued);
+}
+
+static void aie2_job_notify_work(struct work_struct *work)
+{
+	struct amdxdna_sched_job *job;
+
+	job = container_of(work, struct amdxdna_sched_job, notify_work);
+	aie2_sched_notify(job);
+}
+
+/* Called with the fence lock held, notify may sleep */
+static void aie2_job_prev_done(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct amdxdna_sched_job *job;
+
+	job = container_of(cb, struct amdxdna_sched_job, prev_cb);
+	queue_work(system_wq, &job->notify_work);
+}
+
+/*
+ * Send a direct job from the submit ioctl, what aie2_sched_job_run() does
+ * for the other ones. The job reference for the run is already taken. A
+ * job that fails to send is completed as aborted, as far as user space is
+ * concerned it was submitted. Fences of the context signal in seq order,
+ * so it is completed once the job before it is, which may still run.
+ */
+static void aie2_job_direct_run(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job)
+{
+	struct dma_fence *prev = NULL;
+	int ret;
+
+	trace_xdna_job(&job->base, ctx->name, "job run direct", job->seq, job->opcode);
+	mmget(job->mm);
+	ret = aie2_job_send(ctx, job);
+	if (ret) {
+		XDNA_ERR(ctx->client->xdna, "%s direct send failed, ret %d", ctx->name, ret);
+		if (job->cmd_bo)
+			amdxdna_cmd_set_state(job->cmd_bo, ERT_CMD_STATE_ABORT);
+		dma_fence_set_error(job->fence, ret);
+
+		if (job->seq)
+			prev = aie2_cmd_get_out_fence(ctx, job->seq - 1);
+		INIT_WORK(&job->notify_work, aie2_job_notify_work);
+		if (!prev || dma_fence_add_callback(prev, &job->prev_cb, aie2_job_prev_done))
+			aie2_sched_notify(job);
+		dma_fence_put(prev);
+		return;
+	}
+	atomic64_inc(&ctx->client->xdna->submit_stats.direct);
+#ifdef AMDXDNA_DRM_USAGE
+	amdxdna_update_stats(ctx->client, ktime_get(), true);
+#endif
+}
+
 int aie2_cmd_submit(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 		    u32 *syncobj_hdls, u64 *syncobj_points, u32 syncobj_cnt, u64 *seq)
 {
@@ -854,6 +1331,7 @@ int aie2_cmd_submit(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 	struct dma_fence_chain *chain;
 	struct amdxdna_gem_obj *abo;
 	unsigned long timeout = 0;
+	bool direct;
 	int ret, i;
 
 	ret = down_interruptible(&ctx->priv->job_sem);
@@ -862,10 +1340,30 @@ int aie2_cmd_submit(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 		return ret;
 	}
 
+	if (aie2_job_use_cmdlist(job)) {
+		job->sealed = aie2_sealed_chain_get(ctx, job->cmd_bo);
+		ret = job->sealed ? 0 : aie2_cmd_buf_get(ctx, job);
+		if (ret) {
+			XDNA_ERR(xdna, "Get command buf failed, ret %d", ret);
+			goto up_job_sem;
+		}
+	}
+
 	ret = aie2_rq_submit_enter(&xdna->dev_handle->ctx_rq, ctx);
 	if (ret) {
 		XDNA_ERR(xdna, "Submit enter failed, ret %d", ret);
-		goto up_job_sem;
+		goto put_cmd_buf;
+	}
+
+	/* Heap chunks added after the context was connected */
+	if (READ_ONCE(ctx->priv->heap_mapped) < smp_load_acquire(&ctx->client->nr_heap_usable)) {
+		mutex_lock(&xdna->dev_handle->aie2_lock);
+		ret = aie2_hwctx_map_heap(ctx);
+		mutex_unlock(&xdna->dev_handle->aie2_lock);
+		if (ret) {
+			XDNA_ERR(xdna, "Map heap chunk failed, ret %d", ret);
+			goto rq_yield;
+		}
 	}
 
 	chain = dma_fence_chain_alloc();
@@ -873,17 +1371,25 @@ int aie2_cmd_submit(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 		ret = -ENOMEM;
 		goto rq_yield;
 	}
+	atomic64_inc(&xdna->submit_stats.chain_alloc);
 
-	ret = drm_sched_job_init(&job->base, &ctx->priv->entity, 1, ctx);
-	if (ret) {
-		XDNA_ERR(xdna, "DRM job init failed, ret %d", ret);
-		goto free_chain;
-	}
+	/* Keeps direct sends in seq order with the jobs pushed to the scheduler */
+	if (direct_submit)
+		mutex_lock(&ctx->priv->submit_lock);
 
-	ret = aie2_add_job_dependency(job, syncobj_hdls, syncobj_points, syncobj_cnt);
-	if (ret) {
-		XDNA_ERR(xdna, "Failed to add dependency, ret %d", ret);
-		goto cleanup_job;
+	direct = aie2_job_is_direct(ctx, job, syncobj_cnt);
+	if (!direct) {
+		ret = drm_sched_job_init(&job->base, &ctx->priv->entity, 1, ctx);
+		if (ret) {
+			XDNA_ERR(xdna, "DRM job init failed, ret %d", ret);
+			goto unlock_submit;
+		}
+
+		ret = aie2_add_job_dependency(job, syncobj_hdls, syncobj_points, syncobj_cnt);
+		if (ret) {
+			XDNA_ERR(xdna, "Failed to add dependency, ret %d", ret);
+			goto cleanup_job;
+		}
 	}
 
 retry:
@@ -894,6 +1400,8 @@ retry:
 	}
 
 	for (i = 0; i < job->bo_cnt; i++) {
+		if (job->bos[i].shared_resv)
+			continue;
 		ret = dma_resv_reserve_fences(job->bos[i].obj->resv, 1);
 		if (ret) {
 			XDNA_WARN(xdna, "Failed to reserve fences %d", ret);
@@ -903,35 +1411,51 @@ retry:
 	}
 
 	down_read(&xdna->notifier_lock);
-	for (i = 0; i < job->bo_cnt; i++) {
-		abo = to_xdna_obj(job->bos[i].obj);
-		if (abo->mem.map_invalid) {
-			up_read(&xdna->notifier_lock);
-			amdxdna_unlock_objects(job, &acquire_ctx);
-			if (!timeout) {
-				timeout = jiffies +
-					msecs_to_jiffies(HMM_RANGE_DEFAULT_TIMEOUT);
-			} else if (time_after(jiffies, timeout)) {
-				ret = -ETIME;
-				goto cleanup_job;
-			}
-
-			ret = aie2_populate_range(abo);
-			if (ret)
-				goto cleanup_job;
-			goto retry;
+	abo = aie2_job_invalid_bo(job);
+	if (abo) {
+		up_read(&xdna->notifier_lock);
+		amdxdna_unlock_objects(job, &acquire_ctx);
+		if (!timeout) {
+			timeout = jiffies +
+				msecs_to_jiffies(HMM_RANGE_DEFAULT_TIMEOUT);
+		} else if (time_after(jiffies, timeout)) {
+			ret = -ETIME;
+			goto cleanup_job;
 		}
+
+		ret = aie2_populate_range(abo);
+		if (ret)
+			goto cleanup_job;
+		goto retry;
 	}
 
 	mutex_lock(&ctx->priv->io_lock);
-	drm_sched_job_arm(&job->base);
-	job->out_fence = dma_fence_get(&job->base.s_fence->finished);
-	for (i = 0; i < job->bo_cnt; i++)
-		dma_resv_add_fence(job->bos[i].obj->resv, job->out_fence, DMA_RESV_USAGE_WRITE);
-	job->seq = ctx->submitted++;
-	ctx->priv->pending[get_job_idx(job->seq)] = job;
+	job->seq = ctx->submitted;
+	/* Fences of the context share fence_ctx, seqno keeps them apart */
+	job->fence->seqno = job->seq + 1;
+	if (direct) {
+		job->out_fence = dma_fence_get(job->fence);
+	} else {
+		drm_sched_job_arm(&job->base);
+		job->out_fence = dma_fence_get(&job->base.s_fence->finished);
+	}
+	for (i = 0; i < job->bo_cnt; i++) {
+		if (!job->bos[i].shared_resv)
+			dma_resv_add_fence(job->bos[i].obj->resv, job->out_fence,
+					   DMA_RESV_USAGE_WRITE);
+	}
+	ctx->priv->pending[get_job_idx(ctx->priv, job->seq)] = job;
+	/* The status page reads pending up to submitted without io_lock */
+	smp_store_release(&ctx->submitted, job->seq + 1);
+	/* Scheduler reference dropped in free_job, direct run one in notify */
 	kref_get(&job->refcnt);
-	drm_sched_entity_push_job(&job->base);
+	if (!direct) {
+		job->has_deps = !!syncobj_cnt;
+		if (job->has_deps)
+			atomic_inc(&ctx->priv->sched_waiting);
+		atomic_inc(&ctx->priv->sched_queued);
+		drm_sched_entity_push_job(&job->base);
+	}
 
 	*seq = job->seq;
 	drm_syncobj_add_point(ctx->priv->syncobj, chain, job->out_fence, *seq);
@@ -939,6 +1463,10 @@ retry:
 
 	up_read(&xdna->notifier_lock);
 	amdxdna_unlock_objects(job, &acquire_ctx);
+	if (direct)
+		aie2_job_direct_run(ctx, job);
+	if (direct_submit)
+		mutex_unlock(&ctx->priv->submit_lock);
 	aie2_rq_submit_exit(ctx);
 
 	aie2_job_put(job);
@@ -946,12 +1474,18 @@ retry:
 	return 0;
 
 cleanup_job:
-	drm_sched_job_cleanup(&job->base);
+	if (!direct)
+		drm_sched_job_cleanup(&job->base);
+unlock_submit:
+	if (direct_submit)
+		mutex_unlock(&ctx->priv->submit_lock);
 free_chain:
 	dma_fence_chain_free(chain);
 rq_yield:
 	aie2_rq_yield(ctx);
 	aie2_rq_submit_exit(ctx);
+put_cmd_buf:
+	aie2_cmd_buf_put(ctx, job);
 up_job_sem:
 	up(&ctx->priv->job_sem);
 	job->job_done = true;
@@ -999,10 +1533,20 @@ void aie2_hmm_invalidate(struct amdxdna_gem_obj *abo, unsigned long cur_seq)
 {
 	struct amdxdna_dev *xdna = to_xdna_dev(to_gobj(abo)->dev);
 	struct drm_gem_object *gobj = to_gobj(abo);
+	struct drm_gem_object *robj;
 	long ret;
 
 	ret = dma_resv_wait_timeout(gobj->resv, DMA_RESV_USAGE_BOOKKEEP,
 				    true, MAX_SCHEDULE_TIMEOUT);
 	if (!ret || ret == -ERESTARTSYS)
 		XDNA_ERR(xdna, "Failed to wait for bo, ret %ld", ret);
+
+	/* Resident submits fence the BO through the resident object */
+	robj = READ_ONCE(abo->resident_obj);
+	if (!robj)
+		return;
+	ret = dma_resv_wait_timeout(robj->resv, DMA_RESV_USAGE_BOOKKEEP,
+				    true, MAX_SCHEDULE_TIMEOUT);
+	if (!ret || ret == -ERESTARTSYS)
+		XDNA_ERR(xdna, "Failed to wait for resident bo, ret %ld", ret);
 }
@@ -56,6 +56,41 @@ static inline bool ctx_should_stop(struct amdxdna_ctx *ctx)
 		ctx_is_debug(ctx);
 }
 
+static inline u32 ctx_prio_level(struct amdxdna_ctx *ctx)
+{
+	return ctx->qos.priority - 1;
+}
+
+static inline bool ctx_is_deadline(struct amdxdna_ctx *ctx)
+{
+	return ctx->priv->dl.deadline_ms;
+}
+
+/* Should not wait for another context to finish its residency */
+static inline bool ctx_is_urgent(struct amdxdna_ctx *ctx)
+{
+	return ctx_is_deadline(ctx) || ctx->qos.priority == AMDXDNA_QOS_REALTIME_PRIORITY;
+}
+
+/* Idle contexts and those not in the deadline class have no deadline */
+static ktime_t ctx_deadline(struct amdxdna_ctx *ctx)
+{
+	if (!ctx_is_deadline(ctx))
+		return KTIME_MAX;
+
+	if (READ_ONCE(ctx->submitted) == READ_ONCE(ctx->completed) &&
+	    !atomic64_read(&ctx->priv->job_pending_cnt))
+		return KTIME_MAX;
+
+	return READ_ONCE(ctx->priv->deadline);
+}
+
+static bool ctx_deadline_before(struct list_head *a, struct list_head *b)
+{
+	return ktime_before(ctx_deadline(list_entry(a, struct amdxdna_ctx, entry)),
+			    ctx_deadline(list_entry(b, struct amdxdna_ctx, entry)));
+}
+
 static inline bool rq_connect_is_full(struct aie2_ctx_rq *rq)
 {
 	WARN_ON(rq->hwctx_cnt > rq->hwctx_limit);
@@ -65,32 +100,14 @@ static inline bool rq_connect_is_full(struct aie2_ctx_rq *rq)
 static struct amdxdna_ctx *
 select_next_ctx(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
 {
-	struct list_head *q;
-	int i;
-
-	if (!rq->runqueue_total)
-		return NULL;
-
-	i = 0;
-	if (ctx) {
-		if (list_is_last(&ctx->entry, &rq->runqueue[ctx->qos.priority - 1].q))
-			i = ctx->qos.priority;
-		else
-			return list_next_entry(ctx, entry);
-	}
+	struct list_head *node;
 
-	while (i < ARRAY_SIZE(rq->runqueue)) {
-		q = &rq->runqueue[i].q;
-
-		if (!rq->runqueue[i].cnt) {
-			i++;
-			continue;
-		}
-
-		return list_first_entry(q, typeof(*ctx), entry);
-	}
+	if (ctx)
+		node = aie2_prio_list_next(&rq->runqueue, &ctx->entry, ctx_prio_level(ctx));
+	else
+		node = aie2_prio_list_first(&rq->runqueue, 0);
 
-	return NULL;
+	return node ? list_entry(node, struct amdxdna_ctx, entry) : NULL;
 }
 
 static struct amdxdna_ctx *
@@ -100,89 +117,134 @@ select_highest_prio_ctx(struct aie2_ctx_rq *rq)
 }
 
 /*
- * The connected context list is ordered. Use this helper function to
- * maintain the ordering. Use linux list_move*, list_del for removing.
- * The rule for ordering,
- * 1. From rq->conn_list head, context is ordered by priority from high to low
- * 2. For same priority contexts, ordered from new to old
- *
- * This rule make it easy to look for lowest and oldest priority context.
+ * Connected contexts are on conn_prio, newest first within a priority, until
+ * they are asked to yield. The lowest priority and oldest one is the last
+ * entry of the lowest non-empty priority.
  */
 static void
 insert_ctx_to_conn_list(struct aie2_ctx_rq *rq, struct amdxdna_ctx *new)
 {
-	struct amdxdna_ctx *curr;
-	struct list_head *pos;
+	list_move_tail(&new->entry, &rq->conn_list);
+	aie2_prio_list_add(&rq->conn_prio, &new->prio_entry, ctx_prio_level(new));
+	rq->hwctx_cnt++;
+}
 
-	if (list_empty(&rq->conn_list)) {
-		pos = &rq->conn_list;
-		goto out;
-	}
+/*
+ * Lowest priority and oldest context, not higher than next, to yield. Among
+ * realtime contexts, when one of them is in the deadline class, the one with
+ * the latest deadline yields, and only to an earlier deadline.
+ */
+static struct amdxdna_ctx *
+select_ctx_to_block(struct aie2_ctx_rq *rq, struct amdxdna_ctx *next)
+{
+	struct amdxdna_ctx *ctx, *victim = NULL;
+	struct list_head *node;
+	ktime_t latest;
 
-	curr = list_last_entry(&rq->conn_list, typeof(*curr), entry);
-	if (curr->qos.priority < new->qos.priority) {
-		pos = &rq->conn_list;
-		goto out;
-	}
+	node = aie2_prio_list_last(&rq->conn_prio, ctx_prio_level(next));
+	if (!node)
+		return NULL;
 
-	list_for_each_entry(curr, &rq->conn_list, entry) {
-		if (curr->qos.priority < new->qos.priority)
-			continue;
+	ctx = list_entry(node, struct amdxdna_ctx, prio_entry);
+	if (list_empty(&rq->dl_list) || ctx_prio_level(ctx) != ctx_prio_level(next))
+		return ctx;
 
-		/* Insert new context before current */
-		pos = &curr->entry;
-		break;
+	latest = KTIME_MIN;
+	list_for_each_entry_reverse(ctx, &rq->conn_prio.q[ctx_prio_level(next)], prio_entry) {
+		if (ktime_after(ctx_deadline(ctx), latest)) {
+			victim = ctx;
+			latest = ctx_deadline(ctx);
+		}
 	}
 
-out:
-	list_move_tail(&new->entry, pos);
-	rq->hwctx_cnt++;
+	if (latest != KTIME_MAX && !ktime_after(latest, ctx_deadline(next)))
+		return NULL;
+
+	return victim;
 }
 
-static struct amdxdna_ctx *
-select_ctx_to_block(struct aie2_ctx_rq *rq, int prio)
+static void rq_ctx_block(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx,
+			 struct amdxdna_ctx *next)
 {
-	struct amdxdna_ctx *ctx;
+	ctx->priv->should_block = true;
+	ctx->priv->block_urgent = ctx_is_urgent(next);
+	aie2_prio_list_del(&rq->conn_prio, &ctx->prio_entry, ctx_prio_level(ctx));
+}
 
-	list_for_each_entry_reverse(ctx, &rq->conn_list, entry) {
-		if (ctx->qos.priority < prio)
-			continue;
+static void rq_hist_add(struct aie2_switch_hist *hist, u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	u32 i;
 
-		if (ctx->priv->should_block)
-			continue;
+	i = us < 2 ? 0 : min_t(u32, ilog2(us), AMDXDNA_SWITCH_HIST_BUCKETS - 1);
+	hist->bucket[i]++;
+	hist->cnt++;
+	hist->total_ns += ns;
+}
 
-		return ctx;
-	}
+/*
+ * Jiffies until ctx has been connected for the minimum residency, 0 if it has
+ * or if it is blocked for a context that should not wait.
+ */
+static unsigned long rq_ctx_residency_left(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
+{
+	ktime_t end;
+	s64 left;
+
+	if (ctx->priv->block_urgent)
+		return 0;
 
-	return NULL;
+	end = ktime_add_ns(ctx->priv->connect_time, READ_ONCE(rq->residency.min_ns));
+	left = ktime_to_ns(ktime_sub(end, ktime_get()));
+	return left > 0 ? nsecs_to_jiffies(left) + 1 : 0;
+}
+
+static void rq_ctx_yielded(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
+{
+	struct amdxdna_dev *xdna;
+
+	xdna = ctx_rq_to_xdna_dev(rq);
+	ctx->priv->sw.yields++;
+	rq->sw.yields++;
+	if (aie2_residency_yielded(&rq->residency, ctx->priv->last_switch_ns,
+				   ctx->priv->last_resident_ns))
+		XDNA_DBG(xdna, "min residency %lld ns", rq->residency.min_ns);
 }
 
 static void rq_ctx_start(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
 {
 	struct amdxdna_dev *xdna;
+	ktime_t start;
+	u64 ns;
 	int err;
 
 	xdna = ctx_rq_to_xdna_dev(rq);
 	drm_WARN_ON(&xdna->ddev, !mutex_is_locked(&xdna->dev_lock));
 	drm_WARN_ON(&xdna->ddev, !rwsem_is_locked(&ctx->priv->io_sem));
+	aie2_prio_list_del(&rq->runqueue, &ctx->entry, ctx_prio_level(ctx));
+	start = ktime_get();
 	err = aie2_ctx_connect(ctx);
 	if (err) {
 		list_move_tail(&ctx->entry, &rq->disconn_list);
 		ctx->priv->status = CTX_STATE_DEAD;
 		XDNA_ERR(xdna, "%s connect failed, err %d", ctx->name, err);
 	} else {
+		ctx->priv->connect_time = ktime_get();
+		ns = ktime_to_ns(ktime_sub(ctx->priv->connect_time, start));
+		rq_hist_add(&ctx->priv->sw.connect, ns);
+		rq_hist_add(&rq->sw.connect, ns);
+		ctx->priv->last_switch_ns = ns;
 		insert_ctx_to_conn_list(rq, ctx);
 		ctx->priv->status = CTX_STATE_CONNECTED;
 		XDNA_DBG(xdna, "%s connected", ctx->name);
 	}
-
-	rq->runqueue[ctx->qos.priority - 1].cnt--;
-	rq->runqueue_total--;
 }
 
 static void rq_ctx_stop_wait(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx, bool wait)
 {
 	struct amdxdna_dev *xdna;
+	ktime_t start;
+	u64 ns;
 
 	xdna = ctx_rq_to_xdna_dev(rq);
 	drm_WARN_ON(&xdna->ddev, !mutex_is_locked(&xdna->dev_lock));
@@ -191,7 +253,21 @@ static void rq_ctx_stop_wait(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx, bo
 		XDNA_DBG(xdna, "%s skip stop, status %d", ctx->name, ctx->priv->status);
 		return;
 	}
-	aie2_ctx_disconnect(ctx, wait);
+	/* The last commands still run, that is resident time */
+	if (wait)
+		aie2_ctx_wait_for_idle(ctx);
+	start = ktime_get();
+	aie2_ctx_disconnect(ctx, false);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	rq_hist_add(&ctx->priv->sw.disconnect, ns);
+	rq_hist_add(&rq->sw.disconnect, ns);
+	ctx->priv->last_switch_ns += ns;
+	ctx->priv->last_resident_ns = ktime_to_ns(ktime_sub(start, ctx->priv->connect_time));
+	ctx->priv->sw.resident_ns += ctx->priv->last_resident_ns;
+	rq->sw.resident_ns += ctx->priv->last_resident_ns;
+	if (!list_empty(&ctx->prio_entry))
+		aie2_prio_list_del(&rq->conn_prio, &ctx->prio_entry, ctx_prio_level(ctx));
+	ctx->priv->should_block = false;
 	list_move_tail(&ctx->entry, &rq->disconn_list);
 	rq->hwctx_cnt--;
 	ctx->priv->status = CTX_STATE_DISCONNECTED;
@@ -206,29 +282,26 @@ static void rq_ctx_stop(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
 static void rq_ctx_dispatch(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
 {
 	struct amdxdna_dev *xdna;
-	int prio_q;
 
 	xdna = ctx_rq_to_xdna_dev(rq);
-	prio_q = ctx->qos.priority - 1;
-	list_move_tail(&ctx->entry, &rq->runqueue[prio_q].q);
+	list_del(&ctx->entry);
+	if (!list_empty(&rq->dl_list) && ctx->qos.priority == AMDXDNA_QOS_REALTIME_PRIORITY)
+		aie2_prio_list_add_ordered(&rq->runqueue, &ctx->entry, ctx_prio_level(ctx),
+					   ctx_deadline_before);
+	else
+		aie2_prio_list_add_tail(&rq->runqueue, &ctx->entry, ctx_prio_level(ctx));
 	ctx->priv->status = CTX_STATE_DISPATCHED;
-	rq->runqueue[prio_q].cnt++;
-	rq->runqueue_total++;
-	XDNA_DBG(xdna, "%s dispatched, priority queue %d", ctx->name, prio_q);
+	XDNA_DBG(xdna, "%s dispatched, priority queue %d", ctx->name, ctx_prio_level(ctx));
 }
 
 static void rq_ctx_cancel(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
 {
 	struct amdxdna_dev *xdna;
-	int prio_q;
 
 	xdna = ctx_rq_to_xdna_dev(rq);
-	prio_q = ctx->qos.priority - 1;
-	list_move_tail(&ctx->entry, &rq->runqueue[prio_q].q);
-	list_move_tail(&ctx->entry, &rq->disconn_list);
+	aie2_prio_list_del(&rq->runqueue, &ctx->entry, ctx_prio_level(ctx));
+	list_add_tail(&ctx->entry, &rq->disconn_list);
 	ctx->priv->status = CTX_STATE_DISCONNECTED;
-	rq->runqueue[prio_q].cnt--;
-	rq->runqueue_total--;
 	XDNA_DBG(xdna, "%s cancelled", ctx->name);
 }
 
@@ -238,6 +311,7 @@ static void rq_sched_work(struct work_struct *work)
 	struct amdxdna_dev *xdna;
 	struct amdxdna_ctx *next;
 	struct amdxdna_ctx *curr;
+	unsigned long delay;
 
 	rq = container_of(work, struct aie2_ctx_rq, sched_work);
 	xdna = ctx_rq_to_xdna_dev(rq);
@@ -264,17 +338,19 @@ static void rq_sched_work(struct work_struct *work)
 	}
 
 	while (next) {
-		curr = select_ctx_to_block(rq, next->qos.priority);
+		curr = select_ctx_to_block(rq, next);
 		if (!curr)
 			break;
 
 		XDNA_DBG(xdna, "block %s, next %s", curr->name, next->name);
-		curr->priv->should_block = true;
+		rq_ctx_block(rq, curr, next);
 		down_write(&curr->priv->io_sem);
 		if (!atomic64_read(&curr->priv->job_pending_cnt) &&
 		    curr->submitted == curr->completed) {
-			curr->priv->status = CTX_STATE_DISCONNECTING;
-			queue_work(rq->work_q, &curr->yield_work);
+			delay = rq_ctx_residency_left(rq, curr);
+			if (!delay)
+				curr->priv->status = CTX_STATE_DISCONNECTING;
+			queue_delayed_work(rq->work_q, &curr->yield_work, delay);
 		}
 		up_write(&curr->priv->io_sem);
 
@@ -310,7 +386,7 @@ static void rq_yield_work(struct work_struct *work)
 	struct amdxdna_dev *xdna;
 	struct amdxdna_ctx *ctx;
 
-	ctx = container_of(work, struct amdxdna_ctx, yield_work);
+	ctx = container_of(to_delayed_work(work), struct amdxdna_ctx, yield_work);
 	xdna = ctx->client->xdna;
 	rq = &xdna->dev_handle->ctx_rq;
 
@@ -320,14 +396,20 @@ static void rq_yield_work(struct work_struct *work)
 	if (ctx->submitted != ctx->completed)
 		goto out;
 
-	ctx->priv->should_block = false;
-	if (!rq->runqueue_total) {
+	if (aie2_prio_list_empty(&rq->runqueue)) {
+		/* Nobody to yield to, a candidate to block again, as the oldest */
+		if (ctx->priv->should_block)
+			aie2_prio_list_add_tail(&rq->conn_prio, &ctx->prio_entry,
+						ctx_prio_level(ctx));
+		ctx->priv->should_block = false;
 		ctx->priv->status = CTX_STATE_CONNECTED;
 		wake_up_all(&ctx->priv->connect_waitq);
 		goto out;
 	}
 
+	ctx->priv->should_block = false;
 	rq_ctx_stop(rq, ctx);
+	rq_ctx_yielded(rq, ctx);
 	queue_work(rq->work_q, &rq->sched_work);
 out:
 	up_write(&ctx->priv->io_sem);
@@ -402,7 +484,7 @@ bool aie2_rq_handle_idle_ctx(struct aie2_ctx_rq *rq)
 
 		if (ctx->priv->idle_cnt == RQ_CTX_IDLE_COUNT) {
 			ctx->priv->idle_cnt = 0;
-			queue_work(rq->work_q, &ctx->yield_work);
+			queue_delayed_work(rq->work_q, &ctx->yield_work, 0);
 			XDNA_DBG(xdna, "%s idle, try swap out", ctx->name);
 			found = true;
 		}
@@ -481,14 +563,30 @@ void aie2_rq_run_all(struct aie2_ctx_rq *rq)
 void aie2_rq_yield(struct amdxdna_ctx *ctx)
 {
 	struct aie2_ctx_rq *rq;
+	unsigned long delay;
+
+	rq = &ctx->client->xdna->dev_handle->ctx_rq;
+	if (!ctx->priv->should_block) {
+		/*
+		 * A deadline context is only blocked for an earlier deadline,
+		 * going idle it has none. Let the waiting ones look again.
+		 */
+		if (ctx_is_deadline(ctx) && ctx->submitted == ctx->completed &&
+		    !aie2_prio_list_empty(&rq->runqueue))
+			queue_work(rq->work_q, &rq->sched_work);
+		return;
+	}
 
-	if (!ctx->priv->should_block)
+	/* Keeps taking commands until it has been connected long enough */
+	delay = rq_ctx_residency_left(rq, ctx);
+	if (delay) {
+		queue_delayed_work(rq->work_q, &ctx->yield_work, delay);
 		return;
+	}
 
-	rq = &ctx->client->xdna->dev_handle->ctx_rq;
 	ctx->priv->status = CTX_STATE_DISCONNECTING;
 	if (ctx->submitted == ctx->completed)
-		queue_work(rq->work_q, &ctx->yield_work);
+		queue_delayed_work(rq->work_q, &ctx->yield_work, 0);
 }
 
 static int rq_submit_enter_slow(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
@@ -537,11 +635,32 @@ exit_and_cleanup:
 	return ret;
 }
 
+/*
+ * A submit to an idle context starts a new frame. One to a context whose frame
+ * overran its deadline gets a new deadline too, so that an overrunning context
+ * doesn't keep the earliest deadline forever.
+ */
+static void rq_ctx_set_deadline(struct amdxdna_ctx *ctx)
+{
+	ktime_t now;
+
+	if (!ctx_is_deadline(ctx))
+		return;
+
+	now = ktime_get();
+	if (READ_ONCE(ctx->submitted) != READ_ONCE(ctx->completed) &&
+	    !ktime_after(now, READ_ONCE(ctx->priv->deadline)))
+		return;
+
+	WRITE_ONCE(ctx->priv->deadline, ktime_add_ms(now, ctx->priv->dl.deadline_ms));
+}
+
 int aie2_rq_submit_enter(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
 {
 	struct amdxdna_dev *xdna;
 
 	xdna = ctx_rq_to_xdna_dev(rq);
+	rq_ctx_set_deadline(ctx);
 	down_read(&ctx->priv->io_sem);
 	if (ctx_is_connected(ctx))
 		return 0;
@@ -561,9 +680,49 @@ void aie2_rq_submit_exit(struct amdxdna_ctx *ctx)
 	up_read(&ctx->priv->io_sem);
 }
 
+/*
+ * Realtime contexts with fps or latency hints are in the deadline class. They
+ * are connected, and yield to each other, earliest deadline first. A context
+ * is only admitted to the class while the admitted frame execution times
+ * still fit in their deadlines.
+ */
+static int rq_ctx_admit(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
+{
+	struct aie2_dl_param *dl = &ctx->priv->dl;
+	struct amdxdna_ctx_priv *priv;
+	struct amdxdna_dev *xdna;
+	u32 max_util = 0;
+	int ret;
+
+	xdna = ctx_rq_to_xdna_dev(rq);
+	ret = aie2_dl_param_init(dl, ctx->qos.fps, ctx->qos.latency, ctx->qos.frame_exec_time);
+	if (ret) {
+		XDNA_ERR(xdna, "Frame exec time %d ms over deadline %d ms",
+			 ctx->qos.frame_exec_time, dl->deadline_ms);
+		return ret;
+	}
+
+	if (!dl->deadline_ms)
+		return 0;
+
+	list_for_each_entry(priv, &rq->dl_list, dl_entry)
+		max_util = max(max_util, priv->dl.util);
+
+	if (!aie2_dl_admit(rq->dl_util, max_util, dl->util, rq->hwctx_limit)) {
+		XDNA_ERR(xdna, "Utilization %d over limit, admitted %d on %d hwctx",
+			 dl->util, rq->dl_util, rq->hwctx_limit);
+		return -EBUSY;
+	}
+
+	list_add_tail(&ctx->priv->dl_entry, &rq->dl_list);
+	rq->dl_util += dl->util;
+	return 0;
+}
+
 int aie2_rq_add(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
 {
 	struct amdxdna_dev *xdna;
+	int ret;
 
 	xdna = ctx_rq_to_xdna_dev(rq);
 	mutex_lock(&xdna->dev_lock);
@@ -573,8 +732,18 @@ int aie2_rq_add(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
 		return -ENOENT;
 	}
 
+	INIT_LIST_HEAD(&ctx->priv->dl_entry);
+	if (ctx->qos.priority == AMDXDNA_QOS_REALTIME_PRIORITY) {
+		ret = rq_ctx_admit(rq, ctx);
+		if (ret) {
+			mutex_unlock(&xdna->dev_lock);
+			return ret;
+		}
+	}
+
 	INIT_WORK(&ctx->dispatch_work, rq_dispatch_work);
-	INIT_WORK(&ctx->yield_work, rq_yield_work);
+	INIT_DELAYED_WORK(&ctx->yield_work, rq_yield_work);
+	INIT_LIST_HEAD(&ctx->prio_entry);
 	ctx->priv->status = CTX_STATE_DISCONNECTED;
 	ctx->priv->should_block = false;
 
@@ -595,9 +764,13 @@ void aie2_rq_del(struct aie2_ctx_rq *rq, struct amdxdna_ctx *ctx)
 	rq_ctx_stop(rq, ctx);
 	up_write(&ctx->priv->io_sem);
 	list_del(&ctx->entry);
+	if (!list_empty(&ctx->priv->dl_entry)) {
+		list_del(&ctx->priv->dl_entry);
+		rq->dl_util -= ctx->priv->dl.util;
+	}
 	rq->ctx_cnt--;
 	mutex_unlock(&xdna->dev_lock);
-	cancel_work_sync(&ctx->yield_work);
+	cancel_delayed_work_sync(&ctx->yield_work);
 	XDNA_DBG(xdna, "%s deleted, status %d", ctx->name, ctx->priv->status);
 }
 
@@ -605,8 +778,8 @@ int aie2_rq_init(struct aie2_ctx_rq *rq)
 {
 	struct amdxdna_dev_hdl *ndev;
 	struct amdxdna_dev *xdna;
-	int i;
 
+	BUILD_BUG_ON(AIE2_PRIO_LEVELS != AMDXDNA_NUM_PRIORITY);
 	ndev = ctx_rq_to_ndev(rq);
 	xdna = ndev->xdna;
 	/* amdxdna_dev_ops.init() set default context and connect limit value */
@@ -637,8 +810,9 @@ int aie2_rq_init(struct aie2_ctx_rq *rq)
 	INIT_WORK(&rq->sched_work, rq_sched_work);
 	INIT_LIST_HEAD(&rq->conn_list);
 	INIT_LIST_HEAD(&rq->disconn_list);
-	for (i = 0; i < ARRAY_SIZE(rq->runqueue); i++)
-		INIT_LIST_HEAD(&rq->runqueue[i].q);
+	aie2_prio_list_init(&rq->runqueue);
+	aie2_prio_list_init(&rq->conn_prio);
+	INIT_LIST_HEAD(&rq->dl_list);
 	rq->paused = false;
 
 	return 0;
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#include <linux/errno.h>
+#include <linux/kernel.h>
+
+#include "aie2_deadline.h"
+
+/*
+ * fps, latency and exec_time are the QoS hints. latency and exec_time are in
+ * milliseconds, the same unit the solver assumes for latency.
+ *
+ * The period is a frame time, the relative deadline is the period or the
+ * latency if that is shorter. Returns -EINVAL if a frame can't run within its
+ * own deadline.
+ */
+int aie2_dl_param_init(struct aie2_dl_param *p, u32 fps, u32 latency, u32 exec_time)
+{
+	u32 period;
+
+	p->deadline_ms = 0;
+	p->util = 0;
+	if (!fps && !latency)
+		return 0;
+
+	period = fps ? max(1000 / fps, 1U) : latency;
+	p->deadline_ms = latency ? min(latency, period) : period;
+	if (!exec_time)
+		return 0;
+
+	if (exec_time > p->deadline_ms)
+		return -EINVAL;
+
+	p->util = DIV_ROUND_UP(exec_time * AIE2_DL_UTIL_FULL, period);
+	return 0;
+}
+
+/*
+ * Connected contexts run in parallel, one per hardware context, so this is
+ * global EDF on nr_hwctx processors. The GFB test (Goossens, Funk, Baruah)
+ * bounds the total utilization by nr_hwctx - (nr_hwctx - 1) * max utilization.
+ *
+ * total and max_util are of the contexts admitted so far.
+ */
+bool aie2_dl_admit(u32 total, u32 max_util, u32 util, u32 nr_hwctx)
+{
+	u64 limit;
+
+	if (!nr_hwctx)
+		return false;
+
+	max_util = max(max_util, util);
+	limit = (u64)nr_hwctx * AIE2_DL_UTIL_FULL - (u64)(nr_hwctx - 1) * max_util;
+	return (u64)total + util <= limit;
+}
@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#ifndef _AIE2_DEADLINE_H_
+#define _AIE2_DEADLINE_H_
+
+#include <linux/types.h>
+
+/* Utilization is in permille of one hardware context */
+#define AIE2_DL_UTIL_FULL	1000
+
+/*
+ * Deadline class parameters derived from the QoS hints. A context with a zero
+ * deadline_ms is not in the deadline class. A zero util means the frame
+ * execution time is unknown, the context is ordered by deadline but reserves
+ * nothing at admission.
+ */
+struct aie2_dl_param {
+	u32	deadline_ms;
+	u32	util;
+};
+
+int aie2_dl_param_init(struct aie2_dl_param *p, u32 fps, u32 latency, u32 exec_time);
+bool aie2_dl_admit(u32 total, u32 max_util, u32 util, u32 nr_hwctx);
+
+#endif /* _AIE2_DEADLINE_H_ */
@@ -14,6 +14,7 @@
 #include <drm/drm_cache.h>
 
 #include "aie2_msg_priv.h"
+#include "aie2_solver.h"
 #include "aie2_pci.h"
 
 #if defined(CONFIG_DEBUG_FS)
@@ -525,6 +526,105 @@ static int aie2_msg_queue_show(struct seq_file *m, void *unused)
 
 AIE2_DBGFS_FOPS(msg_queue, aie2_msg_queue_show, NULL);
 
+static int aie2_solver_show(struct seq_file *m, void *unused)
+{
+	struct amdxdna_dev_hdl *ndev = m->private;
+	struct xrs_stats stats;
+
+	mutex_lock(&ndev->aie2_lock);
+	xrs_get_stats(ndev->xrs_hdl, &stats);
+	mutex_unlock(&ndev->aie2_lock);
+
+	seq_printf(m, "defrag: %lld\n", stats.defrag);
+	seq_printf(m, "migrations: %lld\n", stats.migrations);
+	seq_printf(m, "migrate_fail: %lld\n", stats.migrate_fail);
+	seq_printf(m, "dpm_level: %d\n", stats.dpm_level);
+	seq_printf(m, "dpm_changes: %lld\n", stats.dpm_changes);
+	return 0;
+}
+
+AIE2_DBGFS_FOPS(solver, aie2_solver_show, NULL);
+
+static int aie2_submit_alloc_show(struct seq_file *m, void *unused)
+{
+	struct amdxdna_dev_hdl *ndev = m->private;
+	struct amdxdna_submit_stats *stats = &ndev->xdna->submit_stats;
+
+	seq_printf(m, "job_cached: %lld\n", atomic64_read(&stats->job_cached));
+	seq_printf(m, "job_kmalloc: %lld\n", atomic64_read(&stats->job_kmalloc));
+	seq_printf(m, "job_freed: %lld\n", atomic64_read(&stats->job_freed));
+	seq_printf(m, "fence_alloc: %lld\n", atomic64_read(&stats->fence_alloc));
+	seq_printf(m, "chain_alloc: %lld\n", atomic64_read(&stats->chain_alloc));
+	seq_printf(m, "direct: %lld\n", atomic64_read(&stats->direct));
+	return 0;
+}
+
+AIE2_DBGFS_FOPS(submit_alloc, aie2_submit_alloc_show, NULL);
+
+static void aie2_switch_hist_show(struct seq_file *m, const char *name,
+				  struct aie2_switch_hist *hist)
+{
+	int i;
+
+	seq_printf(m, "%s: %lld total_ns: %lld\n", name, hist->cnt, hist->total_ns);
+	for (i = 0; i < AMDXDNA_SWITCH_HIST_BUCKETS; i++) {
+		if (!hist->bucket[i])
+			continue;
+		seq_printf(m, "  %s%lu us: %u\n", i ? ">=" : "<",
+			   i ? BIT(i) : 2UL, hist->bucket[i]);
+	}
+}
+
+static int aie2_ctx_switch_show(struct seq_file *m, void *unused)
+{
+	struct amdxdna_dev_hdl *ndev = m->private;
+	struct amdxdna_dev *xdna = ndev->xdna;
+	struct aie2_ctx_rq *rq = &ndev->ctx_rq;
+	struct amdxdna_client *client;
+	struct aie2_switch_stats *sw;
+	struct amdxdna_ctx *ctx;
+	unsigned long ctx_id;
+	int idx;
+
+	mutex_lock(&xdna->dev_lock);
+	aie2_switch_hist_show(m, "connect", &rq->sw.connect);
+	aie2_switch_hist_show(m, "disconnect", &rq->sw.disconnect);
+	seq_printf(m, "yields: %lld\n", rq->sw.yields);
+	seq_printf(m, "resident_ns: %lld\n", rq->sw.resident_ns);
+	seq_printf(m, "min_residency_ns: %lld\n", rq->residency.min_ns);
+
+	list_for_each_entry(client, &xdna->client_list, node) {
+		idx = srcu_read_lock(&client->ctx_srcu);
+		amdxdna_for_each_ctx(client, ctx_id, ctx) {
+			sw = &ctx->priv->sw;
+			seq_printf(m, "%s: connect %lld/%lld ns disconnect %lld/%lld ns yields %lld resident %lld ns\n",
+				   ctx->name, sw->connect.cnt, sw->connect.total_ns,
+				   sw->disconnect.cnt, sw->disconnect.total_ns,
+				   sw->yields, sw->resident_ns);
+		}
+		srcu_read_unlock(&client->ctx_srcu, idx);
+	}
+	mutex_unlock(&xdna->dev_lock);
+	return 0;
+}
+
+AIE2_DBGFS_FOPS(ctx_switch, aie2_ctx_switch_show, NULL);
+
+static int aie2_heap_show(struct seq_file *m, void *unused)
+{
+	struct amdxdna_dev_hdl *ndev = m->private;
+	struct amdxdna_dev *xdna = ndev->xdna;
+	struct amdxdna_client *client;
+
+	mutex_lock(&xdna->dev_lock);
+	list_for_each_entry(client, &xdna->client_list, node)
+		amdxdna_gem_heap_show(client, m);
+	mutex_unlock(&xdna->dev_lock);
+	return 0;
+}
+
+AIE2_DBGFS_FOPS(heap, aie2_heap_show, NULL);
+
 static int aie2_telemetry(struct seq_file *m, u32 type)
 {
 	struct amdxdna_dev_hdl *ndev = m->private;
@@ -603,6 +703,10 @@ const struct {
 	AIE2_DBGFS_FILE(ringbuf, 0400),
 	AIE2_DBGFS_FILE(msg_queue, 0400),
 	AIE2_DBGFS_FILE(ioctl_id, 0400),
+	AIE2_DBGFS_FILE(solver, 0400),
+	AIE2_DBGFS_FILE(submit_alloc, 0400),
+	AIE2_DBGFS_FILE(ctx_switch, 0400),
+	AIE2_DBGFS_FILE(heap, 0400),
 	AIE2_DBGFS_FILE(telemetry_disabled, 0400),
 	AIE2_DBGFS_FILE(telemetry_health, 0400),
 	AIE2_DBGFS_FILE(telemetry_error_info, 0400),
@@ -59,22 +59,58 @@ static void aie2_release_resource(struct amdxdna_ctx *ctx)
 		XDNA_ERR(xdna, "Release AIE resource failed, ret %d", ret);
 }
 
+static int aie2_hwctx_map_chunk(struct amdxdna_ctx *ctx, struct amdxdna_gem_obj *heap)
+{
+	struct amdxdna_dev *xdna = ctx->client->xdna;
+
+#ifdef AMDXDNA_DEVEL
+	if (iommu_mode == AMDXDNA_IOMMU_NO_PASID)
+		return aie2_map_host_buf(xdna->dev_handle, ctx->priv->id,
+					 heap->mem.dma_addr, heap->mem.size);
+#endif
+	return aie2_map_host_buf(xdna->dev_handle, ctx->priv->id,
+				 heap->mem.userptr, heap->mem.size);
+}
+
+/*
+ * Map the heap chunks usable since the last call, each with its own host
+ * buffer. The first chunk is mapped on start even before it is usable.
+ */
+int aie2_hwctx_map_heap(struct amdxdna_ctx *ctx)
+{
+	struct amdxdna_client *client = ctx->client;
+	struct amdxdna_ctx_priv *priv = ctx->priv;
+	u32 nr_usable;
+	int ret;
+
+	drm_WARN_ON(&client->xdna->ddev, !mutex_is_locked(&client->xdna->dev_handle->aie2_lock));
+	nr_usable = max(smp_load_acquire(&client->nr_heap_usable), 1U);
+	while (priv->heap_mapped < nr_usable) {
+		ret = aie2_hwctx_map_chunk(ctx, client->heap_chunks[priv->heap_mapped]);
+		if (ret)
+			return ret;
+		priv->heap_mapped++;
+	}
+	return 0;
+}
+
 int aie2_hwctx_start(struct amdxdna_ctx *ctx)
 {
 	struct amdxdna_dev *xdna = ctx->client->xdna;
 	struct drm_gpu_scheduler *sched;
-	struct amdxdna_gem_obj *heap;
 	struct amdxdna_dev_hdl *ndev;
 	int ret;
 
 	ndev = xdna->dev_handle;
 	sched = &ctx->priv->sched;
-	heap = ctx->priv->heap;
 
 	drm_WARN_ON(&xdna->ddev, !mutex_is_locked(&ndev->aie2_lock));
+	/* Jobs left queued at the last disconnect were freed without running */
+	atomic_set(&ctx->priv->sched_queued, 0);
+	atomic_set(&ctx->priv->sched_waiting, 0);
 	ret = drm_sched_init(sched, &sched_ops, ctx->priv->submit_wq,
 			     DRM_SCHED_PRIORITY_COUNT,
-			     CTX_MAX_CMDS, 0, MAX_SCHEDULE_TIMEOUT,
+			     ctx->priv->num_cmds, 0, MAX_SCHEDULE_TIMEOUT,
 			     NULL, NULL, ctx->name, xdna->ddev.dev);
 	if (ret) {
 		XDNA_ERR(xdna, "Failed to init DRM scheduler. ret %d", ret);
@@ -94,18 +130,8 @@ int aie2_hwctx_start(struct amdxdna_ctx *ctx)
 		goto destroy_entity;
 	}
 
-#ifdef AMDXDNA_DEVEL
-	if (iommu_mode == AMDXDNA_IOMMU_NO_PASID) {
-		ret = aie2_map_host_buf(xdna->dev_handle, ctx->priv->id,
-					heap->mem.dma_addr, heap->mem.size);
-		goto skip;
-	}
-#endif
-	ret = aie2_map_host_buf(xdna->dev_handle, ctx->priv->id,
-				heap->mem.userptr, heap->mem.size);
-#ifdef AMDXDNA_DEVEL
-skip:
-#endif
+	ctx->priv->heap_mapped = 0;
+	ret = aie2_hwctx_map_heap(ctx);
 	if (ret) {
 		XDNA_ERR(xdna, "Map host buffer failed, ret %d", ret);
 		goto release_resource;
@@ -164,6 +190,7 @@ int aie2_xrs_load_hwctx(struct amdxdna_ctx *ctx, struct xrs_action_load *action)
 	mbox_chann = xdna_mailbox_create_channel(ndev->mbox, &info, type);
 	if (!mbox_chann) {
 		XDNA_ERR(xdna, "not able to create channel");
+		ret = -EINVAL;
 		goto failed;
 	}
 
@@ -197,3 +224,82 @@ int aie2_xrs_unload_hwctx(struct amdxdna_ctx *ctx)
 	xdna_mailbox_destroy_channel(ctx->priv->mbox_chann);
 	return ret;
 }
+
+/*
+ * aie2_xrs_migrate_hwctx() - Move an idle context to another partition.
+ *
+ * Called by the solver, with aie2_lock held, to compact columns. Only a
+ * connected context without outstanding or pending commands is moved, and
+ * holding its io_sem keeps new commands out meanwhile. The context is loaded
+ * at the new partition before the old one is unloaded, so on failure it
+ * keeps running where it was.
+ */
+int aie2_xrs_migrate_hwctx(struct amdxdna_ctx *ctx, struct xrs_action_load *action)
+{
+	struct amdxdna_dev *xdna = ctx->client->xdna;
+	void *old_chann, *new_chann;
+	u32 old_start_col, old_num_col;
+	u32 old_heap_mapped;
+	int old_id, new_id;
+	int ret;
+
+	drm_WARN_ON(&xdna->ddev, !mutex_is_locked(&xdna->dev_handle->aie2_lock));
+	if (!down_write_trylock(&ctx->priv->io_sem))
+		return -EBUSY;
+
+	if (ctx->priv->status != CTX_STATE_CONNECTED || ctx->priv->should_block ||
+	    atomic64_read(&ctx->priv->job_pending_cnt) ||
+	    ctx->submitted != ctx->completed) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	old_id = ctx->priv->id;
+	old_chann = ctx->priv->mbox_chann;
+	old_start_col = ctx->start_col;
+	old_num_col = ctx->num_col;
+	old_heap_mapped = ctx->priv->heap_mapped;
+
+	ret = aie2_xrs_load_hwctx(ctx, action);
+	if (ret)
+		goto restore;
+
+	ctx->priv->heap_mapped = 0;
+	ret = aie2_hwctx_map_heap(ctx);
+	if (ret) {
+		XDNA_ERR(xdna, "%s map host buffer failed, ret %d", ctx->name, ret);
+		goto unload;
+	}
+
+	ret = aie2_ctx_config_cu(ctx);
+	if (ret) {
+		XDNA_ERR(xdna, "%s config cu failed, ret %d", ctx->name, ret);
+		goto unload;
+	}
+
+	/* Switch over, then tear down the old hardware context */
+	new_id = ctx->priv->id;
+	new_chann = ctx->priv->mbox_chann;
+	ctx->priv->id = old_id;
+	ctx->priv->mbox_chann = old_chann;
+	aie2_xrs_unload_hwctx(ctx);
+	ctx->priv->id = new_id;
+	ctx->priv->mbox_chann = new_chann;
+
+	XDNA_DBG(xdna, "%s migrated from col %d to %d, ncols %d", ctx->name,
+		 old_start_col, ctx->start_col, ctx->num_col);
+	up_write(&ctx->priv->io_sem);
+	return 0;
+
+unload:
+	aie2_xrs_unload_hwctx(ctx);
+restore:
+	ctx->priv->id = old_id;
+	ctx->priv->mbox_chann = old_chann;
+	ctx->start_col = old_start_col;
+	ctx->num_col = old_num_col;
+	ctx->priv->heap_mapped = old_heap_mapped;
+unlock:
+	up_write(&ctx->priv->io_sem);
+	return ret;
+}
@@ -511,6 +511,16 @@ int aie2_config_cu(struct amdxdna_ctx *ctx)
 	return ret;
 }
 
+static int aie2_send_job_msg(struct mailbox_channel *chann, struct amdxdna_sched_job *job,
+			     struct xdna_mailbox_msg *msg)
+{
+	u32 flags = job->msg_more ? XDNA_MAILBOX_SEND_MORE : 0;
+	int ret;
+
+	ret = xdna_mailbox_send_msgs(chann, msg, 1, flags, TX_TIMEOUT);
+	return ret < 0 ? ret : 0;
+}
+
 int aie2_execbuf(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 		 int (*notify_cb)(void *, void __iomem *, size_t))
 {
@@ -599,7 +609,7 @@ int aie2_execbuf(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 			     msg.send_size, false);
 #endif
 
-	ret = xdna_mailbox_send_msg(chann, &msg, TX_TIMEOUT);
+	ret = aie2_send_job_msg(chann, job, &msg);
 	if (ret) {
 		XDNA_ERR(xdna, "Send message failed");
 		return ret;
@@ -705,13 +715,6 @@ done:
 	return ret;
 }
 
-static inline struct amdxdna_gem_obj *
-aie2_cmdlist_get_cmd_buf(struct amdxdna_sched_job *job)
-{
-	int idx = get_job_idx(job->seq);
-
-	return job->ctx->priv->cmd_buf[idx];
-}
 
 static inline void
 aie2_cmdlist_prepare_request(struct cmd_chain_req *req,
@@ -742,7 +745,7 @@ int aie2_cmdlist_multi_execbuf(struct amdxdna_ctx *ctx,
 			       struct amdxdna_sched_job *job,
 			       int (*notify_cb)(void *, void __iomem *, size_t))
 {
-	struct amdxdna_gem_obj *cmdbuf_abo = aie2_cmdlist_get_cmd_buf(job);
+	struct amdxdna_gem_obj *cmdbuf_abo = job->cmd_buf;
 	struct mailbox_channel *chann = ctx->priv->mbox_chann;
 	struct amdxdna_client *client = ctx->client;
 	struct amdxdna_gem_obj *cmd_abo = job->cmd_bo;
@@ -756,6 +759,10 @@ int aie2_cmdlist_multi_execbuf(struct amdxdna_ctx *ctx,
 	u32 op;
 	u32 i;
 
+	/* Command BO is user writable, it may be turned into a chain after submit */
+	if (!cmdbuf_abo)
+		return -EINVAL;
+
 	op = amdxdna_cmd_get_op(cmd_abo);
 	payload = amdxdna_cmd_get_payload(cmd_abo, &payload_len);
 	if (op != ERT_CMD_CHAIN || !payload ||
@@ -794,7 +801,7 @@ int aie2_cmdlist_multi_execbuf(struct amdxdna_ctx *ctx,
 	msg.notify_cb = notify_cb;
 	msg.send_data = (u8 *)&req;
 	msg.send_size = sizeof(req);
-	ret = xdna_mailbox_send_msg(chann, &msg, TX_TIMEOUT);
+	ret = aie2_send_job_msg(chann, job, &msg);
 	if (ret) {
 		XDNA_ERR(ctx->client->xdna, "Send message failed");
 		return ret;
@@ -808,7 +815,7 @@ int aie2_cmdlist_single_execbuf(struct amdxdna_ctx *ctx,
 				struct amdxdna_sched_job *job,
 				int (*notify_cb)(void *, void __iomem *, size_t))
 {
-	struct amdxdna_gem_obj *cmdbuf_abo = aie2_cmdlist_get_cmd_buf(job);
+	struct amdxdna_gem_obj *cmdbuf_abo = job->cmd_buf;
 	struct mailbox_channel *chann = ctx->priv->mbox_chann;
 	struct amdxdna_gem_obj *cmd_abo = job->cmd_bo;
 	struct xdna_mailbox_msg msg;
@@ -831,7 +838,102 @@ int aie2_cmdlist_single_execbuf(struct amdxdna_ctx *ctx,
 	msg.notify_cb = notify_cb;
 	msg.send_data = (u8 *)&req;
 	msg.send_size = sizeof(req);
-	ret = xdna_mailbox_send_msg(chann, &msg, TX_TIMEOUT);
+	ret = aie2_send_job_msg(chann, job, &msg);
+	if (ret) {
+		XDNA_ERR(ctx->client->xdna, "Send message failed");
+		return ret;
+	}
+	job->msg_id = msg.id;
+
+	return 0;
+}
+
+/* Encode all sub-commands into sc->buf and keep a reference to each of them */
+int aie2_cmdlist_seal(struct amdxdna_client *client, struct amdxdna_sealed_chain *sc,
+		      struct amdxdna_cmd_chain *payload)
+{
+	struct amdxdna_gem_obj *abo;
+	u32 offset = 0;
+	u32 size;
+	int ret;
+	u32 i;
+
+	for (i = 0; i < sc->count; i++) {
+		struct aie2_sealed_slot *slot = &sc->slots[i];
+
+		slot->hdl = (u32)READ_ONCE(payload->data[i]);
+		abo = amdxdna_gem_get_obj(client, slot->hdl, AMDXDNA_BO_CMD);
+		if (!abo) {
+			XDNA_ERR(client->xdna, "Failed to find cmd BO %d", slot->hdl);
+			ret = -ENOENT;
+			goto put_slots;
+		}
+
+		/* All sub-cmd should have same op, use the first one. */
+		if (i == 0)
+			sc->op = amdxdna_cmd_get_op(abo);
+
+		ret = aie2_cmdlist_fill_one_slot(sc->op, sc->buf, offset, abo, &size);
+		if (ret) {
+			amdxdna_gem_put_obj(abo);
+			goto put_slots;
+		}
+		slot->abo = abo;
+		amdxdna_cmd_get_payload(abo, &slot->payload_len);
+		slot->offset = offset;
+		slot->size = size;
+		offset += size;
+	}
+
+	if (aie2_cmd_op_to_msg_op(sc->op) == MSG_OP_MAX_OPCODE) {
+		ret = -EOPNOTSUPP;
+		goto put_slots;
+	}
+	sc->size = offset;
+	return 0;
+
+put_slots:
+	while (i--) {
+		amdxdna_gem_put_obj(sc->slots[i].abo);
+		sc->slots[i].abo = NULL;
+	}
+	return ret;
+}
+
+int aie2_cmdlist_sealed_execbuf(struct amdxdna_ctx *ctx,
+				struct amdxdna_sched_job *job,
+				int (*notify_cb)(void *, void __iomem *, size_t))
+{
+	struct mailbox_channel *chann = ctx->priv->mbox_chann;
+	struct amdxdna_sealed_chain *sc = job->sealed;
+	struct xdna_mailbox_msg msg;
+	struct cmd_chain_req req;
+	int ret;
+	u32 i;
+
+	/*
+	 * Fill every slot again, instruction buffer, CU index and arguments may
+	 * have changed since the chain was sealed. Only the slot sizes are fixed.
+	 */
+	for (i = 0; i < sc->count; i++) {
+		struct aie2_sealed_slot *slot = &sc->slots[i];
+		u32 size;
+
+		ret = aie2_cmdlist_fill_one_slot(sc->op, sc->buf, slot->offset, slot->abo, &size);
+		if (ret)
+			return ret;
+		if (size != slot->size)
+			return -EINVAL;
+	}
+
+	aie2_cmdlist_prepare_request(&req, sc->buf, sc->size, sc->count);
+
+	msg.opcode = aie2_cmd_op_to_msg_op(sc->op);
+	msg.handle = job;
+	msg.notify_cb = notify_cb;
+	msg.send_data = (u8 *)&req;
+	msg.send_size = sizeof(req);
+	ret = aie2_send_job_msg(chann, job, &msg);
 	if (ret) {
 		XDNA_ERR(ctx->client->xdna, "Send message failed");
 		return ret;
@@ -868,7 +970,7 @@ int aie2_sync_bo(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 	msg.send_size = sizeof(req);
 	msg.opcode = MSG_OP_SYNC_BO;
 
-	ret = xdna_mailbox_send_msg(chann, &msg, TX_TIMEOUT);
+	ret = aie2_send_job_msg(chann, job, &msg);
 	if (ret) {
 		XDNA_ERR(xdna, "Send message failed");
 		return ret;
@@ -901,7 +1003,7 @@ int aie2_config_debug_bo(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 	msg.send_size = sizeof(req);
 	msg.opcode = MSG_OP_CONFIG_DEBUG_BO;
 
-	ret = xdna_mailbox_send_msg(chann, &msg, TX_TIMEOUT);
+	ret = aie2_send_job_msg(chann, job, &msg);
 	if (ret) {
 		XDNA_ERR(xdna, "Send message failed");
 		return ret;
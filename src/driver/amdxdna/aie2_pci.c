@@ -34,6 +34,18 @@ MODULE_PARM_DESC(aie2_control_flags,
 		 " Bit " __stringify(AIE2_BIT_BYPASS_SET_FREQ) ": Bypass set freq,"
 		 " Bit " __stringify(AIE2_BIT_BYPASS_FW_LOAD) ": Bypass FW loading");
 
+uint aie2_col_placement = XRS_PLACEMENT_BEST_FIT;
+module_param(aie2_col_placement, uint, 0400);
+MODULE_PARM_DESC(aie2_col_placement, "Column placement, 0 = First fit, 1 = Best fit (Default)");
+
+uint aie2_max_migrations = 2;
+module_param(aie2_max_migrations, uint, 0400);
+MODULE_PARM_DESC(aie2_max_migrations, "Contexts moved to place one request, 0 = No defrag, max 4 (Default 2)");
+
+uint aie2_dpm_down_hold_ms = 200;
+module_param(aie2_dpm_down_hold_ms, uint, 0400);
+MODULE_PARM_DESC(aie2_dpm_down_hold_ms, "Time in ms the demand stays lower before lowering DPM level (Default 200)");
+
 bool disable_fine_preemption;
 module_param(disable_fine_preemption, bool, 0600);
 MODULE_PARM_DESC(disable_fine_preemption, "Disable fine grain preemption");
@@ -333,10 +345,32 @@ static int aie2_xrs_set_dft_dpm_level(struct drm_device *ddev, u32 dpm_level)
 	return ndev->priv->hw_ops.set_dpm(ndev, dpm_level);
 }
 
+static void aie2_xrs_defer_dpm_update(struct drm_device *ddev, u64 delay_ns)
+{
+	struct amdxdna_dev *xdna = to_xdna_dev(ddev);
+
+	mod_delayed_work(system_wq, &xdna->dev_handle->dpm_work,
+			 nsecs_to_jiffies(delay_ns) + 1);
+}
+
+static void aie2_dpm_work(struct work_struct *work)
+{
+	struct amdxdna_dev_hdl *ndev;
+
+	ndev = container_of(to_delayed_work(work), struct amdxdna_dev_hdl, dpm_work);
+	mutex_lock(&ndev->aie2_lock);
+	/* Stopped device has no context, resume re-evaluates on allocation */
+	if (ndev->dev_status >= AIE2_DEV_START && xrs_update_dpm(ndev->xrs_hdl))
+		XDNA_WARN(ndev->xdna, "update dpm level failed");
+	mutex_unlock(&ndev->aie2_lock);
+}
+
 static struct xrs_action_ops aie2_xrs_actions = {
 	.load_hwctx = aie2_xrs_load_hwctx,
 	.unload_hwctx = aie2_xrs_unload_hwctx,
+	.migrate_hwctx = aie2_xrs_migrate_hwctx,
 	.set_dft_dpm_level = aie2_xrs_set_dft_dpm_level,
+	.defer_dpm_update = aie2_xrs_defer_dpm_update,
 };
 
 static void aie2_hw_stop(struct amdxdna_dev *xdna)
@@ -505,6 +539,7 @@ static int aie2_init(struct amdxdna_dev *xdna)
 	ndev->priv = xdna->dev_info->dev_priv;
 	ndev->xdna = xdna;
 	mutex_init(&ndev->aie2_lock);
+	INIT_DELAYED_WORK(&ndev->dpm_work, aie2_dpm_work);
 
 	ret = request_firmware(&fw, ndev->priv->fw_path, &pdev->dev);
 	if (ret) {
@@ -622,6 +657,9 @@ skip_pasid:
 	xrs_cfg.ddev = &xdna->ddev;
 	xrs_cfg.actions = &aie2_xrs_actions;
 	xrs_cfg.total_col = ndev->total_col;
+	xrs_cfg.placement = aie2_col_placement;
+	xrs_cfg.max_migrations = aie2_max_migrations;
+	xrs_cfg.dpm_down_hold_ns = (u64)aie2_dpm_down_hold_ms * NSEC_PER_MSEC;
 
 	ndev->xrs_hdl = xrsm_init(&xrs_cfg);
 	if (!ndev->xrs_hdl) {
@@ -681,6 +719,7 @@ static void aie2_fini(struct amdxdna_dev *xdna)
 
 	aie2_event_trace_fini(ndev);
 	aie2_rq_fini(&ndev->ctx_rq);
+	cancel_delayed_work_sync(&ndev->dpm_work);
 	aie2_hw_stop(xdna);
 	aie2_error_async_events_free(ndev);
 #ifdef AMDXDNA_DEVEL
@@ -944,7 +983,7 @@ static int aie2_get_ctx_status(struct amdxdna_client *client,
 			tmp->command_submissions = ctx->submitted;
 			tmp->command_completions = ctx->completed;
 			tmp->migrations = 0;
-			tmp->preemptions = 0;
+			tmp->preemptions = ctx->priv->sw.yields;
 			tmp->errors = 0;
 			tmp->priority = ctx->qos.priority;
 
@@ -971,6 +1010,82 @@ out:
 	return ret;
 }
 
+static void aie2_copy_switch_hist(__u32 *dst, struct aie2_switch_hist *hist)
+{
+	int i;
+
+	for (i = 0; i < AMDXDNA_SWITCH_HIST_BUCKETS; i++)
+		dst[i] = hist->bucket[i];
+}
+
+static int aie2_get_ctx_switch(struct amdxdna_client *client,
+			       struct amdxdna_drm_get_info *args)
+{
+	struct amdxdna_drm_query_ctx_switch __user *buf;
+	struct amdxdna_dev *xdna = client->xdna;
+	struct amdxdna_drm_query_ctx_switch *tmp;
+	struct amdxdna_client *tmp_client;
+	struct aie2_switch_stats *sw;
+	struct amdxdna_ctx *ctx;
+	unsigned long ctx_id;
+	bool overflow = false;
+	u32 req_bytes = 0;
+	u32 hw_i = 0;
+	int ret = 0;
+	int idx;
+
+	tmp = kzalloc(sizeof(*tmp), GFP_KERNEL);
+	if (!tmp)
+		return -ENOMEM;
+
+	buf = u64_to_user_ptr(args->buffer);
+	mutex_lock(&xdna->dev_lock);
+	list_for_each_entry(tmp_client, &xdna->client_list, node) {
+		idx = srcu_read_lock(&tmp_client->ctx_srcu);
+		amdxdna_for_each_ctx(tmp_client, ctx_id, ctx) {
+			req_bytes += sizeof(*tmp);
+			if (args->buffer_size < req_bytes) {
+				/* Continue iterating to get the required size */
+				overflow = true;
+				continue;
+			}
+
+			sw = &ctx->priv->sw;
+			tmp->pid = tmp_client->pid;
+			tmp->context_id = ctx->id;
+			tmp->connects = sw->connect.cnt;
+			tmp->disconnects = sw->disconnect.cnt;
+			tmp->yields = sw->yields;
+			tmp->connect_ns = sw->connect.total_ns;
+			tmp->disconnect_ns = sw->disconnect.total_ns;
+			tmp->resident_ns = sw->resident_ns;
+			tmp->min_residency_ns = READ_ONCE(xdna->dev_handle->ctx_rq.residency.min_ns);
+			aie2_copy_switch_hist(tmp->connect_hist, &sw->connect);
+			aie2_copy_switch_hist(tmp->disconnect_hist, &sw->disconnect);
+
+			if (copy_to_user(&buf[hw_i], tmp, sizeof(*tmp))) {
+				ret = -EFAULT;
+				srcu_read_unlock(&tmp_client->ctx_srcu, idx);
+				goto out;
+			}
+			hw_i++;
+		}
+		srcu_read_unlock(&tmp_client->ctx_srcu, idx);
+	}
+
+	if (overflow) {
+		XDNA_ERR(xdna, "Invalid buffer size. Given: %u Need: %u.",
+			 args->buffer_size, req_bytes);
+		ret = -EINVAL;
+	}
+
+out:
+	mutex_unlock(&xdna->dev_lock);
+	kfree(tmp);
+	args->buffer_size = req_bytes;
+	return ret;
+}
+
 static int aie2_get_telemetry(struct amdxdna_client *client,
 			      struct amdxdna_drm_get_info *args)
 {
@@ -1067,6 +1182,11 @@ static int aie2_get_info(struct amdxdna_client *client, struct amdxdna_drm_get_i
 		ret = aie2_get_ctx_status(client, args);
 		mutex_lock(&xdna->dev_handle->aie2_lock);
 		break;
+	case DRM_AMDXDNA_QUERY_CTX_SWITCH:
+		mutex_unlock(&xdna->dev_handle->aie2_lock);
+		ret = aie2_get_ctx_switch(client, args);
+		mutex_lock(&xdna->dev_handle->aie2_lock);
+		break;
 #ifdef AMDXDNA_AIE2_PRIV
 	case DRM_AMDXDNA_READ_AIE_MEM:
 		ret = aie2_read_aie_mem(client, args);
@@ -16,6 +16,9 @@
 #include <drm/gpu_scheduler.h>
 
 #include "drm_local/amdxdna_accel.h"
+#include "aie2_deadline.h"
+#include "aie2_prio_list.h"
+#include "aie2_residency.h"
 #include "amdxdna_pci_drv.h"
 #include "amdxdna_ctx.h"
 #include "amdxdna_gem.h"
@@ -187,24 +190,97 @@ struct ctx_pdi {
 #endif
 
 /*
- * Define the maximum number of pending commands in a context.
- * Must be power of 2!
+ * Define the number of pending commands in a context. The user may ask for
+ * up to ctx_max_cmds, which is capped by CTX_MAX_CMDS_LIMIT. The number is
+ * always rounded up to power of 2!
  */
-#define CTX_MAX_CMDS		4
-#define get_job_idx(seq) ((seq) & (CTX_MAX_CMDS - 1))
+#define CTX_DEFAULT_CMDS	4
+#define CTX_MAX_CMDS_LIMIT	128
+#define get_job_idx(priv, seq) ((seq) & ((priv)->num_cmds - 1))
+
+/*
+ * A command chain validated and laid out by DRM_AMDXDNA_CTX_SEAL_CHAIN. A later
+ * submission of the chain BO is matched against it, each sub-command handle
+ * must still name the same BO with the same payload size. The slots are then
+ * filled again in place, no command buffer is taken. There is one encoded
+ * buffer, so only one submission of the chain is in flight at a time, the
+ * others go through the regular command buffers.
+ */
+#define CTX_MAX_SEALED_CHAINS	16
+struct aie2_sealed_slot {
+	struct amdxdna_gem_obj		*abo;
+	u32				hdl;
+	u32				payload_len;
+	/* Slot in the encoded buffer */
+	u32				offset;
+	u32				size;
+};
+
+struct amdxdna_sealed_chain {
+	struct list_head		node;
+	struct kref			refcnt;
+	struct amdxdna_ctx		*ctx;
+	struct amdxdna_gem_obj		*cmd_abo;
+	struct amdxdna_gem_obj		*buf;
+	atomic_t			busy;
+	u32				op;
+	u32				size;
+	u32				count;
+	struct aie2_sealed_slot		slots[] __counted_by(count);
+};
+
+/* Bucket n counts durations from 2^n us, see struct amdxdna_drm_query_ctx_switch */
+struct aie2_switch_hist {
+	u64	cnt;
+	u64	total_ns;
+	u32	bucket[AMDXDNA_SWITCH_HIST_BUCKETS];
+};
+
+struct aie2_switch_stats {
+	struct aie2_switch_hist	connect;
+	struct aie2_switch_hist	disconnect;
+	u64			yields;
+	u64			resident_ns;
+};
+
 struct amdxdna_ctx_priv {
 	struct amdxdna_gem_obj		*heap;
+	/* Heap chunks mapped to the firmware context, under aie2_lock */
+	u32				heap_mapped;
 #ifdef AMDXDNA_DEVEL
 	struct ctx_pdi			*pdi_infos;
 #endif
 
-	struct amdxdna_gem_obj		*cmd_buf[CTX_MAX_CMDS];
+	/*
+	 * Command chain buffers, for jobs and sealed chains, are allocated
+	 * from dev heap when the context is created. Only user space can grow
+	 * the heap, so the kernel never allocates from it later. There are
+	 * num_cmds + CTX_MAX_SEALED_CHAINS of them, cmd_buf[0..cmd_buf_free)
+	 * are the idle ones.
+	 */
+	spinlock_t			cmd_buf_lock;
+	struct amdxdna_gem_obj		**cmd_buf;
+	u32				cmd_buf_cnt;
+	u32				cmd_buf_free;
+
+	/* Sealed command chains, protected by sealed_lock */
+	spinlock_t			sealed_lock;
+	struct list_head		sealed_list;
+	u32				sealed_cnt;
 
 	struct mutex			io_lock; /* protect seq and cmd order */
-#ifdef AMDXDNA_DEVEL
-	struct amdxdna_sched_job	*pending[CTX_MAX_CMDS];
-#endif
+	/* Serializes submissions when direct_submit is on */
+	struct mutex			submit_lock;
+	/* Jobs pushed to the scheduler and not yet sent to firmware */
+	atomic_t			sched_queued;
+	/* The ones of them submitted with a syncobj dependency */
+	atomic_t			sched_waiting;
+	u32				num_cmds;
+	struct amdxdna_sched_job	**pending;
 	struct semaphore		job_sem;
+	/* Commands below this seq are all done, protected by status_lock */
+	spinlock_t			status_lock;
+	u64				status_done;
 
 	struct workqueue_struct		*submit_wq;
 	struct drm_syncobj		*syncobj;
@@ -232,6 +308,19 @@ struct amdxdna_ctx_priv {
 #define CTX_STATE_DEAD			0xFF
 	u32				status;
 	bool				should_block;
+	/* Blocked for a realtime or deadline context, yield without residency */
+	bool				block_urgent;
+
+	/* Connect and disconnect accounting, protected by dev_lock */
+	struct aie2_switch_stats	sw;
+	ktime_t				connect_time;
+	u64				last_switch_ns;
+	u64				last_resident_ns;
+
+	/* Deadline class, see rq_ctx_admit() */
+	struct aie2_dl_param		dl;
+	struct list_head		dl_entry;
+	ktime_t				deadline; /* Absolute, of the current frame */
 };
 
 enum aie2_dev_status {
@@ -245,16 +334,24 @@ enum aie2_power_state {
 	SMU_POWER_ON,
 };
 
-struct aie2_ctx_q {
-	struct list_head	q;
-	u32			cnt;
-};
-
+/*
+ * Contexts are on exactly one of conn_list, disconn_list or runqueue through
+ * ctx->entry. Connected contexts not asked to yield are also on conn_prio
+ * through ctx->prio_entry.
+ */
 struct aie2_ctx_rq {
 	struct list_head	conn_list;
 	struct list_head	disconn_list;
-	struct aie2_ctx_q	runqueue[AMDXDNA_NUM_PRIORITY];
-	u32			runqueue_total;
+	struct aie2_prio_list	runqueue; /* Dispatched, first in first out */
+	struct aie2_prio_list	conn_prio; /* Newest first */
+
+	/* Admitted deadline class contexts */
+	struct list_head	dl_list;
+	u32			dl_util;
+
+	/* Of all contexts, and the minimum residency adapted to them */
+	struct aie2_switch_stats sw;
+	struct aie2_residency	residency;
 
 	struct workqueue_struct	*work_q;
 	struct work_struct	sched_work;
@@ -291,6 +388,7 @@ struct amdxdna_dev_hdl {
 	u32				dpm_level;
 	u32				dft_dpm_level;
 	u32				max_dpm_level;
+	struct delayed_work		dpm_work;	/* finishes a held DPM drop */
 	u32				clk_gating;
 	u32				npuclk_freq;
 	u32				hclk_freq;
@@ -462,6 +560,11 @@ int aie2_cmdlist_single_execbuf(struct amdxdna_ctx *ctx,
 int aie2_cmdlist_multi_execbuf(struct amdxdna_ctx *ctx,
 			       struct amdxdna_sched_job *job,
 			       int (*notify_cb)(void *, void __iomem *, size_t));
+int aie2_cmdlist_sealed_execbuf(struct amdxdna_ctx *ctx,
+				struct amdxdna_sched_job *job,
+				int (*notify_cb)(void *, void __iomem *, size_t));
+int aie2_cmdlist_seal(struct amdxdna_client *client, struct amdxdna_sealed_chain *sc,
+		      struct amdxdna_cmd_chain *payload);
 int aie2_sync_bo(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 		 int (*notify_cb)(void *, void __iomem *, size_t));
 int aie2_config_debug_bo(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
@@ -471,7 +574,9 @@ int aie2_config_debug_bo(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 int aie2_ctx_init(struct amdxdna_ctx *ctx);
 void aie2_ctx_fini(struct amdxdna_ctx *ctx);
 int aie2_ctx_connect(struct amdxdna_ctx *ctx);
+void aie2_ctx_wait_for_idle(struct amdxdna_ctx *ctx);
 void aie2_ctx_disconnect(struct amdxdna_ctx *ctx, bool wait);
+int aie2_ctx_config_cu(struct amdxdna_ctx *ctx);
 int aie2_ctx_config(struct amdxdna_ctx *ctx, u32 type, u64 value, void *buf, u32 size);
 int aie2_cmd_submit(struct amdxdna_ctx *ctx, struct amdxdna_sched_job *job,
 		    u32 *syncobj_hdls, u64 *syncobj_points, u32 syncobj_cnt, u64 *seq);
@@ -482,9 +587,11 @@ void aie2_dump_ctx(struct amdxdna_client *client);
 
 /* aie2_hwctx.c */
 int aie2_hwctx_start(struct amdxdna_ctx *ctx);
+int aie2_hwctx_map_heap(struct amdxdna_ctx *ctx);
 void aie2_hwctx_stop(struct amdxdna_ctx *ctx);
 int aie2_xrs_load_hwctx(struct amdxdna_ctx *ctx, struct xrs_action_load *action);
 int aie2_xrs_unload_hwctx(struct amdxdna_ctx *ctx);
+int aie2_xrs_migrate_hwctx(struct amdxdna_ctx *ctx, struct xrs_action_load *action);
 
 /* aid2_ctx_runqueue.c */
 int aie2_rq_init(struct aie2_ctx_rq *rq);
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#include "aie2_prio_list.h"
+
+void aie2_prio_list_init(struct aie2_prio_list *pl)
+{
+	int i;
+
+	for (i = 0; i < AIE2_PRIO_LEVELS; i++) {
+		INIT_LIST_HEAD(&pl->q[i]);
+		pl->cnt[i] = 0;
+	}
+	pl->total = 0;
+	pl->map = 0;
+}
+
+static void prio_list_added(struct aie2_prio_list *pl, u32 level)
+{
+	pl->cnt[level]++;
+	pl->total++;
+	pl->map |= BIT(level);
+}
+
+/* Add at the head of its level, e.g. newest first */
+void aie2_prio_list_add(struct aie2_prio_list *pl, struct list_head *node, u32 level)
+{
+	list_add(node, &pl->q[level]);
+	prio_list_added(pl, level);
+}
+
+/* Add at the tail of its level, e.g. first in first out */
+void aie2_prio_list_add_tail(struct aie2_prio_list *pl, struct list_head *node, u32 level)
+{
+	list_add_tail(node, &pl->q[level]);
+	prio_list_added(pl, level);
+}
+
+/* Add before the first entry of its level that node goes before, or at the tail */
+void aie2_prio_list_add_ordered(struct aie2_prio_list *pl, struct list_head *node, u32 level,
+				bool (*before)(struct list_head *a, struct list_head *b))
+{
+	struct list_head *pos;
+
+	list_for_each(pos, &pl->q[level]) {
+		if (before(node, pos))
+			break;
+	}
+	list_add_tail(node, pos);
+	prio_list_added(pl, level);
+}
+
+void aie2_prio_list_del(struct aie2_prio_list *pl, struct list_head *node, u32 level)
+{
+	list_del_init(node);
+	pl->total--;
+	if (!--pl->cnt[level])
+		pl->map &= ~BIT(level);
+}
+
+/* First entry of the highest non-empty level at or below level from */
+struct list_head *aie2_prio_list_first(struct aie2_prio_list *pl, u32 from)
+{
+	unsigned long map;
+
+	if (from >= AIE2_PRIO_LEVELS)
+		return NULL;
+
+	map = pl->map & ~(BIT(from) - 1);
+	if (!map)
+		return NULL;
+
+	return pl->q[__ffs(map)].next;
+}
+
+/* Entry after node, which is at level, continuing with the lower levels */
+struct list_head *aie2_prio_list_next(struct aie2_prio_list *pl, struct list_head *node,
+				      u32 level)
+{
+	if (!list_is_last(node, &pl->q[level]))
+		return node->next;
+
+	return aie2_prio_list_first(pl, level + 1);
+}
+
+/* Last entry of the lowest non-empty level, if it is at or below level from */
+struct list_head *aie2_prio_list_last(struct aie2_prio_list *pl, u32 from)
+{
+	unsigned long map;
+
+	if (from >= AIE2_PRIO_LEVELS)
+		return NULL;
+
+	map = pl->map & ~(BIT(from) - 1);
+	if (!map)
+		return NULL;
+
+	return pl->q[__fls(map)].prev;
+}
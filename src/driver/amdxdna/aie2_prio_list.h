@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#ifndef _AIE2_PRIO_LIST_H_
+#define _AIE2_PRIO_LIST_H_
+
+#include <linux/bitops.h>
+#include <linux/list.h>
+#include <linux/types.h>
+
+/* Same as AMDXDNA_NUM_PRIORITY, level 0 is the highest priority */
+#define AIE2_PRIO_LEVELS	4
+
+/*
+ * One list per priority level and a bitmap of the non-empty ones, so that the
+ * first entry of the highest level or the last entry of the lowest level is
+ * found without walking any list. Entries are plain list nodes, the user
+ * tracks which level each one is at.
+ */
+struct aie2_prio_list {
+	struct list_head	q[AIE2_PRIO_LEVELS];
+	u32			cnt[AIE2_PRIO_LEVELS];
+	u32			total;
+	unsigned long		map;
+};
+
+void aie2_prio_list_init(struct aie2_prio_list *pl);
+void aie2_prio_list_add(struct aie2_prio_list *pl, struct list_head *node, u32 level);
+void aie2_prio_list_add_tail(struct aie2_prio_list *pl, struct list_head *node, u32 level);
+void aie2_prio_list_add_ordered(struct aie2_prio_list *pl, struct list_head *node, u32 level,
+				bool (*before)(struct list_head *a, struct list_head *b));
+void aie2_prio_list_del(struct aie2_prio_list *pl, struct list_head *node, u32 level);
+struct list_head *aie2_prio_list_first(struct aie2_prio_list *pl, u32 from);
+struct list_head *aie2_prio_list_next(struct aie2_prio_list *pl, struct list_head *node,
+				      u32 level);
+struct list_head *aie2_prio_list_last(struct aie2_prio_list *pl, u32 from);
+
+static inline bool aie2_prio_list_empty(struct aie2_prio_list *pl)
+{
+	return !pl->total;
+}
+
+#endif /* _AIE2_PRIO_LIST_H_ */
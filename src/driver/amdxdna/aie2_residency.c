@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/time64.h>
+
+#include "aie2_residency.h"
+
+#define AIE2_RESIDENCY_MAX_NS	(100 * NSEC_PER_MSEC)
+
+/*
+ * A context yielded after it was connected for resident_ns, connecting and
+ * disconnecting it took switch_ns.
+ *
+ * Contexts yielding soon after they connected spend more time switching than
+ * running. Every AIE2_RESIDENCY_WINDOW yields, if switching took more than a
+ * quarter of the time the yielding contexts were connected, double the
+ * minimum residency, to at least four switches. If it took less than a
+ * sixteenth, halve it. Returns true if the minimum changed.
+ */
+bool aie2_residency_yielded(struct aie2_residency *r, u64 switch_ns, u64 resident_ns)
+{
+	u64 min_ns = r->min_ns;
+	u64 avg;
+
+	r->win_switch_ns += switch_ns;
+	r->win_resident_ns += resident_ns;
+	if (++r->win_yields < AIE2_RESIDENCY_WINDOW)
+		return false;
+
+	if (r->win_switch_ns * 4 > r->win_resident_ns) {
+		avg = div_u64(r->win_switch_ns, r->win_yields);
+		min_ns = min_t(u64, max(min_ns * 2, avg * 4), AIE2_RESIDENCY_MAX_NS);
+	} else if (r->win_switch_ns * 16 < r->win_resident_ns) {
+		min_ns /= 2;
+	}
+
+	r->win_switch_ns = 0;
+	r->win_resident_ns = 0;
+	r->win_yields = 0;
+	if (min_ns == r->min_ns)
+		return false;
+
+	WRITE_ONCE(r->min_ns, min_ns);
+	return true;
+}
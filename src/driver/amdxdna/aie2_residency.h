@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#ifndef _AIE2_RESIDENCY_H_
+#define _AIE2_RESIDENCY_H_
+
+#include <linux/types.h>
+
+/* Yields the switch and resident times are summed over before adapting */
+#define AIE2_RESIDENCY_WINDOW	16
+
+/*
+ * Minimum time a yielding context stays connected, adapted to what switching
+ * contexts in and out costs. min_ns is read without the lock.
+ */
+struct aie2_residency {
+	u64	min_ns;
+	u64	win_switch_ns;
+	u64	win_resident_ns;
+	u32	win_yields;
+};
+
+bool aie2_residency_yielded(struct aie2_residency *r, u64 switch_ns, u64 resident_ns);
+
+#endif /* _AIE2_RESIDENCY_H_ */
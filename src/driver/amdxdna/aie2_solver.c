@@ -8,6 +8,7 @@
 #include <drm/drm_print.h>
 #include <linux/bitops.h>
 #include <linux/bitmap.h>
+#include <linux/ktime.h>
 
 #include "aie2_solver.h"
 
@@ -25,7 +26,9 @@ struct solver_node {
 
 	struct partition_node	*pt_node;
 	struct amdxdna_ctx	*ctx;
-	u32			dpm_level;
+	bool			qos_valid;	/* false means run at max DPM level */
+	u32			opc;		/* operations per cycle of the CDO */
+	u64			demand;		/* required GOPs */
 	u32			cols_len;
 	u32			start_cols[] __counted_by(cols_len);
 };
@@ -38,12 +41,43 @@ struct solver_rgroup {
 	DECLARE_BITMAP(resbit, XRS_MAX_COL);
 	struct list_head		node_list;
 	struct list_head		pt_node_list;
+
+	/*
+	 * Partition starting at each column. Partitions never overlap, so
+	 * there is at most one per start column.
+	 */
+	struct partition_node		*col_part[XRS_MAX_COL];
+};
+
+#define DPM_LEVEL_UNSET		U32_MAX
+
+/*
+ * Clock governor state. Raising the level is applied at once, lowering is
+ * held back until the demand stayed lower for dpm_down_hold_ns.
+ */
+struct dpm_governor {
+	u32				level;		/* level in effect */
+	u32				down_level;	/* highest level asked while held */
+	bool				holding;	/* a drop is being held back */
+	u64				down_since;	/* ktime ns the drop started */
 };
 
 struct solver_state {
 	struct solver_rgroup		rgp;
 	struct init_config		cfg;
 	struct xrs_action_ops		*actions;
+	struct dpm_governor		gov;
+	struct xrs_stats		stats;
+};
+
+/*
+ * Contexts to move, and where, to free the columns starting at start_col.
+ */
+struct defrag_plan {
+	u32			start_col;
+	u32			nmoves;
+	struct solver_node	*nodes[XRS_MAX_MIGRATIONS];
+	u32			dest_cols[XRS_MAX_MIGRATIONS];
 };
 
 static u32 calculate_gops(struct aie_qos *rqos)
@@ -108,37 +142,112 @@ static bool is_valid_qos_dpm_params(struct aie_qos *rqos)
 	return false;
 }
 
-static int set_dpm_level(struct solver_state *xrs, struct alloc_requests *req, u32 *dpm_level)
+/*
+ * partition_dpm_level() - Lowest DPM level that serves a partition.
+ *
+ * Contexts sharing a partition are time multiplexed on it, so their demands
+ * add up and the partition runs at the pace of the slowest CDO among them.
+ */
+static u32 partition_dpm_level(struct solver_state *xrs,
+			       struct partition_node *pt_node)
 {
-	struct solver_rgroup *rgp = &xrs->rgp;
-	struct cdo_parts *cdop = &req->cdo;
-	struct aie_qos *rqos = &req->rqos;
-	u32 freq, max_dpm_level, level;
+	u32 max_dpm_level = xrs->cfg.clk_list.num_levels - 1;
 	struct solver_node *node;
+	u32 opc = U32_MAX, level;
+	u64 demand = 0;
+
+	list_for_each_entry(node, &xrs->rgp.node_list, list) {
+		if (node->pt_node != pt_node)
+			continue;
+
+		if (!node->qos_valid)
+			return max_dpm_level;
 
-	max_dpm_level = xrs->cfg.clk_list.num_levels - 1;
-	/* If no QoS parameters are passed, set it to the max DPM level */
-	if (!is_valid_qos_dpm_params(rqos)) {
-		level = max_dpm_level;
-		goto set_dpm;
+		demand += node->demand;
+		opc = min(opc, node->opc);
 	}
 
-	/* Find one CDO group that meet the GOPs requirement. */
 	for (level = 0; level < max_dpm_level; level++) {
-		freq = xrs->cfg.clk_list.cu_clk_list[level];
-		if (!qos_meet(xrs, rqos, cdop->qos_cap.opc * freq / 1000))
+		if (demand <= (u64)opc * xrs->cfg.clk_list.cu_clk_list[level] / 1000)
 			break;
 	}
 
-	/* set the dpm level which fits all the sessions */
-	list_for_each_entry(node, &rgp->node_list, list) {
-		if (node->dpm_level > level)
-			level = node->dpm_level;
+	return level;
+}
+
+/*
+ * solve_dpm_level() - Lowest DPM level that serves all live contexts.
+ */
+static u32 solve_dpm_level(struct solver_state *xrs)
+{
+	struct partition_node *pt_node;
+	u32 level = 0;
+
+	list_for_each_entry(pt_node, &xrs->rgp.pt_node_list, list)
+		level = max(level, partition_dpm_level(xrs, pt_node));
+
+	return level;
+}
+
+/*
+ * update_dpm_level() - Re-evaluate the DPM level after contexts change.
+ *
+ * A context swapped out and back in by the runqueue, or a short lived one,
+ * would otherwise toggle the clocks on every allocate and release. When the
+ * demand drops, keep the level for dpm_down_hold_ns and then go down to the
+ * highest level asked during that time. The consumer is asked to call
+ * xrs_update_dpm() once the hold expires, so the drop does not depend on
+ * another allocate or release coming.
+ */
+static int update_dpm_level(struct solver_state *xrs)
+{
+	u64 hold = xrs->cfg.dpm_down_hold_ns;
+	struct dpm_governor *gov = &xrs->gov;
+	u32 demand, level;
+	u64 now, held;
+	int ret;
+
+	demand = solve_dpm_level(xrs);
+	level = demand;
+	now = ktime_get_ns();
+	if (gov->level != DPM_LEVEL_UNSET && level < gov->level) {
+		if (!gov->holding) {
+			gov->holding = true;
+			gov->down_since = now;
+			gov->down_level = level;
+		} else {
+			gov->down_level = max(gov->down_level, level);
+		}
+
+		held = now - gov->down_since;
+		if (held < hold)
+			goto defer;
+
+		level = gov->down_level;
+	}
+
+	/* Dropped to a level still above the demand, hold again from now */
+	gov->holding = demand < level;
+	if (level != gov->level) {
+		ret = xrs->cfg.actions->set_dft_dpm_level(xrs->cfg.ddev, level);
+		if (ret)
+			return ret;
+
+		drm_dbg(xrs->cfg.ddev, "dpm level %d -> %d\n", gov->level, level);
+		gov->level = level;
+		xrs->stats.dpm_changes++;
 	}
 
-set_dpm:
-	*dpm_level = level;
-	return xrs->cfg.actions->set_dft_dpm_level(xrs->cfg.ddev, level);
+	if (!gov->holding)
+		return 0;
+
+	gov->down_since = now;
+	gov->down_level = demand;
+	held = 0;
+defer:
+	if (xrs->cfg.actions->defer_dpm_update)
+		xrs->cfg.actions->defer_dpm_update(xrs->cfg.ddev, hold - held);
+	return 0;
 }
 
 static struct solver_node *rg_search_node(struct solver_rgroup *rgp, u64 rid)
@@ -162,6 +271,7 @@ static void remove_partition_node(struct solver_rgroup *rgp,
 
 	list_del(&pt_node->list);
 	rgp->npartition_node--;
+	rgp->col_part[pt_node->start_col] = NULL;
 
 	bitmap_clear(rgp->resbit, pt_node->start_col, pt_node->ncols);
 	kfree(pt_node);
@@ -179,22 +289,82 @@ static void remove_solver_node(struct solver_rgroup *rgp,
 	kfree(node);
 }
 
-static int get_free_partition(struct solver_state *xrs,
-			      struct solver_node *snode,
-			      struct alloc_requests *req)
+static bool is_free_range(const unsigned long *map, u32 col, u32 ncols)
 {
-	struct partition_node *pt_node;
-	u32 ncols = req->cdo.ncols;
-	u32 col, i;
+	return find_next_bit(map, XRS_MAX_COL, col) >= col + ncols;
+}
+
+/*
+ * placement_score() - Score a free candidate range. Lower is better.
+ *
+ * The score is the number of free columns left on both sides of the range
+ * within the same free hole, so the tightest hole wins. Candidates are
+ * scanned in ascending order and ties keep the first one, which puts the
+ * range against the left boundary of the hole instead of splitting it.
+ */
+static u32 placement_score(struct solver_state *xrs, const unsigned long *map,
+			   u32 col, u32 ncols)
+{
+	u32 end = col + ncols;
+	u32 left, right, last;
+
+	last = find_last_bit(map, col);
+	left = (last == col) ? col : col - last - 1;
+	right = find_next_bit(map, xrs->cfg.total_col, end) - end;
+
+	return left + right;
+}
+
+/*
+ * find_free_start_col() - Find a start column for @ncols columns among the
+ * start columns of @snode, which are all free in the column bitmap @map.
+ */
+static int find_free_start_col(struct solver_state *xrs, const unsigned long *map,
+			       struct solver_node *snode, u32 ncols, u32 *start_col)
+{
+	u32 best_score = U32_MAX;
+	u32 col, score, i;
+	bool found = false;
 
 	for (i = 0; i < snode->cols_len; i++) {
 		col = snode->start_cols[i];
-		if (find_next_bit(xrs->rgp.resbit, XRS_MAX_COL, col) >= col + ncols)
+		if (col + ncols > xrs->cfg.total_col)
+			continue;
+
+		if (!is_free_range(map, col, ncols))
+			continue;
+
+		if (xrs->cfg.placement == XRS_PLACEMENT_FIRST_FIT) {
+			*start_col = col;
+			return 0;
+		}
+
+		score = placement_score(xrs, map, col, ncols);
+		if (score >= best_score)
+			continue;
+
+		best_score = score;
+		*start_col = col;
+		found = true;
+		if (!score)
 			break;
 	}
 
-	if (i == snode->cols_len)
-		return -ENODEV;
+	return found ? 0 : -ENODEV;
+}
+
+static int get_free_partition(struct solver_state *xrs,
+			      struct solver_node *snode,
+			      struct alloc_requests *req)
+{
+	struct partition_node *pt_node;
+	u32 ncols = req->cdo.ncols;
+	u32 col;
+	int ret;
+
+	ret = find_free_start_col(xrs, xrs->rgp.resbit, snode, ncols, &col);
+	if (ret)
+		return ret;
 
 	pt_node = kzalloc(sizeof(*pt_node), GFP_KERNEL);
 	if (!pt_node)
@@ -211,6 +381,7 @@ static int get_free_partition(struct solver_state *xrs,
 
 	list_add_tail(&pt_node->list, &xrs->rgp.pt_node_list);
 	xrs->rgp.npartition_node++;
+	xrs->rgp.col_part[pt_node->start_col] = pt_node;
 	bitmap_set(xrs->rgp.resbit, pt_node->start_col, pt_node->ncols);
 
 	snode->pt_node = pt_node;
@@ -218,6 +389,129 @@ static int get_free_partition(struct solver_state *xrs,
 	return 0;
 }
 
+/*
+ * plan_defrag() - Plan the moves that free @ncols columns from @col.
+ *
+ * Every partition in the range must be used by a single loaded context and
+ * must fit on one of its own start columns outside of the range and outside
+ * of the other destinations. Destinations are free columns now, so the
+ * moves do not depend on each other and can be done in any order.
+ */
+static int plan_defrag(struct solver_state *xrs, u32 col, u32 ncols,
+		       struct defrag_plan *plan)
+{
+	struct solver_rgroup *rgp = &xrs->rgp;
+	DECLARE_BITMAP(map, XRS_MAX_COL);
+	struct partition_node *pt_node;
+	struct solver_node *node;
+	u32 dest;
+
+	bitmap_copy(map, rgp->resbit, XRS_MAX_COL);
+	bitmap_set(map, col, ncols);
+	plan->start_col = col;
+	plan->nmoves = 0;
+
+	list_for_each_entry(node, &rgp->node_list, list) {
+		pt_node = node->pt_node;
+		if (pt_node->start_col >= col + ncols ||
+		    pt_node->start_col + pt_node->ncols <= col)
+			continue;
+
+		if (pt_node->nshared > 1 || !node->ctx)
+			return -ENODEV;
+
+		if (plan->nmoves == xrs->cfg.max_migrations)
+			return -ENODEV;
+
+		if (find_free_start_col(xrs, map, node, pt_node->ncols, &dest))
+			return -ENODEV;
+
+		bitmap_set(map, dest, pt_node->ncols);
+		plan->nodes[plan->nmoves] = node;
+		plan->dest_cols[plan->nmoves] = dest;
+		plan->nmoves++;
+	}
+
+	return 0;
+}
+
+static int migrate_node(struct solver_state *xrs, struct solver_node *node, u32 dest)
+{
+	struct partition_node *pt_node = node->pt_node;
+	struct xrs_action_load action;
+	int ret;
+
+	action.rid = node->rid;
+	action.part.start_col = dest;
+	action.part.ncols = pt_node->ncols;
+	ret = xrs->cfg.actions->migrate_hwctx(node->ctx, &action);
+	if (ret) {
+		xrs->stats.migrate_fail++;
+		drm_dbg(xrs->cfg.ddev, "migrate rid %lld failed, ret %d\n", node->rid, ret);
+		return ret;
+	}
+
+	drm_dbg(xrs->cfg.ddev, "migrate rid %lld from col %d to %d ncols %d\n",
+		node->rid, pt_node->start_col, dest, pt_node->ncols);
+	bitmap_clear(xrs->rgp.resbit, pt_node->start_col, pt_node->ncols);
+	bitmap_set(xrs->rgp.resbit, dest, pt_node->ncols);
+	xrs->rgp.col_part[pt_node->start_col] = NULL;
+	xrs->rgp.col_part[dest] = pt_node;
+	pt_node->start_col = dest;
+	xrs->stats.migrations++;
+
+	return 0;
+}
+
+/*
+ * defrag_partition() - Move loaded contexts to open a hole for the request.
+ *
+ * Only tried when there are enough free columns in total. The plan with the
+ * fewest moves wins. If a move fails, the moves done so far are kept, they
+ * are valid placements on their own.
+ */
+static int defrag_partition(struct solver_state *xrs,
+			    struct solver_node *snode,
+			    struct alloc_requests *req)
+{
+	struct defrag_plan plan, best = { .nmoves = U32_MAX };
+	u32 ncols = req->cdo.ncols;
+	u32 col, i;
+	int ret;
+
+	if (!xrs->cfg.max_migrations || !xrs->cfg.actions->migrate_hwctx)
+		return -ENODEV;
+
+	if (xrs->cfg.total_col - bitmap_weight(xrs->rgp.resbit, xrs->cfg.total_col) < ncols)
+		return -ENODEV;
+
+	for (i = 0; i < snode->cols_len; i++) {
+		col = snode->start_cols[i];
+		if (col + ncols > xrs->cfg.total_col)
+			continue;
+
+		if (plan_defrag(xrs, col, ncols, &plan))
+			continue;
+
+		if (plan.nmoves < best.nmoves)
+			best = plan;
+		if (best.nmoves == 1)
+			break;
+	}
+
+	if (best.nmoves == U32_MAX)
+		return -ENODEV;
+
+	for (i = 0; i < best.nmoves; i++) {
+		ret = migrate_node(xrs, best.nodes[i], best.dest_cols[i]);
+		if (ret)
+			return ret;
+	}
+
+	xrs->stats.defrag++;
+	return get_free_partition(xrs, snode, req);
+}
+
 static int allocate_partition(struct solver_state *xrs,
 			      struct solver_node *snode,
 			      struct alloc_requests *req)
@@ -229,24 +523,26 @@ static int allocate_partition(struct solver_state *xrs,
 	if (!ret)
 		return ret;
 
-	/* try to get a share-able partition */
-	list_for_each_entry(pt_node, &xrs->rgp.pt_node_list, list) {
-		if (pt_node->exclusive)
+	ret = defrag_partition(xrs, snode, req);
+	if (!ret)
+		return ret;
+
+	/* try to get a share-able partition, the least shared one */
+	for (idx = 0; idx < snode->cols_len; idx++) {
+		if (snode->start_cols[idx] >= xrs->cfg.total_col)
 			continue;
 
-		if (rpt_node && pt_node->nshared >= rpt_node->nshared)
+		pt_node = xrs->rgp.col_part[snode->start_cols[idx]];
+		if (!pt_node || pt_node->exclusive)
 			continue;
 
-		for (idx = 0; idx < snode->cols_len; idx++) {
-			if (snode->start_cols[idx] != pt_node->start_col)
-				continue;
+		if (req->cdo.ncols != pt_node->ncols)
+			continue;
 
-			if (req->cdo.ncols != pt_node->ncols)
-				continue;
+		if (rpt_node && pt_node->nshared >= rpt_node->nshared)
+			continue;
 
-			rpt_node = pt_node;
-			break;
-		}
+		rpt_node = pt_node;
 	}
 
 	if (!rpt_node)
@@ -270,6 +566,9 @@ static struct solver_node *create_solver_node(struct solver_state *xrs,
 		return ERR_PTR(-ENOMEM);
 
 	node->rid = req->rid;
+	node->qos_valid = is_valid_qos_dpm_params(&req->rqos);
+	node->opc = cdop->qos_cap.opc;
+	node->demand = (u64)calculate_gops(&req->rqos) * xrs->cfg.sys_eff_factor;
 	node->cols_len = cdop->cols_len;
 	memcpy(node->start_cols, cdop->start_cols, cdop->cols_len * sizeof(u32));
 
@@ -300,7 +599,6 @@ int xrs_allocate_resource(void *hdl, struct alloc_requests *req, struct amdxdna_
 	struct xrs_action_load load_act;
 	struct solver_node *snode;
 	struct solver_state *xrs;
-	u32 dpm_level;
 	int ret;
 
 	xrs = (struct solver_state *)hdl;
@@ -325,11 +623,10 @@ int xrs_allocate_resource(void *hdl, struct alloc_requests *req, struct amdxdna_
 	if (ret)
 		goto free_node;
 
-	ret = set_dpm_level(xrs, req, &dpm_level);
+	ret = update_dpm_level(xrs);
 	if (ret)
 		goto free_node;
 
-	snode->dpm_level = dpm_level;
 	snode->ctx = ctx;
 
 	drm_dbg(xrs->cfg.ddev, "start col %d ncols %d\n",
@@ -357,9 +654,25 @@ int xrs_release_resource(void *hdl, u64 rid)
 	xrs->cfg.actions->unload_hwctx(node->ctx);
 	remove_solver_node(&xrs->rgp, node);
 
+	if (update_dpm_level(xrs))
+		drm_warn(xrs->cfg.ddev, "update dpm level failed");
+
 	return 0;
 }
 
+int xrs_update_dpm(void *hdl)
+{
+	return update_dpm_level(hdl);
+}
+
+void xrs_get_stats(void *hdl, struct xrs_stats *stats)
+{
+	struct solver_state *xrs = hdl;
+
+	memcpy(stats, &xrs->stats, sizeof(*stats));
+	stats->dpm_level = xrs->gov.level;
+}
+
 void *xrsm_init(struct init_config *cfg)
 {
 	struct solver_rgroup *rgp;
@@ -370,6 +683,12 @@ void *xrsm_init(struct init_config *cfg)
 		return NULL;
 
 	memcpy(&xrs->cfg, cfg, sizeof(*cfg));
+	if (xrs->cfg.placement >= XRS_PLACEMENT_MAX)
+		xrs->cfg.placement = XRS_PLACEMENT_FIRST_FIT;
+	if (xrs->cfg.max_migrations > XRS_MAX_MIGRATIONS)
+		xrs->cfg.max_migrations = XRS_MAX_MIGRATIONS;
+
+	xrs->gov.level = DPM_LEVEL_UNSET;
 
 	rgp = &xrs->rgp;
 	INIT_LIST_HEAD(&rgp->node_list);
@@ -8,7 +8,8 @@
 
 #include <linux/types.h>
 
-#include "aie2_pci.h"
+struct amdxdna_ctx;
+struct drm_device;
 
 #define XRS_MAX_COL 128
 
@@ -80,17 +81,45 @@ struct clk_list_info {
 	u32        cu_clk_list[POWER_LEVEL_NUM];   /* available aie clock frequencies in Mhz*/
 };
 
+/*
+ * migrate_hwctx() is optional. It moves a loaded context to the partition in
+ * @action and returns 0, or leaves the context where it is and returns an
+ * error, e.g. -EBUSY when the context can not be moved right now.
+ */
 struct xrs_action_ops {
 	int (*load_hwctx)(struct amdxdna_ctx *ctx, struct xrs_action_load *action);
 	int (*unload_hwctx)(struct amdxdna_ctx *ctx);
+	int (*migrate_hwctx)(struct amdxdna_ctx *ctx, struct xrs_action_load *action);
 	int (*set_dft_dpm_level)(struct drm_device *ddev, u32 level);
+	/* Optional, call xrs_update_dpm() in delay_ns to finish a held drop */
+	void (*defer_dpm_update)(struct drm_device *ddev, u64 delay_ns);
+};
+
+/*
+ * Column placement policy used when a request is placed on free columns.
+ *
+ * XRS_PLACEMENT_FIRST_FIT: take the first free candidate start column.
+ * XRS_PLACEMENT_BEST_FIT:  take the candidate in the tightest free hole,
+ *			    placed at the edge of the hole, to limit
+ *			    fragmentation.
+ */
+enum xrs_placement {
+	XRS_PLACEMENT_FIRST_FIT = 0,
+	XRS_PLACEMENT_BEST_FIT,
+	XRS_PLACEMENT_MAX,
 };
 
+/* Upper bound of init_config.max_migrations */
+#define XRS_MAX_MIGRATIONS	4
+
 /*
  * Structure used to describe information for solver during initialization.
  */
 struct init_config {
 	u32			total_col;
+	u32			placement;	/* enum xrs_placement */
+	u32			max_migrations;	/* per request, 0 disables defrag */
+	u64			dpm_down_hold_ns; /* lower demand time before lowering DPM */
 	u32			sys_eff_factor; /* system efficiency factor */
 	u32			latency_adj;    /* latency adjustment in ms */
 	struct clk_list_info	clk_list;       /* List of frequencies available in system */
@@ -98,6 +127,17 @@ struct init_config {
 	struct xrs_action_ops	*actions;
 };
 
+/*
+ * Solver counters and state.
+ */
+struct xrs_stats {
+	u64	defrag;		/* requests placed after moving contexts */
+	u64	migrations;	/* contexts moved */
+	u64	migrate_fail;	/* moves refused or failed */
+	u64	dpm_changes;	/* set_dft_dpm_level() calls */
+	u32	dpm_level;	/* current level, U32_MAX before the first one */
+};
+
 /*
  * xrsm_init() - Register resource solver. Resource solver client needs
  *              to call this function to register itself.
@@ -136,4 +176,23 @@ int xrs_allocate_resource(void *hdl, struct alloc_requests *req, struct amdxdna_
  * @rid:	The Request ID to identify the requesting context
  */
 int xrs_release_resource(void *hdl, u64 rid);
+
+/*
+ * xrs_update_dpm() - Re-evaluate the DPM level without a context change.
+ *                    Called after the delay given to defer_dpm_update().
+ *
+ * @hdl:	Resource solver handle obtained from xrs_init()
+ *
+ * Return:	0 when successful.
+ *		Or the error returned by set_dft_dpm_level()
+ */
+int xrs_update_dpm(void *hdl);
+
+/*
+ * xrs_get_stats() - Get solver counters.
+ *
+ * @hdl:	Resource solver handle obtained from xrs_init()
+ * @stats:	Returns the counters
+ */
+void xrs_get_stats(void *hdl, struct xrs_stats *stats);
 #endif /* _AIE2_SOLVER_H */
@@ -23,6 +23,9 @@ struct amdxdna_fence {
 	struct amdxdna_ctx	*ctx;
 };
 
+static struct kmem_cache *amdxdna_job_cache;
+static struct kmem_cache *amdxdna_fence_cache;
+
 static const char *amdxdna_fence_get_driver_name(struct dma_fence *fence)
 {
 	return KBUILD_MODNAME;
@@ -32,27 +35,48 @@ static const char *amdxdna_fence_get_timeline_name(struct dma_fence *fence)
 {
 	struct amdxdna_fence *xdna_fence;
 
+	/* Out fences of direct jobs may outlive the context */
+	if (test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags))
+		return "signaled";
+
 	xdna_fence = container_of(fence, struct amdxdna_fence, base);
 
 	return xdna_fence->ctx->name;
 }
 
+static void amdxdna_fence_free_rcu(struct rcu_head *rcu)
+{
+	struct dma_fence *fence = container_of(rcu, struct dma_fence, rcu);
+
+	kmem_cache_free(amdxdna_fence_cache,
+			container_of(fence, struct amdxdna_fence, base));
+}
+
+/* Same as dma_fence_free(), RCU readers may still look at the fence */
+static void amdxdna_fence_release(struct dma_fence *fence)
+{
+	call_rcu(&fence->rcu, amdxdna_fence_free_rcu);
+}
+
 static const struct dma_fence_ops fence_ops = {
 	.get_driver_name = amdxdna_fence_get_driver_name,
 	.get_timeline_name = amdxdna_fence_get_timeline_name,
+	.release = amdxdna_fence_release,
 };
 
 static struct dma_fence *amdxdna_fence_create(struct amdxdna_ctx *ctx)
 {
 	struct amdxdna_fence *fence;
 
-	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	fence = kmem_cache_zalloc(amdxdna_fence_cache, GFP_KERNEL);
 	if (!fence)
 		return NULL;
 
+	atomic64_inc(&ctx->client->xdna->submit_stats.fence_alloc);
 	fence->ctx = ctx;
 	spin_lock_init(&fence->lock);
-	dma_fence_init(&fence->base, &fence_ops, &fence->lock, ctx->id, 0);
+	/* The backend sets seqno when the job gets its seq at submit */
+	dma_fence_init(&fence->base, &fence_ops, &fence->lock, ctx->fence_ctx, 0);
 	return &fence->base;
 }
 
@@ -63,6 +87,9 @@ static void amdxdna_ctx_destroy_rcu(struct amdxdna_ctx *ctx, struct srcu_struct
 	synchronize_srcu(ss);
 
 	xdna->dev_info->ops->ctx_fini(ctx);
+	amdxdna_resident_set_put(ctx->resident);
+	if (ctx->status_bo)
+		amdxdna_gem_put_obj(ctx->status_bo);
 	kfree(ctx->name);
 	kfree(ctx);
 }
@@ -93,7 +120,7 @@ int amdxdna_drm_create_ctx_ioctl(struct drm_device *dev, void *data, struct drm_
 	struct amdxdna_ctx *ctx;
 	int ret, idx;
 
-	if (args->ext || args->ext_flags)
+	if (args->ext || (args->ext_flags & ~AMDXDNA_CTX_FLAG_STATUS_BO) || args->pad)
 		return -EINVAL;
 
 	if (!drm_dev_enter(dev, &idx))
@@ -114,10 +141,13 @@ int amdxdna_drm_create_ctx_ioctl(struct drm_device *dev, void *data, struct drm_
 	if (ctx->qos.priority == AMDXDNA_QOS_DEFAULT_PRIORITY)
 		ctx->qos.priority = AMDXDNA_QOS_HIGH_PRIORITY;
 	ctx->client = client;
+	ctx->fence_ctx = dma_fence_context_alloc(1);
 	ctx->last_completed = -1;
+	spin_lock_init(&ctx->resident_lock);
 	ctx->num_tiles = args->num_tiles;
 	ctx->mem_size = args->mem_size;
 	ctx->max_opc = args->max_opc;
+	ctx->max_cmds = args->max_cmds;
 	ctx->umq_bo = args->umq_bo;
 	ctx->log_buf_bo = args->log_buf_bo;
 	ret = xa_alloc_cyclic(&client->ctx_xa, &ctx->id, ctx,
@@ -134,21 +164,47 @@ int amdxdna_drm_create_ctx_ioctl(struct drm_device *dev, void *data, struct drm_
 		goto rm_id;
 	}
 
+	/* Status is in place before the first command can complete */
+	if (args->ext_flags & AMDXDNA_CTX_FLAG_STATUS_BO) {
+		ctx->status_bo = amdxdna_gem_create_status_bo(dev, filp);
+		if (IS_ERR(ctx->status_bo)) {
+			ret = PTR_ERR(ctx->status_bo);
+			ctx->status_bo = NULL;
+			goto free_name;
+		}
+		ctx->status = ctx->status_bo->mem.kva;
+		memset(ctx->status, 0, sizeof(*ctx->status));
+	}
+
 	ret = xdna->dev_info->ops->ctx_init(ctx);
 	if (ret) {
 		XDNA_ERR(xdna, "Init ctx failed, ret %d", ret);
-		goto free_name;
+		goto put_status;
+	}
+
+	if (ctx->status_bo) {
+		ret = drm_gem_handle_create(filp, to_gobj(ctx->status_bo), &args->status_bo);
+		if (ret) {
+			XDNA_ERR(xdna, "Create status bo handle failed, ret %d", ret);
+			goto fini_ctx;
+		}
 	}
 
 	atomic64_set(&ctx->job_free_cnt, 0);
 	args->handle = ctx->id;
 	args->syncobj_handle = ctx->syncobj_hdl;
 	args->umq_doorbell = ctx->doorbell_offset;
+	args->max_cmds = ctx->max_cmds;
 
 	XDNA_DBG(xdna, "PID %d create context %d, ret %d", client->pid, args->handle, ret);
 	drm_dev_exit(idx);
 	return 0;
 
+fini_ctx:
+	xdna->dev_info->ops->ctx_fini(ctx);
+put_status:
+	if (ctx->status_bo)
+		amdxdna_gem_put_obj(ctx->status_bo);
 free_name:
 	kfree(ctx->name);
 rm_id:
@@ -205,6 +261,10 @@ int amdxdna_drm_config_ctx_ioctl(struct drm_device *dev, void *data, struct drm_
 	buf_size = args->param_val_size;
 
 	switch (args->param_type) {
+	case DRM_AMDXDNA_CTX_SET_RESIDENT_BOS:
+		if (!IS_ALIGNED(buf_size, sizeof(u32)))
+			return -EINVAL;
+		fallthrough;
 	case DRM_AMDXDNA_CTX_CONFIG_CU:
 		/* For those types that param_val is pointer */
 		if (buf_size > PAGE_SIZE) {
@@ -224,6 +284,8 @@ int amdxdna_drm_config_ctx_ioctl(struct drm_device *dev, void *data, struct drm_
 		break;
 	case DRM_AMDXDNA_CTX_ASSIGN_DBG_BUF:
 	case DRM_AMDXDNA_CTX_REMOVE_DBG_BUF:
+	case DRM_AMDXDNA_CTX_SEAL_CHAIN:
+	case DRM_AMDXDNA_CTX_UNSEAL_CHAIN:
 		/* For those types that param_val is a value */
 		buf = NULL;
 		buf_size = 0;
@@ -241,7 +303,10 @@ int amdxdna_drm_config_ctx_ioctl(struct drm_device *dev, void *data, struct drm_
 		goto unlock_srcu;
 	}
 
-	ret = xdna->dev_info->ops->ctx_config(ctx, args->param_type, val, buf, buf_size);
+	if (args->param_type == DRM_AMDXDNA_CTX_SET_RESIDENT_BOS)
+		ret = amdxdna_ctx_set_resident_bos(ctx, buf, buf_size / sizeof(u32));
+	else
+		ret = xdna->dev_info->ops->ctx_config(ctx, args->param_type, val, buf, buf_size);
 
 unlock_srcu:
 	srcu_read_unlock(&client->ctx_srcu, idx);
@@ -261,49 +326,261 @@ amdxdna_arg_bos_put(struct amdxdna_sched_job *job)
 	}
 }
 
+/* Look up an argument BO and pin it until the BO is freed */
+static struct drm_gem_object *
+amdxdna_arg_bo_get(struct amdxdna_client *client, u32 bo_hdl)
+{
+	struct drm_gem_object *gobj;
+	struct amdxdna_gem_obj *abo;
+	int ret;
+
+	gobj = drm_gem_object_lookup(client->filp, bo_hdl);
+	if (!gobj)
+		return ERR_PTR(-ENOENT);
+	abo = to_xdna_obj(gobj);
+
+	mutex_lock(&abo->lock);
+	if (abo->flags & BO_SUBMIT_PINNED) {
+		mutex_unlock(&abo->lock);
+		return gobj;
+	}
+
+	ret = amdxdna_gem_pin_nolock(abo);
+	if (ret) {
+		mutex_unlock(&abo->lock);
+		drm_gem_object_put(gobj);
+		return ERR_PTR(ret);
+	}
+	abo->flags |= BO_SUBMIT_PINNED;
+	mutex_unlock(&abo->lock);
+
+	return gobj;
+}
+
 static int
 amdxdna_arg_bos_lookup(struct amdxdna_client *client,
 		       struct amdxdna_sched_job *job,
 		       u32 *bo_hdls, u32 bo_cnt)
 {
 	struct drm_gem_object *gobj;
-	int i, ret;
+	int i;
 
 	job->bo_cnt = bo_cnt;
 	for (i = 0; i < job->bo_cnt; i++) {
-		struct amdxdna_gem_obj *abo;
+		gobj = amdxdna_arg_bo_get(client, bo_hdls[i]);
+		if (IS_ERR(gobj)) {
+			amdxdna_arg_bos_put(job);
+			return PTR_ERR(gobj);
+		}
+		job->bos[i].obj = gobj;
+	}
 
-		gobj = drm_gem_object_lookup(client->filp, bo_hdls[i]);
-		if (!gobj) {
-			ret = -ENOENT;
-			goto put_arg_bos;
+	return 0;
+}
+
+static void amdxdna_resident_set_release(struct kref *ref)
+{
+	struct amdxdna_resident_set *set;
+	int i;
+
+	set = container_of(ref, struct amdxdna_resident_set, refcnt);
+	for (i = 0; i < set->bo_cnt; i++)
+		drm_gem_object_put(set->bos[i]);
+	kfree(set);
+}
+
+void amdxdna_resident_set_put(struct amdxdna_resident_set *set)
+{
+	if (set)
+		kref_put(&set->refcnt, amdxdna_resident_set_release);
+}
+
+static struct amdxdna_resident_set *
+amdxdna_resident_set_lookup(struct amdxdna_client *client, u32 ctx_hdl)
+{
+	struct amdxdna_resident_set *set = NULL;
+	struct amdxdna_ctx *ctx;
+	int idx;
+
+	idx = srcu_read_lock(&client->ctx_srcu);
+	ctx = xa_load(&client->ctx_xa, ctx_hdl);
+	if (ctx) {
+		spin_lock(&ctx->resident_lock);
+		set = ctx->resident;
+		if (set)
+			kref_get(&set->refcnt);
+		spin_unlock(&ctx->resident_lock);
+	}
+	srcu_read_unlock(&client->ctx_srcu, idx);
+	return set;
+}
+
+/* Fence a resident BO through the resident object of the client from now on */
+static void amdxdna_resident_bo_share_resv(struct amdxdna_client *client,
+					   struct drm_gem_object *gobj)
+{
+	struct amdxdna_gem_obj *abo = to_xdna_obj(gobj);
+
+	mutex_lock(&abo->lock);
+	if (!is_import_bo(abo) && !gobj->dma_buf && !abo->exported && !abo->resident_obj) {
+		drm_gem_object_get(client->resident_obj);
+		WRITE_ONCE(abo->resident_obj, client->resident_obj);
+	}
+	mutex_unlock(&abo->lock);
+}
+
+static bool amdxdna_resident_bo_private(struct amdxdna_client *client,
+					struct drm_gem_object *gobj)
+{
+	struct amdxdna_gem_obj *abo = to_xdna_obj(gobj);
+
+	return READ_ONCE(abo->resident_obj) == client->resident_obj &&
+	       !READ_ONCE(abo->exported);
+}
+
+/*
+ * Give the job the resident BOs as argument BOs, what a lookup of their
+ * handles would do, after the resident object of the client. A BO whose
+ * handle was closed since the set was registered fails the submit, user
+ * space may be reusing the handle for another BO by now.
+ */
+static int
+amdxdna_resident_bos_get(struct amdxdna_client *client, struct amdxdna_sched_job *job,
+			 struct amdxdna_resident_set *set)
+{
+	struct drm_gem_object *gobj;
+	int i;
+
+	job->bo_cnt = set->bo_cnt + 1;
+	drm_gem_object_get(client->resident_obj);
+	job->bos[0].obj = client->resident_obj;
+	for (i = 0; i < set->bo_cnt; i++) {
+		gobj = set->bos[i];
+		if (!READ_ONCE(gobj->handle_count)) {
+			amdxdna_arg_bos_put(job);
+			return -ENOENT;
 		}
-		abo = to_xdna_obj(gobj);
+		drm_gem_object_get(gobj);
+		job->bos[i + 1].obj = gobj;
+		job->bos[i + 1].shared_resv = amdxdna_resident_bo_private(client, gobj);
+	}
 
-		mutex_lock(&abo->lock);
-		if (abo->flags & BO_SUBMIT_PINNED) {
-			mutex_unlock(&abo->lock);
-			job->bos[i].obj = gobj;
-			continue;
+	return 0;
+}
+
+/*
+ * Called with the BOs of the job locked. A resident BO exported since the
+ * submit looked at it is fenced directly, it has to be locked too.
+ */
+static bool amdxdna_resident_bos_exported(struct amdxdna_sched_job *job)
+{
+	bool exported = false;
+	int i;
+
+	for (i = 0; i < job->bo_cnt; i++) {
+		if (job->bos[i].shared_resv &&
+		    READ_ONCE(to_xdna_obj(job->bos[i].obj)->exported)) {
+			job->bos[i].shared_resv = false;
+			exported = true;
 		}
+	}
+	return exported;
+}
 
-		ret = amdxdna_gem_pin_nolock(abo);
-		if (ret) {
-			mutex_unlock(&abo->lock);
-			drm_gem_object_put(gobj);
-			goto put_arg_bos;
+/* Replace the resident BO set of @ctx, @bo_cnt 0 removes it */
+static int amdxdna_ctx_set_resident_bos(struct amdxdna_ctx *ctx, u32 *bo_hdls, u32 bo_cnt)
+{
+	struct amdxdna_client *client = ctx->client;
+	struct amdxdna_resident_set *set = NULL;
+	struct drm_gem_object *gobj;
+	int i;
+
+	if (bo_cnt) {
+		set = kzalloc(struct_size(set, bos, bo_cnt), GFP_KERNEL);
+		if (!set)
+			return -ENOMEM;
+
+		kref_init(&set->refcnt);
+		set->bo_cnt = bo_cnt;
+		for (i = 0; i < bo_cnt; i++) {
+			gobj = amdxdna_arg_bo_get(client, bo_hdls[i]);
+			if (IS_ERR(gobj)) {
+				XDNA_ERR(client->xdna, "Resident BO %d lookup failed", bo_hdls[i]);
+				set->bo_cnt = i;
+				amdxdna_resident_set_put(set);
+				return PTR_ERR(gobj);
+			}
+			set->bos[i] = gobj;
+			amdxdna_resident_bo_share_resv(client, gobj);
 		}
-		abo->flags |= BO_SUBMIT_PINNED;
-		mutex_unlock(&abo->lock);
+	}
 
-		job->bos[i].obj = gobj;
+	spin_lock(&ctx->resident_lock);
+	swap(ctx->resident, set);
+	spin_unlock(&ctx->resident_lock);
+
+	/* Submitted jobs hold their own reference to each BO */
+	amdxdna_resident_set_put(set);
+
+	XDNA_DBG(client->xdna, "%s has %d resident BOs", ctx->name, bo_cnt);
+	return 0;
+}
+
+int amdxdna_job_cache_init(void)
+{
+	struct amdxdna_sched_job *job;
+
+	amdxdna_job_cache = kmem_cache_create("amdxdna_job",
+					      struct_size(job, bos, AMDXDNA_JOB_INLINE_BOS),
+					      0, SLAB_HWCACHE_ALIGN, NULL);
+	if (!amdxdna_job_cache)
+		return -ENOMEM;
+
+	amdxdna_fence_cache = KMEM_CACHE(amdxdna_fence, SLAB_HWCACHE_ALIGN);
+	if (!amdxdna_fence_cache) {
+		kmem_cache_destroy(amdxdna_job_cache);
+		return -ENOMEM;
 	}
 
 	return 0;
+}
 
-put_arg_bos:
-	amdxdna_arg_bos_put(job);
-	return ret;
+void amdxdna_job_cache_fini(void)
+{
+	/* Wait for fences still in amdxdna_fence_free_rcu() */
+	rcu_barrier();
+	kmem_cache_destroy(amdxdna_fence_cache);
+	kmem_cache_destroy(amdxdna_job_cache);
+}
+
+static struct amdxdna_sched_job *
+amdxdna_sched_job_alloc(struct amdxdna_dev *xdna, u32 bo_cnt)
+{
+	struct amdxdna_sched_job *job;
+
+	if (bo_cnt > AMDXDNA_JOB_INLINE_BOS) {
+		job = kzalloc(struct_size(job, bos, bo_cnt), GFP_KERNEL);
+		if (job)
+			atomic64_inc(&xdna->submit_stats.job_kmalloc);
+		return job;
+	}
+
+	job = kmem_cache_zalloc(amdxdna_job_cache, GFP_KERNEL);
+	if (!job)
+		return NULL;
+
+	atomic64_inc(&xdna->submit_stats.job_cached);
+	job->cached = true;
+	return job;
+}
+
+void amdxdna_sched_job_free(struct amdxdna_dev *xdna, struct amdxdna_sched_job *job)
+{
+	atomic64_inc(&xdna->submit_stats.job_freed);
+	if (job->cached)
+		kmem_cache_free(amdxdna_job_cache, job);
+	else
+		kfree(job);
 }
 
 void amdxdna_sched_job_cleanup(struct amdxdna_sched_job *job)
@@ -331,7 +608,7 @@ retry:
 	}
 
 	for (i = 0; i < job->bo_cnt; i++) {
-		if (job->bos[i].locked)
+		if (job->bos[i].locked || job->bos[i].shared_resv)
 			continue;
 
 		ret = dma_resv_lock_interruptible(job->bos[i].obj->resv, ctx);
@@ -368,6 +645,17 @@ retry:
 		job->bos[i].locked = true;
 	}
 
+	if (amdxdna_resident_bos_exported(job)) {
+		for (i = 0; i < job->bo_cnt; i++) {
+			if (job->bos[i].locked) {
+				dma_resv_unlock(job->bos[i].obj->resv);
+				job->bos[i].locked = false;
+			}
+		}
+		contended = -1;
+		goto retry;
+	}
+
 	ww_acquire_done(ctx);
 
 	return 0;
@@ -393,15 +681,29 @@ int amdxdna_cmd_submit(struct amdxdna_client *client, u32 opcode,
 		       u32 *syncobj_hdls, u64 *syncobj_points, u32 syncobj_cnt,
 		       u32 ctx_hdl, u64 *seq)
 {
+	struct amdxdna_resident_set *set = NULL;
 	struct amdxdna_dev *xdna = client->xdna;
 	struct amdxdna_sched_job *job;
 	struct amdxdna_ctx *ctx;
 	int ret, idx;
 
 	XDNA_DBG(xdna, "Command BO hdl %d, Arg BO count %d", cmd_bo_hdl, arg_bo_cnt);
-	job = kzalloc(struct_size(job, bos, arg_bo_cnt), GFP_KERNEL);
-	if (!job)
-		return -ENOMEM;
+	/* A user command without argument BO handles runs on the resident BOs */
+	if (opcode == OP_USER && !arg_bo_hdls) {
+		set = amdxdna_resident_set_lookup(client, ctx_hdl);
+		if (!set) {
+			XDNA_ERR(xdna, "No resident BO on ctx %d", ctx_hdl);
+			return -EINVAL;
+		}
+		/* And the resident object of the client */
+		arg_bo_cnt = set->bo_cnt + 1;
+	}
+
+	job = amdxdna_sched_job_alloc(xdna, arg_bo_cnt);
+	if (!job) {
+		ret = -ENOMEM;
+		goto put_set;
+	}
 
 	if (cmd_bo_hdl != AMDXDNA_INVALID_BO_HANDLE) {
 		job->cmd_bo = amdxdna_gem_get_obj(client, cmd_bo_hdl, AMDXDNA_BO_CMD);
@@ -410,6 +712,11 @@ int amdxdna_cmd_submit(struct amdxdna_client *client, u32 opcode,
 			ret = -EINVAL;
 			goto free_job;
 		}
+		if (job->cmd_bo->flags & BO_USER_RDONLY) {
+			XDNA_ERR(xdna, "Cmd bo %d is read only", cmd_bo_hdl);
+			ret = -EINVAL;
+			goto cmd_put;
+		}
 	} else {
 		job->cmd_bo = NULL;
 		drm_WARN_ON(&xdna->ddev, opcode == OP_USER);
@@ -421,6 +728,12 @@ int amdxdna_cmd_submit(struct amdxdna_client *client, u32 opcode,
 			XDNA_ERR(xdna, "Argument BOs lookup failed, ret %d", ret);
 			goto cmd_put;
 		}
+	} else if (set) {
+		ret = amdxdna_resident_bos_get(client, job, set);
+		if (ret) {
+			XDNA_ERR(xdna, "Resident BO handle closed, ret %d", ret);
+			goto cmd_put;
+		}
 	}
 
 	idx = srcu_read_lock(&client->ctx_srcu);
@@ -459,6 +772,7 @@ int amdxdna_cmd_submit(struct amdxdna_client *client, u32 opcode,
 	 */
 	srcu_read_unlock(&client->ctx_srcu, idx);
 	trace_amdxdna_debug_point(ctx->name, *seq, "job pushed");
+	amdxdna_resident_set_put(set);
 
 	return 0;
 
@@ -470,7 +784,9 @@ unlock_srcu:
 cmd_put:
 	amdxdna_gem_put_obj(job->cmd_bo);
 free_job:
-	kfree(job);
+	amdxdna_sched_job_free(xdna, job);
+put_set:
+	amdxdna_resident_set_put(set);
 	return ret;
 }
 
@@ -483,11 +799,19 @@ static int amdxdna_drm_submit_execbuf(struct amdxdna_client *client,
 				      struct amdxdna_drm_exec_cmd *args)
 {
 	struct amdxdna_dev *xdna = client->xdna;
-	u32 *arg_bo_hdls;
+	u32 *arg_bo_hdls = NULL;
 	u32 cmd_bo_hdl;
+	bool resident;
 	int ret;
 
-	if (!args->arg_count || args->arg_count > MAX_ARG_COUNT) {
+	if (args->ext_flags & ~AMDXDNA_EXEC_CMD_FLAG_RESIDENT_BOS) {
+		XDNA_ERR(xdna, "Invalid flags 0x%llx", args->ext_flags);
+		return -EINVAL;
+	}
+
+	/* Either argument BOs, or the resident BOs of the context */
+	resident = args->ext_flags & AMDXDNA_EXEC_CMD_FLAG_RESIDENT_BOS;
+	if (resident ? args->arg_count : !args->arg_count || args->arg_count > MAX_ARG_COUNT) {
 		XDNA_ERR(xdna, "Invalid arg bo count %d", args->arg_count);
 		return -EINVAL;
 	}
@@ -499,6 +823,9 @@ static int amdxdna_drm_submit_execbuf(struct amdxdna_client *client,
 	}
 
 	cmd_bo_hdl = (u32)args->cmd_handles;
+	if (resident)
+		goto submit;
+
 	arg_bo_hdls = kcalloc(args->arg_count, sizeof(u32), GFP_KERNEL);
 	if (!arg_bo_hdls)
 		return -ENOMEM;
@@ -509,6 +836,7 @@ static int amdxdna_drm_submit_execbuf(struct amdxdna_client *client,
 		goto free_cmd_bo_hdls;
 	}
 
+submit:
 	ret = amdxdna_cmd_submit(client, OP_USER, cmd_bo_hdl, arg_bo_hdls,
 				 args->arg_count, NULL, NULL, 0, args->ctx, &args->seq);
 
@@ -645,7 +973,11 @@ int amdxdna_drm_submit_cmd_ioctl(struct drm_device *dev, void *data, struct drm_
 	struct amdxdna_client *client = filp->driver_priv;
 	struct amdxdna_drm_exec_cmd *args = data;
 
-	if (args->ext || args->ext_flags)
+	if (args->ext)
+		return -EINVAL;
+
+	/* Flags only apply to the command, not to dependency or signal */
+	if (args->ext_flags && args->type != AMDXDNA_CMD_SUBMIT_EXEC_BUF)
 		return -EINVAL;
 
 	switch (args->type) {
@@ -21,6 +21,9 @@
 #endif
 
 struct amdxdna_ctx_priv;
+struct amdxdna_dev;
+struct amdxdna_resident_set;
+struct amdxdna_sealed_chain;
 
 enum ert_cmd_opcode {
 	ERT_START_CU		= 0,
@@ -97,6 +100,7 @@ struct amdxdna_ctx {
 
 	u32				id;
 	u32				max_opc;
+	u32				max_cmds;
 	u32				num_tiles;
 	u32				mem_size;
 	u32				col_list_len;
@@ -119,10 +123,19 @@ struct amdxdna_ctx {
 	u64				last_completed;
 	/* For command completion notification. */
 	u32				syncobj_hdl;
+	/* Of the hardware fences, which are out fences of direct jobs too */
+	u64				fence_ctx;
+	/* Optional status page mapped by user, see struct amdxdna_ctx_status */
+	struct amdxdna_gem_obj		*status_bo;
+	struct amdxdna_ctx_status	*status;
+
+	spinlock_t			resident_lock; /* protects resident */
+	struct amdxdna_resident_set	*resident;
 
 	struct list_head		entry;
+	struct list_head		prio_entry;
 	struct work_struct		dispatch_work;
-	struct work_struct		yield_work;
+	struct delayed_work		yield_work;
 };
 
 #define drm_job_to_xdna_job(j) \
@@ -131,6 +144,44 @@ struct amdxdna_ctx {
 struct amdxdna_job_bo {
 	struct drm_gem_object   *obj;
 	bool			locked;
+	/* Resident BO fenced through the resident object, not locked */
+	bool			shared_resv;
+};
+
+/*
+ * struct amdxdna_resident_set - BOs registered once on a context
+ *
+ * Commands submitted with AMDXDNA_EXEC_CMD_FLAG_RESIDENT_BOS use the resident
+ * set of their context as argument BOs. The BOs are looked up and pinned when
+ * the set is registered, a submit only takes a reference on each of them.
+ *
+ * BOs private to the client share the resident object of the client for
+ * fencing, as BOs of a VM share its reservation object with VM_BIND. A
+ * submit locks it and adds its fence to it once, whatever the number of BOs.
+ * Waiting for such a BO also waits on the resident object. Imported and
+ * exported BOs are seen by other users, they are locked and fenced one by one
+ * like argument BOs.
+ */
+struct amdxdna_resident_set {
+	struct kref		refcnt;
+	u32			bo_cnt;
+	struct drm_gem_object	*bos[] __counted_by(bo_cnt);
+};
+
+/*
+ * Jobs with up to this many argument BOs come from a slab cache, bigger ones
+ * fall back to kzalloc.
+ */
+#define AMDXDNA_JOB_INLINE_BOS	8
+
+/* Allocations on the command submit path, shown in debugfs */
+struct amdxdna_submit_stats {
+	atomic64_t		job_cached;
+	atomic64_t		job_kmalloc;
+	atomic64_t		job_freed;
+	atomic64_t		fence_alloc;
+	atomic64_t		chain_alloc;
+	atomic64_t		direct; /* Jobs sent without the DRM scheduler */
 };
 
 struct amdxdna_sched_job {
@@ -151,7 +202,20 @@ struct amdxdna_sched_job {
 #define OP_NOOP			4
 	u32			opcode;
 	int			msg_id;
+	/* Another job runs right after this one, firmware can be notified later */
+	bool			msg_more;
+	/* Pushed to the scheduler with a syncobj dependency */
+	bool			has_deps;
 	struct amdxdna_gem_obj	*cmd_bo;
+	/* Command chain buffer, only for jobs sent as command list */
+	struct amdxdna_gem_obj	*cmd_buf;
+	/* Pre-encoded chain used instead of cmd_buf */
+	struct amdxdna_sealed_chain *sealed;
+	/* Direct job that failed to send, completed after the job before it */
+	struct dma_fence_cb	prev_cb;
+	struct work_struct	notify_work;
+	/* Allocated from amdxdna_job_cache */
+	bool			cached;
 	size_t			bo_cnt;
 	struct amdxdna_job_bo	bos[] __counted_by(bo_cnt);
 };
@@ -234,8 +298,29 @@ amdxdna_ctx_col_map(struct amdxdna_ctx *ctx)
 		       ctx->start_col);
 }
 
+/*
+ * Publish to the status page that every command with a seq below done has
+ * completed. The command states are written before, user space that sees
+ * the new count reads the final state.
+ */
+static inline void
+amdxdna_ctx_status_update(struct amdxdna_ctx *ctx, u64 done, u64 last_seq)
+{
+	struct amdxdna_ctx_status *status = ctx->status;
+
+	if (!status)
+		return;
+
+	WRITE_ONCE(status->last_seq, last_seq);
+	smp_store_release(&status->completed, done);
+}
+
 void amdxdna_ctx_wait_jobs(struct amdxdna_ctx *ctx, long timeout);
+int amdxdna_job_cache_init(void);
+void amdxdna_job_cache_fini(void);
+void amdxdna_sched_job_free(struct amdxdna_dev *xdna, struct amdxdna_sched_job *job);
 void amdxdna_sched_job_cleanup(struct amdxdna_sched_job *job);
+void amdxdna_resident_set_put(struct amdxdna_resident_set *set);
 void amdxdna_ctx_remove_all(struct amdxdna_client *client);
 
 int amdxdna_lock_objects(struct amdxdna_sched_job *job, struct ww_acquire_ctx *ctx);
@@ -37,6 +37,11 @@ static int amdxdna_drm_open(struct drm_device *ddev, struct drm_file *filp)
 
 	client->pid = pid_nr(filp->pid);
 	client->xdna = xdna;
+	client->resident_obj = amdxdna_gem_create_resv_obj(ddev);
+	if (!client->resident_obj) {
+		ret = -ENOMEM;
+		goto failed;
+	}
 
 #ifdef AMDXDNA_DEVEL
 	if (iommu_mode != AMDXDNA_IOMMU_PASID)
@@ -60,6 +65,7 @@ skip_sva_bind:
 	init_srcu_struct(&client->ctx_srcu);
 	xa_init_flags(&client->ctx_xa, XA_FLAGS_ALLOC);
 	mutex_init(&client->mm_lock);
+	amdxdna_heap_slab_init(client->heap_slabs);
 
 	mutex_lock(&xdna->dev_lock);
 	list_add_tail(&client->node, &xdna->client_list);
@@ -79,6 +85,7 @@ skip_sva_bind:
 unbind_sva:
 	iommu_sva_unbind_device(client->sva);
 failed:
+	drm_gem_object_put(client->resident_obj);
 	kfree(client);
 put_rpm:
 	pm_runtime_mark_last_busy(ddev->dev);
@@ -91,14 +98,18 @@ static void amdxdna_drm_close(struct drm_device *ddev, struct drm_file *filp)
 {
 	struct amdxdna_client *client = filp->driver_priv;
 	struct amdxdna_dev *xdna = to_xdna_dev(ddev);
+	u32 i;
 
 	XDNA_DBG(xdna, "Closing PID %d", client->pid);
 
 	xa_destroy(&client->ctx_xa);
 	cleanup_srcu_struct(&client->ctx_srcu);
 	mutex_destroy(&client->mm_lock);
-	if (client->dev_heap)
-		drm_gem_object_put(to_gobj(client->dev_heap));
+	amdxdna_heap_slab_fini(client->heap_slabs);
+	for (i = 0; i < client->nr_heap_chunks; i++)
+		drm_gem_object_put(to_gobj(client->heap_chunks[i]));
+	/* Jobs still running hold their own reference */
+	drm_gem_object_put(client->resident_obj);
 
 #ifdef AMDXDNA_DEVEL
 	if (iommu_mode != AMDXDNA_IOMMU_PASID)
@@ -198,6 +209,7 @@ static const struct drm_ioctl_desc amdxdna_drm_ioctls[] = {
 	DRM_IOCTL_DEF_DRV(AMDXDNA_CREATE_BO, amdxdna_drm_create_bo_ioctl, 0),
 	DRM_IOCTL_DEF_DRV(AMDXDNA_GET_BO_INFO, amdxdna_drm_get_bo_info_ioctl, 0),
 	DRM_IOCTL_DEF_DRV(AMDXDNA_SYNC_BO, amdxdna_drm_sync_bo_ioctl, 0),
+	DRM_IOCTL_DEF_DRV(AMDXDNA_CREATE_BOS, amdxdna_drm_create_bos_ioctl, 0),
 	/* Exectuion */
 	DRM_IOCTL_DEF_DRV(AMDXDNA_EXEC_CMD, amdxdna_drm_submit_cmd_ioctl, 0),
 	DRM_IOCTL_DEF_DRV(AMDXDNA_WAIT_CMD, amdxdna_drm_wait_cmd_ioctl, 0),
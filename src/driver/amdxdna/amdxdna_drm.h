@@ -37,6 +37,8 @@
 
 extern const struct drm_driver amdxdna_drm_drv;
 
+#define AMDXDNA_MAX_HEAP_CHUNKS	8
+
 struct amdxdna_dev;
 struct amdxdna_client;
 struct amdxdna_dev_hdl;
@@ -124,6 +126,8 @@ struct amdxdna_dev {
 #endif
 	struct rw_semaphore		notifier_lock; /* for mmu notifier */
 	struct workqueue_struct		*notifier_wq;
+	struct amdxdna_submit_stats	submit_stats;
+	struct vfsmount			*gemfs; /* tmpfs for huge page share BOs */
 };
 
 struct amdxdna_stats {
@@ -144,7 +148,13 @@ struct amdxdna_stats {
  * @xdna: XDNA device pointer
  * @filp: DRM file pointer
  * @mm_lock: lock for client wide memory related
- * @dev_heap: Shared device heap memory
+ * @dev_heap: First chunk of the device heap, its allocator covers all chunks
+ * @heap_chunks: Device heap chunks, back to back in device address
+ * @nr_heap_chunks: Number of heap chunks
+ * @nr_heap_usable: Leading heap chunks mapped back to back in user space
+ * @heap_size: Size of all heap chunks
+ * @heap_usable_size: Size of the usable heap chunks
+ * @heap_slabs: Slab size classes for small DEV BOs
  * @sva: iommu SVA handle
  * @pasid: PASID
  * @stats: record npu usage stats
@@ -161,6 +171,14 @@ struct amdxdna_client {
 
 	struct mutex			mm_lock; /* protect memory related */
 	struct amdxdna_gem_obj		*dev_heap;
+	struct amdxdna_gem_obj		*heap_chunks[AMDXDNA_MAX_HEAP_CHUNKS];
+	u32				nr_heap_chunks;
+	u32				nr_heap_usable;
+	u64				heap_size;
+	u64				heap_usable_size;
+	struct amdxdna_heap_slab_class	heap_slabs[AMDXDNA_HEAP_SLAB_CLASSES];
+	/* Fenced by resident submits instead of their BOs */
+	struct drm_gem_object		*resident_obj;
 
 	struct iommu_sva		*sva;
 	int				pasid;
@@ -6,9 +6,13 @@
 #include "drm_local/amdxdna_accel.h"
 #include <linux/dma-buf.h>
 #include <linux/dma-direct.h>
+#include <linux/fs.h>
+#include <linux/huge_mm.h>
 #include <linux/iosys-map.h>
+#include <linux/mount.h>
 #include <linux/pagemap.h>
 #include <linux/pfn.h>
+#include <linux/seq_file.h>
 #include <linux/version.h>
 #include <linux/vmalloc.h>
 #include <drm/drm_cache.h>
@@ -21,6 +25,12 @@
 #endif
 
 #define XDNA_MAX_CMD_BO_SIZE	SZ_32K
+#define XDNA_BO_FLAGS		(AMDXDNA_BO_FLAG_INFO | AMDXDNA_BO_FLAG_HUGE)
+
+/* Needs vmf_insert_folio_pmd() and drm_gem_shmem_create_with_mnt() */
+#if defined(CONFIG_TRANSPARENT_HUGEPAGE) && KERNEL_VERSION(6, 15, 0) <= LINUX_VERSION_CODE
+#define XDNA_HUGE_BO
+#endif
 
 #if KERNEL_VERSION(6, 13, 0) > LINUX_VERSION_CODE
 MODULE_IMPORT_NS(DMA_BUF);
@@ -28,72 +38,233 @@ MODULE_IMPORT_NS(DMA_BUF);
 MODULE_IMPORT_NS("DMA_BUF");
 #endif
 
+/*
+ * A heap chunk is usable once user space mapped it right after the chunk
+ * before it, so that a DEV BO spanning chunks has one user VA range.
+ */
+static void amdxdna_gem_heap_grow_locked(struct amdxdna_client *client)
+{
+	struct amdxdna_gem_obj *heap = client->dev_heap;
+	struct amdxdna_gem_obj *chunk;
+	u64 offset;
+
+	while (client->nr_heap_usable < client->nr_heap_chunks) {
+		chunk = client->heap_chunks[client->nr_heap_usable];
+		offset = chunk->mem.dev_addr - heap->mem.dev_addr;
+		if (chunk->mem.userptr == AMDXDNA_INVALID_ADDR ||
+		    chunk->mem.userptr != heap->mem.userptr + offset)
+			break;
+
+		client->heap_usable_size = offset + chunk->mem.size;
+		/* Pairs with aie2_hwctx_map_heap() reading the chunks */
+		smp_store_release(&client->nr_heap_usable, client->nr_heap_usable + 1);
+	}
+}
+
+/* Index of the heap chunk holding dev_addr */
+static u32 amdxdna_gem_heap_chunk(struct amdxdna_client *client, u64 dev_addr)
+{
+	struct amdxdna_gem_obj *chunk;
+	u32 i;
+
+	for (i = 0; i < client->nr_heap_chunks - 1; i++) {
+		chunk = client->heap_chunks[i];
+		if (dev_addr < chunk->mem.dev_addr + chunk->mem.size)
+			break;
+	}
+	return i;
+}
+
+/*
+ * Pages of a DEV BO are the heap pages if the heap has them. A BO spanning
+ * heap chunks gets its own array of them.
+ */
+static int amdxdna_gem_heap_pages(struct amdxdna_gem_obj *abo)
+{
+	struct amdxdna_client *client = abo->client;
+	struct amdxdna_mem *mem = &abo->mem;
+	struct amdxdna_gem_obj *chunk;
+	u32 first, last, i, c;
+	u64 offset;
+
+	first = amdxdna_gem_heap_chunk(client, mem->dev_addr);
+	last = amdxdna_gem_heap_chunk(client, mem->dev_addr + mem->size - 1);
+	for (c = first; c <= last; c++) {
+		if (!client->heap_chunks[c]->base.pages)
+			return 0;
+	}
+
+	mem->nr_pages = mem->size >> PAGE_SHIFT;
+	chunk = client->heap_chunks[first];
+	offset = mem->dev_addr - chunk->mem.dev_addr;
+	if (first == last) {
+		mem->pages = &chunk->base.pages[offset >> PAGE_SHIFT];
+		return 0;
+	}
+
+	mem->pages = kvmalloc_array(mem->nr_pages, sizeof(*mem->pages), GFP_KERNEL);
+	if (!mem->pages)
+		return -ENOMEM;
+
+	for (i = 0, c = first; i < mem->nr_pages; i++, offset += PAGE_SIZE) {
+		if (offset == client->heap_chunks[c]->mem.size) {
+			offset = 0;
+			c++;
+		}
+		mem->pages[i] = client->heap_chunks[c]->base.pages[offset >> PAGE_SHIFT];
+	}
+	abo->flags |= BO_HEAP_PAGES;
+	return 0;
+}
+
+static void
+amdxdna_gem_heap_release_locked(struct amdxdna_gem_obj *abo)
+{
+	if (abo->slab) {
+		amdxdna_heap_slab_free(abo->slab, abo->mem.dev_addr, abo->mem.size);
+		abo->slab = NULL;
+	} else {
+		drm_mm_remove_node(&abo->mm_node);
+	}
+}
+
 static int
-amdxdna_gem_heap_alloc(struct amdxdna_gem_obj *abo)
+amdxdna_gem_heap_alloc_locked(struct amdxdna_gem_obj *abo)
 {
 	struct amdxdna_client *client = abo->client;
 	struct amdxdna_dev *xdna = client->xdna;
 	struct amdxdna_mem *mem = &abo->mem;
 	struct amdxdna_gem_obj *heap;
-	u64 offset;
+	u64 start, end;
 	u32 align;
 	int ret;
 
-	mutex_lock(&client->mm_lock);
+	lockdep_assert_held(&client->mm_lock);
 
 	heap = client->dev_heap;
-	if (!heap) {
-		mutex_unlock(&client->mm_lock);
+	if (!heap)
 		return -EINVAL;
-	}
 
-	if (heap->mem.userptr == AMDXDNA_INVALID_ADDR) {
+	amdxdna_gem_heap_grow_locked(client);
+	if (!client->nr_heap_usable) {
 		XDNA_ERR(xdna, "Invalid dev heap userptr");
-		mutex_unlock(&client->mm_lock);
 		return -EINVAL;
 	}
 
-	if (mem->size == 0 || mem->size > heap->mem.size) {
+	if (mem->size == 0 || mem->size > xdna->dev_info->dev_mem_size) {
 		XDNA_ERR(xdna, "Invalid dev bo size 0x%lx, limit 0x%lx",
-			 mem->size, heap->mem.size);
-		mutex_unlock(&client->mm_lock);
+			 mem->size, xdna->dev_info->dev_mem_size);
 		return -EINVAL;
 	}
 
 	align = 1 << max(PAGE_SHIFT, xdna->dev_info->dev_mem_buf_shift);
-	ret = drm_mm_insert_node_generic(&heap->mm, &abo->mm_node, mem->size,
-					 align, 0, DRM_MM_INSERT_BEST);
+	start = heap->mem.dev_addr;
+	end = start + client->heap_usable_size;
+	ret = amdxdna_heap_slab_alloc(client->heap_slabs, &heap->mm, mem->size, align,
+				      start, end, &abo->slab, &mem->dev_addr);
+
+	/* Large BO, or no room for another slab. -ENOSPC tells user space to add a heap chunk */
+	if (ret == -ENOSPC) {
+		ret = amdxdna_heap_insert(client->heap_slabs, &heap->mm, &abo->mm_node,
+					  mem->size, align, start, end);
+		if (!ret)
+			mem->dev_addr = abo->mm_node.start;
+	}
 	if (ret) {
-		XDNA_ERR(xdna, "Failed to alloc dev bo memory, ret %d", ret);
-		mutex_unlock(&client->mm_lock);
+		XDNA_DBG(xdna, "Failed to alloc dev bo memory, ret %d", ret);
 		return ret;
 	}
 
-	mem->dev_addr = abo->mm_node.start;
-	offset = mem->dev_addr - client->dev_heap->mem.dev_addr;
-	mem->userptr = client->dev_heap->mem.userptr + offset;
-	if (client->dev_heap->base.pages) {
-		mem->pages = &client->dev_heap->base.pages[offset >> PAGE_SHIFT];
-		mem->nr_pages = mem->size >> PAGE_SHIFT;
+	mem->userptr = heap->mem.userptr + (mem->dev_addr - heap->mem.dev_addr);
+	ret = amdxdna_gem_heap_pages(abo);
+	if (ret) {
+		amdxdna_gem_heap_release_locked(abo);
+		return ret;
 	}
 
 	drm_gem_object_get(to_gobj(heap));
-
-	mutex_unlock(&client->mm_lock);
 	return 0;
 }
 
+static int
+amdxdna_gem_heap_alloc(struct amdxdna_gem_obj *abo)
+{
+	int ret;
+
+	mutex_lock(&abo->client->mm_lock);
+	ret = amdxdna_gem_heap_alloc_locked(abo);
+	mutex_unlock(&abo->client->mm_lock);
+	return ret;
+}
+
 static void
 amdxdna_gem_heap_free(struct amdxdna_gem_obj *abo)
 {
 	mutex_lock(&abo->client->mm_lock);
 
-	drm_mm_remove_node(&abo->mm_node);
-	drm_gem_object_put(to_gobj(abo->client->dev_heap));
+	/* Not allocated if creating the BO failed */
+	if (abo->slab || drm_mm_node_allocated(&abo->mm_node)) {
+		amdxdna_gem_heap_release_locked(abo);
+		drm_gem_object_put(to_gobj(abo->client->dev_heap));
+	}
+	if (abo->flags & BO_HEAP_PAGES)
+		kvfree(abo->mem.pages);
 
 	mutex_unlock(&abo->client->mm_lock);
 }
 
+/* Free space, fragmentation and slab usage of the usable heap */
+void amdxdna_gem_heap_show(struct amdxdna_client *client, struct seq_file *m)
+{
+	u64 hole_start, hole_end, heap_end, free = 0, largest = 0, frag = 0;
+	u64 slab_free = 0, slab_waste = 0;
+	struct amdxdna_heap_slab_class *class;
+	struct amdxdna_gem_obj *heap;
+	struct drm_mm_node *hole;
+	u32 nr_holes = 0;
+	int i;
+
+	mutex_lock(&client->mm_lock);
+	heap = client->dev_heap;
+	if (!heap)
+		goto unlock;
+
+	heap_end = heap->mem.dev_addr + client->heap_usable_size;
+	drm_mm_for_each_hole(hole, &heap->mm, hole_start, hole_end) {
+		hole_end = min(hole_end, heap_end);
+		if (hole_start >= hole_end)
+			continue;
+		free += hole_end - hole_start;
+		largest = max(largest, hole_end - hole_start);
+		nr_holes++;
+	}
+	for (i = 0; i < AMDXDNA_HEAP_SLAB_CLASSES; i++) {
+		class = &client->heap_slabs[i];
+		slab_free += (u64)class->nr_free * class->obj_size;
+		slab_waste += (u64)class->nr_objs * class->obj_size - class->used_bytes;
+	}
+	/* Free slab objects only take BOs of their class, count them as fragments */
+	if (free + slab_free)
+		frag = 100 - div64_u64(largest * 100, free + slab_free);
+
+	seq_printf(m, "pid %d: heap 0x%llx usable 0x%llx chunks %u/%u\n", client->pid,
+		   client->heap_size, client->heap_usable_size,
+		   client->nr_heap_usable, client->nr_heap_chunks);
+	seq_printf(m, "  free 0x%llx holes %u largest 0x%llx fragmentation %llu%%\n",
+		   free, nr_holes, largest, frag);
+	seq_printf(m, "  slab free 0x%llx waste 0x%llx\n", slab_free, slab_waste);
+	for (i = 0; i < AMDXDNA_HEAP_SLAB_CLASSES; i++) {
+		class = &client->heap_slabs[i];
+		if (!class->nr_allocs)
+			continue;
+		seq_printf(m, "  slab %uK: slabs %u objs %u free %u allocs %llu\n",
+			   class->obj_size >> 10, class->nr_slabs, class->nr_objs,
+			   class->nr_free, class->nr_allocs);
+	}
+unlock:
+	mutex_unlock(&client->mm_lock);
+}
+
 static bool amdxdna_hmm_invalidate(struct mmu_interval_notifier *mni,
 				   const struct mmu_notifier_range *range,
 				   unsigned long cur_seq)
@@ -266,6 +437,7 @@ amdxdna_gem_create_obj(struct drm_device *dev, size_t size)
 static void
 amdxdna_gem_destroy_obj(struct amdxdna_gem_obj *abo)
 {
+	drm_gem_object_put(abo->resident_obj);
 	mutex_destroy(&abo->lock);
 	kfree(abo);
 }
@@ -333,7 +505,8 @@ static void amdxdna_gem_shmem_obj_free(struct drm_gem_object *gobj)
 	if (abo->flags & BO_SUBMIT_PINNED)
 		amdxdna_gem_unpin(abo);
 
-	if (abo->type == AMDXDNA_BO_DEV_HEAP)
+	/* Only the first heap chunk has the allocator */
+	if (abo->type == AMDXDNA_BO_DEV_HEAP && drm_mm_initialized(&abo->mm))
 		drm_mm_takedown(&abo->mm);
 
 #ifdef AMDXDNA_DEVEL
@@ -343,10 +516,127 @@ static void amdxdna_gem_shmem_obj_free(struct drm_gem_object *gobj)
 		amdxdna_bo_dma_unmap(abo);
 #endif
 	amdxdna_gem_vunmap(abo);
+	drm_gem_object_put(abo->resident_obj);
 	mutex_destroy(&abo->lock);
 	drm_gem_shmem_free(&abo->base);
 }
 
+/* drm_gem_shmem_vm_ops with the faults below, set up with gemfs */
+static struct vm_operations_struct amdxdna_gem_huge_vm_ops;
+
+#ifdef XDNA_HUGE_BO
+static vm_fault_t amdxdna_gem_huge_pte_fault(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	struct amdxdna_gem_obj *abo = to_xdna_obj(vma->vm_private_data);
+	pgoff_t pgoff = (vmf->address - vma->vm_start) >> PAGE_SHIFT;
+
+	if (pgoff >= to_gobj(abo)->size >> PAGE_SHIFT)
+		return VM_FAULT_SIGBUS;
+
+	return vmf_insert_page(vma, vmf->address, abo->base.pages[pgoff]);
+}
+
+/* Pages of the BO stay while it is mapped, the vma holds them */
+static vm_fault_t amdxdna_gem_huge_fault(struct vm_fault *vmf, unsigned int order)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	struct amdxdna_gem_obj *abo = to_xdna_obj(vma->vm_private_data);
+	unsigned long addr = vmf->address & PMD_MASK;
+	struct folio *folio;
+	struct page *page;
+	pgoff_t pgoff;
+
+	if (order != PMD_ORDER || addr < vma->vm_start || addr + PMD_SIZE > vma->vm_end)
+		return VM_FAULT_FALLBACK;
+
+	pgoff = (addr - vma->vm_start) >> PAGE_SHIFT;
+	if (pgoff + HPAGE_PMD_NR > to_gobj(abo)->size >> PAGE_SHIFT)
+		return VM_FAULT_FALLBACK;
+
+	/* tmpfs puts small pages where a huge one is not available */
+	page = abo->base.pages[pgoff];
+	folio = page_folio(page);
+	if (folio_order(folio) != PMD_ORDER || folio_page(folio, 0) != page)
+		return VM_FAULT_FALLBACK;
+
+	return vmf_insert_folio_pmd(vmf, folio, vmf->flags & FAULT_FLAG_WRITE);
+}
+
+/*
+ * Share BOs with AMDXDNA_BO_FLAG_HUGE come from a tmpfs that allocates huge
+ * pages within the file size. Without it they are regular share BOs.
+ */
+void amdxdna_gem_huge_init(struct amdxdna_dev *xdna)
+{
+	char huge_opt[] = "huge=within_size";
+	struct file_system_type *type;
+	struct vfsmount *gemfs;
+
+	type = get_fs_type("tmpfs");
+	if (!type)
+		goto no_huge;
+
+	gemfs = vfs_kern_mount(type, SB_KERNMOUNT, type->name, huge_opt);
+	if (IS_ERR(gemfs))
+		goto no_huge;
+
+	amdxdna_gem_huge_vm_ops = drm_gem_shmem_vm_ops;
+	amdxdna_gem_huge_vm_ops.fault = amdxdna_gem_huge_pte_fault;
+	amdxdna_gem_huge_vm_ops.huge_fault = amdxdna_gem_huge_fault;
+	xdna->gemfs = gemfs;
+	XDNA_DBG(xdna, "Huge page share BO enabled");
+	return;
+
+no_huge:
+	XDNA_WARN(xdna, "Huge page share BO not available");
+}
+
+void amdxdna_gem_huge_fini(struct amdxdna_dev *xdna)
+{
+	if (!xdna->gemfs)
+		return;
+
+	kern_unmount(xdna->gemfs);
+	xdna->gemfs = NULL;
+}
+
+static struct amdxdna_gem_obj *
+amdxdna_gem_create_huge_object(struct drm_device *dev, struct amdxdna_drm_create_bo *args)
+{
+	struct amdxdna_dev *xdna = to_xdna_dev(dev);
+	struct drm_gem_shmem_object *shmem;
+	struct amdxdna_gem_obj *abo;
+
+	if (!(args->flags & AMDXDNA_BO_FLAG_HUGE) || !xdna->gemfs ||
+	    amdxdna_use_carvedout() || args->size < HPAGE_PMD_SIZE)
+		return NULL;
+
+	shmem = drm_gem_shmem_create_with_mnt(dev, PAGE_ALIGN(args->size), xdna->gemfs);
+	if (IS_ERR(shmem))
+		return ERR_CAST(shmem);
+
+	shmem->map_wc = false;
+	abo = to_xdna_obj(&shmem->base);
+	abo->flags |= BO_HUGE;
+	return abo;
+}
+#else
+void amdxdna_gem_huge_init(struct amdxdna_dev *xdna)
+{
+}
+
+void amdxdna_gem_huge_fini(struct amdxdna_dev *xdna)
+{
+}
+
+static struct amdxdna_gem_obj *
+amdxdna_gem_create_huge_object(struct drm_device *dev, struct amdxdna_drm_create_bo *args)
+{
+	return NULL;
+}
+#endif
+
 static int amdxdna_gem_shmem_insert_pages(struct amdxdna_gem_obj *abo,
 					  struct vm_area_struct *vma)
 {
@@ -364,6 +654,13 @@ static int amdxdna_gem_shmem_insert_pages(struct amdxdna_gem_obj *abo,
 
 		/* The buffer is based on memory pages. Fix the flag. */
 		vm_flags_mod(vma, VM_MIXEDMAP, VM_PFNMAP);
+		if (abo->flags & BO_HUGE) {
+			/* Mapped on fault, by PMD where it can */
+			vma->vm_ops = &amdxdna_gem_huge_vm_ops;
+			vm_flags_set(vma, VM_HUGEPAGE);
+			return 0;
+		}
+
 		ret = vm_insert_pages(vma, vma->vm_start, abo->base.pages,
 				      &num_pages);
 		if (ret) {
@@ -403,6 +700,19 @@ static int amdxdna_gem_shmem_insert_pages(struct amdxdna_gem_obj *abo,
 	return 0;
 }
 
+static int amdxdna_gem_mmap_check(struct amdxdna_gem_obj *abo, struct vm_area_struct *vma)
+{
+	if (!(abo->flags & BO_USER_RDONLY))
+		return 0;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	/* No mprotect() to writable later */
+	vm_flags_clear(vma, VM_MAYWRITE);
+	return 0;
+}
+
 static int amdxdna_gem_shmem_obj_mmap(struct drm_gem_object *gobj,
 				      struct vm_area_struct *vma)
 {
@@ -410,6 +720,10 @@ static int amdxdna_gem_shmem_obj_mmap(struct drm_gem_object *gobj,
 	struct amdxdna_gem_obj *abo = to_xdna_obj(gobj);
 	int ret;
 
+	ret = amdxdna_gem_mmap_check(abo, vma);
+	if (ret)
+		return ret;
+
 	ret = amdxdna_hmm_register(abo, vma);
 	if (ret)
 		return ret;
@@ -472,6 +786,10 @@ static int amdxdna_gem_carvedout_obj_mmap(struct drm_gem_object *gobj,
 	struct amdxdna_gem_obj *abo = to_xdna_obj(gobj);
 	int ret;
 
+	ret = amdxdna_gem_mmap_check(abo, vma);
+	if (ret)
+		return ret;
+
 	ret = amdxdna_hmm_register(abo, vma);
 	if (ret)
 		return ret;
@@ -501,6 +819,10 @@ static int amdxdna_gem_dmabuf_mmap(struct dma_buf *dma_buf, struct vm_area_struc
 	unsigned long num_pages = vma_pages(vma);
 	int ret;
 
+	ret = amdxdna_gem_mmap_check(abo, vma);
+	if (ret)
+		return ret;
+
 	vma->vm_ops = &drm_gem_shmem_vm_ops;
 	vma->vm_private_data = gobj;
 
@@ -588,9 +910,55 @@ static const struct dma_buf_ops amdxdna_dmabuf_ops = {
 	.vunmap = drm_gem_dmabuf_vunmap,
 };
 
+/*
+ * Resident submits fence a BO only through the resident object of its client,
+ * see amdxdna_resident_bos_get(). Importers look at the BO itself, so from now
+ * on submits fence the BO directly and it gets the fences of those before.
+ * A submit checks exported with the resident object locked, it either sees
+ * it set or its fence is on the resident object already.
+ */
+static int amdxdna_gem_resident_export(struct amdxdna_gem_obj *abo)
+{
+	struct drm_gem_object *gobj = to_gobj(abo);
+	struct drm_gem_object *robj;
+	struct dma_fence *fence;
+	int ret;
+
+	mutex_lock(&abo->lock);
+	abo->exported = true;
+	robj = abo->resident_obj;
+	mutex_unlock(&abo->lock);
+	if (!robj)
+		return 0;
+
+	ret = dma_resv_lock_interruptible(robj->resv, NULL);
+	if (ret)
+		return ret;
+	ret = dma_resv_get_singleton(robj->resv, DMA_RESV_USAGE_WRITE, &fence);
+	dma_resv_unlock(robj->resv);
+	if (ret || !fence)
+		return ret;
+
+	ret = dma_resv_lock_interruptible(gobj->resv, NULL);
+	if (ret)
+		goto put_fence;
+	ret = dma_resv_reserve_fences(gobj->resv, 1);
+	if (!ret)
+		dma_resv_add_fence(gobj->resv, fence, DMA_RESV_USAGE_WRITE);
+	dma_resv_unlock(gobj->resv);
+put_fence:
+	dma_fence_put(fence);
+	return ret;
+}
+
 static struct dma_buf *amdxdna_gem_prime_export(struct drm_gem_object *gobj, int flags)
 {
 	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	int ret;
+
+	ret = amdxdna_gem_resident_export(to_xdna_obj(gobj));
+	if (ret)
+		return ERR_PTR(ret);
 
 	exp_info.ops = &amdxdna_dmabuf_ops;
 	exp_info.size = gobj->size;
@@ -780,7 +1148,9 @@ amdxdna_drm_create_share_bo(struct drm_device *dev,
 	struct amdxdna_client *client = filp->driver_priv;
 	struct amdxdna_gem_obj *abo;
 
-	abo = amdxdna_gem_create_share_object(dev, args->size);
+	abo = amdxdna_gem_create_huge_object(dev, args);
+	if (!abo)
+		abo = amdxdna_gem_create_share_object(dev, args->size);
 	if (IS_ERR(abo))
 		return ERR_CAST(abo);
 
@@ -817,13 +1187,26 @@ amdxdna_drm_create_dev_heap_bo(struct drm_device *dev,
 		return ERR_PTR(-EINVAL);
 	}
 
+	/*
+	 * Each one is a chunk of the heap, after the ones before it in device
+	 * address. Carvedout chunks can't be mapped as one range, there is
+	 * only one.
+	 */
 	mutex_lock(&client->mm_lock);
-	if (client->dev_heap) {
+	if (client->nr_heap_chunks == AMDXDNA_MAX_HEAP_CHUNKS ||
+	    (client->dev_heap && amdxdna_use_carvedout())) {
 		XDNA_ERR(client->xdna, "dev heap is already created");
 		ret = -EBUSY;
 		goto mm_unlock;
 	}
 
+	if (client->heap_size + PAGE_ALIGN(args->size) > xdna->dev_info->dev_mem_size) {
+		XDNA_ERR(xdna, "Invalid dev heap size 0x%llx, used 0x%llx, limit 0x%lx",
+			 args->size, client->heap_size, xdna->dev_info->dev_mem_size);
+		ret = -EINVAL;
+		goto mm_unlock;
+	}
+
 	abo = amdxdna_gem_create_share_object(dev, args->size);
 	if (IS_ERR(abo)) {
 		ret = PTR_ERR(abo);
@@ -832,8 +1215,9 @@ amdxdna_drm_create_dev_heap_bo(struct drm_device *dev,
 
 	abo->type = AMDXDNA_BO_DEV_HEAP;
 	abo->client = client;
-	abo->mem.dev_addr = client->xdna->dev_info->dev_mem_base;
-	drm_mm_init(&abo->mm, abo->mem.dev_addr, abo->mem.size);
+	abo->mem.dev_addr = xdna->dev_info->dev_mem_base + client->heap_size;
+	if (!client->dev_heap)
+		drm_mm_init(&abo->mm, abo->mem.dev_addr, xdna->dev_info->dev_mem_size);
 
 #ifdef AMDXDNA_DEVEL
 	if (iommu_mode == AMDXDNA_IOMMU_NO_PASID) {
@@ -844,7 +1228,10 @@ amdxdna_drm_create_dev_heap_bo(struct drm_device *dev,
 		}
 	}
 #endif
-	client->dev_heap = abo;
+	if (!client->dev_heap)
+		client->dev_heap = abo;
+	client->heap_chunks[client->nr_heap_chunks++] = abo;
+	client->heap_size += abo->mem.size;
 	drm_gem_object_get(to_gobj(abo));
 	mutex_unlock(&client->mm_lock);
 
@@ -855,27 +1242,40 @@ mm_unlock:
 	return ERR_PTR(ret);
 }
 
+/* Dev BO without heap space, freed with amdxdna_gem_dev_obj_free() */
+static struct amdxdna_gem_obj *
+amdxdna_gem_create_dev_obj(struct drm_device *dev, size_t size, struct drm_file *filp)
+{
+	size_t aligned_sz = PAGE_ALIGN(size);
+	struct amdxdna_gem_obj *abo;
+	struct drm_gem_object *gobj;
+
+	abo = amdxdna_gem_create_obj(dev, aligned_sz);
+	if (IS_ERR(abo))
+		return abo;
+	gobj = to_gobj(abo);
+	gobj->funcs = &amdxdna_gem_dev_obj_funcs;
+	drm_gem_private_object_init(dev, gobj, aligned_sz);
+
+	abo->type = AMDXDNA_BO_DEV;
+	abo->client = filp->driver_priv;
+	return abo;
+}
+
 struct amdxdna_gem_obj *
 amdxdna_drm_create_dev_bo(struct drm_device *dev, struct amdxdna_drm_create_bo *args,
 			  struct drm_file *filp)
 {
-	struct amdxdna_client *client = filp->driver_priv;
 	struct amdxdna_dev *xdna = to_xdna_dev(dev);
-	size_t aligned_sz = PAGE_ALIGN(args->size);
 	struct amdxdna_gem_obj *abo;
 	struct drm_gem_object *gobj;
 	struct iosys_map map;
 	int ret;
 
-	abo = amdxdna_gem_create_obj(dev, aligned_sz);
+	abo = amdxdna_gem_create_dev_obj(dev, args->size, filp);
 	if (IS_ERR(abo))
 		return abo;
 	gobj = to_gobj(abo);
-	gobj->funcs = &amdxdna_gem_dev_obj_funcs;
-	drm_gem_private_object_init(dev, gobj, aligned_sz);
-
-	abo->type = AMDXDNA_BO_DEV;
-	abo->client = client;
 
 	ret = amdxdna_gem_heap_alloc(abo);
 	if (ret) {
@@ -939,6 +1339,54 @@ release_obj:
 	return ERR_PTR(ret);
 }
 
+static void amdxdna_gem_resv_obj_free(struct drm_gem_object *gobj)
+{
+	drm_gem_object_release(gobj);
+	kfree(gobj);
+}
+
+static const struct drm_gem_object_funcs amdxdna_gem_resv_obj_funcs = {
+	.free = amdxdna_gem_resv_obj_free,
+};
+
+/*
+ * GEM object with no backing store, only its reservation object is used. It
+ * is shared by BOs that are fenced together, as the VM of drm_gpuvm does.
+ */
+struct drm_gem_object *amdxdna_gem_create_resv_obj(struct drm_device *dev)
+{
+	struct drm_gem_object *gobj;
+
+	gobj = kzalloc(sizeof(*gobj), GFP_KERNEL);
+	if (!gobj)
+		return NULL;
+
+	gobj->funcs = &amdxdna_gem_resv_obj_funcs;
+	drm_gem_private_object_init(dev, gobj, 0);
+	return gobj;
+}
+
+/*
+ * One page command BO the driver writes status to and user space can only
+ * map read only. It is not accepted as a command to submit.
+ */
+struct amdxdna_gem_obj *
+amdxdna_gem_create_status_bo(struct drm_device *dev, struct drm_file *filp)
+{
+	struct amdxdna_drm_create_bo args = {
+		.type = AMDXDNA_BO_CMD,
+		.size = PAGE_SIZE,
+	};
+	struct amdxdna_gem_obj *abo;
+
+	abo = amdxdna_drm_create_cmd_bo(dev, &args, filp);
+	if (IS_ERR(abo))
+		return abo;
+
+	abo->flags |= BO_USER_RDONLY;
+	return abo;
+}
+
 static struct amdxdna_gem_obj *
 amdxdna_drm_create_guest_bo(struct drm_device *dev,
 			    struct amdxdna_drm_create_bo *args,
@@ -1031,17 +1479,28 @@ free_va_tbl:
 	return ERR_PTR(ret);
 };
 
-int amdxdna_drm_create_bo_ioctl(struct drm_device *dev, void *data, struct drm_file *filp)
+static void amdxdna_gem_get_info(struct amdxdna_gem_obj *abo, u64 *map_offset,
+				 u64 *vaddr, u64 *xdna_addr)
+{
+	*vaddr = abo->mem.userptr;
+	*xdna_addr = abo->mem.dev_addr;
+
+	if (abo->type != AMDXDNA_BO_DEV)
+		*map_offset = drm_vma_node_offset_addr(&to_gobj(abo)->vma_node);
+	else
+		*map_offset = AMDXDNA_INVALID_ADDR;
+}
+
+static struct amdxdna_gem_obj *
+amdxdna_gem_create_bo(struct drm_device *dev, struct amdxdna_drm_create_bo *args,
+		      struct drm_file *filp)
 {
-	struct amdxdna_dev *xdna = to_xdna_dev(dev);
-	struct amdxdna_drm_create_bo *args = data;
 	struct amdxdna_gem_obj *abo;
+#ifdef AMDXDNA_DEVEL
 	int ret;
+#endif
 
-	if (args->flags)
-		return -EINVAL;
-
-	XDNA_DBG(xdna, "BO arg type %d vaddr 0x%llx size 0x%llx flags 0x%llx",
+	XDNA_DBG(to_xdna_dev(dev), "BO arg type %d vaddr 0x%llx size 0x%llx flags 0x%llx",
 		 args->type, args->vaddr, args->size, args->flags);
 	switch (args->type) {
 	case AMDXDNA_BO_SHARE:
@@ -1060,9 +1519,11 @@ int amdxdna_drm_create_bo_ioctl(struct drm_device *dev, void *data, struct drm_f
 			break;
 		abo->mem.pages = abo->base.pages;
 		abo->mem.nr_pages = to_gobj(abo)->size >> PAGE_SHIFT;
-		ret = amdxdna_mem_map(xdna, &abo->mem);
-		if (ret)
-			goto put_obj;
+		ret = amdxdna_mem_map(to_xdna_dev(dev), &abo->mem);
+		if (ret) {
+			drm_gem_object_put(to_gobj(abo));
+			return ERR_PTR(ret);
+		}
 		abo->mem.dev_addr = abo->mem.dma_addr;
 #endif
 		break;
@@ -1070,8 +1531,22 @@ int amdxdna_drm_create_bo_ioctl(struct drm_device *dev, void *data, struct drm_f
 		abo = amdxdna_drm_create_guest_bo(dev, args, filp);
 		break;
 	default:
-		return -EINVAL;
+		return ERR_PTR(-EINVAL);
 	}
+	return abo;
+}
+
+int amdxdna_drm_create_bo_ioctl(struct drm_device *dev, void *data, struct drm_file *filp)
+{
+	struct amdxdna_dev *xdna = to_xdna_dev(dev);
+	struct amdxdna_drm_create_bo *args = data;
+	struct amdxdna_gem_obj *abo;
+	int ret;
+
+	if (args->flags & ~XDNA_BO_FLAGS)
+		return -EINVAL;
+
+	abo = amdxdna_gem_create_bo(dev, args, filp);
 	if (IS_ERR(abo))
 		return PTR_ERR(abo);
 
@@ -1082,6 +1557,9 @@ int amdxdna_drm_create_bo_ioctl(struct drm_device *dev, void *data, struct drm_f
 		goto put_obj;
 	}
 
+	if (args->flags & AMDXDNA_BO_FLAG_INFO)
+		amdxdna_gem_get_info(abo, &args->map_offset, &args->vaddr, &args->xdna_addr);
+
 	XDNA_DBG(xdna, "BO hdl %d type %d userptr 0x%llx xdna_addr 0x%llx size 0x%lx",
 		 args->handle, args->type, abo->mem.userptr,
 		 abo->mem.dev_addr, abo->mem.size);
@@ -1091,6 +1569,172 @@ put_obj:
 	return ret;
 }
 
+/*
+ * Creating BOs one by one, each DEV BO takes mm_lock. Here all DEV BOs get
+ * their heap space under one mm_lock, before anything else is created.
+ */
+int amdxdna_drm_create_bos_ioctl(struct drm_device *dev, void *data, struct drm_file *filp)
+{
+	struct amdxdna_client *client = filp->driver_priv;
+	struct amdxdna_dev *xdna = to_xdna_dev(dev);
+	struct amdxdna_drm_create_bos *args = data;
+	struct amdxdna_drm_create_bo *bos;
+	struct amdxdna_gem_obj **abos;
+	struct iosys_map map;
+	u32 nr_handles = 0;
+	int ret = 0;
+	u32 i;
+
+	if (args->pad || !args->count || args->count > AMDXDNA_MAX_CREATE_BOS)
+		return -EINVAL;
+
+	bos = kvcalloc(args->count, sizeof(*bos), GFP_KERNEL);
+	if (!bos)
+		return -ENOMEM;
+
+	if (copy_from_user(bos, u64_to_user_ptr(args->bos), args->count * sizeof(*bos))) {
+		ret = -EFAULT;
+		goto free_bos;
+	}
+
+	abos = kvcalloc(args->count, sizeof(*abos), GFP_KERNEL);
+	if (!abos) {
+		ret = -ENOMEM;
+		goto free_bos;
+	}
+
+	for (i = 0; i < args->count; i++) {
+		if (bos[i].flags & ~XDNA_BO_FLAGS ||
+		    bos[i].type == AMDXDNA_BO_DEV_HEAP) {
+			ret = -EINVAL;
+			goto put_objs;
+		}
+		if (bos[i].type != AMDXDNA_BO_DEV)
+			continue;
+
+		abos[i] = amdxdna_gem_create_dev_obj(dev, bos[i].size, filp);
+		if (IS_ERR(abos[i])) {
+			ret = PTR_ERR(abos[i]);
+			abos[i] = NULL;
+			goto put_objs;
+		}
+	}
+
+	mutex_lock(&client->mm_lock);
+	for (i = 0; i < args->count; i++) {
+		if (!abos[i])
+			continue;
+		ret = amdxdna_gem_heap_alloc_locked(abos[i]);
+		if (ret)
+			break;
+	}
+	mutex_unlock(&client->mm_lock);
+	if (ret)
+		goto put_objs;
+
+	for (i = 0; i < args->count; i++) {
+		if (abos[i]) {
+			ret = drm_gem_vmap_unlocked(to_gobj(abos[i]), &map);
+			if (ret) {
+				XDNA_ERR(xdna, "Vmap dev bo failed, ret %d", ret);
+				goto put_objs;
+			}
+			continue;
+		}
+
+		abos[i] = amdxdna_gem_create_bo(dev, &bos[i], filp);
+		if (IS_ERR(abos[i])) {
+			ret = PTR_ERR(abos[i]);
+			abos[i] = NULL;
+			goto put_objs;
+		}
+	}
+
+	for (i = 0; i < args->count; i++)
+		amdxdna_gem_get_info(abos[i], &bos[i].map_offset, &bos[i].vaddr,
+				     &bos[i].xdna_addr);
+
+	/*
+	 * Everything that can fail is done before the first handle exists,
+	 * including faulting in the array handles are returned in. Another
+	 * thread may use or close a handle as soon as it is created, so only
+	 * a failure to create handles deletes the ones before it.
+	 */
+	if (copy_to_user(u64_to_user_ptr(args->bos), bos, args->count * sizeof(*bos))) {
+		ret = -EFAULT;
+		goto put_objs;
+	}
+
+	for (nr_handles = 0; nr_handles < args->count; nr_handles++) {
+		i = nr_handles;
+		ret = drm_gem_handle_create(filp, to_gobj(abos[i]), &bos[i].handle);
+		if (ret) {
+			XDNA_ERR(xdna, "Create handle failed");
+			goto delete_handles;
+		}
+	}
+
+	/* Handles stay, the file owns them and frees them on close */
+	if (copy_to_user(u64_to_user_ptr(args->bos), bos, args->count * sizeof(*bos))) {
+		ret = -EFAULT;
+		goto put_objs;
+	}
+	XDNA_DBG(xdna, "Created %d BOs", args->count);
+	goto put_objs;
+
+delete_handles:
+	for (i = 0; i < nr_handles; i++)
+		drm_gem_handle_delete(filp, bos[i].handle);
+put_objs:
+	/* Handles hold the objects now, or they are freed */
+	for (i = 0; i < args->count; i++) {
+		if (abos[i])
+			drm_gem_object_put(to_gobj(abos[i]));
+	}
+	kvfree(abos);
+free_bos:
+	kvfree(bos);
+	return ret;
+}
+
+/* A DEV BO pins the heap chunks it is in */
+static int amdxdna_gem_pin_heap(struct amdxdna_gem_obj *abo)
+{
+	struct amdxdna_client *client = abo->client;
+	u32 first, last, c;
+	int ret;
+
+	first = amdxdna_gem_heap_chunk(client, abo->mem.dev_addr);
+	last = amdxdna_gem_heap_chunk(client, abo->mem.dev_addr + abo->mem.size - 1);
+	for (c = first; c <= last; c++) {
+		ret = drm_gem_shmem_pin(&client->heap_chunks[c]->base);
+		if (ret)
+			goto unpin;
+	}
+	return 0;
+
+unpin:
+	while (c-- > first)
+		drm_gem_shmem_unpin(&client->heap_chunks[c]->base);
+	return ret;
+}
+
+static void amdxdna_gem_unpin_heap(struct amdxdna_gem_obj *abo)
+{
+	struct amdxdna_client *client = abo->client;
+	struct amdxdna_gem_obj *chunk;
+	u32 first, last, c;
+
+	first = amdxdna_gem_heap_chunk(client, abo->mem.dev_addr);
+	last = amdxdna_gem_heap_chunk(client, abo->mem.dev_addr + abo->mem.size - 1);
+	for (c = first; c <= last; c++) {
+		chunk = client->heap_chunks[c];
+		mutex_lock(&chunk->lock);
+		drm_gem_shmem_unpin(&chunk->base);
+		mutex_unlock(&chunk->lock);
+	}
+}
+
 int amdxdna_gem_pin_nolock(struct amdxdna_gem_obj *abo)
 {
 	struct amdxdna_dev *xdna = to_xdna_dev(to_gobj(abo)->dev);
@@ -1105,7 +1749,7 @@ int amdxdna_gem_pin_nolock(struct amdxdna_gem_obj *abo)
 		ret = drm_gem_shmem_pin(&abo->base);
 		break;
 	case AMDXDNA_BO_DEV:
-		ret = drm_gem_shmem_pin(&abo->client->dev_heap->base);
+		ret = amdxdna_gem_pin_heap(abo);
 		break;
 	default:
 		ret = -EOPNOTSUPP;
@@ -1131,8 +1775,10 @@ void amdxdna_gem_unpin(struct amdxdna_gem_obj *abo)
 	if (is_import_bo(abo) || amdxdna_use_carvedout())
 		return;
 
-	if (abo->type == AMDXDNA_BO_DEV)
-		abo = abo->client->dev_heap;
+	if (abo->type == AMDXDNA_BO_DEV) {
+		amdxdna_gem_unpin_heap(abo);
+		return;
+	}
 
 	mutex_lock(&abo->lock);
 	drm_gem_shmem_unpin(&abo->base);
@@ -1178,13 +1824,7 @@ int amdxdna_drm_get_bo_info_ioctl(struct drm_device *dev, void *data, struct drm
 	}
 
 	abo = to_xdna_obj(gobj);
-	args->vaddr = abo->mem.userptr;
-	args->xdna_addr = abo->mem.dev_addr;
-
-	if (abo->type != AMDXDNA_BO_DEV)
-		args->map_offset = drm_vma_node_offset_addr(&gobj->vma_node);
-	else
-		args->map_offset = AMDXDNA_INVALID_ADDR;
+	amdxdna_gem_get_info(abo, &args->map_offset, &args->vaddr, &args->xdna_addr);
 
 	XDNA_DBG(xdna, "BO hdl %d map_offset 0x%llx vaddr 0x%llx xdna_addr 0x%llx",
 		 args->handle, args->map_offset, args->vaddr, args->xdna_addr);
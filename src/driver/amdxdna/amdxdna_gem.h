@@ -10,6 +10,13 @@
 #include <drm/drm_gem.h>
 #include <drm/drm_gem_shmem_helper.h>
 #include <linux/hmm.h>
+#include <linux/log2.h>
+#include <linux/sizes.h>
+
+#include "amdxdna_heap_slab.h"
+
+struct amdxdna_dev;
+struct seq_file;
 
 struct amdxdna_umap {
 	struct vm_area_struct		*vma;
@@ -40,6 +47,9 @@ struct amdxdna_mem {
 };
 
 #define BO_SUBMIT_PINNED	BIT(0)
+#define BO_USER_RDONLY		BIT(1) /* Written by driver, user maps read only */
+#define BO_HEAP_PAGES		BIT(2) /* DEV BO spanning heap chunks owns mem.pages */
+#define BO_HUGE			BIT(3) /* Share BO on huge page tmpfs, mapped by PMD */
 struct amdxdna_gem_obj {
 	struct drm_gem_shmem_object	base;
 	struct amdxdna_client		*client;
@@ -51,7 +61,11 @@ struct amdxdna_gem_obj {
 	/* Below members are initialized when needed */
 	struct drm_mm			mm; /* For AMDXDNA_BO_DEV_HEAP */
 	struct drm_mm_node		mm_node; /* For AMDXDNA_BO_DEV / carvedout */
+	struct amdxdna_heap_slab	*slab; /* For AMDXDNA_BO_DEV from a slab */
 	u32				assigned_ctx; /* For debug bo */
+	/* Resident submits of its client fence the BO here, see amdxdna_resident_set */
+	struct drm_gem_object		*resident_obj;
+	bool				exported; /* Protected by lock */
 };
 
 #define to_gobj(obj)    (&(obj)->base.base)
@@ -76,6 +90,9 @@ amdxdna_gem_create_shmem_object_cb(struct drm_device *dev, size_t size);
 struct drm_gem_object *
 amdxdna_gem_prime_import(struct drm_device *dev, struct dma_buf *dma_buf);
 struct amdxdna_gem_obj *
+amdxdna_gem_create_status_bo(struct drm_device *dev, struct drm_file *filp);
+struct drm_gem_object *amdxdna_gem_create_resv_obj(struct drm_device *dev);
+struct amdxdna_gem_obj *
 amdxdna_drm_create_dev_bo(struct drm_device *dev, struct amdxdna_drm_create_bo *args,
 			  struct drm_file *filp);
 
@@ -83,11 +100,17 @@ int amdxdna_gem_pin_nolock(struct amdxdna_gem_obj *abo);
 int amdxdna_gem_pin(struct amdxdna_gem_obj *abo);
 void amdxdna_gem_unpin(struct amdxdna_gem_obj *abo);
 
+void amdxdna_gem_huge_init(struct amdxdna_dev *xdna);
+void amdxdna_gem_huge_fini(struct amdxdna_dev *xdna);
+
+void amdxdna_gem_heap_show(struct amdxdna_client *client, struct seq_file *m);
+
 u32 amdxdna_gem_get_assigned_ctx(struct amdxdna_client *client, u32 bo_hdl);
 int amdxdna_gem_set_assigned_ctx(struct amdxdna_client *client, u32 bo_hdl, u32 ctx_hdl);
 void amdxdna_gem_clear_assigned_ctx(struct amdxdna_client *client, u32 bo_hdl);
 
 int amdxdna_drm_create_bo_ioctl(struct drm_device *dev, void *data, struct drm_file *filp);
+int amdxdna_drm_create_bos_ioctl(struct drm_device *dev, void *data, struct drm_file *filp);
 int amdxdna_drm_get_bo_info_ioctl(struct drm_device *dev, void *data, struct drm_file *filp);
 int amdxdna_drm_sync_bo_ioctl(struct drm_device *dev, void *data, struct drm_file *filp);
 
@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+
+#include "amdxdna_heap_slab.h"
+
+void amdxdna_heap_slab_init(struct amdxdna_heap_slab_class *classes)
+{
+	struct amdxdna_heap_slab_class *class;
+	int i;
+
+	for (i = 0; i < AMDXDNA_HEAP_SLAB_CLASSES; i++) {
+		class = &classes[i];
+		INIT_LIST_HEAD(&class->partial);
+		INIT_LIST_HEAD(&class->full);
+		if (i < AMDXDNA_HEAP_SLAB_POW2_CLASSES)
+			class->obj_size = PAGE_SIZE << i;
+		else
+			class->obj_size = (i - AMDXDNA_HEAP_SLAB_POW2_CLASSES + 1) *
+					  AMDXDNA_HEAP_SLAB_STEP;
+	}
+}
+
+static void amdxdna_heap_slab_destroy(struct amdxdna_heap_slab *slab)
+{
+	drm_mm_remove_node(&slab->node);
+	list_del(&slab->entry);
+	slab->class->nr_slabs--;
+	slab->class->nr_free -= slab->nr_free;
+	kfree(slab);
+}
+
+/* Called before the drm_mm goes away */
+void amdxdna_heap_slab_fini(struct amdxdna_heap_slab_class *classes)
+{
+	struct amdxdna_heap_slab *slab, *tmp;
+	struct amdxdna_heap_slab_class *class;
+	int i;
+
+	for (i = 0; i < AMDXDNA_HEAP_SLAB_CLASSES; i++) {
+		class = &classes[i];
+		WARN_ON(class->nr_objs);
+		list_for_each_entry_safe(slab, tmp, &class->partial, entry)
+			amdxdna_heap_slab_destroy(slab);
+		list_for_each_entry_safe(slab, tmp, &class->full, entry)
+			amdxdna_heap_slab_destroy(slab);
+	}
+}
+
+/*
+ * Each class keeps its last empty slab, so a BO freed and created again does
+ * not take a new extent each time. Those go back when the heap is short.
+ */
+u32 amdxdna_heap_slab_reclaim(struct amdxdna_heap_slab_class *classes)
+{
+	struct amdxdna_heap_slab_class *class;
+	struct amdxdna_heap_slab *slab;
+	u32 nr = 0;
+	int i;
+
+	for (i = 0; i < AMDXDNA_HEAP_SLAB_CLASSES; i++) {
+		class = &classes[i];
+		if (list_empty(&class->partial))
+			continue;
+		slab = list_last_entry(&class->partial, struct amdxdna_heap_slab, entry);
+		if (slab->nr_free < slab->nr_objs)
+			continue;
+		amdxdna_heap_slab_destroy(slab);
+		nr++;
+	}
+	return nr;
+}
+
+/* Best fit in the drm_mm, empty slabs are given back if nothing fits */
+int amdxdna_heap_insert(struct amdxdna_heap_slab_class *classes, struct drm_mm *mm,
+			struct drm_mm_node *node, u64 size, u64 align, u64 start, u64 end)
+{
+	int ret;
+
+	ret = drm_mm_insert_node_in_range(mm, node, size, align, 0, start, end,
+					  DRM_MM_INSERT_BEST);
+	if (ret != -ENOSPC || !amdxdna_heap_slab_reclaim(classes))
+		return ret;
+
+	return drm_mm_insert_node_in_range(mm, node, size, align, 0, start, end,
+					   DRM_MM_INSERT_BEST);
+}
+
+/*
+ * The smallest class holding size whose objects keep the alignment, or -1.
+ * Objects of a class are aligned to the lowest bit of its size.
+ */
+static int amdxdna_heap_slab_class_idx(u64 size, u64 align)
+{
+	u32 obj_size;
+	int i;
+
+	if (size > AMDXDNA_HEAP_SLAB_MAX_OBJ)
+		return -1;
+
+	if (size <= AMDXDNA_HEAP_SLAB_STEP) {
+		obj_size = max_t(u32, roundup_pow_of_two(size), PAGE_SIZE);
+		i = ilog2(obj_size) - PAGE_SHIFT;
+	} else {
+		i = AMDXDNA_HEAP_SLAB_POW2_CLASSES +
+		    DIV_ROUND_UP(size, AMDXDNA_HEAP_SLAB_STEP) - 1;
+	}
+
+	for (; i < AMDXDNA_HEAP_SLAB_CLASSES; i++) {
+		if (i < AMDXDNA_HEAP_SLAB_POW2_CLASSES)
+			obj_size = PAGE_SIZE << i;
+		else
+			obj_size = (i - AMDXDNA_HEAP_SLAB_POW2_CLASSES + 1) *
+				   AMDXDNA_HEAP_SLAB_STEP;
+		if ((obj_size & -obj_size) >= align)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * Take an object from the size class of the BO. Partially used slabs come
+ * first, so that empty ones can go back to the heap. A new slab takes an
+ * extent of the heap, -ENOSPC if there is no room for it or no class fits.
+ */
+int amdxdna_heap_slab_alloc(struct amdxdna_heap_slab_class *classes, struct drm_mm *mm,
+			    u64 size, u64 align, u64 start, u64 end,
+			    struct amdxdna_heap_slab **slabp, u64 *addr)
+{
+	struct amdxdna_heap_slab_class *class;
+	struct amdxdna_heap_slab *slab;
+	u32 obj_size, nr_objs, i;
+	int idx, ret;
+
+	idx = amdxdna_heap_slab_class_idx(size, align);
+	if (idx < 0)
+		return -ENOSPC;
+	class = &classes[idx];
+	obj_size = class->obj_size;
+
+	slab = list_first_entry_or_null(&class->partial, struct amdxdna_heap_slab, entry);
+	if (!slab) {
+		slab = kzalloc(sizeof(*slab), GFP_KERNEL);
+		if (!slab)
+			return -ENOMEM;
+
+		nr_objs = AMDXDNA_HEAP_SLAB_SIZE / obj_size;
+		ret = amdxdna_heap_insert(classes, mm, &slab->node, (u64)nr_objs * obj_size,
+					  obj_size & -obj_size, start, end);
+		if (ret) {
+			kfree(slab);
+			return ret;
+		}
+		slab->class = class;
+		slab->nr_objs = nr_objs;
+		slab->nr_free = nr_objs;
+		list_add(&slab->entry, &class->partial);
+		class->nr_slabs++;
+		class->nr_free += nr_objs;
+	}
+
+	i = find_first_zero_bit(slab->used, slab->nr_objs);
+	__set_bit(i, slab->used);
+	if (!--slab->nr_free)
+		list_move(&slab->entry, &class->full);
+	class->nr_free--;
+	class->nr_objs++;
+	class->used_bytes += size;
+	class->nr_allocs++;
+
+	*slabp = slab;
+	*addr = slab->node.start + (u64)i * obj_size;
+	return 0;
+}
+
+/* An empty slab is kept only if it is the last one of its class */
+void amdxdna_heap_slab_free(struct amdxdna_heap_slab *slab, u64 addr, u64 size)
+{
+	struct amdxdna_heap_slab_class *class = slab->class;
+
+	__clear_bit(div_u64(addr - slab->node.start, class->obj_size), slab->used);
+	if (!slab->nr_free++)
+		list_move(&slab->entry, &class->partial);
+	class->nr_free++;
+	class->nr_objs--;
+	class->used_bytes -= size;
+
+	if (slab->nr_free < slab->nr_objs)
+		return;
+
+	if (class->nr_slabs > 1)
+		amdxdna_heap_slab_destroy(slab);
+	else
+		list_move_tail(&slab->entry, &class->partial);
+}
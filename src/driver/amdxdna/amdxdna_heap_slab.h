@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#ifndef _AMDXDNA_HEAP_SLAB_H_
+#define _AMDXDNA_HEAP_SLAB_H_
+
+#include <drm/drm_mm.h>
+#include <linux/bitops.h>
+#include <linux/list.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/sizes.h>
+#include <linux/types.h>
+
+/*
+ * Small DEV BOs come from slabs, heap extents carved into objects of one
+ * size class. Classes are powers of two up to AMDXDNA_HEAP_SLAB_STEP, then
+ * AMDXDNA_HEAP_SLAB_STEP apart, so an object wastes less than half of a
+ * small BO or less than a step of a larger one. A slab holds as many objects
+ * as fit in AMDXDNA_HEAP_SLAB_SIZE.
+ */
+#define AMDXDNA_HEAP_SLAB_SIZE		SZ_1M
+#define AMDXDNA_HEAP_SLAB_STEP		SZ_32K
+#define AMDXDNA_HEAP_SLAB_MAX_OBJ	SZ_256K
+#define AMDXDNA_HEAP_SLAB_POW2_CLASSES	(ilog2(AMDXDNA_HEAP_SLAB_STEP) - PAGE_SHIFT)
+#define AMDXDNA_HEAP_SLAB_CLASSES	(AMDXDNA_HEAP_SLAB_POW2_CLASSES + \
+					 AMDXDNA_HEAP_SLAB_MAX_OBJ / AMDXDNA_HEAP_SLAB_STEP)
+
+struct amdxdna_heap_slab_class {
+	struct list_head		partial; /* Slabs with free objects, empty ones last */
+	struct list_head		full;
+	u32				obj_size;
+	u32				nr_slabs;
+	u32				nr_objs; /* Objects in use */
+	u32				nr_free; /* Free objects in all slabs */
+	u64				used_bytes; /* Size asked for by the objects in use */
+	u64				nr_allocs;
+};
+
+struct amdxdna_heap_slab {
+	struct drm_mm_node		node;
+	struct list_head		entry;
+	struct amdxdna_heap_slab_class	*class;
+	u32				nr_objs;
+	u32				nr_free;
+	DECLARE_BITMAP(used, AMDXDNA_HEAP_SLAB_SIZE >> PAGE_SHIFT);
+};
+
+/*
+ * All of these are called with the lock of the drm_mm held. start and end
+ * bound where in the drm_mm allocations may go.
+ */
+void amdxdna_heap_slab_init(struct amdxdna_heap_slab_class *classes);
+void amdxdna_heap_slab_fini(struct amdxdna_heap_slab_class *classes);
+int amdxdna_heap_insert(struct amdxdna_heap_slab_class *classes, struct drm_mm *mm,
+			struct drm_mm_node *node, u64 size, u64 align, u64 start, u64 end);
+int amdxdna_heap_slab_alloc(struct amdxdna_heap_slab_class *classes, struct drm_mm *mm,
+			    u64 size, u64 align, u64 start, u64 end,
+			    struct amdxdna_heap_slab **slab, u64 *addr);
+void amdxdna_heap_slab_free(struct amdxdna_heap_slab *slab, u64 addr, u64 size);
+u32 amdxdna_heap_slab_reclaim(struct amdxdna_heap_slab_class *classes);
+
+#endif /* _AMDXDNA_HEAP_SLAB_H_ */
@@ -10,14 +10,18 @@
 #include <linux/io.h>
 #include <linux/pci.h>
 #include <linux/spinlock.h>
+#include <linux/mutex.h>
 #include <linux/iopoll.h>
 #include <linux/vmalloc.h>
 #include <linux/build_bug.h>
 #include <linux/interrupt.h>
+#include <linux/hrtimer.h>
+#include <linux/version.h>
 #include <linux/dev_printk.h>
 #if defined(CONFIG_DEBUG_FS)
 #include <linux/seq_file.h>
 #include <linux/wait.h>
+#include <linux/math64.h>
 #endif
 #ifdef AMDXDNA_DEVEL
 #include <linux/kthread.h>
@@ -25,6 +29,7 @@
 #include <linux/irqreturn.h>
 #include "amdxdna_trace.h"
 #include "amdxdna_mailbox.h"
+#include "amdxdna_mailbox_ring.h"
 
 #define MB_ERR(chann, fmt, args...) \
 ({ \
@@ -48,7 +53,14 @@
 #define MAGIC_VAL			0x1D000000U
 #define MAGIC_VAL_MASK			0xFF000000
 #define MAX_MSG_ID_ENTRIES		256
+#define MB_MSG_SLOTS			32
+#define MB_SLOT_PKG_SIZE		256
+#define MB_SLOT_SIZE			(sizeof(struct mailbox_msg) + MB_SLOT_PKG_SIZE)
 #define MAILBOX_NAME			"xdna_mailbox"
+/* Longest time the tail pointer is held back for more messages */
+#define MB_TX_HOLD_NS			(50 * NSEC_PER_USEC)
+/* Responses handled per channel before the poll thread moves on */
+#define MB_NAPI_BUDGET			64
 #define MSG_ID2ENTRY(msg_id)		((msg_id) & ~MAGIC_VAL_MASK)
 
 #ifdef AMDXDNA_DEVEL
@@ -62,6 +74,18 @@ MODULE_PARM_DESC(mailbox_polling, "<=0:interrupt(default); >0:poll interval in m
 #define MB_TIMER_JIFF msecs_to_jiffies(mailbox_polling)
 #endif
 
+bool mailbox_napi;
+module_param(mailbox_napi, bool, 0444);
+MODULE_PARM_DESC(mailbox_napi, "Poll busy channels with their interrupt masked (default false)");
+
+uint mailbox_napi_spin_us = 50;
+module_param(mailbox_napi_spin_us, uint, 0644);
+MODULE_PARM_DESC(mailbox_napi_spin_us, "Max wait in us for more responses before unmasking (default 50)");
+
+bool mailbox_irq_thread;
+module_param(mailbox_irq_thread, bool, 0444);
+MODULE_PARM_DESC(mailbox_irq_thread, "Complete in a SCHED_FIFO IRQ thread, overrides mailbox_napi (default false)");
+
 enum channel_res_type {
 	CHAN_RES_X2I,
 	CHAN_RES_I2X,
@@ -77,6 +101,15 @@ struct mailbox {
 	struct task_struct	*polld;
 	struct wait_queue_head	poll_wait;
 	bool			sent_msg; /* For polld */
+
+	/* Channels handed to napid by their interrupt handler */
+	spinlock_t		napi_lock; /* protect napi_list and napi_sched */
+	struct list_head	napi_list;
+	struct mutex		napi_mutex; /* held by napid while polling a channel */
+	struct task_struct	*napid;
+	struct wait_queue_head	napi_wait;
+
+	struct kmem_cache	*msg_cache; /* Messages not fitting in a free slot */
 #if defined(CONFIG_DEBUG_FS)
 	struct list_head        res_records;
 #endif /* CONFIG_DEBUG_FS */
@@ -101,11 +134,30 @@ struct mailbox_channel {
 	struct list_head		chann_entry;
 	struct xdna_mailbox_chann_res	res[CHAN_RES_NUM];
 	int				msix_irq;
-	u32				x2i_tail;
 	u32				iohub_int_addr;
+
+	/*
+	 * Packages are copied to the ring at x2i_tail. Firmware only sees
+	 * them when the tail register is written, which is held back while
+	 * the sender has more messages coming.
+	 */
+	spinlock_t			tx_lock; /* protect below tx fields */
+	u32				x2i_tail;
+	bool				x2i_held;
+	struct hrtimer			tx_timer;
+
 	enum xdna_mailbox_channel_type	type;
-	struct xarray			chan_xa;
+
+	/*
+	 * Outstanding messages indexed by message ID. The package of a message
+	 * goes to the preallocated slot picked by the low bits of its ID.
+	 */
+	spinlock_t			msg_lock; /* protect below msg fields */
+	struct mailbox_msg		*msgs[MAX_MSG_ID_ENTRIES];
+	u32				msg_cnt;
 	u32				next_msgid;
+	void				*slots;
+	DECLARE_BITMAP(slot_busy, MB_MSG_SLOTS);
 
 	/* Received msg related fields */
 	struct workqueue_struct		*work_q;
@@ -113,6 +165,17 @@ struct mailbox_channel {
 	u32				i2x_head;
 	bool				bad_state;
 	u32				last_msg_id;
+	struct xdna_mailbox_chann_stats	stats;
+	bool				irq_thread;
+	u64				irq_ts; /* For trace_mbox_rx_latency() */
+
+	/* Adaptive polling, see mailbox_napid() */
+	bool				napi;
+	bool				napi_sched;
+	bool				napi_spinning;
+	struct list_head		napi_entry;
+	u64				napi_spin_ns;
+	u64				napi_last_rx;
 
 #ifdef AMDXDNA_DEVEL
 	struct timer_list		timer;
@@ -137,10 +200,14 @@ struct mailbox_pkg {
 
 /* The protocol version. */
 #define MSG_PROTOCOL_VERSION	0x1
-/* The tombstone value. */
-#define TOMBSTONE		0xDEADFACE
+enum mailbox_msg_origin {
+	MB_MSG_SLOT,
+	MB_MSG_CACHE,
+	MB_MSG_HEAP,
+};
 
 struct mailbox_msg {
+	enum mailbox_msg_origin	origin;
 	void			*handle;
 	int			(*notify_cb)(void *handle, void __iomem *data, size_t size);
 	size_t			pkg_size; /* package size in bytes */
@@ -177,7 +244,7 @@ static int mailbox_tail_read_non_zero(struct mailbox_channel *mb_chann, u32 *val
 	if (ret < 0)
 		return ret;
 
-	if (unlikely(tail > ringbuf_size || !IS_ALIGNED(tail, 4))) {
+	if (unlikely(!mailbox_ring_ptr_valid(tail, ringbuf_size))) {
 		MB_WARN_ONCE(mb_chann, "Invalid tail 0x%x", tail);
 		return -EINVAL;
 	}
@@ -198,6 +265,7 @@ mailbox_set_tailptr(struct mailbox_channel *mb_chann, u32 tailptr_val)
 {
 	mailbox_reg_write(mb_chann, mb_chann->res[CHAN_RES_X2I].mb_tail_ptr_reg, tailptr_val);
 	mb_chann->x2i_tail = tailptr_val;
+	mb_chann->x2i_held = false;
 }
 
 static inline u32
@@ -238,33 +306,127 @@ static inline int mailbox_validate_msgid(struct mailbox_channel *mb_chann, u32 m
 	return true;
 }
 
-static int mailbox_acquire_msgid(struct mailbox_channel *mb_chann, struct mailbox_msg *mb_msg)
+static struct mailbox_msg *mailbox_slot(struct mailbox_channel *mb_chann, u32 slot)
 {
-	u32 msg_id;
-	int ret;
+	return mb_chann->slots + slot * MB_SLOT_SIZE;
+}
 
-	ret = xa_alloc_cyclic_irq(&mb_chann->chan_xa, &msg_id, mb_msg,
-				  XA_LIMIT(0, MAX_MSG_ID_ENTRIES - 1),
-				  &mb_chann->next_msgid, GFP_NOWAIT);
-	if (ret < 0)
-		return ret;
+static struct mailbox_msg *
+mailbox_alloc_msg(struct mailbox_channel *mb_chann, size_t pkg_size)
+{
+	struct mailbox_msg *mb_msg;
+
+	if (pkg_size <= MB_SLOT_PKG_SIZE) {
+		mb_msg = kmem_cache_alloc(mb_chann->mb->msg_cache, GFP_KERNEL);
+		if (mb_msg)
+			mb_msg->origin = MB_MSG_CACHE;
+		return mb_msg;
+	}
+
+	mb_msg = kmalloc(sizeof(*mb_msg) + pkg_size, GFP_KERNEL);
+	if (mb_msg)
+		mb_msg->origin = MB_MSG_HEAP;
+	return mb_msg;
+}
+
+static void mailbox_free_msg(struct mailbox_channel *mb_chann, struct mailbox_msg *mb_msg)
+{
+	u32 slot;
+
+	switch (mb_msg->origin) {
+	case MB_MSG_SLOT:
+		slot = ((void *)mb_msg - mb_chann->slots) / MB_SLOT_SIZE;
+		spin_lock(&mb_chann->msg_lock);
+		__clear_bit(slot, mb_chann->slot_busy);
+		spin_unlock(&mb_chann->msg_lock);
+		break;
+	case MB_MSG_CACHE:
+		kmem_cache_free(mb_chann->mb->msg_cache, mb_msg);
+		break;
+	default:
+		kfree(mb_msg);
+		break;
+	}
+}
+
+/*
+ * mailbox_acquire_msg() - Get a message ID and the memory for its package.
+ *
+ * Called with tx_lock held once the package has room in the ring, so IDs
+ * reach the ring in the order they are handed out and none is ever given
+ * back. IDs are handed out cyclically, so the slot picked by the low bits of
+ * the ID is free unless MB_MSG_SLOTS messages are outstanding. A package that
+ * does not fit in a slot, or whose slot is busy, takes *spare. Without one it
+ * fails with -EAGAIN, the caller allocates it without the lock and retries.
+ */
+static struct mailbox_msg *
+mailbox_acquire_msg(struct mailbox_channel *mb_chann, size_t pkg_size,
+		    struct mailbox_msg **spare, u32 *msg_id)
+{
+	struct mailbox_msg *mb_msg;
+	u32 id, slot, i;
+
+	spin_lock(&mb_chann->msg_lock);
+	for (i = 0; i < MAX_MSG_ID_ENTRIES; i++) {
+		id = (mb_chann->next_msgid + i) % MAX_MSG_ID_ENTRIES;
+		if (!mb_chann->msgs[id])
+			break;
+	}
+	if (i == MAX_MSG_ID_ENTRIES) {
+		mb_msg = ERR_PTR(-EBUSY);
+		goto unlock;
+	}
+
+	slot = id % MB_MSG_SLOTS;
+	if (pkg_size <= MB_SLOT_PKG_SIZE && !test_bit(slot, mb_chann->slot_busy)) {
+		__set_bit(slot, mb_chann->slot_busy);
+		mb_msg = mailbox_slot(mb_chann, slot);
+		mb_msg->origin = MB_MSG_SLOT;
+	} else if (*spare) {
+		mb_msg = *spare;
+		*spare = NULL;
+	} else {
+		mb_msg = ERR_PTR(-EAGAIN);
+		goto unlock;
+	}
+
+	mb_chann->msgs[id] = mb_msg;
+	mb_chann->msg_cnt++;
+	mb_chann->next_msgid = (id + 1) % MAX_MSG_ID_ENTRIES;
 
 	/*
 	 * Add MAGIC_VAL to the higher bits.
 	 */
-	msg_id |= MAGIC_VAL;
-	return msg_id;
+	*msg_id = id | MAGIC_VAL;
+
+unlock:
+	spin_unlock(&mb_chann->msg_lock);
+	return mb_msg;
 }
 
 static bool mailbox_channel_no_msg(struct mailbox_channel *mb_chann)
 {
-	return xa_empty(&mb_chann->chan_xa);
+	return !READ_ONCE(mb_chann->msg_cnt);
 }
 
-static void mailbox_release_msgid(struct mailbox_channel *mb_chann, int msg_id)
+/* Remove the message from the ID table, the caller frees it */
+static struct mailbox_msg *mailbox_take_msg(struct mailbox_channel *mb_chann, u32 msg_id)
 {
+	struct mailbox_msg *mb_msg;
+
 	msg_id = MSG_ID2ENTRY(msg_id);
-	xa_erase_irq(&mb_chann->chan_xa, msg_id);
+	if (msg_id >= MAX_MSG_ID_ENTRIES)
+		return NULL;
+
+	spin_lock(&mb_chann->msg_lock);
+	mb_msg = mb_chann->msgs[msg_id];
+	if (mb_msg) {
+		mb_chann->msgs[msg_id] = NULL;
+		mb_chann->msg_cnt--;
+	}
+	spin_unlock(&mb_chann->msg_lock);
+
+	return mb_msg;
 }
 
 static void mailbox_release_msg(struct mailbox_channel *mb_chann,
@@ -273,51 +435,89 @@ static void mailbox_release_msg(struct mailbox_channel *mb_chann,
 	MB_DBG(mb_chann, "msg_id 0x%x msg opcode 0x%x",
 	       mb_msg->pkg.header.id, mb_msg->pkg.header.opcode);
 	mb_msg->notify_cb(mb_msg->handle, NULL, 0);
-	kfree(mb_msg);
+	mailbox_free_msg(mb_chann, mb_msg);
 }
 
+/*
+ * mailbox_stage_msg() - Copy a message to the X2I ring. The caller makes it
+ * visible to firmware with mailbox_set_tailptr().
+ *
+ * Called with tx_lock held. The message gets its ID only once it has room
+ * in the ring, nothing fails after that.
+ */
 static int
-mailbox_send_msg(struct mailbox_channel *mb_chann, struct mailbox_msg *mb_msg)
+mailbox_stage_msg(struct mailbox_channel *mb_chann, struct xdna_mailbox_msg *msg,
+		  size_t pkg_size, struct mailbox_msg **spare)
 {
+	struct xdna_msg_header *header;
+	struct mailbox_msg *mb_msg;
 	void __iomem *write_addr;
 	u32 ringbuf_size;
 	u32 head, tail;
 	u32 start_addr;
-	u32 tmp_tail;
+	u32 offset;
+	u32 msg_id;
+	int ret;
 
 	head = mailbox_get_headptr(mb_chann, CHAN_RES_X2I);
 	tail = mb_chann->x2i_tail;
 	ringbuf_size = mailbox_get_ringbuf_size(mb_chann, CHAN_RES_X2I);
 	start_addr = mb_chann->res[CHAN_RES_X2I].rb_start_addr;
-	tmp_tail = tail + mb_msg->pkg_size;
 
-	if (tail < head && tmp_tail >= head)
-		goto no_space;
+	ret = mailbox_ring_reserve(head, tail, ringbuf_size, pkg_size, &offset);
+	if (ret)
+		return ret;
 
-	if (tail >= head && (tmp_tail > ringbuf_size - sizeof(u32) &&
-			     mb_msg->pkg_size >= head))
-		goto no_space;
+	mb_msg = mailbox_acquire_msg(mb_chann, pkg_size, spare, &msg_id);
+	if (IS_ERR(mb_msg))
+		return PTR_ERR(mb_msg);
 
-	if (tail >= head && tmp_tail > ringbuf_size - sizeof(u32)) {
-		write_addr = mb_chann->mb->res.ringbuf_base + start_addr + tail;
-		writel(TOMBSTONE, write_addr);
+	mb_msg->handle = msg->handle;
+	mb_msg->notify_cb = msg->notify_cb;
+	mb_msg->pkg_size = pkg_size;
 
-		/* tombstone is set. Write from the start of the ringbuf */
-		tail = 0;
+	header = &mb_msg->pkg.header;
+	/*
+	 * Hardware use total_size and size to split huge message.
+	 * We do not support it here. Thus the values are the same.
+	 */
+	header->total_size = msg->send_size;
+	header->sz_ver = FIELD_PREP(MSG_BODY_SZ, msg->send_size) |
+			FIELD_PREP(MSG_PROTO_VER, MSG_PROTOCOL_VERSION);
+	header->opcode = msg->opcode;
+	header->id = msg_id;
+	memcpy(mb_msg->pkg.payload, msg->send_data, msg->send_size);
+	msg->id = header->id;
+
+	MB_DBG(mb_chann, "opcode 0x%x size %d id 0x%x",
+	       header->opcode, header->total_size, header->id);
+
+	if (offset != tail) {
+		write_addr = mb_chann->mb->res.ringbuf_base + start_addr + tail;
+		writel(MAILBOX_TOMBSTONE, write_addr);
 	}
 
-	write_addr = mb_chann->mb->res.ringbuf_base + start_addr + tail;
-	memcpy_toio(write_addr, &mb_msg->pkg, mb_msg->pkg_size);
-	mailbox_set_tailptr(mb_chann, tail + mb_msg->pkg_size);
+	write_addr = mb_chann->mb->res.ringbuf_base + start_addr + offset;
+	memcpy_toio(write_addr, &mb_msg->pkg, pkg_size);
+	mb_chann->x2i_tail = offset + pkg_size;
 
 	trace_mbox_set_tail(MAILBOX_NAME, mb_chann->msix_irq,
-			    mb_msg->pkg.header.opcode,
-			    mb_msg->pkg.header.id);
+			    header->opcode, header->id);
 
 	return 0;
+}
 
-no_space:
-	return -ENOSPC;
+static const char *mailbox_rx_path(struct mailbox_channel *mb_chann)
+{
+	if (mb_chann->type == MB_CHANNEL_MGMT)
+		return "mgmt";
+	if (mb_chann->type == MB_CHANNEL_USER_POLL)
+		return "poll";
+	if (mb_chann->irq_thread)
+		return "thread";
+	if (mb_chann->napi)
+		return "napi";
+	return "irq";
 }
 
 static int
@@ -333,8 +533,7 @@ mailbox_get_resp(struct mailbox_channel *mb_chann, struct xdna_msg_header *heade
 		return -EINVAL;
 	mb_chann->last_msg_id = msg_id;
 
-	msg_id = MSG_ID2ENTRY(msg_id);
-	mb_msg = xa_erase_irq(&mb_chann->chan_xa, msg_id);
+	mb_msg = mailbox_take_msg(mb_chann, msg_id);
 	if (!mb_msg) {
 		MB_ERR(mb_chann, "Cannot find msg 0x%x", msg_id);
 		return -EINVAL;
@@ -347,7 +546,15 @@ mailbox_get_resp(struct mailbox_channel *mb_chann, struct xdna_msg_header *heade
 		MB_ERR(mb_chann, "Size %d opcode 0x%x ret %d",
 		       header->total_size, header->opcode, ret);
 
-	kfree(mb_msg);
+	/* Only the first response after an interrupt is measured */
+	if (READ_ONCE(mb_chann->irq_ts)) {
+		trace_mbox_rx_latency(MAILBOX_NAME, mb_chann->msix_irq,
+				      mailbox_rx_path(mb_chann), header->id,
+				      ktime_get_ns() - READ_ONCE(mb_chann->irq_ts));
+		WRITE_ONCE(mb_chann->irq_ts, 0);
+	}
+
+	mailbox_free_msg(mb_chann, mb_msg);
 	return ret;
 }
 
@@ -380,15 +587,14 @@ static int mailbox_get_msg(struct mailbox_channel *mb_chann)
 	if (head == tail)
 		return -ENOENT;
 
-	if (head == ringbuf_size)
-		head = 0;
+	head = mailbox_ring_read_start(head, ringbuf_size);
 
 	/* Peek size of the message or TOMBSTONE */
 	read_addr = mb_chann->mb->res.ringbuf_base + start_addr + head;
 	header.total_size = readl(read_addr);
 	/* size is TOMBSTONE, set next read from 0 */
-	if (header.total_size == TOMBSTONE) {
-		if (head < tail) {
+	if (header.total_size == MAILBOX_TOMBSTONE) {
+		if (!mailbox_ring_tombstone_valid(head, tail)) {
 			MB_WARN_ONCE(mb_chann, "Tombstone, head 0x%x tail 0x%x",
 				     head, tail);
 			return -EINVAL;
@@ -412,7 +618,7 @@ static int mailbox_get_msg(struct mailbox_channel *mb_chann)
 	}
 	msg_size = sizeof(header) + header.total_size;
 
-	if (msg_size > ringbuf_size - head || msg_size > tail - head) {
+	if (!mailbox_ring_pkg_valid(head, tail, ringbuf_size, msg_size)) {
 		MB_WARN_ONCE(mb_chann, "Invalid message size %d, tail %d, head %d",
 			     msg_size, tail, head);
 		return -EINVAL;
@@ -432,22 +638,20 @@ static int mailbox_get_msg(struct mailbox_channel *mb_chann)
 	return ret;
 }
 
-static void mailbox_rx_worker(struct work_struct *rx_work)
+/*
+ * mailbox_rx_drain() - Consume responses until the ring stays empty
+ *
+ * Return: 0, or the error of a bad response. The channel is marked bad then
+ * and the caller disables its interrupt.
+ */
+static int mailbox_rx_drain(struct mailbox_channel *mb_chann)
 {
-	struct mailbox_channel *mb_chann;
 	u32 iohub;
 	int ret;
 
-	mb_chann = container_of(rx_work, struct mailbox_channel, rx_work);
-	trace_mbox_rx_worker(MAILBOX_NAME, mb_chann->msix_irq);
-
-	if (READ_ONCE(mb_chann->bad_state)) {
-		MB_ERR(mb_chann, "Channel in bad state, work aborted");
-		return;
-	}
-
 again:
 	mailbox_reg_write(mb_chann, mb_chann->iohub_int_addr, 0);
+	mb_chann->stats.polls++;
 
 	while (1) {
 		/*
@@ -462,9 +666,9 @@ again:
 		if (unlikely(ret)) {
 			MB_ERR(mb_chann, "Unexpected ret %d, disable irq", ret);
 			WRITE_ONCE(mb_chann->bad_state, true);
-			disable_irq(mb_chann->msix_irq);
-			return;
+			return ret;
 		}
+		mb_chann->stats.msgs++;
 	}
 
 	/*
@@ -476,6 +680,62 @@ again:
 	iohub = mailbox_reg_read(mb_chann, mb_chann->iohub_int_addr);
 	if (iohub)
 		goto again;
+
+	return 0;
+}
+
+static void mailbox_rx_worker(struct work_struct *rx_work)
+{
+	struct mailbox_channel *mb_chann;
+
+	mb_chann = container_of(rx_work, struct mailbox_channel, rx_work);
+	trace_mbox_rx_worker(MAILBOX_NAME, mb_chann->msix_irq);
+
+	if (READ_ONCE(mb_chann->bad_state)) {
+		MB_ERR(mb_chann, "Channel in bad state, work aborted");
+		return;
+	}
+	mb_chann->stats.wakeups++;
+
+	if (mailbox_rx_drain(mb_chann))
+		disable_irq(mb_chann->msix_irq);
+}
+
+/*
+ * Threaded handler of mailbox_irq_thread channels. IRQ threads run
+ * SCHED_FIFO, so responses are not queued behind other work as with the
+ * rx workqueue. The line stays masked until this returns (IRQF_ONESHOT).
+ */
+static irqreturn_t mailbox_irq_thread_fn(int irq, void *p)
+{
+	struct mailbox_channel *mb_chann = p;
+
+	trace_mbox_irq_thread(MAILBOX_NAME, irq);
+	if (READ_ONCE(mb_chann->bad_state))
+		return IRQ_HANDLED;
+	mb_chann->stats.wakeups++;
+
+	/* disable_irq() would wait for this thread */
+	if (mailbox_rx_drain(mb_chann))
+		disable_irq_nosync(irq);
+
+	return IRQ_HANDLED;
+}
+
+static void mailbox_napi_schedule(struct mailbox_channel *mb_chann)
+{
+	struct mailbox *mb = mb_chann->mb;
+	unsigned long flags;
+
+	spin_lock_irqsave(&mb->napi_lock, flags);
+	if (!mb_chann->napi_sched) {
+		mb_chann->napi_sched = true;
+		mb_chann->stats.wakeups++;
+		list_add_tail(&mb_chann->napi_entry, &mb->napi_list);
+	}
+	spin_unlock_irqrestore(&mb->napi_lock, flags);
+
+	wake_up(&mb->napi_wait);
 }
 
 static irqreturn_t mailbox_irq_handler(int irq, void *p)
@@ -483,15 +743,179 @@ static irqreturn_t mailbox_irq_handler(int irq, void *p)
 	struct mailbox_channel *mb_chann = p;
 
 	trace_mbox_irq_handle(MAILBOX_NAME, irq);
+	mb_chann->stats.irqs++;
 	if (mb_chann->type == MB_CHANNEL_USER_POLL)
 		return IRQ_HANDLED;
 
+	if (trace_mbox_rx_latency_enabled())
+		WRITE_ONCE(mb_chann->irq_ts, ktime_get_ns());
+
+	if (mb_chann->irq_thread)
+		return IRQ_WAKE_THREAD;
+
+	if (mb_chann->napi) {
+		/* Stays masked until napid finds the channel idle */
+		disable_irq_nosync(irq);
+		mailbox_napi_schedule(mb_chann);
+		return IRQ_HANDLED;
+	}
+
 	/* Schedule a rx_work to call the callback functions */
 	queue_work(mb_chann->work_q, &mb_chann->rx_work);
 
 	return IRQ_HANDLED;
 }
 
+enum mailbox_napi_state {
+	MB_NAPI_MORE,	/* Keep polling */
+	MB_NAPI_IDLE,	/* Unmask the interrupt */
+	MB_NAPI_ERR,	/* Bad channel, leave it masked */
+};
+
+/*
+ * mailbox_napi_poll() - One pass over the I2X ring of a channel
+ *
+ * At most MB_NAPI_BUDGET responses are handled so other channels get their
+ * turn. Once the ring is empty, the channel keeps being polled for up to
+ * napi_spin_ns if it still waits for responses. The spin time adapts: it
+ * doubles when a response showed up during the spin and halves when the
+ * spin ran out for nothing, between 1/8 and all of mailbox_napi_spin_us.
+ */
+static enum mailbox_napi_state mailbox_napi_poll(struct mailbox_channel *mb_chann)
+{
+	u64 spin_max = (u64)READ_ONCE(mailbox_napi_spin_us) * NSEC_PER_USEC;
+	u64 now;
+	int cnt;
+	int ret;
+
+	if (READ_ONCE(mb_chann->bad_state))
+		return MB_NAPI_ERR;
+
+	mailbox_reg_write(mb_chann, mb_chann->iohub_int_addr, 0);
+	mb_chann->stats.polls++;
+
+	for (cnt = 0; cnt < MB_NAPI_BUDGET; cnt++) {
+		ret = mailbox_get_msg(mb_chann);
+		if (ret == -ENOENT)
+			break;
+
+		if (unlikely(ret)) {
+			MB_ERR(mb_chann, "Unexpected ret %d, keep irq disabled", ret);
+			WRITE_ONCE(mb_chann->bad_state, true);
+			return MB_NAPI_ERR;
+		}
+	}
+	mb_chann->stats.msgs += cnt;
+
+	now = ktime_get_ns();
+	if (cnt) {
+		if (mb_chann->napi_spinning)
+			mb_chann->napi_spin_ns = min(mb_chann->napi_spin_ns * 2, spin_max);
+		mb_chann->napi_spinning = false;
+		mb_chann->napi_last_rx = now;
+		return MB_NAPI_MORE;
+	}
+
+	/* A response may have landed after the ring was found empty */
+	if (mailbox_reg_read(mb_chann, mb_chann->iohub_int_addr))
+		return MB_NAPI_MORE;
+
+	if (!mailbox_channel_no_msg(mb_chann) &&
+	    now - mb_chann->napi_last_rx < min(mb_chann->napi_spin_ns, spin_max)) {
+		mb_chann->napi_spinning = true;
+		return MB_NAPI_MORE;
+	}
+
+	if (mb_chann->napi_spinning)
+		mb_chann->napi_spin_ns = max(mb_chann->napi_spin_ns / 2, spin_max / 8);
+	mb_chann->napi_spinning = false;
+	return MB_NAPI_IDLE;
+}
+
+static bool mailbox_napi_pending(struct mailbox *mb)
+{
+	bool pending;
+
+	spin_lock_irq(&mb->napi_lock);
+	pending = !list_empty(&mb->napi_list);
+	spin_unlock_irq(&mb->napi_lock);
+
+	return pending;
+}
+
+/*
+ * NAPI style completion for interrupt driven channels. The interrupt handler
+ * masks the channel interrupt and queues the channel here. While responses
+ * keep coming, the channel is polled round robin with the other busy
+ * channels and takes no interrupts. It is unmasked again once idle.
+ */
+static int mailbox_napid(void *data)
+{
+	struct mailbox *mb = (struct mailbox *)data;
+	struct mailbox_channel *mb_chann;
+	enum mailbox_napi_state state;
+
+	dev_dbg(mb->dev, "napid start");
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(mb->napi_wait, mailbox_napi_pending(mb) ||
+					 kthread_should_stop());
+
+		mutex_lock(&mb->napi_mutex);
+		spin_lock_irq(&mb->napi_lock);
+		mb_chann = list_first_entry_or_null(&mb->napi_list, struct mailbox_channel,
+						    napi_entry);
+		if (mb_chann)
+			list_del_init(&mb_chann->napi_entry);
+		spin_unlock_irq(&mb->napi_lock);
+		if (!mb_chann) {
+			mutex_unlock(&mb->napi_mutex);
+			continue;
+		}
+
+		state = mailbox_napi_poll(mb_chann);
+
+		spin_lock_irq(&mb->napi_lock);
+		if (state == MB_NAPI_MORE)
+			list_add_tail(&mb_chann->napi_entry, &mb->napi_list);
+		else
+			mb_chann->napi_sched = false;
+		spin_unlock_irq(&mb->napi_lock);
+
+		if (state == MB_NAPI_IDLE)
+			enable_irq(mb_chann->msix_irq);
+		mutex_unlock(&mb->napi_mutex);
+
+		cond_resched();
+	}
+	dev_dbg(mb->dev, "napid stop");
+
+	return 0;
+}
+
+/* Take the channel away from napid. The interrupt is disabled by the caller. */
+static void mailbox_napi_cancel(struct mailbox_channel *mb_chann)
+{
+	struct mailbox *mb = mb_chann->mb;
+	bool sched;
+
+	if (!mb_chann->napi)
+		return;
+
+	mutex_lock(&mb->napi_mutex);
+	spin_lock_irq(&mb->napi_lock);
+	sched = mb_chann->napi_sched;
+	if (sched) {
+		list_del_init(&mb_chann->napi_entry);
+		mb_chann->napi_sched = false;
+	}
+	spin_unlock_irq(&mb->napi_lock);
+	mutex_unlock(&mb->napi_mutex);
+
+	/* Balance disable_irq_nosync() of the interrupt handler */
+	if (sched)
+		enable_irq(mb_chann->msix_irq);
+}
+
 #ifdef AMDXDNA_DEVEL
 static void mailbox_timer(struct timer_list *t)
 {
@@ -520,6 +944,8 @@ static void mailbox_polld_handle_chann(struct mailbox_channel *mb_chann)
 		return;
 
 	trace_mbox_poll_handle(MAILBOX_NAME, mb_chann->msix_irq);
+	mb_chann->stats.wakeups++;
+	mb_chann->stats.polls++;
 
 	/* Clear pending events */
 	iohub = 0;
@@ -537,6 +963,8 @@ static void mailbox_polld_handle_chann(struct mailbox_channel *mb_chann)
 	 */
 	do {
 		ret = mailbox_get_msg(mb_chann);
+		if (!ret)
+			mb_chann->stats.msgs++;
 	} while (!ret);
 
 	if (ret == -ENOENT)
@@ -618,15 +1046,14 @@ static int mailbox_polld(void *data)
 	return 0;
 }
 
-int xdna_mailbox_send_msg(struct mailbox_channel *mb_chann,
-			  struct xdna_mailbox_msg *msg, u64 tx_timeout)
+/* Copy one message to the ring without making it visible to firmware */
+static int mailbox_post_msg(struct mailbox_channel *mb_chann, struct xdna_mailbox_msg *msg)
 {
-	struct xdna_msg_header *header;
-	struct mailbox_msg *mb_msg;
+	struct mailbox_msg *spare = NULL;
 	size_t pkg_size;
 	int ret;
 
-	pkg_size = sizeof(*header) + msg->send_size;
+	pkg_size = sizeof(struct xdna_msg_header) + msg->send_size;
 	if (pkg_size > mailbox_get_ringbuf_size(mb_chann, CHAN_RES_X2I)) {
 		MB_ERR(mb_chann, "Message size larger than ringbuf size");
 		return -EINVAL;
@@ -638,7 +1065,7 @@ int xdna_mailbox_send_msg(struct mailbox_channel *mb_chann,
 	}
 
 	/* The fist word in payload can NOT be TOMBSTONE */
-	if (unlikely(((u32 *)msg->send_data)[0] == TOMBSTONE)) {
+	if (unlikely(((u32 *)msg->send_data)[0] == MAILBOX_TOMBSTONE)) {
 		MB_ERR(mb_chann, "Tomb stone in data");
 		return -EINVAL;
 	}
@@ -648,51 +1075,85 @@ int xdna_mailbox_send_msg(struct mailbox_channel *mb_chann,
 		return -EPIPE;
 	}
 
-	mb_msg = kzalloc(sizeof(*mb_msg) + pkg_size, GFP_KERNEL);
-	if (!mb_msg)
-		return -ENOMEM;
+again:
+	spin_lock_bh(&mb_chann->tx_lock);
+	ret = mailbox_stage_msg(mb_chann, msg, pkg_size, &spare);
+	spin_unlock_bh(&mb_chann->tx_lock);
+	if (ret == -EAGAIN) {
+		spare = mailbox_alloc_msg(mb_chann, pkg_size);
+		if (!spare)
+			return -ENOMEM;
+		goto again;
+	}
+	if (ret)
+		MB_DBG(mb_chann, "Error in mailbox send msg, ret %d", ret);
 
-	mb_msg->handle = msg->handle;
-	mb_msg->notify_cb = msg->notify_cb;
-	mb_msg->pkg_size = pkg_size;
+	if (spare)
+		mailbox_free_msg(mb_chann, spare);
+	return ret;
+}
 
-	header = &mb_msg->pkg.header;
-	/*
-	 * Hardware use total_size and size to split huge message.
-	 * We do not support it here. Thus the values are the same.
-	 */
-	header->total_size = msg->send_size;
-	header->sz_ver = FIELD_PREP(MSG_BODY_SZ, msg->send_size) |
-			FIELD_PREP(MSG_PROTO_VER, MSG_PROTOCOL_VERSION);
-	header->opcode = msg->opcode;
-	memcpy(mb_msg->pkg.payload, msg->send_data, msg->send_size);
+static enum hrtimer_restart mailbox_tx_timer(struct hrtimer *timer)
+{
+	struct mailbox_channel *mb_chann;
 
-	ret = mailbox_acquire_msgid(mb_chann, mb_msg);
-	if (unlikely(ret < 0)) {
-		MB_ERR(mb_chann, "mailbox_acquire_msgid failed");
-		goto msg_id_failed;
-	}
-	header->id = ret;
-	msg->id = header->id;
+	mb_chann = container_of(timer, struct mailbox_channel, tx_timer);
+	spin_lock(&mb_chann->tx_lock);
+	if (mb_chann->x2i_held)
+		mailbox_set_tailptr(mb_chann, mb_chann->x2i_tail);
+	spin_unlock(&mb_chann->tx_lock);
 
-	MB_DBG(mb_chann, "opcode 0x%x size %d id 0x%x",
-	       header->opcode, header->total_size, header->id);
+	return HRTIMER_NORESTART;
+}
 
-	ret = mailbox_send_msg(mb_chann, mb_msg);
-	if (ret) {
-		MB_DBG(mb_chann, "Error in mailbox send msg, ret %d", ret);
-		goto release_id;
+int xdna_mailbox_send_msgs(struct mailbox_channel *mb_chann, struct xdna_mailbox_msg *msgs,
+			   u32 cnt, u32 flags, u64 tx_timeout)
+{
+	int ret = 0;
+	bool hold;
+	u32 i;
+
+	for (i = 0; i < cnt; i++) {
+		ret = mailbox_post_msg(mb_chann, &msgs[i]);
+		if (ret)
+			break;
 	}
 
-	if (mb_chann->type == MB_CHANNEL_USER_POLL)
+	/*
+	 * Hold the tail only when everything fit and more is coming. Otherwise
+	 * publish whatever is in the ring, including what earlier calls held,
+	 * so firmware can drain it.
+	 */
+	hold = i == cnt && (flags & XDNA_MAILBOX_SEND_MORE);
+	spin_lock_bh(&mb_chann->tx_lock);
+	if (hold) {
+		if (!mb_chann->x2i_held) {
+			mb_chann->x2i_held = true;
+			hrtimer_start(&mb_chann->tx_timer, ns_to_ktime(MB_TX_HOLD_NS),
+				      HRTIMER_MODE_REL_SOFT);
+		}
+	} else if (mb_chann->x2i_held) {
+		/* A running timer finds nothing held and returns */
+		hrtimer_try_to_cancel(&mb_chann->tx_timer);
+		mailbox_set_tailptr(mb_chann, mb_chann->x2i_tail);
+	} else if (i) {
+		mailbox_set_tailptr(mb_chann, mb_chann->x2i_tail);
+	}
+	spin_unlock_bh(&mb_chann->tx_lock);
+
+	if (i && mb_chann->type == MB_CHANNEL_USER_POLL)
 		mailbox_polld_wakeup(mb_chann->mb);
-	return 0;
 
-release_id:
-	mailbox_release_msgid(mb_chann, header->id);
-msg_id_failed:
-	kfree(mb_msg);
-	return ret;
+	return i ? i : ret;
+}
+
+int xdna_mailbox_send_msg(struct mailbox_channel *mb_chann,
+			  struct xdna_mailbox_msg *msg, u64 tx_timeout)
+{
+	int ret;
+
+	ret = xdna_mailbox_send_msgs(mb_chann, msg, 1, 0, tx_timeout);
+	return ret < 0 ? ret : 0;
 }
 
 #if defined(CONFIG_DEBUG_FS)
@@ -736,11 +1197,25 @@ found:
 	return record;
 }
 
+static void xdna_mailbox_stats_show(struct mailbox_channel *mb_chann, struct seq_file *m)
+{
+	struct xdna_mailbox_chann_stats stats;
+	u64 per_wakeup;
+
+	xdna_mailbox_get_stats(mb_chann, &stats);
+	/* In hundredths */
+	per_wakeup = stats.wakeups ? div64_u64(stats.msgs * 100, stats.wakeups) : 0;
+	seq_printf(m, "%4d  %-6s  %-12llu  %-12llu  %-12llu  %-12llu  %llu.%02llu\n",
+		   mb_chann->msix_irq, mailbox_rx_path(mb_chann), stats.irqs, stats.wakeups,
+		   stats.polls, stats.msgs, per_wakeup / 100, per_wakeup % 100);
+}
+
 int xdna_mailbox_info_show(struct mailbox *mb, struct seq_file *m)
 {
 	static const char ring_fmt[] = "%4d  %3s  %5d  %4d  0x%08x  0x%04x  ";
 	static const char mbox_fmt[] = "0x%08x  0x%08x  0x%04x    0x%04x\n";
 	struct mailbox_res_record *record;
+	struct mailbox_channel *mb_chann;
 
 	/* If below two puts changed, make sure update fmt[] as well */
 	seq_puts(m, "mbox  dir  alive  type  ring addr   size    ");
@@ -771,6 +1246,15 @@ int xdna_mailbox_info_show(struct mailbox *mb, struct seq_file *m)
 	}
 	spin_unlock(&mb->mbox_lock);
 
+	seq_puts(m, "\nmbox  mode    irqs          wakeups       polls         msgs          ");
+	seq_puts(m, "msgs/wakeup\n");
+	spin_lock(&mb->mbox_lock);
+	list_for_each_entry(mb_chann, &mb->chann_list, chann_entry)
+		xdna_mailbox_stats_show(mb_chann, m);
+	list_for_each_entry(mb_chann, &mb->poll_chann_list, chann_entry)
+		xdna_mailbox_stats_show(mb_chann, m);
+	spin_unlock(&mb->mbox_lock);
+
 	return 0;
 }
 
@@ -849,10 +1333,34 @@ xdna_mailbox_create_channel(struct mailbox *mb,
 #endif
 	mb_chann->msix_irq = mb_irq;
 	mb_chann->iohub_int_addr = iohub_int_addr;
+	if (mb_chann->type == MB_CHANNEL_USER_NORMAL) {
+		mb_chann->irq_thread = mailbox_irq_thread;
+		mb_chann->napi = mailbox_napi && !mailbox_irq_thread;
+	}
+#ifdef AMDXDNA_DEVEL
+	if (MB_PERIODIC_POLL) {
+		mb_chann->irq_thread = false;
+		mb_chann->napi = false;
+	}
+#endif
+	INIT_LIST_HEAD(&mb_chann->napi_entry);
+	mb_chann->napi_spin_ns = (u64)mailbox_napi_spin_us * NSEC_PER_USEC;
 	memcpy(&mb_chann->res[CHAN_RES_X2I], x2i, sizeof(*x2i));
 	memcpy(&mb_chann->res[CHAN_RES_I2X], i2x, sizeof(*i2x));
 
-	xa_init_flags(&mb_chann->chan_xa, XA_FLAGS_ALLOC | XA_FLAGS_LOCK_IRQ);
+	spin_lock_init(&mb_chann->msg_lock);
+	spin_lock_init(&mb_chann->tx_lock);
+#if KERNEL_VERSION(6, 13, 0) > LINUX_VERSION_CODE
+	hrtimer_init(&mb_chann->tx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+	mb_chann->tx_timer.function = mailbox_tx_timer;
+#else
+	hrtimer_setup(&mb_chann->tx_timer, mailbox_tx_timer, CLOCK_MONOTONIC,
+		      HRTIMER_MODE_REL_SOFT);
+#endif
+	mb_chann->slots = kcalloc(MB_MSG_SLOTS, MB_SLOT_SIZE, GFP_KERNEL);
+	if (!mb_chann->slots)
+		goto free_and_out;
+
 	mb_chann->x2i_tail = mailbox_get_tailptr(mb_chann, CHAN_RES_X2I);
 	mb_chann->i2x_head = mailbox_get_headptr(mb_chann, CHAN_RES_I2X);
 	mailbox_reg_write(mb_chann, mb_chann->iohub_int_addr, 0);
@@ -876,7 +1384,11 @@ xdna_mailbox_create_channel(struct mailbox *mb,
 	}
 #endif
 	/* Everything look good. Time to enable irq handler */
-	ret = request_irq(mb_irq, mailbox_irq_handler, 0, MAILBOX_NAME, mb_chann);
+	if (mb_chann->irq_thread)
+		ret = request_threaded_irq(mb_irq, mailbox_irq_handler, mailbox_irq_thread_fn,
+					   IRQF_ONESHOT, MAILBOX_NAME, mb_chann);
+	else
+		ret = request_irq(mb_irq, mailbox_irq_handler, 0, MAILBOX_NAME, mb_chann);
 	if (ret) {
 		MB_ERR(mb_chann, "Failed to request irq %d ret %d", mb_irq, ret);
 		goto destroy_wq;
@@ -904,6 +1416,7 @@ skip_irq:
 destroy_wq:
 	destroy_workqueue(mb_chann->work_q);
 free_and_out:
+	kfree(mb_chann->slots);
 	kfree(mb_chann);
 	return NULL;
 }
@@ -911,7 +1424,7 @@ free_and_out:
 void xdna_mailbox_release_channel(struct mailbox_channel *mb_chann)
 {
 	struct mailbox_msg *mb_msg;
-	unsigned long msg_id;
+	u32 msg_id;
 
 	if (!mb_chann)
 		return;
@@ -927,16 +1440,21 @@ void xdna_mailbox_release_channel(struct mailbox_channel *mb_chann)
 	if (MB_PERIODIC_POLL)
 		goto destroy_wq;
 #endif
+	mailbox_napi_cancel(mb_chann);
 	free_irq(mb_chann->msix_irq, mb_chann);
 
 #ifdef AMDXDNA_DEVEL
 destroy_wq:
 #endif
 	destroy_workqueue(mb_chann->work_q);
+	hrtimer_cancel(&mb_chann->tx_timer);
 	/* We can clean up and release resources */
 
-	xa_for_each(&mb_chann->chan_xa, msg_id, mb_msg)
-		mailbox_release_msg(mb_chann, mb_msg);
+	for (msg_id = 0; msg_id < MAX_MSG_ID_ENTRIES; msg_id++) {
+		mb_msg = mailbox_take_msg(mb_chann, msg_id);
+		if (mb_msg)
+			mailbox_release_msg(mb_chann, mb_msg);
+	}
 
 	MB_DBG(mb_chann, "Mailbox channel released type %d irq: %d",
 	       mb_chann->type, mb_chann->msix_irq);
@@ -947,7 +1465,7 @@ void xdna_mailbox_free_channel(struct mailbox_channel *mb_chann)
 	if (!mb_chann)
 		return;
 
-	xa_destroy(&mb_chann->chan_xa);
+	kfree(mb_chann->slots);
 	kfree(mb_chann);
 }
 
@@ -961,15 +1479,26 @@ void xdna_mailbox_stop_channel(struct mailbox_channel *mb_chann)
 #endif
 	/* Disable an irq and wait. This might sleep. */
 	disable_irq(mb_chann->msix_irq);
+	mailbox_napi_cancel(mb_chann);
 
 #ifdef AMDXDNA_DEVEL
 skip_irq:
 #endif
 	/* Cancel RX work and wait for it to finish */
 	cancel_work_sync(&mb_chann->rx_work);
+	hrtimer_cancel(&mb_chann->tx_timer);
 	MB_DBG(mb_chann, "IRQ disabled and RX work cancelled");
 }
 
+void xdna_mailbox_get_stats(struct mailbox_channel *mb_chann,
+			    struct xdna_mailbox_chann_stats *stats)
+{
+	stats->irqs = READ_ONCE(mb_chann->stats.irqs);
+	stats->wakeups = READ_ONCE(mb_chann->stats.wakeups);
+	stats->polls = READ_ONCE(mb_chann->stats.polls);
+	stats->msgs = READ_ONCE(mb_chann->stats.msgs);
+}
+
 void xdna_mailbox_destroy_channel(struct mailbox_channel *mailbox_chann)
 {
 	xdna_mailbox_release_channel(mailbox_chann);
@@ -989,6 +1518,12 @@ struct mailbox *xdna_mailbox_create(struct device *dev,
 	/* mailbox and ring buf base and size information */
 	memcpy(&mb->res, res, sizeof(*res));
 
+	mb->msg_cache = kmem_cache_create(MAILBOX_NAME "_msg", MB_SLOT_SIZE, 0, 0, NULL);
+	if (!mb->msg_cache) {
+		kfree(mb);
+		return NULL;
+	}
+
 	spin_lock_init(&mb->mbox_lock);
 	INIT_LIST_HEAD(&mb->chann_list);
 	INIT_LIST_HEAD(&mb->poll_chann_list);
@@ -1001,12 +1536,26 @@ struct mailbox *xdna_mailbox_create(struct device *dev,
 	mb->polld = kthread_run(mailbox_polld, mb, MAILBOX_NAME);
 	if (IS_ERR(mb->polld)) {
 		dev_err(mb->dev, "Failed to create polld ret %ld", PTR_ERR(mb->polld));
+		kmem_cache_destroy(mb->msg_cache);
 		kfree(mb);
 		return NULL;
 	}
 	init_waitqueue_head(&mb->poll_wait);
 	mb->sent_msg = false;
 
+	spin_lock_init(&mb->napi_lock);
+	INIT_LIST_HEAD(&mb->napi_list);
+	mutex_init(&mb->napi_mutex);
+	init_waitqueue_head(&mb->napi_wait);
+	mb->napid = kthread_run(mailbox_napid, mb, MAILBOX_NAME "_napi");
+	if (IS_ERR(mb->napid)) {
+		dev_err(mb->dev, "Failed to create napid ret %ld", PTR_ERR(mb->napid));
+		(void)kthread_stop(mb->polld);
+		kmem_cache_destroy(mb->msg_cache);
+		kfree(mb);
+		return NULL;
+	}
+
 #if defined(CONFIG_DEBUG_FS)
 	INIT_LIST_HEAD(&mb->res_records);
 #endif /* CONFIG_DEBUG_FS */
@@ -1031,10 +1580,12 @@ done_release_record:
 #endif /* CONFIG_DEBUG_FS */
 	dev_dbg(mb->dev, "Stopping polld");
 	(void)kthread_stop(mb->polld);
+	(void)kthread_stop(mb->napid);
 
 	spin_lock(&mb->mbox_lock);
 	WARN_ONCE(!list_empty(&mb->chann_list), "Channel not destroy");
 	spin_unlock(&mb->mbox_lock);
 
+	kmem_cache_destroy(mb->msg_cache);
 	kfree(mb);
 }
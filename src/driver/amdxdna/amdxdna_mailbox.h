@@ -164,6 +164,53 @@ void xdna_mailbox_stop_channel(struct mailbox_channel *mailbox_chann);
 int xdna_mailbox_send_msg(struct mailbox_channel *mailbox_chann,
 			  struct xdna_mailbox_msg *msg, u64 tx_timeout);
 
+/* More messages follow shortly, firmware may be notified later */
+#define XDNA_MAILBOX_SEND_MORE		BIT(0)
+
+/*
+ * xdna_mailbox_send_msgs() -- Send messages with one tail pointer update
+ *
+ * @mailbox_chann: Mailbox channel handle
+ * @msgs: array of messages
+ * @cnt: number of messages
+ * @flags: XDNA_MAILBOX_SEND_*
+ * @tx_timeout: the timeout value for sending the message in ms.
+ *
+ * The messages are copied to the ring back to back and firmware is notified
+ * once for all of them. With XDNA_MAILBOX_SEND_MORE, the notification is
+ * held until the next send, or for 50us at most.
+ *
+ * Return: number of messages sent, which is less than @cnt if the ring is
+ * full. Error code if none is sent.
+ */
+int xdna_mailbox_send_msgs(struct mailbox_channel *mailbox_chann,
+			   struct xdna_mailbox_msg *msgs, u32 cnt, u32 flags,
+			   u64 tx_timeout);
+
+/*
+ * xdna_mailbox_chann_stats - receive counters of a channel
+ *
+ * @irqs:	interrupts taken
+ * @wakeups:	times the rx worker or a poll thread was started for the channel
+ * @polls:	passes over the response ring
+ * @msgs:	responses received
+ */
+struct xdna_mailbox_chann_stats {
+	u64	irqs;
+	u64	wakeups;
+	u64	polls;
+	u64	msgs;
+};
+
+/*
+ * xdna_mailbox_get_stats() -- Read the receive counters of a channel
+ *
+ * @mailbox_chann: Mailbox channel handle
+ * @stats: filled with the counters since the channel was created
+ */
+void xdna_mailbox_get_stats(struct mailbox_channel *mailbox_chann,
+			    struct xdna_mailbox_chann_stats *stats);
+
 #if defined(CONFIG_DEBUG_FS)
 /*
  * xdna_mailbox_info_show() -- Show mailbox info for debug
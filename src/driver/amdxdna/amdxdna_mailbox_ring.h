@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#ifndef _AMDXDNA_MAILBOX_RING_H_
+#define _AMDXDNA_MAILBOX_RING_H_
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/errno.h>
+
+/*
+ * Ring buffer arithmetic of a mailbox channel, the same for X2I and I2X.
+ *
+ * Only offsets are handled here, the caller does all register and ring
+ * memory access. This keeps the header usable outside of the kernel, the
+ * firmware model of the mailbox test is built on it too.
+ *
+ * The writer owns the tail and the reader owns the head, head == tail means
+ * the ring is empty. A package is never split across the end of the ring.
+ * If it does not fit before the end, the writer puts MAILBOX_TOMBSTONE at the
+ * tail and continues from offset 0. The last word of the ring is never used
+ * by a package so there is always room for the tombstone.
+ */
+#define MAILBOX_TOMBSTONE	0xDEADFACE
+
+/* Head and tail are byte offsets in the ring and word aligned */
+static inline bool mailbox_ring_ptr_valid(u32 ptr, u32 ring_size)
+{
+	return ptr <= ring_size && IS_ALIGNED(ptr, sizeof(u32));
+}
+
+/*
+ * mailbox_ring_reserve() - Find space for a package on the writer side
+ *
+ * @head:	reader offset
+ * @tail:	writer offset
+ * @ring_size:	ring size in bytes
+ * @len:	package size in bytes
+ * @offset:	where the package goes. When it is not @tail, the writer has to
+ *		put MAILBOX_TOMBSTONE at @tail first.
+ *
+ * The new tail is @offset + @len. It never reaches @head from behind, that
+ * would look like an empty ring to the reader.
+ *
+ * Return: 0 or -ENOSPC
+ */
+static inline int
+mailbox_ring_reserve(u32 head, u32 tail, u32 ring_size, u32 len, u32 *offset)
+{
+	u32 tmp_tail = tail + len;
+
+	if (tail < head) {
+		if (tmp_tail >= head)
+			return -ENOSPC;
+	} else if (tmp_tail > ring_size - sizeof(u32)) {
+		/* Wrap around, the package has to fit in front of the head */
+		if (len >= head)
+			return -ENOSPC;
+		*offset = 0;
+		return 0;
+	}
+
+	*offset = tail;
+	return 0;
+}
+
+/*
+ * The writer may leave the tail at the very end of the ring, the reader
+ * continues from the start then.
+ */
+static inline u32 mailbox_ring_read_start(u32 head, u32 ring_size)
+{
+	return head == ring_size ? 0 : head;
+}
+
+/*
+ * A tombstone at @head is only legal once the writer has wrapped, i.e. the
+ * tail is behind the head. The reader continues at offset 0.
+ */
+static inline bool mailbox_ring_tombstone_valid(u32 head, u32 tail)
+{
+	return tail < head;
+}
+
+/* Package of @len bytes at @head lies before the ring end and the tail */
+static inline bool mailbox_ring_pkg_valid(u32 head, u32 tail, u32 ring_size, u32 len)
+{
+	/* tail - head wraps when the tail is behind, only the ring end limits then */
+	return len <= ring_size - head && len <= tail - head;
+}
+
+#endif /* _AMDXDNA_MAILBOX_RING_H_ */
@@ -119,6 +119,7 @@ static int amdxdna_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 	pm_runtime_allow(dev);
 
 	amdxdna_tdr_start(&xdna->tdr);
+	amdxdna_gem_huge_init(xdna);
 
 	ret = drm_dev_register(&xdna->ddev, 0);
 	if (ret) {
@@ -139,6 +140,7 @@ static int amdxdna_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 	return 0;
 
 failed_tdr_fini:
+	amdxdna_gem_huge_fini(xdna);
 	amdxdna_tdr_stop(&xdna->tdr);
 	amdxdna_sysfs_fini(xdna);
 failed_dev_fini:
@@ -182,6 +184,7 @@ static void amdxdna_remove(struct pci_dev *pdev)
 	mutex_unlock(&xdna->dev_lock);
 
 	xdna->dev_info->ops->fini(xdna);
+	amdxdna_gem_huge_fini(xdna);
 #ifdef AMDXDNA_DEVEL
 	ida_destroy(&xdna->pdi_ida);
 #endif
@@ -248,14 +251,26 @@ static struct pci_driver amdxdna_pci_driver = {
 
 static int __init amdxdna_mod_init(void)
 {
+	int ret;
+
+	ret = amdxdna_job_cache_init();
+	if (ret)
+		return ret;
+
 	amdxdna_carvedout_init();
-	return pci_register_driver(&amdxdna_pci_driver);
+	ret = pci_register_driver(&amdxdna_pci_driver);
+	if (ret) {
+		amdxdna_carvedout_fini();
+		amdxdna_job_cache_fini();
+	}
+	return ret;
 }
 
 static void __exit amdxdna_mod_exit(void)
 {
 	pci_unregister_driver(&amdxdna_pci_driver);
 	amdxdna_carvedout_fini();
+	amdxdna_job_cache_fini();
 }
 
 module_init(amdxdna_mod_init);
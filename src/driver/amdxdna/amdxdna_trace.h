@@ -59,8 +59,11 @@ TRACE_EVENT(xdna_job,
 	    TP_fast_assign(__assign_str(name);
 			   __assign_str(str);
 #endif
-			   __entry->fence_context = sched_job->s_fence->finished.context;
-			   __entry->fence_seqno = sched_job->s_fence->finished.seqno;
+			   /* Jobs sent directly have no scheduler fence */
+			   __entry->fence_context = sched_job->s_fence ?
+				sched_job->s_fence->finished.context : 0;
+			   __entry->fence_seqno = sched_job->s_fence ?
+				sched_job->s_fence->finished.seqno : 0;
 			   __entry->seq = seq;
 			   __entry->op = op;),
 
@@ -141,6 +144,37 @@ DEFINE_EVENT(xdna_mbox_name_id, mbox_poll_handle,
 	     TP_ARGS(name, irq)
 );
 
+DEFINE_EVENT(xdna_mbox_name_id, mbox_irq_thread,
+	     TP_PROTO(char *name, int irq),
+	     TP_ARGS(name, irq)
+);
+
+TRACE_EVENT(mbox_rx_latency,
+	    TP_PROTO(char *name, int irq, const char *path, u32 msg_id, u64 delay_ns),
+
+	    TP_ARGS(name, irq, path, msg_id, delay_ns),
+
+	    TP_STRUCT__entry(__string(name, name)
+			     __field(int, irq)
+			     __string(path, path)
+			     __field(u32, msg_id)
+			     __field(u64, delay_ns)),
+
+#if KERNEL_VERSION(6, 10, 0) > LINUX_VERSION_CODE
+	    TP_fast_assign(__assign_str(name, name);
+			   __assign_str(path, path);
+#else
+	    TP_fast_assign(__assign_str(name);
+			   __assign_str(path);
+#endif
+			   __entry->irq = irq;
+			   __entry->msg_id = msg_id;
+			   __entry->delay_ns = delay_ns;),
+
+	    TP_printk("%s.%d %s id 0x%x irq to notify done %llu ns", __get_str(name),
+		      __entry->irq, __get_str(path), __entry->msg_id, __entry->delay_ns)
+);
+
 #endif /* !defined(_AMDXDNA_TRACE_EVENTS_H_) || defined(TRACE_HEADER_MULTI_READ) */
 
 /* This part must be outside protection */
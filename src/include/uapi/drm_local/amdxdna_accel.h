@@ -19,7 +19,12 @@ extern "C" {
 #endif
 
 #define AMDXDNA_DRIVER_MAJOR		1
-#define AMDXDNA_DRIVER_MINOR		0
+/*
+ * Minor 1: AMDXDNA_BO_DEV_HEAP can be created more than once per client, each
+ * one adds a chunk to the device heap after the ones before it.
+ * Minor 2: AMDXDNA_CTX_FLAG_STATUS_BO.
+ */
+#define AMDXDNA_DRIVER_MINOR		2
 
 #define AMDXDNA_INVALID_ADDR		(~0UL)
 #define AMDXDNA_INVALID_CTX_HANDLE	0
@@ -57,6 +62,7 @@ extern "C" {
 #define	DRM_AMDXDNA_GET_INFO		7
 #define	DRM_AMDXDNA_SET_STATE		8
 #define	DRM_AMDXDNA_WAIT_CMD		9
+#define	DRM_AMDXDNA_CREATE_BOS		10
 
 #define	AMDXDNA_DEV_TYPE_UNKNOWN	-1
 #define	AMDXDNA_DEV_TYPE_KMQ		0
@@ -102,7 +108,8 @@ struct amdxdna_qos_info {
 /**
  * struct amdxdna_drm_create_ctx - Create context.
  * @ext: MBZ.
- * @ext_flags: MBZ.
+ * @ext_flags: AMDXDNA_CTX_FLAG_*, others MBZ. AMDXDNA_CTX_FLAG_STATUS_BO
+ *             creates a context status BO, returned in @status_bo.
  * @qos_p: Address of QoS info.
  * @umq_bo: BO handle for user mode queue(UMQ).
  * @log_buf_bo: BO handle for log buffer.
@@ -112,9 +119,15 @@ struct amdxdna_qos_info {
  * @umq_doorbell: Returned offset of doorbell associated with UMQ.
  * @handle: Returned context handle.
  * @syncobj_handle: The drm timeline syncobj handle for command completion notification.
+ * @max_cmds: Maximum number of outstanding commands, 0 = driver default.
+ *            Returns the number the context got.
+ * @status_bo: Returned handle of the context status BO when
+ *             AMDXDNA_CTX_FLAG_STATUS_BO is set.
+ * @pad: MBZ.
  */
 struct amdxdna_drm_create_ctx {
 	__u64 ext;
+#define AMDXDNA_CTX_FLAG_STATUS_BO	(1ULL << 0)
 	__u64 ext_flags;
 	__u64 qos_p;
 	__u32 umq_bo;
@@ -125,6 +138,30 @@ struct amdxdna_drm_create_ctx {
 	__u32 umq_doorbell;
 	__u32 handle;
 	__u32 syncobj_handle;
+	__u32 max_cmds;
+	__u32 status_bo;
+	__u64 pad;
+};
+
+/**
+ * struct amdxdna_ctx_status - Context status page.
+ * @completed: Commands with a seq lower than this are all done, their
+ *             command BO holds the final state.
+ * @last_seq: Seq of the last completed command.
+ *
+ * Layout of the status BO. The BO is one page, written by the driver when a
+ * command completes and mapped read only by user space, which may look up
+ * its map_offset with DRM_IOCTL_AMDXDNA_GET_BO_INFO. Commands of a context
+ * may complete out of order, e.g. one that fails to be sent while earlier
+ * ones still run, so @last_seq can be above @completed and only @completed
+ * tells whether a given command is done. Commands dropped without a
+ * response, e.g. on timeout recovery or context destroy, may not advance
+ * @completed, use DRM_IOCTL_AMDXDNA_WAIT_CMD or the syncobj to wait for
+ * those.
+ */
+struct amdxdna_ctx_status {
+	__u64 completed;
+	__u64 last_seq;
 };
 
 /**
@@ -172,12 +209,29 @@ struct amdxdna_ctx_param_config_cu {
  *
  * Note: if the param_val is a pointer pointing to a buffer, the maximum size
  * of the buffer is 4KiB(PAGE_SIZE).
+ *
+ * DRM_AMDXDNA_CTX_SET_RESIDENT_BOS: param_val points to an array of BO handles.
+ * Commands submitted with AMDXDNA_EXEC_CMD_FLAG_RESIDENT_BOS use these BOs as
+ * argument BOs, with the same implicit synchronization. The handles are looked
+ * up once. A command fails with ENOENT once the handle of any of the BOs is
+ * closed, the set must be registered again. A param_val_size of 0 removes the
+ * set.
+ *
+ * DRM_AMDXDNA_CTX_SEAL_CHAIN: param_val is the handle of an ERT_CMD_CHAIN
+ * command BO. The driver validates and lays out the chain once. Submitting the
+ * same BO later uses that layout as long as every sub-command handle still
+ * names the BO it named at seal time, with the same payload size. Otherwise
+ * the chain is encoded as if it was not sealed. DRM_AMDXDNA_CTX_UNSEAL_CHAIN
+ * drops the chain.
  */
 struct amdxdna_drm_config_ctx {
 	__u32 handle;
 #define DRM_AMDXDNA_CTX_CONFIG_CU	0
 #define	DRM_AMDXDNA_CTX_ASSIGN_DBG_BUF	1
 #define	DRM_AMDXDNA_CTX_REMOVE_DBG_BUF	2
+#define	DRM_AMDXDNA_CTX_SET_RESIDENT_BOS	3
+#define	DRM_AMDXDNA_CTX_SEAL_CHAIN	4
+#define	DRM_AMDXDNA_CTX_UNSEAL_CHAIN	5
 	__u32 param_type;
 	__u64 param_val;
 	__u32 param_val_size;
@@ -197,13 +251,25 @@ struct amdxdna_bo_va_entry {
 
 /**
  * struct amdxdna_drm_create_bo - Create a buffer object.
- * @flags: Buffer flags. MBZ.
+ * @flags: AMDXDNA_BO_FLAG_*, others MBZ.
  * @vaddr: User VA of buffer if applied. MBZ.
+ *         Returned as in struct amdxdna_drm_get_bo_info with AMDXDNA_BO_FLAG_INFO.
  * @size: Size in bytes.
  * @type: Buffer type.
  * @handle: Returned DRM buffer object handle.
+ * @map_offset: Returned DRM fake offset for mmap() with AMDXDNA_BO_FLAG_INFO.
+ * @xdna_addr: Returned XDNA device virtual address with AMDXDNA_BO_FLAG_INFO.
+ *
+ * AMDXDNA_BO_FLAG_INFO returns what DRM_IOCTL_AMDXDNA_GET_BO_INFO would, saving
+ * that call. A driver without it fails the flag with -EINVAL.
+ *
+ * AMDXDNA_BO_FLAG_HUGE asks for huge page backing of AMDXDNA_BO_SHARE, mapped
+ * by PMD where the user VA is aligned. It is a hint, ignored where huge pages
+ * are not available. A driver without it fails the flag with -EINVAL.
  */
 struct amdxdna_drm_create_bo {
+#define AMDXDNA_BO_FLAG_INFO	(1ULL << 0)
+#define AMDXDNA_BO_FLAG_HUGE	(1ULL << 1)
 	__u64	flags;
 	__u64	vaddr;
 	__u64	size;
@@ -216,6 +282,29 @@ struct amdxdna_drm_create_bo {
 #define	AMDXDNA_BO_GUEST	6 /* BO for virt-io guest */
 	__u32	type;
 	__u32	handle;
+	__u64	map_offset;
+	__u64	xdna_addr;
+};
+
+/**
+ * struct amdxdna_drm_create_bos - Create a number of buffer objects.
+ * @bos: Address of an array of struct amdxdna_drm_create_bo, one per BO.
+ *       Each is handled as by DRM_IOCTL_AMDXDNA_CREATE_BO with
+ *       AMDXDNA_BO_FLAG_INFO set, except AMDXDNA_BO_DEV_HEAP is not accepted.
+ * @count: Number of entries in @bos, up to AMDXDNA_MAX_CREATE_BOS.
+ * @pad: MBZ.
+ *
+ * Either all BOs are created or none. Heap space of all AMDXDNA_BO_DEV
+ * entries is allocated at once. Handles are created only after all BOs are,
+ * so a failure never deletes a handle another thread could already see. The
+ * one exception is -EFAULT on writing @bos back, after which the handles
+ * exist until closed or the file is released.
+ */
+struct amdxdna_drm_create_bos {
+	__u64	bos;
+#define	AMDXDNA_MAX_CREATE_BOS	1024
+	__u32	count;
+	__u32	pad;
 };
 
 /**
@@ -257,7 +346,10 @@ struct amdxdna_drm_sync_bo {
 /**
  * struct amdxdna_drm_exec_cmd - Execute command.
  * @ext: MBZ.
- * @ext_flags: MBZ.
+ * @ext_flags: AMDXDNA_EXEC_CMD_FLAG_* for AMDXDNA_CMD_SUBMIT_EXEC_BUF, MBZ
+ *             otherwise. AMDXDNA_EXEC_CMD_FLAG_RESIDENT_BOS runs the command
+ *             on the resident BOs of the context, see
+ *             DRM_AMDXDNA_CTX_SET_RESIDENT_BOS, and needs arg_count 0.
  * @ctx: Context handle.
  * @type: Command type.
  * @cmd_handles: Array of command handles or the command handle itself
@@ -269,6 +361,7 @@ struct amdxdna_drm_sync_bo {
  */
 struct amdxdna_drm_exec_cmd {
 	__u64 ext;
+#define AMDXDNA_EXEC_CMD_FLAG_RESIDENT_BOS	(1ULL << 0)
 	__u64 ext_flags;
 	__u32 ctx;
 #define	AMDXDNA_CMD_SUBMIT_EXEC_BUF	0
@@ -417,7 +510,7 @@ struct amdxdna_drm_query_sensor {
  * @command_completions: The number of commands completed by this context.
  * @migrations: The number of times this context has been moved to a different partition.
  * @preemptions: The number of times this context has been preempted by another context in the
- *               same partition.
+ *               same partition, e.g. disconnected to let another context run.
  * @errors: The errors for this context.
  * @priority: Context priority
  */
@@ -435,6 +528,46 @@ struct amdxdna_drm_query_ctx {
 	__u64 priority;
 };
 
+#define AMDXDNA_SWITCH_HIST_BUCKETS	16
+
+/**
+ * struct amdxdna_drm_query_ctx_switch - Connect and disconnect cost of a context.
+ * @context_id: The ID for this context.
+ * @pad: Structure padding.
+ * @pid: The Process ID of the process that created this context.
+ * @connects: Number of times this context connected to the hardware.
+ * @disconnects: Number of times this context disconnected from the hardware.
+ * @yields: Disconnects to let another context connect.
+ * @connect_ns: Total time spent connecting, creating the firmware context and
+ *              configuring its CUs.
+ * @disconnect_ns: Total time spent disconnecting, waiting for the last
+ *                 command and destroying the firmware context.
+ * @resident_ns: Total time connected.
+ * @min_residency_ns: Time a context stays connected before it yields, at the
+ *                    time of the query. The same for all contexts.
+ * @connect_hist: Connect durations. Bucket 0 counts durations below 2 us,
+ *                bucket n those from 2^n us up to 2^(n+1) us, the last one
+ *                anything longer.
+ * @disconnect_hist: Disconnect durations, same buckets.
+ *
+ * Returned for DRM_AMDXDNA_QUERY_CTX_SWITCH, one per context, the same way
+ * as DRM_AMDXDNA_QUERY_HW_CONTEXTS.
+ */
+struct amdxdna_drm_query_ctx_switch {
+	__u32 context_id;
+	__u32 pad;
+	__s64 pid;
+	__u64 connects;
+	__u64 disconnects;
+	__u64 yields;
+	__u64 connect_ns;
+	__u64 disconnect_ns;
+	__u64 resident_ns;
+	__u64 min_residency_ns;
+	__u32 connect_hist[AMDXDNA_SWITCH_HIST_BUCKETS];
+	__u32 disconnect_hist[AMDXDNA_SWITCH_HIST_BUCKETS];
+};
+
 /**
  * struct amdxdna_drm_aie_mem - The data for AIE memory read/write
  * @col:   The AIE column index
@@ -525,6 +658,7 @@ struct amdxdna_drm_get_info {
 #define	DRM_AMDXDNA_GET_POWER_MODE		9
 #define	DRM_AMDXDNA_QUERY_TELEMETRY		10
 #define	DRM_AMDXDNA_GET_FORCE_PREEMPT_STATE	11
+#define	DRM_AMDXDNA_QUERY_CTX_SWITCH		12
 	__u32 param; /* in */
 	__u32 buffer_size; /* in/out */
 	__u64 buffer; /* in/out */
@@ -607,6 +741,10 @@ struct amdxdna_drm_set_state {
 	DRM_IOWR(DRM_COMMAND_BASE + DRM_AMDXDNA_SET_STATE, \
 		 struct amdxdna_drm_set_state)
 
+#define DRM_IOCTL_AMDXDNA_CREATE_BOS \
+	DRM_IOWR(DRM_COMMAND_BASE + DRM_AMDXDNA_CREATE_BOS, \
+		 struct amdxdna_drm_create_bos)
+
 #if defined(__cplusplus)
 } /* extern c end */
 #endif
@@ -3,10 +3,17 @@
 
 #include "bo.h"
 #include "shim_debug.h"
+#include <algorithm>
+#include <atomic>
 #include <unistd.h>
 
 namespace {
 
+// Cleared once the driver turns out not to know AMDXDNA_BO_FLAG_INFO
+std::atomic<bool> create_bo_with_info{true};
+// Cleared once the driver turns out not to know AMDXDNA_BO_FLAG_HUGE
+std::atomic<bool> create_bo_huge{true};
+
 void *
 map_parent_range(size_t size)
 {
@@ -171,13 +178,21 @@ mmap_bo(size_t align)
    * The first mmap() is just for reserved a range in user vritual address space.
    * The second mmap() uses an aligned addr as the first argument in mmap syscall.
    */
-  m_parent_size = align * 2 - 1;
+  m_parent_size = std::max(align, m_aligned_size) + align - 1;
   m_parent = map_parent_range(m_parent_size);
   auto aligned = addr_align(m_parent, align);
   m_aligned = map_drm_bo(m_pdev, aligned, m_aligned_size, PROT_READ | PROT_WRITE,
     MAP_SHARED | MAP_LOCKED | MAP_FIXED, m_bo->m_map_offset);
 }
 
+void
+bo::
+mmap_bo_at(void* addr)
+{
+  m_aligned = map_drm_bo(m_pdev, addr, m_aligned_size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_LOCKED | MAP_FIXED, m_bo->m_map_offset);
+}
+
 void
 bo::
 munmap_bo()
@@ -195,10 +210,20 @@ void
 bo::
 alloc_bo()
 {
-  uint32_t boh = alloc_drm_bo(m_pdev, m_type, m_aligned_size);
+  amdxdna_drm_get_bo_info bo_info = {};
+  alloc_drm_bo(m_pdev, m_type, m_aligned_size, &bo_info);
+  m_bo = std::make_unique<bo::drm_bo>(*this, bo_info);
+}
 
+void
+bo::
+adopt_bo(const amdxdna_drm_create_bo& cbo)
+{
   amdxdna_drm_get_bo_info bo_info = {};
-  get_drm_bo_info(m_pdev, boh, &bo_info);
+  bo_info.handle = cbo.handle;
+  bo_info.map_offset = cbo.map_offset;
+  bo_info.vaddr = cbo.vaddr;
+  bo_info.xdna_addr = cbo.xdna_addr;
   m_bo = std::make_unique<bo::drm_bo>(*this, bo_info);
 }
 
@@ -337,17 +362,96 @@ get_type() const
   return m_type;
 }
 
-uint32_t
+void
 bo::
-alloc_drm_bo(const shim_xdna::pdev& dev, int type, size_t size)
+alloc_drm_bo(const shim_xdna::pdev& dev, int type, size_t size, amdxdna_drm_get_bo_info* bo_info)
 {
   amdxdna_drm_create_bo cbo = {
+    .flags = create_bo_with_info ? AMDXDNA_BO_FLAG_INFO : 0,
     .vaddr = 0,
     .size = size,
     .type = static_cast<uint32_t>(type),
   };
-  dev.ioctl(DRM_IOCTL_AMDXDNA_CREATE_BO, &cbo);
-  return cbo.handle;
+  if (m_huge && create_bo_huge)
+    cbo.flags |= AMDXDNA_BO_FLAG_HUGE;
+  auto flags = cbo.flags;
+
+  while (true) {
+    try {
+      dev.ioctl(DRM_IOCTL_AMDXDNA_CREATE_BO, &cbo);
+      break;
+    } catch (const xrt_core::system_error& ex) {
+      // Older driver, retry without the newest flag
+      if (ex.get_code() != EINVAL || !cbo.flags)
+        throw;
+      if (cbo.flags & AMDXDNA_BO_FLAG_HUGE)
+        cbo.flags &= ~AMDXDNA_BO_FLAG_HUGE;
+      else
+        cbo.flags = 0;
+    }
+  }
+
+  if ((flags & AMDXDNA_BO_FLAG_HUGE) && !(cbo.flags & AMDXDNA_BO_FLAG_HUGE)) {
+    shim_debug("Huge page BO not supported");
+    create_bo_huge = false;
+  }
+  // Fall back to a separate GET_BO_INFO
+  if ((flags & AMDXDNA_BO_FLAG_INFO) && !(cbo.flags & AMDXDNA_BO_FLAG_INFO)) {
+    shim_debug("BO info on creation not supported");
+    create_bo_with_info = false;
+  }
+
+  if (!(cbo.flags & AMDXDNA_BO_FLAG_INFO)) {
+    get_drm_bo_info(dev, cbo.handle, bo_info);
+    return;
+  }
+  bo_info->handle = cbo.handle;
+  bo_info->map_offset = cbo.map_offset;
+  bo_info->vaddr = cbo.vaddr;
+  bo_info->xdna_addr = cbo.xdna_addr;
+}
+
+bool
+bo::
+alloc_drm_bos(const pdev& dev, std::vector<amdxdna_drm_create_bo>& cbos)
+{
+  size_t done = 0;
+
+  if (!create_bo_huge) {
+    for (auto& cbo : cbos)
+      cbo.flags &= ~AMDXDNA_BO_FLAG_HUGE;
+  }
+
+  try {
+    while (done < cbos.size()) {
+      auto n = std::min<size_t>(cbos.size() - done, AMDXDNA_MAX_CREATE_BOS);
+      amdxdna_drm_create_bos arg = {
+        .bos = reinterpret_cast<uintptr_t>(&cbos[done]),
+        .count = static_cast<uint32_t>(n),
+      };
+      dev.ioctl(DRM_IOCTL_AMDXDNA_CREATE_BOS, &arg);
+      done += n;
+    }
+  } catch (const xrt_core::system_error& ex) {
+    for (size_t i = 0; i < done; i++) {
+      drm_gem_close close_bo = {cbos[i].handle, 0};
+      dev.ioctl(DRM_IOCTL_GEM_CLOSE, &close_bo);
+    }
+    // Older driver without the ioctl, or arguments the caller will hit again
+    if (ex.get_code() != EINVAL || done)
+      throw;
+    // Driver without the huge page flag, see alloc_drm_bo()
+    auto huge = std::any_of(cbos.begin(), cbos.end(),
+      [](const amdxdna_drm_create_bo& cbo) { return (cbo.flags & AMDXDNA_BO_FLAG_HUGE) != 0; });
+    if (huge && create_bo_huge) {
+      shim_debug("Huge page BO not supported");
+      create_bo_huge = false;
+      return alloc_drm_bos(dev, cbos);
+    }
+    shim_debug("Bulk BO creation failed, fall back to one by one");
+    return false;
+  }
+  return true;
 }
 
 void
@@ -364,6 +468,7 @@ free_drm_bo(const shim_xdna::pdev& dev, uint32_t boh)
 {
   drm_gem_close close_bo = {boh, 0};
   dev.ioctl(DRM_IOCTL_GEM_CLOSE, &close_bo);
+  dev.bo_freed();
 }
 
 } // namespace shim_xdna
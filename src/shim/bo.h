@@ -89,6 +89,15 @@ protected:
   void
   alloc_bo();
 
+  // Take over a DRM BO created by alloc_drm_bos()
+  void
+  adopt_bo(const amdxdna_drm_create_bo& cbo);
+
+  // Create DRM BOs of the type and size in each of cbos, which return the
+  // handle and info. False if the driver can't, nothing is created then.
+  static bool
+  alloc_drm_bos(const pdev& dev, std::vector<amdxdna_drm_create_bo>& cbos);
+
   // Import DRM BO from m_import shared object
   void
   import_bo();
@@ -100,6 +109,10 @@ protected:
   void
   mmap_bo(size_t align = 0);
 
+  // Map BO at addr, replacing what was mapped there
+  void
+  mmap_bo_at(void* addr);
+
   void
   munmap_bo();
 
@@ -116,6 +129,8 @@ protected:
   detach_from_ctx();
 
   const pdev& m_pdev;
+  // Ask the driver for huge page backing
+  bool m_huge = false;
   void* m_aligned = nullptr;
   size_t m_aligned_size = 0;
   uint64_t m_flags = 0;
@@ -146,8 +161,9 @@ private:
   // Only valid for cmd BO.
   uint64_t m_cmd_id = -1;
 
-  virtual uint32_t
-  alloc_drm_bo(const shim_xdna::pdev& dev, int type, size_t size);
+  // Creates the DRM BO and fills in its info
+  virtual void
+  alloc_drm_bo(const shim_xdna::pdev& dev, int type, size_t size, amdxdna_drm_get_bo_info* bo_info);
 
   virtual void
   get_drm_bo_info(const shim_xdna::pdev& dev, uint32_t boh, amdxdna_drm_get_bo_info* bo_info);
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2025, Advanced Micro Devices, Inc. All rights reserved.
+
+#include "cmd_graph.h"
+
+#include <cerrno>
+#include <system_error>
+
+namespace shim_xdna {
+
+void
+cmd_graph_backend::
+detach_graphs()
+{
+  std::lock_guard<std::mutex> lg(m_graphs_lock);
+  for (auto g : m_graphs)
+    g->release();
+  m_graphs.clear();
+}
+
+void
+cmd_graph::
+add_command(xrt_core::buffer_handle *cmd)
+{
+  m_nodes.push_back({ node_type::command, cmd, {} });
+}
+
+void
+cmd_graph::
+add_wait(const std::vector<xrt_core::fence_handle*>& fences)
+{
+  m_nodes.push_back({ node_type::wait, nullptr, fences });
+}
+
+// Fences are only passed back to the queue, which takes them as const
+void
+cmd_graph::
+add_wait(const xrt_core::fence_handle *fence)
+{
+  auto f = const_cast<xrt_core::fence_handle*>(fence);
+  m_nodes.push_back({ node_type::wait_one, nullptr, { f } });
+}
+
+void
+cmd_graph::
+add_signal(const xrt_core::fence_handle *fence)
+{
+  auto f = const_cast<xrt_core::fence_handle*>(fence);
+  m_nodes.push_back({ node_type::signal, nullptr, { f } });
+}
+
+cmd_graph_exec::
+cmd_graph_exec(const cmd_graph& graph, cmd_graph_backend& backend, size_t max_chain)
+  : m_backend(&backend)
+  , m_max_chain(max_chain ? max_chain : 1)
+{
+  std::vector<xrt_core::buffer_handle*> run;
+
+  try {
+    for (auto& n : graph.get_nodes()) {
+      if (n.type == cmd_graph::node_type::command) {
+        run.push_back(n.cmd);
+        if (run.size() == m_max_chain) {
+          add_commands(run);
+          run.clear();
+        }
+        continue;
+      }
+
+      add_commands(run);
+      run.clear();
+      m_steps.push_back({ n.type, nullptr, n.fences });
+    }
+    add_commands(run);
+  } catch (...) {
+    release();
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lg(m_backend->m_graphs_lock);
+  m_backend->m_graphs.insert(this);
+}
+
+cmd_graph_exec::
+~cmd_graph_exec()
+{
+  if (!m_backend)
+    return;
+
+  std::lock_guard<std::mutex> lg(m_backend->m_graphs_lock);
+  // Detached by the backend while waiting for the lock
+  if (!m_backend->m_graphs.erase(this))
+    return;
+  release();
+}
+
+void
+cmd_graph_exec::
+release()
+{
+  for (auto c : m_chains)
+    m_backend->unchain(c);
+  m_chains.clear();
+  m_steps.clear();
+  m_last_cmd = nullptr;
+  m_backend = nullptr;
+}
+
+void
+cmd_graph_exec::
+add_commands(const std::vector<xrt_core::buffer_handle*>& cmds)
+{
+  if (cmds.empty())
+    return;
+
+  if (cmds.size() > 1) {
+    auto c = m_backend->chain(cmds);
+    if (c) {
+      m_chains.push_back(c);
+      m_steps.push_back({ cmd_graph::node_type::command, c, {} });
+      return;
+    }
+  }
+
+  for (auto cmd : cmds)
+    m_steps.push_back({ cmd_graph::node_type::command, cmd, {} });
+}
+
+void
+cmd_graph_exec::
+launch()
+{
+  if (!m_backend)
+    throw std::system_error(ENODEV, std::generic_category(), "HW queue of graph is gone");
+
+  for (auto& s : m_steps) {
+    switch (s.type) {
+    case cmd_graph::node_type::command:
+      m_backend->issue(s.cmd);
+      m_last_cmd = s.cmd;
+      break;
+    case cmd_graph::node_type::wait:
+      m_backend->issue_wait(s.fences);
+      break;
+    case cmd_graph::node_type::wait_one:
+      m_backend->issue_wait(s.fences.front());
+      break;
+    case cmd_graph::node_type::signal:
+      m_backend->issue_signal(s.fences.front());
+      break;
+    }
+  }
+}
+
+int
+cmd_graph_exec::
+wait(uint32_t timeout_ms)
+{
+  if (!m_backend)
+    throw std::system_error(ENODEV, std::generic_category(), "HW queue of graph is gone");
+
+  // Queue is in order, the last command done means all of them are
+  if (!m_last_cmd)
+    return 1;
+  return m_backend->wait(m_last_cmd, timeout_ms);
+}
+
+} // shim_xdna
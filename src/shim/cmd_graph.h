@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2025, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _CMD_GRAPH_XDNA_H_
+#define _CMD_GRAPH_XDNA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace xrt_core {
+class buffer_handle;
+class fence_handle;
+class hwqueue_handle;
+}
+
+namespace shim_xdna {
+
+class cmd_graph_exec;
+
+// What a command graph needs from a HW queue. Kept apart from hw_q so that
+// graphs can be built and replayed against a mock.
+class cmd_graph_backend
+{
+public:
+  virtual
+  ~cmd_graph_backend() = default;
+
+  // Build one chained command running cmds in order, nullptr if the queue
+  // can't chain them. The chain belongs to the backend and stays valid
+  // until it is passed to unchain().
+  virtual xrt_core::buffer_handle*
+  chain(const std::vector<xrt_core::buffer_handle*>& cmds) = 0;
+
+  virtual void
+  unchain(xrt_core::buffer_handle *chain) = 0;
+
+  virtual void
+  issue(xrt_core::buffer_handle *cmd) = 0;
+
+  virtual void
+  issue_wait(const std::vector<xrt_core::fence_handle*>& fences) = 0;
+
+  virtual void
+  issue_wait(const xrt_core::fence_handle *fence) = 0;
+
+  virtual void
+  issue_signal(const xrt_core::fence_handle *fence) = 0;
+
+  virtual int
+  wait(xrt_core::buffer_handle *cmd, uint32_t timeout_ms) = 0;
+
+protected:
+  // Unchain the graphs still instantiated on this backend and cut them off
+  // from it, launching them fails afterwards. Called from the destructor of
+  // the most derived backend, while unchain() still reaches it.
+  void
+  detach_graphs();
+
+private:
+  friend class cmd_graph_exec;
+
+  std::mutex m_graphs_lock;
+  std::set<cmd_graph_exec*> m_graphs;
+};
+
+// Commands and fence operations recorded in submission order. A HW queue
+// runs its commands in order, so the order is all the graph keeps, fence
+// edges to other queues are the waits and signals in between.
+class cmd_graph
+{
+public:
+  // wait_one is a single fence passed on its own, which the fence handles
+  // account differently from a list of one
+  enum class node_type { command, wait, wait_one, signal };
+
+  struct node
+  {
+    node_type type;
+    xrt_core::buffer_handle *cmd;
+    std::vector<xrt_core::fence_handle*> fences;
+  };
+
+  void
+  add_command(xrt_core::buffer_handle *cmd);
+
+  void
+  add_wait(const std::vector<xrt_core::fence_handle*>& fences);
+
+  void
+  add_wait(const xrt_core::fence_handle *fence);
+
+  void
+  add_signal(const xrt_core::fence_handle *fence);
+
+  const std::vector<node>&
+  get_nodes() const
+  { return m_nodes; }
+
+private:
+  std::vector<node> m_nodes;
+};
+
+// A graph ready to launch. Runs of commands between fence operations are
+// chained, up to max_chain commands each. Once launched, completion is
+// reported by wait(), the captured commands themselves are not updated when
+// they run as part of a chain. A graph may outlive its backend, but not be
+// destroyed or launched while the backend goes away.
+class cmd_graph_exec
+{
+public:
+  // Same as the chained command tests, fits the chain buffer of the driver
+  static constexpr size_t default_max_chain = 24;
+
+  cmd_graph_exec(const cmd_graph& graph, cmd_graph_backend& backend,
+    size_t max_chain = default_max_chain);
+
+  ~cmd_graph_exec();
+
+  void
+  launch();
+
+  // Wait for the last command of the most recent launch
+  int
+  wait(uint32_t timeout_ms);
+
+  // Number of submissions one launch makes
+  size_t
+  get_num_submissions() const
+  { return m_steps.size(); }
+
+  size_t
+  get_num_chains() const
+  { return m_chains.size(); }
+
+private:
+  struct step
+  {
+    cmd_graph::node_type type;
+    xrt_core::buffer_handle *cmd;
+    std::vector<xrt_core::fence_handle*> fences;
+  };
+
+  friend class cmd_graph_backend;
+
+  void
+  add_commands(const std::vector<xrt_core::buffer_handle*>& cmds);
+
+  // Give the chains back, m_graphs_lock of the backend held
+  void
+  release();
+
+  cmd_graph_backend *m_backend;
+  size_t m_max_chain;
+  std::vector<step> m_steps;
+  std::vector<xrt_core::buffer_handle*> m_chains;
+  xrt_core::buffer_handle *m_last_cmd = nullptr;
+};
+
+} // shim_xdna
+
+// Entry points of the shim library. xrt_core::hwqueue_handle has no graph
+// calls, so applications reach capture and replay on a queue from
+// hw_ctx::get_hw_queue() through these. All return 0 or -errno.
+extern "C" {
+
+int
+xdna_hwq_begin_capture(xrt_core::hwqueue_handle *hwq);
+
+int
+xdna_hwq_end_capture(xrt_core::hwqueue_handle *hwq, shim_xdna::cmd_graph **graph);
+
+int
+xdna_hwq_instantiate(xrt_core::hwqueue_handle *hwq, const shim_xdna::cmd_graph *graph,
+  shim_xdna::cmd_graph_exec **exec);
+
+void
+xdna_graph_destroy(shim_xdna::cmd_graph *graph);
+
+int
+xdna_graph_launch(shim_xdna::cmd_graph_exec *exec);
+
+// 1 once the last command of the launch is done, 0 on timeout
+int
+xdna_graph_wait(shim_xdna::cmd_graph_exec *exec, uint32_t timeout_ms);
+
+void
+xdna_graph_exec_destroy(shim_xdna::cmd_graph_exec *exec);
+
+}
+
+#endif // _CMD_GRAPH_XDNA_H_
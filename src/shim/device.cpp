@@ -1224,6 +1224,17 @@ alloc_bo(void* userptr, size_t size, uint64_t flags)
   return alloc_bo(userptr, AMDXDNA_INVALID_CTX_HANDLE, size, flags);
 }
 
+std::vector<std::unique_ptr<xrt_core::buffer_handle>>
+device::
+alloc_bos(const std::vector<bo_spec>& specs)
+{
+  std::vector<std::unique_ptr<xrt_core::buffer_handle>> bos;
+
+  for (auto& s : specs)
+    bos.push_back(alloc_bo(s.first, s.second));
+  return bos;
+}
+
 std::unique_ptr<xrt_core::buffer_handle>
 device::
 import_bo(pid_t pid, xrt_core::shared_handle::export_handle ehdl)
@@ -9,6 +9,8 @@
 #include "shim_debug.h"
 
 #include "core/common/ishim.h"
+#include <utility>
+#include <vector>
 
 namespace shim_xdna {
 
@@ -42,6 +44,14 @@ public:
   alloc_bo(void* userptr, xrt_core::hwctx_handle::slot_id ctx_id,
     size_t size, uint64_t flags) = 0;
 
+  // Size and XRT BO flags of one BO for alloc_bos()
+  using bo_spec = std::pair<size_t, uint64_t>;
+
+  // Allocates a number of BOs, with as few driver calls as it can.
+  // Meant for model load, which creates hundreds of them.
+  virtual std::vector<std::unique_ptr<xrt_core::buffer_handle>>
+  alloc_bos(const std::vector<bo_spec>& specs);
+
 // ISHIM APIs supported are listed below
 public:
   void
@@ -9,6 +9,9 @@
 #include "core/common/query_requests.h"
 #include "core/common/api/xclbin_int.h"
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 namespace {
 
 std::vector<uint8_t>
@@ -37,6 +40,16 @@ destroy_syncobj(const shim_xdna::pdev& dev, uint32_t hdl)
   dev.ioctl(DRM_IOCTL_SYNCOBJ_DESTROY, &dsobj);
 }
 
+void
+close_bo(const shim_xdna::pdev& dev, uint32_t hdl)
+{
+  if (hdl == AMDXDNA_INVALID_BO_HANDLE)
+    return;
+
+  drm_gem_close close_bo = {hdl, 0};
+  dev.ioctl(DRM_IOCTL_GEM_CLOSE, &close_bo);
+}
+
 int
 convert_priority(int p)
 {
@@ -83,6 +96,13 @@ hw_ctx::
   } catch (const xrt_core::system_error& e) {
     shim_debug("Failed to destroy sync object: %s", e.what());
   }
+  if (m_status)
+    m_device.get_pdev().munmap(const_cast<amdxdna_ctx_status*>(m_status), getpagesize());
+  try {
+    close_bo(m_device.get_pdev(), m_status_bo);
+  } catch (const xrt_core::system_error& e) {
+    shim_debug("Failed to close status BO: %s", e.what());
+  }
   shim_debug("Destroyed HW context (%d)...", m_handle);
 }
 
@@ -160,6 +180,8 @@ init_qos_info(const qos_type& qos)
       m_qos.frame_exec_time = value;
     else if (key == "priority")
       m_qos.priority = convert_priority(value);
+    else if (key == "queue_depth")
+      m_max_cmds = value;
   }
 }
 
@@ -227,17 +249,43 @@ get_cu_info() const
 
 void
 hw_ctx::
-create_ctx_on_device()
+create_ctx_on_device(uint64_t flags)
 {
+  // Driver without status page, it is an optimization only
+  if ((flags & AMDXDNA_CTX_FLAG_STATUS_BO) && !m_device.get_pdev().driver_version_at_least(1, 2)) {
+    shim_debug("Context status page not supported");
+    flags &= ~AMDXDNA_CTX_FLAG_STATUS_BO;
+  }
+
   amdxdna_drm_create_ctx arg = {};
+  arg.ext_flags = flags;
   arg.qos_p = reinterpret_cast<uintptr_t>(&m_qos);
   arg.umq_bo = m_q->get_queue_bo();
   arg.max_opc = m_ops_per_cycle;
+  arg.max_cmds = m_max_cmds;
   arg.num_tiles = m_num_cols * xrt_core::device_query<xrt_core::query::aie_tiles_stats>(&m_device).core_rows;
   arg.log_buf_bo = m_log_bo ?
     static_cast<bo*>(m_log_bo.get())->get_drm_bo_handle() :
     AMDXDNA_INVALID_BO_HANDLE;
   m_device.get_pdev().ioctl(DRM_IOCTL_AMDXDNA_CREATE_CTX, &arg);
+  shim_debug("Context %d max outstanding commands %d", arg.handle, arg.max_cmds);
+  if (arg.ext_flags & AMDXDNA_CTX_FLAG_STATUS_BO) {
+    try {
+      map_status(arg.status_bo);
+    } catch (const xrt_core::system_error&) {
+      // Handle not recorded yet, the destructor would not destroy it
+      amdxdna_drm_destroy_ctx darg = {};
+      darg.handle = arg.handle;
+      try {
+        m_device.get_pdev().ioctl(DRM_IOCTL_AMDXDNA_DESTROY_CTX, &darg);
+        close_bo(m_device.get_pdev(), m_status_bo);
+      } catch (const xrt_core::system_error& e) {
+        shim_debug("Failed to clean up context %d: %s", arg.handle, e.what());
+      }
+      m_status_bo = AMDXDNA_INVALID_BO_HANDLE;
+      throw;
+    }
+  }
 
   set_slotidx(arg.handle);
   set_doorbell(arg.umq_doorbell);
@@ -246,6 +294,30 @@ create_ctx_on_device()
   m_q->bind_hwctx(this);
 }
 
+void
+hw_ctx::
+map_status(uint32_t boh)
+{
+  m_status_bo = boh;
+  amdxdna_drm_get_bo_info info = {};
+  info.handle = boh;
+  m_device.get_pdev().ioctl(DRM_IOCTL_AMDXDNA_GET_BO_INFO, &info);
+  auto p = m_device.get_pdev().mmap(nullptr, getpagesize(), PROT_READ, MAP_SHARED, info.map_offset);
+  m_status = static_cast<const amdxdna_ctx_status*>(p);
+}
+
+bool
+hw_ctx::
+is_cmd_done(uint64_t seq) const
+{
+  if (!m_status)
+    return false;
+  // Pairs with the release store in the driver, cmd state is final once
+  // seen. Commands may complete out of order, completed only covers the
+  // ones done from the first on.
+  return __atomic_load_n(&m_status->completed, __ATOMIC_ACQUIRE) > seq;
+}
+
 void
 hw_ctx::
 delete_ctx_on_device()
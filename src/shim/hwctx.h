@@ -64,6 +64,11 @@ public:
   uint32_t
   get_syncobj() const;
 
+  // True if the status page shows command seq has completed. False when
+  // not known, the caller falls back to the command state.
+  bool
+  is_cmd_done(uint64_t seq) const;
+
 protected:
   uint32_t m_num_cols;
   std::unique_ptr<xrt_core::buffer_handle> m_log_bo;
@@ -90,7 +95,7 @@ protected:
   set_syncobj(uint32_t syncobj);
 
   void
-  create_ctx_on_device();
+  create_ctx_on_device(uint64_t flags = 0);
 
 private:
   const device& m_device;
@@ -99,12 +104,18 @@ private:
   std::vector<cu_info> m_cu_info;
   std::unique_ptr<hw_q> m_q;
   uint32_t m_ops_per_cycle;
+  uint32_t m_max_cmds = 0;
   uint32_t m_doorbell;
   uint32_t m_syncobj;
+  uint32_t m_status_bo = AMDXDNA_INVALID_BO_HANDLE;
+  const amdxdna_ctx_status *m_status = nullptr;
 
   void
   delete_ctx_on_device();
 
+  void
+  map_status(uint32_t boh);
+
   void
   init_qos_info(const qos_type& qos);
 
@@ -94,6 +94,13 @@ hw_q(const device& device)
 {
 }
 
+// Queue types with chains detach in their own destructor, this catches the rest
+hw_q::
+~hw_q()
+{
+  detach_graphs();
+}
+
 void
 hw_q::
 bind_hwctx(const hw_ctx *ctx)
@@ -121,6 +128,10 @@ void
 hw_q::
 submit_command(xrt_core::buffer_handle *cmd)
 {
+  if (m_capture) {
+    m_capture->add_command(cmd);
+    return;
+  }
   issue_command(cmd);
 }
 
@@ -128,6 +139,12 @@ int
 hw_q::
 poll_command(xrt_core::buffer_handle *cmd) const
 {
+  auto boh = static_cast<bo*>(cmd);
+  if (m_hwctx && m_hwctx->is_cmd_done(boh->get_cmd_id())) {
+    XRT_TRACE_POINT_LOG(poll_command_done);
+    return 1;
+  }
+
   auto cmdpkt = reinterpret_cast<ert_packet *>(cmd->map(xrt_core::buffer_handle::map_type::write));
 
   if (cmdpkt->state >= ERT_CMD_STATE_COMPLETED) {
@@ -150,23 +167,182 @@ void
 hw_q::
 submit_wait(const xrt_core::fence_handle* f)
 {
-  auto fh = static_cast<const fence*>(f);
-  fh->submit_wait(m_hwctx);
+  if (m_capture) {
+    m_capture->add_wait(f);
+    return;
+  }
+  issue_wait(f);
 }
 
 void
 hw_q::
 submit_wait(const std::vector<xrt_core::fence_handle*>& fences)
 {
-  fence::submit_wait(m_pdev, m_hwctx, fences);
+  if (m_capture) {
+    m_capture->add_wait(fences);
+    return;
+  }
+  issue_wait(fences);
 }
 
 void
 hw_q::
 submit_signal(const xrt_core::fence_handle* f)
+{
+  if (m_capture) {
+    m_capture->add_signal(f);
+    return;
+  }
+  issue_signal(f);
+}
+
+void
+hw_q::
+begin_capture()
+{
+  if (m_capture)
+    shim_err(EBUSY, "HW queue is already capturing");
+  m_capture = std::make_unique<cmd_graph>();
+  shim_debug("Start capturing on HW queue");
+}
+
+std::unique_ptr<cmd_graph>
+hw_q::
+end_capture()
+{
+  if (!m_capture)
+    shim_err(EINVAL, "HW queue is not capturing");
+  shim_debug("Captured %ld nodes on HW queue", m_capture->get_nodes().size());
+  return std::move(m_capture);
+}
+
+std::unique_ptr<cmd_graph_exec>
+hw_q::
+instantiate(const cmd_graph& graph)
+{
+  // Base is not public, convert here rather than in make_unique
+  cmd_graph_backend& backend = *this;
+  auto exec = std::make_unique<cmd_graph_exec>(graph, backend);
+  shim_debug("Graph of %ld nodes, %ld submissions with %ld chains per launch",
+    graph.get_nodes().size(), exec->get_num_submissions(), exec->get_num_chains());
+  return exec;
+}
+
+void
+hw_q::
+issue(xrt_core::buffer_handle *cmd)
+{
+  issue_command(cmd);
+}
+
+void
+hw_q::
+issue_wait(const std::vector<xrt_core::fence_handle*>& fences)
+{
+  fence::submit_wait(m_pdev, m_hwctx, fences);
+}
+
+void
+hw_q::
+issue_wait(const xrt_core::fence_handle *f)
+{
+  auto fh = static_cast<const fence*>(f);
+  fh->submit_wait(m_hwctx);
+}
+
+void
+hw_q::
+issue_signal(const xrt_core::fence_handle *f)
 {
   auto fh = static_cast<const fence*>(f);
   fh->submit_signal(m_hwctx);
 }
 
+int
+hw_q::
+wait(xrt_core::buffer_handle *cmd, uint32_t timeout_ms)
+{
+  return wait_command(cmd, timeout_ms);
+}
+
 } // shim_xdna
+
+namespace {
+
+shim_xdna::hw_q*
+to_hw_q(xrt_core::hwqueue_handle *hwq)
+{
+  auto q = dynamic_cast<shim_xdna::hw_q*>(hwq);
+  if (!q)
+    shim_err(EINVAL, "Not a HW queue of this driver");
+  return q;
+}
+
+template <typename F>
+int
+graph_call(const char *name, F&& f)
+{
+  try {
+    f();
+    return 0;
+  } catch (const std::system_error& ex) {
+    shim_debug("%s failed: %s", name, ex.what());
+    return ex.code().value() > 0 ? -ex.code().value() : -EIO;
+  } catch (const std::bad_alloc&) {
+    return -ENOMEM;
+  } catch (const std::exception& ex) {
+    shim_debug("%s failed: %s", name, ex.what());
+    return -EIO;
+  }
+}
+
+}
+
+extern "C" {
+
+int
+xdna_hwq_begin_capture(xrt_core::hwqueue_handle *hwq)
+{
+  return graph_call(__func__, [&] { to_hw_q(hwq)->begin_capture(); });
+}
+
+int
+xdna_hwq_end_capture(xrt_core::hwqueue_handle *hwq, shim_xdna::cmd_graph **graph)
+{
+  return graph_call(__func__, [&] { *graph = to_hw_q(hwq)->end_capture().release(); });
+}
+
+int
+xdna_hwq_instantiate(xrt_core::hwqueue_handle *hwq, const shim_xdna::cmd_graph *graph,
+  shim_xdna::cmd_graph_exec **exec)
+{
+  return graph_call(__func__, [&] { *exec = to_hw_q(hwq)->instantiate(*graph).release(); });
+}
+
+void
+xdna_graph_destroy(shim_xdna::cmd_graph *graph)
+{
+  delete graph;
+}
+
+int
+xdna_graph_launch(shim_xdna::cmd_graph_exec *exec)
+{
+  return graph_call(__func__, [&] { exec->launch(); });
+}
+
+int
+xdna_graph_wait(shim_xdna::cmd_graph_exec *exec, uint32_t timeout_ms)
+{
+  int done = 0;
+  int ret = graph_call(__func__, [&] { done = exec->wait(timeout_ms); });
+  return ret ? ret : done;
+}
+
+void
+xdna_graph_exec_destroy(shim_xdna::cmd_graph_exec *exec)
+{
+  delete exec;
+}
+
+}
@@ -4,6 +4,7 @@
 #ifndef _HWQ_XDNA_H_
 #define _HWQ_XDNA_H_
 
+#include "cmd_graph.h"
 #include "fence.h"
 #include "hwctx.h"
 #include "shim_debug.h"
@@ -12,11 +13,13 @@
 
 namespace shim_xdna {
 
-class hw_q : public xrt_core::hwqueue_handle
+class hw_q : public xrt_core::hwqueue_handle, protected cmd_graph_backend
 {
 public:
   hw_q(const device& device);
 
+  ~hw_q();
+
   void
   submit_command(xrt_core::buffer_handle *) override;
 
@@ -49,13 +52,51 @@ public:
   uint32_t
   get_queue_bo();
 
+  // Commands and fence operations submitted between begin_capture() and
+  // end_capture() are recorded into a graph instead of being issued.
+  void
+  begin_capture();
+
+  std::unique_ptr<cmd_graph>
+  end_capture();
+
+  std::unique_ptr<cmd_graph_exec>
+  instantiate(const cmd_graph& graph);
+
 protected:
   virtual void
   issue_command(xrt_core::buffer_handle *) = 0;
 
+  // Queue types able to chain commands override these
+  xrt_core::buffer_handle*
+  chain(const std::vector<xrt_core::buffer_handle*>&) override
+  { return nullptr; }
+
+  void
+  unchain(xrt_core::buffer_handle *) override
+  {}
+
   const hw_ctx *m_hwctx;
   const pdev& m_pdev;
   uint32_t m_queue_boh;
+
+private:
+  void
+  issue(xrt_core::buffer_handle *cmd) override;
+
+  void
+  issue_wait(const std::vector<xrt_core::fence_handle*>& fences) override;
+
+  void
+  issue_wait(const xrt_core::fence_handle *fence) override;
+
+  void
+  issue_signal(const xrt_core::fence_handle *fence) override;
+
+  int
+  wait(xrt_core::buffer_handle *cmd, uint32_t timeout_ms) override;
+
+  std::unique_ptr<cmd_graph> m_capture;
 };
 
 } // shim_xdna
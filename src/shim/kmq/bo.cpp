@@ -60,6 +60,28 @@ sync_drm_bo(const shim_xdna::pdev& dev, uint32_t boh, xrt_core::buffer_handle::d
   dev.ioctl(DRM_IOCTL_AMDXDNA_SYNC_BO, &sbo);
 }
 
+// Share BOs of at least one huge page get huge page backing if asked for
+const size_t huge_page_size = (2 << 20);
+
+bool
+is_huge_page_bo()
+{
+  static int huge_bo = -1;
+
+  if (huge_bo == -1) {
+    bool hb = xrt_core::config::detail::get_bool_value("Debug.huge_page_bo", false);
+    huge_bo = hb ? 1 : 0;
+  }
+  return huge_bo == 1;
+}
+
+// Huge pages are mapped by PMD only at aligned VA
+bool
+use_huge_page(int type, size_t size)
+{
+  return type == AMDXDNA_BO_SHARE && size >= huge_page_size && is_huge_page_bo();
+}
+
 bool
 is_driver_sync()
 {
@@ -99,7 +121,20 @@ bo_kmq(const pdev& pdev, xrt_core::hwctx_handle::slot_id ctx_id, size_t size, ui
   if (m_type == AMDXDNA_BO_DEV_HEAP)
     align = 64 * 1024 * 1024; // Device mem heap must align at 64MB boundary.
 
-  alloc_bo();
+  if (use_huge_page(m_type, size)) {
+    m_huge = true;
+    align = huge_page_size;
+  }
+
+  try {
+    alloc_bo();
+  } catch (const xrt_core::system_error& ex) {
+    // Device heap is full, retry once it has grown
+    if (m_type != AMDXDNA_BO_DEV || ex.get_code() != ENOSPC ||
+      !m_pdev.expand_dev_heap(m_aligned_size))
+      throw;
+    alloc_bo();
+  }
   mmap_bo(align);
 
   // Newly allocated buffer may contain dirty pages. If used as output buffer,
@@ -114,6 +149,82 @@ bo_kmq(const pdev& pdev, xrt_core::hwctx_handle::slot_id ctx_id, size_t size, ui
   shim_debug("Allocated KMQ BO, %s", describe().c_str());
 }
 
+bo_kmq::
+bo_kmq(const pdev& pdev, size_t size, void* addr)
+  : bo(pdev, AMDXDNA_INVALID_CTX_HANDLE, size, 0, AMDXDNA_BO_DEV_HEAP)
+{
+  alloc_bo();
+  mmap_bo_at(addr);
+
+  shim_debug("Allocated KMQ heap chunk, %s", describe().c_str());
+}
+
+bo_kmq::
+bo_kmq(const pdev& pdev, uint64_t flags, const amdxdna_drm_create_bo& cbo)
+  : bo(pdev, AMDXDNA_INVALID_CTX_HANDLE, cbo.size, flags, cbo.type)
+{
+  adopt_bo(cbo);
+  // Same as above
+  m_huge = use_huge_page(m_type, m_aligned_size);
+  mmap_bo(m_huge ? huge_page_size : 0);
+
+  // See above
+  if (m_type == AMDXDNA_BO_SHARE)
+    sync(direction::host2device, m_aligned_size, 0);
+
+  shim_debug("Allocated KMQ BO, %s", describe().c_str());
+}
+
+std::vector<std::unique_ptr<xrt_core::buffer_handle>>
+bo_kmq::
+alloc_bos(const pdev& pdev, const std::vector<device::bo_spec>& specs)
+{
+  std::vector<std::unique_ptr<xrt_core::buffer_handle>> bos;
+  std::vector<amdxdna_drm_create_bo> cbos(specs.size());
+  size_t dev_size = 0;
+  bool created;
+  size_t i;
+
+  for (i = 0; i < specs.size(); i++) {
+    cbos[i].size = specs[i].first;
+    cbos[i].type = flag_to_type(specs[i].second);
+    if (cbos[i].type == AMDXDNA_BO_INVALID)
+      shim_err(EINVAL, "Invalid BO flags: 0x%lx", specs[i].second);
+    if (cbos[i].type == AMDXDNA_BO_DEV)
+      dev_size += cbos[i].size;
+    if (use_huge_page(cbos[i].type, cbos[i].size))
+      cbos[i].flags |= AMDXDNA_BO_FLAG_HUGE;
+  }
+
+  try {
+    created = alloc_drm_bos(pdev, cbos);
+  } catch (const xrt_core::system_error& ex) {
+    // Device heap is full, retry once it has grown
+    if (ex.get_code() != ENOSPC || !pdev.expand_dev_heap(dev_size))
+      throw;
+    created = alloc_drm_bos(pdev, cbos);
+  }
+
+  if (!created) {
+    for (auto& s : specs)
+      bos.push_back(std::make_unique<bo_kmq>(pdev, AMDXDNA_INVALID_CTX_HANDLE, s.first, s.second));
+    return bos;
+  }
+
+  try {
+    for (i = 0; i < specs.size(); i++)
+      bos.push_back(std::unique_ptr<bo_kmq>(new bo_kmq(pdev, specs[i].second, cbos[i])));
+  } catch (...) {
+    // The BO that failed freed its own DRM BO, the ones after it are not owned
+    for (i++; i < cbos.size(); i++) {
+      drm_gem_close close_bo = {cbos[i].handle, 0};
+      pdev.ioctl(DRM_IOCTL_GEM_CLOSE, &close_bo);
+    }
+    throw;
+  }
+  return bos;
+}
+
 bo_kmq::
 bo_kmq(const pdev& pdev, xrt_core::shared_handle::export_handle ehdl)
   : bo(pdev, ehdl)
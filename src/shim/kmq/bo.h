@@ -30,14 +30,23 @@ public:
   // Support BO creation from internal
   bo_kmq(const pdev& pdev, size_t size, int type);
 
+  // Device heap chunk mapped at addr
+  bo_kmq(const pdev& pdev, size_t size, void* addr);
+
   // Obtain array of arg BO handles, returns real number of handles
   uint32_t
   get_arg_bo_handles(uint32_t *handles, size_t num) const;
 
+  static std::vector<std::unique_ptr<xrt_core::buffer_handle>>
+  alloc_bos(const pdev& pdev, const std::vector<device::bo_spec>& specs);
+
 private:
   bo_kmq(const pdev& pdev, xrt_core::hwctx_handle::slot_id ctx_id,
     size_t size, uint64_t flags, int type);
 
+  // BO created by alloc_drm_bos()
+  bo_kmq(const pdev& pdev, uint64_t flags, const amdxdna_drm_create_bo& cbo);
+
   // Only for AMDXDNA_BO_CMD type
   std::map<size_t, uint32_t> m_args_map;
   mutable std::mutex m_args_map_lock;
@@ -43,6 +43,13 @@ alloc_bo(void* userptr, xrt_core::hwctx_handle::slot_id ctx_id,
   return std::make_unique<bo_kmq>(get_pdev(), ctx_id, size, flags);
 }
 
+std::vector<std::unique_ptr<xrt_core::buffer_handle>>
+device_kmq::
+alloc_bos(const std::vector<bo_spec>& specs)
+{
+  return bo_kmq::alloc_bos(get_pdev(), specs);
+}
+
 std::unique_ptr<xrt_core::buffer_handle>
 device_kmq::
 import_bo(xrt_core::shared_handle::export_handle ehdl) const
@@ -19,6 +19,9 @@ public:
   alloc_bo(void* userptr, xrt_core::hwctx_handle::slot_id ctx_id,
     size_t size, uint64_t flags) override;
 
+  std::vector<std::unique_ptr<xrt_core::buffer_handle>>
+  alloc_bos(const std::vector<bo_spec>& specs) override;
+
 private:
   std::unique_ptr<xrt_core::hwctx_handle>
   create_hw_context(const device& dev, const xrt::xclbin& xclbin,
@@ -29,7 +29,7 @@ hw_ctx_kmq::
 hw_ctx_kmq(const device& device, const xrt::xclbin& xclbin, const xrt::hw_context::qos_type& qos)
   : hw_ctx(device, qos, std::make_unique<hw_q_kmq>(device), xclbin)
 {
-  hw_ctx::create_ctx_on_device();
+  hw_ctx::create_ctx_on_device(AMDXDNA_CTX_FLAG_STATUS_BO);
 
   auto cu_info = get_cu_info();
   std::vector<char> cu_conf_param_buf(
@@ -39,10 +39,15 @@ hw_ctx_kmq(const device& device, const xrt::xclbin& xclbin, const xrt::hw_contex
   cu_conf_param->num_cus = cu_info.size();
   xcl_bo_flags f = {};
   f.flags = XRT_BO_FLAGS_CACHEABLE;
+  // All PDI BOs in one go, xclbin with many kernels would otherwise pay an ioctl each
+  std::vector<device::bo_spec> specs;
+  for (auto& ci : cu_info)
+    specs.emplace_back(ci.m_pdi.size(), f.all);
+  // const_cast: see alloc_bo() below
+  m_pdi_bos = const_cast<device&>(get_device()).alloc_bos(specs);
+
   for (int i = 0; i < cu_info.size(); i++) {
     auto& ci = cu_info[i];
-
-    m_pdi_bos.push_back(alloc_bo(nullptr, ci.m_pdi.size(), f.all));
     auto& pdi_bo = m_pdi_bos[i];
     auto pdi_vaddr = reinterpret_cast<char *>(
       pdi_bo->map(xrt_core::buffer_handle::map_type::write));
@@ -3,6 +3,38 @@
 
 #include "bo.h"
 #include "hwq.h"
+#include "core/common/config_reader.h"
+
+#include <algorithm>
+
+namespace {
+
+bool
+is_resident_bos()
+{
+  static int resident = -1;
+
+  if (resident == -1) {
+    bool rb = xrt_core::config::detail::get_bool_value("Debug.resident_arg_bos", false);
+    resident = rb ? 1 : 0;
+  }
+  return resident == 1;
+}
+
+
+bool
+is_seal_chains()
+{
+  static int seal = -1;
+
+  if (seal == -1) {
+    bool sc = xrt_core::config::detail::get_bool_value("Debug.seal_cmd_chains", false);
+    seal = sc ? 1 : 0;
+  }
+  return seal == 1;
+}
+
+}
 
 namespace shim_xdna {
 
@@ -16,6 +48,8 @@ hw_q_kmq::
 ~hw_q_kmq()
 {
   shim_debug("Destroying KMQ HW queue");
+  // Graph chains are bo_kmq, unchain() has to run before this is gone
+  detach_graphs();
 }
 
 void
@@ -29,6 +63,9 @@ issue_command(xrt_core::buffer_handle *cmd_bo)
   auto boh = static_cast<bo_kmq*>(cmd_bo);
   uint32_t cmd_bo_hdl = boh->get_drm_bo_handle();
 
+  if (is_seal_chains())
+    seal_chain(cmd_bo, cmd_bo_hdl);
+
   amdxdna_drm_exec_cmd ecmd = {
     .ctx = m_hwctx->get_slotidx(),
     .type = AMDXDNA_CMD_SUBMIT_EXEC_BUF,
@@ -37,6 +74,11 @@ issue_command(xrt_core::buffer_handle *cmd_bo)
     .cmd_count = 1,
     .arg_count = static_cast<uint32_t>(boh->get_arg_bo_handles(arg_bo_hdls, max_arg_bos)),
   };
+  if (use_resident_bos(arg_bo_hdls, ecmd.arg_count)) {
+    ecmd.ext_flags = AMDXDNA_EXEC_CMD_FLAG_RESIDENT_BOS;
+    ecmd.args = 0;
+    ecmd.arg_count = 0;
+  }
   m_pdev.ioctl(DRM_IOCTL_AMDXDNA_EXEC_CMD, &ecmd);
 
   auto id = ecmd.seq;
@@ -44,6 +86,134 @@ issue_command(xrt_core::buffer_handle *cmd_bo)
   shim_debug("Submitted command (%ld)", id);
 }
 
+// The arg BOs of the first command become the resident set of the context,
+// later commands with exactly the same arg BOs are submitted without them.
+// The driver holds on to the BOs of the set, so once any BO of the device is
+// freed the set is registered again from the current command: a handle in
+// the set may name another BO by now.
+bool
+hw_q_kmq::
+use_resident_bos(const uint32_t *hdls, size_t cnt)
+{
+  if (!cnt || !is_resident_bos())
+    return false;
+
+  std::lock_guard<std::mutex> lg(m_cfg_lock);
+  auto gen = m_pdev.bo_free_gen();
+  if (!m_resident_bos.empty() && gen == m_resident_gen)
+    return std::equal(hdls, hdls + cnt, m_resident_bos.begin(), m_resident_bos.end());
+
+  amdxdna_drm_config_ctx cfg = {
+    .handle = m_hwctx->get_slotidx(),
+    .param_type = DRM_AMDXDNA_CTX_SET_RESIDENT_BOS,
+    .param_val = reinterpret_cast<uintptr_t>(hdls),
+    .param_val_size = static_cast<uint32_t>(cnt * sizeof(*hdls)),
+  };
+  try {
+    m_pdev.ioctl(DRM_IOCTL_AMDXDNA_CONFIG_CTX, &cfg);
+  } catch (const xrt_core::system_error& ex) {
+    shim_debug("Failed to register resident BOs: %s", ex.what());
+    m_resident_bos.clear();
+    return false;
+  }
+  m_resident_bos.assign(hdls, hdls + cnt);
+  m_resident_gen = gen;
+  shim_debug("Registered %ld resident BOs", cnt);
+  return true;
+}
+
+// Let the driver lay out a chained command once, later submissions of it skip
+// the command buffer. The driver falls back to a regular encode when the chain
+// no longer lists the sub-command BOs it was sealed with.
+void
+hw_q_kmq::
+seal_chain(xrt_core::buffer_handle *cmd_bo, uint32_t cmd_bo_hdl)
+{
+  auto cmdpkt = reinterpret_cast<ert_packet *>(cmd_bo->map(xrt_core::buffer_handle::map_type::write));
+  if (cmdpkt->opcode != ERT_CMD_CHAIN)
+    return;
+
+  std::lock_guard<std::mutex> lg(m_cfg_lock);
+  // Sealing is tried once per BO, a chain that can't be sealed runs as before
+  if (!m_sealed_cmds.insert(cmd_bo_hdl).second)
+    return;
+
+  amdxdna_drm_config_ctx cfg = {
+    .handle = m_hwctx->get_slotidx(),
+    .param_type = DRM_AMDXDNA_CTX_SEAL_CHAIN,
+    .param_val = cmd_bo_hdl,
+  };
+  try {
+    m_pdev.ioctl(DRM_IOCTL_AMDXDNA_CONFIG_CTX, &cfg);
+    shim_debug("Sealed chained command BO %d", cmd_bo_hdl);
+  } catch (const xrt_core::system_error& ex) {
+    shim_debug("Failed to seal chained command BO %d: %s", cmd_bo_hdl, ex.what());
+  }
+}
+
+// Graph chains are built once and never rewritten, always worth sealing
+xrt_core::buffer_handle*
+hw_q_kmq::
+chain(const std::vector<xrt_core::buffer_handle*>& cmds)
+{
+  uint32_t op = ERT_CMD_CHAIN;
+
+  // Only kernel starts of one kind can be chained
+  for (auto cmd : cmds) {
+    auto cmdpkt = reinterpret_cast<ert_packet *>(cmd->map(xrt_core::buffer_handle::map_type::write));
+    if (op == ERT_CMD_CHAIN)
+      op = cmdpkt->opcode;
+    if (cmdpkt->opcode != op || (op != ERT_START_CU && op != ERT_START_NPU))
+      return nullptr;
+  }
+
+  auto sz = sizeof(ert_packet) + sizeof(ert_cmd_chain_data) + cmds.size() * sizeof(uint64_t);
+  auto cbo = std::make_unique<bo_kmq>(m_pdev, sz, AMDXDNA_BO_CMD);
+  auto cmdpkt = reinterpret_cast<ert_packet *>(cbo->map(xrt_core::buffer_handle::map_type::write));
+  cmdpkt->state = ERT_CMD_STATE_NEW;
+  cmdpkt->count = (sz - sizeof(ert_packet)) / sizeof(uint32_t);
+  cmdpkt->opcode = ERT_CMD_CHAIN;
+  cmdpkt->type = ERT_SCU;
+
+  auto payload = get_ert_cmd_chain_data(cmdpkt);
+  payload->command_count = cmds.size();
+  payload->submit_index = 0;
+  payload->error_index = 0;
+  for (size_t i = 0; i < cmds.size(); i++) {
+    auto boh = static_cast<bo_kmq*>(cmds[i]);
+    payload->data[i] = boh->get_drm_bo_handle();
+    cbo->bind_at(i, boh, 0, boh->get_properties().size);
+  }
+
+  seal_chain(cbo.get(), cbo->get_drm_bo_handle());
+  return cbo.release();
+}
+
+void
+hw_q_kmq::
+unchain(xrt_core::buffer_handle *chain)
+{
+  // Freed on return, after it is unsealed
+  std::unique_ptr<bo_kmq> cbo(static_cast<bo_kmq*>(chain));
+  auto hdl = cbo->get_drm_bo_handle();
+
+  std::lock_guard<std::mutex> lg(m_cfg_lock);
+  // Sealed chains go away with the context
+  if (!m_sealed_cmds.erase(hdl) || !m_hwctx)
+    return;
+
+  amdxdna_drm_config_ctx cfg = {
+    .handle = m_hwctx->get_slotidx(),
+    .param_type = DRM_AMDXDNA_CTX_UNSEAL_CHAIN,
+    .param_val = hdl,
+  };
+  try {
+    m_pdev.ioctl(DRM_IOCTL_AMDXDNA_CONFIG_CTX, &cfg);
+  } catch (const xrt_core::system_error& ex) {
+    shim_debug("Failed to unseal chained command BO %d: %s", hdl, ex.what());
+  }
+}
+
 void
 hw_q_kmq::
 bind_hwctx(const hw_ctx *ctx)
@@ -6,6 +6,10 @@
 
 #include "../hwq.h"
 
+#include <mutex>
+#include <set>
+#include <vector>
+
 namespace shim_xdna {
 
 class hw_q_kmq : public hw_q
@@ -20,6 +24,29 @@ public:
 
   void
   issue_command(xrt_core::buffer_handle *) override;
+
+protected:
+  xrt_core::buffer_handle*
+  chain(const std::vector<xrt_core::buffer_handle*>& cmds) override;
+
+  void
+  unchain(xrt_core::buffer_handle *chain) override;
+
+private:
+  bool
+  use_resident_bos(const uint32_t *hdls, size_t cnt);
+
+  void
+  seal_chain(xrt_core::buffer_handle *cmd_bo, uint32_t cmd_bo_hdl);
+
+  // Context config done from the submit path
+  std::mutex m_cfg_lock;
+  // Arg BOs registered as the resident set of the bound context
+  std::vector<uint32_t> m_resident_bos;
+  // pdev::bo_free_gen() when the set was registered
+  uint64_t m_resident_gen = 0;
+  // Chained command BOs already sealed in the bound context
+  std::set<uint32_t> m_sealed_cmds;
 };
 
 } // shim_xdna
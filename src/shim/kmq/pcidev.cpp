@@ -5,11 +5,31 @@
 #include "device.h"
 #include "pcidev.h"
 
+#include "core/common/config_reader.h"
+#include <algorithm>
+#include <sys/mman.h>
+
 namespace {
 
 // Device memory heap needs to be within one 64MB page. The maximum size is 64MB.
 const size_t max_heap_mem_size = (64 << 20);
 const size_t min_heap_mem_size = (1 << 20);
+// Heap to start with when it can grow on demand.
+const size_t initial_heap_mem_size = (16 << 20);
+
+// Growing maps more than one host buffer to a firmware context, which is not
+// confirmed to work on all firmware yet, so only if asked for.
+bool
+is_growable_heap()
+{
+  static int growable = -1;
+
+  if (growable == -1) {
+    bool g = xrt_core::config::detail::get_bool_value("Debug.growable_dev_heap", false);
+    growable = g ? 1 : 0;
+  }
+  return growable == 1;
+}
 
 }
 
@@ -35,37 +55,99 @@ create_device(xrt_core::device::handle_type handle, xrt_core::device::id_type id
   return std::make_shared<device_kmq>(*this, handle, id);
 }
 
-void
+bool
 pdev_kmq::
-on_first_open() const
+add_heap_chunk(size_t size, size_t min_size) const
 {
-  size_t heap_sz = max_heap_mem_size;
-
-  while (m_dev_heap_bo == nullptr) {
+  while (size >= min_size) {
     try {
-      // Alloc device memory on first device open.
-      m_dev_heap_bo = std::make_unique<bo_kmq>(*this, heap_sz, AMDXDNA_BO_DEV_HEAP);
+      if (m_heap_window) {
+        m_dev_heap_bos.push_back(
+          std::make_unique<bo_kmq>(*this, size, m_heap_window + m_heap_size));
+      } else {
+        m_dev_heap_bos.push_back(std::make_unique<bo_kmq>(*this, size, AMDXDNA_BO_DEV_HEAP));
+      }
+      m_heap_size += size;
+      return true;
     } catch (const xrt_core::system_error& ex) {
-      switch (ex.get_code()) {
-      case ENOMEM:
-        // Try with smaller size in case of memory pressure or IOMMU_MODE constrain
-        heap_sz /= 2;
-        if (heap_sz < min_heap_mem_size)
-          shim_err(EINVAL, "No mem for dev heap BO, giving up");
-        break;
-      default:
+      if (ex.get_code() != ENOMEM)
         throw;
-      }
+      // Try with smaller size in case of memory pressure or IOMMU_MODE constrain
+      size /= 2;
     }
   }
+  return false;
+}
+
+void
+pdev_kmq::
+on_first_open() const
+{
+  const std::lock_guard<std::mutex> lock(m_heap_lock);
+  size_t window_sz = max_heap_mem_size * 2 - 1;
+
+  if (!m_dev_heap_bos.empty())
+    return;
+
+  // Alloc device memory on first device open.
+  // Driver takes more than one dev heap BO since 1.1
+  if (!is_growable_heap() || !driver_version_at_least(1, 1)) {
+    if (!add_heap_chunk(max_heap_mem_size, min_heap_mem_size))
+      shim_err(EINVAL, "No mem for dev heap BO, giving up");
+    return;
+  }
+
+  // Reserve the 64MB aligned window, heap chunks are mapped into it on demand.
+  m_heap_parent = ::mmap(nullptr, window_sz, PROT_NONE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (m_heap_parent == MAP_FAILED) {
+    m_heap_parent = nullptr;
+    shim_err(errno, "mmap(len=%ld) failed", window_sz);
+  }
+  auto p = reinterpret_cast<uintptr_t>(m_heap_parent);
+  m_heap_window = reinterpret_cast<char*>((p + max_heap_mem_size - 1) & ~(max_heap_mem_size - 1));
+
+  if (!add_heap_chunk(initial_heap_mem_size, min_heap_mem_size))
+    shim_err(EINVAL, "No mem for dev heap BO, giving up");
+}
+
+bool
+pdev_kmq::
+expand_dev_heap(size_t need) const
+{
+  const std::lock_guard<std::mutex> lock(m_heap_lock);
+
+  if (!m_heap_window)
+    return false;
+
+  need = (need + min_heap_mem_size - 1) & ~(min_heap_mem_size - 1);
+  auto room = max_heap_mem_size - m_heap_size;
+  if (need > room)
+    return false;
+
+  // Double the heap each time to keep the number of chunks low
+  auto size = std::min(room, std::max(need, m_heap_size));
+  try {
+    return add_heap_chunk(size, need);
+  } catch (const xrt_core::system_error& ex) {
+    shim_debug("Failed to add dev heap chunk: %s", ex.what());
+    return false;
+  }
 }
 
 void
 pdev_kmq::
 on_last_close() const
 {
-  m_dev_heap_bo.reset();
+  const std::lock_guard<std::mutex> lock(m_heap_lock);
+
+  m_dev_heap_bos.clear();
+  m_heap_size = 0;
+  if (m_heap_parent) {
+    ::munmap(m_heap_parent, max_heap_mem_size * 2 - 1);
+    m_heap_parent = nullptr;
+    m_heap_window = nullptr;
+  }
 }
 
 } // namespace shim_xdna
-
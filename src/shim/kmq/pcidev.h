@@ -19,8 +19,20 @@ public:
   std::shared_ptr<xrt_core::device>
   create_device(xrt_core::device::handle_type handle, xrt_core::device::id_type id) const override;
 
+  bool
+  expand_dev_heap(size_t need) const override;
+
 private:
-  mutable std::unique_ptr<xrt_core::buffer_handle> m_dev_heap_bo;
+  // Heap chunks, back to back from m_heap_window when the driver can grow
+  // the heap, otherwise just one.
+  mutable std::vector<std::unique_ptr<xrt_core::buffer_handle>> m_dev_heap_bos;
+  mutable void* m_heap_parent = nullptr;
+  mutable char* m_heap_window = nullptr;
+  mutable size_t m_heap_size = 0;
+  mutable std::mutex m_heap_lock;
+
+  bool
+  add_heap_chunk(size_t size, size_t min_size) const;
 
   virtual void
   on_first_open() const override;
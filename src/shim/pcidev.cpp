@@ -54,6 +54,8 @@ namespace {
       return "DRM_IOCTL_SYNCOBJ_TIMELINE_SIGNAL";
     case DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT:
       return "DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT";
+    case DRM_IOCTL_VERSION:
+      return "DRM_IOCTL_VERSION";
     }
 
     return "UNKNOWN(" + std::to_string(cmd) + ")";
@@ -135,6 +137,16 @@ ioctl(unsigned long cmd, void* arg) const
     shim_err(errno, "%s IOCTL failed", ioctl_cmd2name(cmd).c_str());
 }
 
+bool
+pdev::
+driver_version_at_least(int major, int minor) const
+{
+  drm_version ver = {};
+
+  ioctl(DRM_IOCTL_VERSION, &ver);
+  return ver.version_major > major || (ver.version_major == major && ver.version_minor >= minor);
+}
+
 void*
 pdev::
 mmap(void *addr, size_t len, int prot, int flags, off_t offset) const
@@ -9,6 +9,8 @@
 #include "core/pcie/linux/device_linux.h"
 #include "core/pcie/linux/pcidev.h"
 
+#include <atomic>
+
 namespace shim_xdna {
 
 class pdev : public xrt_core::pci::dev
@@ -40,6 +42,25 @@ public:
   void
   close() const;
 
+  // True if the driver is major.minor or later, see AMDXDNA_DRIVER_MINOR
+  bool
+  driver_version_at_least(int major, int minor) const;
+
+  // Add at least need bytes to the device heap, false if it can't grow
+  virtual bool
+  expand_dev_heap(size_t need) const
+  { return false; }
+
+  // Bumped on every BO free. Holders of BO handles compare it to notice that
+  // a handle they kept may have been closed and reused since.
+  void
+  bo_freed() const
+  { m_bo_free_gen++; }
+
+  uint64_t
+  bo_free_gen() const
+  { return m_bo_free_gen; }
+
 private:
   virtual void
   on_first_open() const {}
@@ -49,6 +70,7 @@ private:
   mutable int m_dev_fd = -1;
   mutable int m_dev_users = 0;
   mutable std::mutex m_lock;
+  mutable std::atomic<uint64_t> m_bo_free_gen{0};
 };
 
 } // namespace shim_xdna
@@ -112,12 +112,11 @@ sync(direction dir, size_t size, size_t offset)
   clflush_data(m_aligned, offset, size); 
 }
 
-uint32_t
+void
 bo_virtio::
-alloc_drm_bo(const shim_xdna::pdev& dev, int type, size_t size)
+alloc_drm_bo(const shim_xdna::pdev& dev, int type, size_t size, amdxdna_drm_get_bo_info* bo_info)
 {
   shim_debug("Allocating VIRTIO BO");
-  return 0;
 }
 
 void
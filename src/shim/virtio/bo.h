@@ -28,8 +28,8 @@ private:
   bo_virtio(const pdev& pdev, xrt_core::hwctx_handle::slot_id ctx_id,
     size_t size, uint64_t flags, int type);
   
-  uint32_t
-  alloc_drm_bo(const shim_xdna::pdev& dev, int type, size_t size) override;
+  void
+  alloc_drm_bo(const shim_xdna::pdev& dev, int type, size_t size, amdxdna_drm_get_bo_info* bo_info) override;
 
   void
   get_drm_bo_info(const shim_xdna::pdev& dev, uint32_t boh, amdxdna_drm_get_bo_info* bo_info) override;
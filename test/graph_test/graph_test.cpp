@@ -0,0 +1,446 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2025, Advanced Micro Devices, Inc. All rights reserved.
+
+// User space harness for the shim command graph (cmd_graph.cpp).
+//
+// The graph runs against a mock queue which records what would have been
+// submitted. Test modes,
+//
+// check: Scripted graphs, the submissions of each launch are compared with
+//        the expected sequence.
+// bench: Inference style DAGs of 20 to 100 kernels with a fence edge every
+//        few kernels. Each submission costs a fixed, simulated ioctl time.
+//        Reports submissions and host time per launch, submitting the nodes
+//        one by one vs launching the instantiated graph.
+
+#include "cmd_graph.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+
+namespace xrt_core {
+
+class buffer_handle
+{
+public:
+  explicit buffer_handle(int id) : m_id(id) {}
+  virtual ~buffer_handle() = default;
+  int m_id;
+};
+
+class fence_handle
+{
+public:
+  explicit fence_handle(int id) : m_id(id) {}
+  int m_id;
+};
+
+}
+
+namespace {
+
+using namespace shim_xdna;
+using clk = std::chrono::high_resolution_clock;
+
+int failures;
+
+#define CHECK(cond) do {							\
+    if (!(cond)) {								\
+      std::cerr << __FILE__ << ":" << __LINE__ << " check failed: " #cond << std::endl; \
+      failures++;								\
+    }									\
+  } while (0)
+
+// Chained commands get ids from 1000 up
+const int chain_id_base = 1000;
+
+class mock_queue : public cmd_graph_backend
+{
+public:
+  bool m_can_chain = true;
+  int m_ioctl_ns = 0;
+  int m_next_chain = chain_id_base;
+  int m_unchained = 0;
+  std::ostringstream m_log;
+
+  using cmd_graph_backend::detach_graphs;
+
+  ~mock_queue()
+  {
+    detach_graphs();
+  }
+
+  xrt_core::buffer_handle*
+  chain(const std::vector<xrt_core::buffer_handle*>& cmds) override
+  {
+    if (!m_can_chain)
+      return nullptr;
+    auto c = new xrt_core::buffer_handle(m_next_chain++);
+    m_members[c->m_id] = cmds.size();
+    return c;
+  }
+
+  void
+  unchain(xrt_core::buffer_handle *chain) override
+  {
+    delete chain;
+    m_unchained++;
+  }
+
+  void
+  issue(xrt_core::buffer_handle *cmd) override
+  {
+    ioctl();
+    if (cmd->m_id >= chain_id_base)
+      m_log << "C" << m_members[cmd->m_id] << " ";
+    else
+      m_log << "x" << cmd->m_id << " ";
+  }
+
+  void
+  issue_wait(const std::vector<xrt_core::fence_handle*>& fences) override
+  {
+    ioctl();
+    m_log << "w";
+    for (auto f : fences)
+      m_log << f->m_id;
+    m_log << " ";
+  }
+
+  void
+  issue_wait(const xrt_core::fence_handle *fence) override
+  {
+    ioctl();
+    m_log << "w" << fence->m_id << " ";
+  }
+
+  void
+  issue_signal(const xrt_core::fence_handle *fence) override
+  {
+    ioctl();
+    m_log << "s" << fence->m_id << " ";
+  }
+
+  int
+  wait(xrt_core::buffer_handle *cmd, uint32_t timeout_ms) override
+  {
+    m_log << "W ";
+    return 1;
+  }
+
+  std::string
+  take_log()
+  {
+    auto s = m_log.str();
+    m_log.str("");
+    return s;
+  }
+
+private:
+  std::map<int, size_t> m_members;
+
+  void
+  ioctl()
+  {
+    if (!m_ioctl_ns)
+      return;
+    auto end = clk::now() + std::chrono::nanoseconds(m_ioctl_ns);
+    while (clk::now() < end)
+      ;
+  }
+};
+
+struct objects
+{
+  std::vector<std::unique_ptr<xrt_core::buffer_handle>> cmds;
+  std::vector<std::unique_ptr<xrt_core::fence_handle>> fences;
+
+  objects(int ncmds, int nfences)
+  {
+    for (int i = 0; i < ncmds; i++)
+      cmds.push_back(std::make_unique<xrt_core::buffer_handle>(i));
+    for (int i = 0; i < nfences; i++)
+      fences.push_back(std::make_unique<xrt_core::fence_handle>(i));
+  }
+};
+
+void
+check_linear()
+{
+  objects o(30, 0);
+  mock_queue q;
+  cmd_graph g;
+
+  for (auto& c : o.cmds)
+    g.add_command(c.get());
+
+  {
+    cmd_graph_exec e(g, q);
+    CHECK(e.get_num_submissions() == 2);
+    CHECK(e.get_num_chains() == 2);
+    e.launch();
+    e.wait(0);
+    CHECK(q.take_log() == "C24 C6 W ");
+    // Replays exactly the same
+    e.launch();
+    CHECK(q.take_log() == "C24 C6 ");
+  }
+  CHECK(q.m_unchained == 2);
+}
+
+void
+check_fences()
+{
+  objects o(8, 4);
+  mock_queue q;
+  cmd_graph g;
+
+  g.add_command(o.cmds[0].get());
+  g.add_wait(o.fences[0].get());
+  g.add_wait({ o.fences[1].get(), o.fences[2].get() });
+  g.add_command(o.cmds[1].get());
+  g.add_command(o.cmds[2].get());
+  g.add_command(o.cmds[3].get());
+  g.add_signal(o.fences[3].get());
+  g.add_command(o.cmds[4].get());
+
+  cmd_graph_exec e(g, q);
+  CHECK(e.get_num_submissions() == 6);
+  CHECK(e.get_num_chains() == 1);
+  e.launch();
+  CHECK(q.take_log() == "x0 w0 w12 C3 s3 x4 ");
+}
+
+void
+check_no_chain()
+{
+  objects o(3, 1);
+  mock_queue q;
+  cmd_graph g;
+
+  q.m_can_chain = false;
+  for (auto& c : o.cmds)
+    g.add_command(c.get());
+  g.add_signal(o.fences[0].get());
+
+  {
+    cmd_graph_exec e(g, q, 2);
+    CHECK(e.get_num_submissions() == 4);
+    CHECK(e.get_num_chains() == 0);
+    e.launch();
+    CHECK(q.take_log() == "x0 x1 x2 s0 ");
+  }
+  CHECK(q.m_unchained == 0);
+}
+
+void
+check_max_chain()
+{
+  objects o(5, 0);
+  mock_queue q;
+  cmd_graph g;
+
+  for (auto& c : o.cmds)
+    g.add_command(c.get());
+
+  cmd_graph_exec e(g, q, 2);
+  e.launch();
+  CHECK(q.take_log() == "C2 C2 x4 ");
+}
+
+void
+check_empty()
+{
+  mock_queue q;
+  cmd_graph g;
+  cmd_graph_exec e(g, q);
+
+  CHECK(e.get_num_submissions() == 0);
+  e.launch();
+  CHECK(e.wait(0) == 1);
+  CHECK(q.take_log().empty());
+}
+
+// A graph outliving its queue gives its chains back and can't be launched
+void
+check_detach()
+{
+  objects o(4, 0);
+  cmd_graph g;
+
+  for (auto& c : o.cmds)
+    g.add_command(c.get());
+
+  auto q = std::make_unique<mock_queue>();
+  auto e = std::make_unique<cmd_graph_exec>(g, *q);
+  auto e2 = std::make_unique<cmd_graph_exec>(g, *q);
+  e->launch();
+  CHECK(q->take_log() == "C4 ");
+  e2.reset();
+  CHECK(q->m_unchained == 1);
+  q->detach_graphs();
+  CHECK(q->m_unchained == 2);
+  q.reset();
+
+  bool thrown = false;
+  try {
+    e->launch();
+  } catch (const std::system_error& ex) {
+    thrown = ex.code().value() == ENODEV;
+  }
+  CHECK(thrown);
+  e.reset();
+}
+
+int
+run_check()
+{
+  check_linear();
+  check_fences();
+  check_no_chain();
+  check_max_chain();
+  check_empty();
+  check_detach();
+
+  if (failures) {
+    std::cout << failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "All checks passed" << std::endl;
+  return 0;
+}
+
+// Kernels with a signal and a wait on another queue every edge_every kernels
+void
+build_dag(cmd_graph& g, objects& o, int nodes, int edge_every)
+{
+  for (int i = 0; i < nodes; i++) {
+    g.add_command(o.cmds[i].get());
+    if ((i + 1) % edge_every == 0 && i + 1 < nodes) {
+      g.add_signal(o.fences[0].get());
+      g.add_wait(o.fences[1].get());
+    }
+  }
+}
+
+void
+replay_eager(mock_queue& q, const cmd_graph& g)
+{
+  for (auto& n : g.get_nodes()) {
+    switch (n.type) {
+    case cmd_graph::node_type::command:
+      q.issue(n.cmd);
+      break;
+    case cmd_graph::node_type::wait:
+      q.issue_wait(n.fences);
+      break;
+    case cmd_graph::node_type::wait_one:
+      q.issue_wait(n.fences.front());
+      break;
+    case cmd_graph::node_type::signal:
+      q.issue_signal(n.fences.front());
+      break;
+    }
+  }
+}
+
+int
+run_bench(int ioctl_ns, int loops, int edge_every)
+{
+  mock_queue q;
+
+  q.m_ioctl_ns = ioctl_ns;
+  std::cout << "Simulated ioctl " << ioctl_ns << " ns, fence edge every "
+            << edge_every << " kernels" << std::endl;
+  for (int nodes = 20; nodes <= 100; nodes += 20) {
+    objects o(nodes, 2);
+    cmd_graph g;
+    build_dag(g, o, nodes, edge_every);
+
+    auto start = clk::now();
+    for (int i = 0; i < loops; i++)
+      replay_eager(q, g);
+    auto eager_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clk::now() - start).count();
+
+    start = clk::now();
+    cmd_graph_exec e(g, q);
+    auto inst_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clk::now() - start).count();
+    start = clk::now();
+    for (int i = 0; i < loops; i++)
+      e.launch();
+    auto graph_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clk::now() - start).count();
+    q.take_log();
+
+    std::cout << nodes << " kernels: eager " << g.get_nodes().size() << " submissions "
+              << eager_ns / loops / 1000.0 << " us, graph " << e.get_num_submissions()
+              << " submissions " << graph_ns / loops / 1000.0 << " us, instantiate "
+              << inst_ns / 1000.0 << " us" << std::endl;
+  }
+  return 0;
+}
+
+void
+usage(const char *prog)
+{
+  std::cout << "Usage: " << prog << " [options]" << std::endl;
+  std::cout << "  -m <mode>   check (default) or bench" << std::endl;
+  std::cout << "  -c <ns>     Simulated ioctl cost for bench, default 2000" << std::endl;
+  std::cout << "  -e <n>      Fence edge every n kernels for bench, default 10" << std::endl;
+  std::cout << "  -l <loops>  Launches per graph for bench, default 1000" << std::endl;
+  std::cout << "  -h          This help" << std::endl;
+}
+
+}
+
+int
+main(int argc, char **argv)
+{
+  bool bench = false;
+  int ioctl_ns = 2000;
+  int edge_every = 10;
+  int loops = 1000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "m:c:e:l:h")) != -1) {
+    switch (opt) {
+    case 'm':
+      if (!strcmp(optarg, "bench")) {
+        bench = true;
+      } else if (strcmp(optarg, "check")) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'c':
+      ioctl_ns = atoi(optarg);
+      break;
+    case 'e':
+      edge_every = atoi(optarg);
+      break;
+    case 'l':
+      loops = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (edge_every <= 0 || loops <= 0 || ioctl_ns < 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (bench)
+    return run_bench(ioctl_ns, loops, edge_every);
+  return run_check();
+}
@@ -0,0 +1,363 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+/*
+ * User space harness for the DEV BO slab allocator (amdxdna_heap_slab.c).
+ *
+ * BOs are allocated the way amdxdna_gem_heap_alloc_locked() does, from a
+ * slab if a size class takes them, else from the drm_mm, on a stand-in
+ * drm_mm with the same best fit placement. Checks,
+ *
+ * classes: Every BO size up to the largest class lands in a class that
+ *	    wastes less than half of a small BO, or less than a step of a
+ *	    larger one, at the asked alignment.
+ * align:   Classes whose objects can not keep the alignment are skipped.
+ * reclaim: Empty slabs kept by the classes never make a BO fail with
+ *	    -ENOSPC, they are given back to the heap first.
+ * churn:   Random BO sizes created and freed, allocations never overlap and
+ *	    the class counts match the slabs. Reports the space lost to
+ *	    rounding next to what power of two classes would lose.
+ */
+
+#include <getopt.h>
+
+#include "amdxdna_heap_slab.h"
+
+#define HEAP_BASE	0x4000000ULL
+#define HEAP_SIZE	(64ULL << 20)
+#define CHURN_BOS	512
+
+#define EXPECT(cond) do {						\
+	if (!(cond)) {							\
+		fprintf(stderr, "%s:%d: %s failed\n",			\
+			__func__, __LINE__, #cond);			\
+		return -EINVAL;						\
+	}								\
+} while (0)
+
+struct test_heap {
+	struct drm_mm				mm;
+	struct amdxdna_heap_slab_class		classes[AMDXDNA_HEAP_SLAB_CLASSES];
+	u64					start;
+	u64					end;
+};
+
+struct test_bo {
+	struct amdxdna_heap_slab		*slab;
+	struct drm_mm_node			node;
+	u64					size;
+	u64					addr;
+	bool					live;
+};
+
+/* The classes are in the zeroed client in the driver */
+static void heap_init(struct test_heap *h, u64 size)
+{
+	memset(h, 0, sizeof(*h));
+	drm_mm_init(&h->mm, HEAP_BASE, size);
+	amdxdna_heap_slab_init(h->classes);
+	h->start = HEAP_BASE;
+	h->end = HEAP_BASE + size;
+}
+
+static int heap_fini(struct test_heap *h)
+{
+	amdxdna_heap_slab_fini(h->classes);
+	EXPECT(drm_mm_clean(&h->mm));
+	return 0;
+}
+
+/* As amdxdna_gem_heap_alloc_locked() */
+static int bo_alloc(struct test_heap *h, struct test_bo *bo, u64 size, u64 align)
+{
+	int ret;
+
+	memset(bo, 0, sizeof(*bo));
+	bo->size = size;
+	ret = amdxdna_heap_slab_alloc(h->classes, &h->mm, size, align, h->start, h->end,
+				      &bo->slab, &bo->addr);
+	if (ret == -ENOSPC) {
+		ret = amdxdna_heap_insert(h->classes, &h->mm, &bo->node, size, align,
+					  h->start, h->end);
+		if (!ret)
+			bo->addr = bo->node.start;
+	}
+	bo->live = !ret;
+	return ret;
+}
+
+static void bo_free(struct test_bo *bo)
+{
+	if (bo->slab)
+		amdxdna_heap_slab_free(bo->slab, bo->addr, bo->size);
+	else
+		drm_mm_remove_node(&bo->node);
+	bo->slab = NULL;
+	bo->live = false;
+}
+
+static u32 bo_obj_size(struct test_bo *bo)
+{
+	return bo->slab ? bo->slab->class->obj_size : bo->size;
+}
+
+static int check_bo(struct test_bo *bo, u64 align)
+{
+	u32 obj_size = bo_obj_size(bo);
+
+	EXPECT(bo->addr % align == 0);
+	EXPECT(obj_size >= bo->size);
+	if (!bo->slab)
+		return 0;
+
+	EXPECT(bo->addr >= bo->slab->node.start);
+	EXPECT(bo->addr + obj_size <= bo->slab->node.start + bo->slab->node.size);
+	/* Larger alignment skips classes, the bounds are for page alignment */
+	if (align > PAGE_SIZE)
+		return 0;
+	if (bo->size <= AMDXDNA_HEAP_SLAB_STEP)
+		EXPECT(obj_size == PAGE_SIZE || obj_size < 2 * bo->size);
+	else
+		EXPECT(obj_size - bo->size < AMDXDNA_HEAP_SLAB_STEP);
+	return 0;
+}
+
+static int run_classes(void)
+{
+	u64 odd[] = { 1, PAGE_SIZE + 1, SZ_32K - 1, SZ_32K + 1, 160 * 1024 + 1, SZ_256K };
+	struct test_heap h;
+	struct test_bo bo;
+	u64 size;
+	u32 i;
+
+	heap_init(&h, HEAP_SIZE);
+	for (size = PAGE_SIZE; size <= AMDXDNA_HEAP_SLAB_MAX_OBJ; size += PAGE_SIZE) {
+		EXPECT(!bo_alloc(&h, &bo, size, PAGE_SIZE));
+		EXPECT(bo.slab);
+		EXPECT(!check_bo(&bo, PAGE_SIZE));
+		bo_free(&bo);
+	}
+	for (i = 0; i < sizeof(odd) / sizeof(odd[0]); i++) {
+		EXPECT(!bo_alloc(&h, &bo, odd[i], PAGE_SIZE));
+		EXPECT(bo.slab);
+		EXPECT(!check_bo(&bo, PAGE_SIZE));
+		bo_free(&bo);
+	}
+
+	/* 129-160 KB took a 256 KB object with power of two classes */
+	EXPECT(!bo_alloc(&h, &bo, 129 * 1024, PAGE_SIZE));
+	EXPECT(bo_obj_size(&bo) == 160 * 1024);
+	bo_free(&bo);
+
+	/* Larger than any class, from the drm_mm */
+	EXPECT(!bo_alloc(&h, &bo, AMDXDNA_HEAP_SLAB_MAX_OBJ + 1, PAGE_SIZE));
+	EXPECT(!bo.slab);
+	bo_free(&bo);
+	return heap_fini(&h);
+}
+
+static int run_align(void)
+{
+	struct test_heap h;
+	struct test_bo bo;
+
+	heap_init(&h, HEAP_SIZE);
+
+	EXPECT(!bo_alloc(&h, &bo, 40 * 1024, SZ_64K));
+	EXPECT(bo.slab && bo_obj_size(&bo) == SZ_64K);
+	EXPECT(!check_bo(&bo, SZ_64K));
+	bo_free(&bo);
+
+	/* 96 KB objects are only 32 KB aligned, 128 KB is the next that fits */
+	EXPECT(!bo_alloc(&h, &bo, 80 * 1024, SZ_64K));
+	EXPECT(bo.slab && bo_obj_size(&bo) == 128 * 1024);
+	EXPECT(!check_bo(&bo, SZ_64K));
+	bo_free(&bo);
+
+	/* No class is aligned that much */
+	EXPECT(!bo_alloc(&h, &bo, PAGE_SIZE, SZ_1M));
+	EXPECT(!bo.slab);
+	EXPECT(!check_bo(&bo, SZ_1M));
+	bo_free(&bo);
+	return heap_fini(&h);
+}
+
+static int run_reclaim(void)
+{
+	struct test_bo bo, big;
+	struct drm_mm_node node = { 0 };
+	struct test_heap h;
+	u64 kept = 0;
+	u32 i;
+
+	/* Every class keeps one empty slab, most of a 12 MB heap */
+	heap_init(&h, 12ULL << 20);
+	for (i = 0; i < AMDXDNA_HEAP_SLAB_CLASSES; i++) {
+		EXPECT(!bo_alloc(&h, &bo, h.classes[i].obj_size, PAGE_SIZE));
+		bo_free(&bo);
+		EXPECT(h.classes[i].nr_slabs == 1);
+		kept += (u64)h.classes[i].nr_free * h.classes[i].obj_size;
+	}
+	EXPECT(kept > (8ULL << 20));
+
+	/* Nothing fits in between the empty slabs */
+	EXPECT(drm_mm_insert_node_in_range(&h.mm, &node, 4ULL << 20, PAGE_SIZE, 0, h.start,
+					   h.end, DRM_MM_INSERT_BEST) == -ENOSPC);
+
+	/* They go back for a BO that needs the room */
+	EXPECT(!bo_alloc(&h, &big, 4ULL << 20, PAGE_SIZE));
+	EXPECT(!check_bo(&big, PAGE_SIZE));
+	for (i = 0; i < AMDXDNA_HEAP_SLAB_CLASSES; i++)
+		EXPECT(!h.classes[i].nr_slabs && !h.classes[i].nr_free);
+
+	/* And for a slab of another class */
+	bo_free(&big);
+	EXPECT(!bo_alloc(&h, &big, 11ULL << 20, PAGE_SIZE));
+	EXPECT(!bo_alloc(&h, &bo, PAGE_SIZE, PAGE_SIZE));
+	bo_free(&bo);
+	EXPECT(h.classes[0].nr_slabs == 1);
+	EXPECT(!bo_alloc(&h, &bo, SZ_256K, PAGE_SIZE));
+	EXPECT(!h.classes[0].nr_slabs);
+	bo_free(&bo);
+	bo_free(&big);
+	return heap_fini(&h);
+}
+
+static int cmp_bo(const void *a, const void *b)
+{
+	const struct test_bo *x = *(const struct test_bo **)a;
+	const struct test_bo *y = *(const struct test_bo **)b;
+
+	return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+static int check_heap(struct test_heap *h, struct test_bo *bos, u32 nr)
+{
+	struct test_bo *live[CHURN_BOS];
+	struct amdxdna_heap_slab_class *class;
+	struct amdxdna_heap_slab *slab;
+	u32 nr_live = 0, nr_objs, nr_free, i, c;
+	u64 used;
+
+	for (i = 0; i < nr; i++) {
+		if (bos[i].live)
+			live[nr_live++] = &bos[i];
+	}
+	qsort(live, nr_live, sizeof(live[0]), cmp_bo);
+	for (i = 1; i < nr_live; i++)
+		EXPECT(live[i - 1]->addr + bo_obj_size(live[i - 1]) <= live[i]->addr);
+
+	for (c = 0; c < AMDXDNA_HEAP_SLAB_CLASSES; c++) {
+		class = &h->classes[c];
+		nr_objs = 0;
+		used = 0;
+		for (i = 0; i < nr_live; i++) {
+			if (live[i]->slab && live[i]->slab->class == class) {
+				nr_objs++;
+				used += live[i]->size;
+			}
+		}
+		EXPECT(class->nr_objs == nr_objs);
+		EXPECT(class->used_bytes == used);
+
+		nr_free = 0;
+		list_for_each_entry(slab, &class->partial, entry) {
+			EXPECT(slab->nr_free);
+			nr_free += slab->nr_free;
+		}
+		list_for_each_entry(slab, &class->full, entry)
+			EXPECT(!slab->nr_free);
+		EXPECT(class->nr_free == nr_free);
+	}
+	return 0;
+}
+
+static int run_churn(u32 seed, u32 nops)
+{
+	u64 waste = 0, pow2_waste = 0, size;
+	struct test_bo bos[CHURN_BOS];
+	struct test_heap h;
+	u32 i, op, nospc = 0;
+	int ret;
+
+	srand(seed);
+	memset(bos, 0, sizeof(bos));
+	heap_init(&h, HEAP_SIZE);
+	for (op = 0; op < nops; op++) {
+		i = rand() % CHURN_BOS;
+		if (bos[i].live) {
+			bo_free(&bos[i]);
+		} else {
+			if (rand() % 5)
+				size = 1 + rand() % AMDXDNA_HEAP_SLAB_MAX_OBJ;
+			else
+				size = AMDXDNA_HEAP_SLAB_MAX_OBJ + rand() % (4 << 20);
+			ret = bo_alloc(&h, &bos[i], size, PAGE_SIZE);
+			if (ret) {
+				EXPECT(ret == -ENOSPC);
+				/* Full only once the empty slabs are given back */
+				EXPECT(!amdxdna_heap_slab_reclaim(h.classes));
+				nospc++;
+			} else {
+				EXPECT(!check_bo(&bos[i], PAGE_SIZE));
+			}
+		}
+		if (!(op % 64))
+			EXPECT(!check_heap(&h, bos, CHURN_BOS));
+	}
+	EXPECT(!check_heap(&h, bos, CHURN_BOS));
+
+	for (i = 0; i < CHURN_BOS; i++) {
+		if (!bos[i].live || !bos[i].slab)
+			continue;
+		waste += bo_obj_size(&bos[i]) - bos[i].size;
+		pow2_waste += max_t(u64, roundup_pow_of_two(bos[i].size), PAGE_SIZE) - bos[i].size;
+	}
+	printf("Churn %u ops, %u -ENOSPC, slab rounding 0x%llx, power of two classes 0x%llx\n",
+	       nops, nospc, waste, pow2_waste);
+	EXPECT(waste <= pow2_waste);
+
+	for (i = 0; i < CHURN_BOS; i++) {
+		if (bos[i].live)
+			bo_free(&bos[i]);
+	}
+	return heap_fini(&h);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-s seed] [-n ops]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	u32 seed = 1, nops = 100000;
+	int ret, c;
+
+	while ((c = getopt(argc, argv, "s:n:h")) != -1) {
+		switch (c) {
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			nops = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 1;
+		}
+	}
+
+	ret = run_classes();
+	if (!ret)
+		ret = run_align();
+	if (!ret)
+		ret = run_reclaim();
+	if (!ret)
+		ret = run_churn(seed, nops);
+
+	printf("%s\n", ret ? "FAILED" : "PASSED");
+	return ret ? 1 : 0;
+}
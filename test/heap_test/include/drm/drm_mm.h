@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#ifndef _HEAP_TEST_DRM_MM_H_
+#define _HEAP_TEST_DRM_MM_H_
+
+#include "kernel_shim.h"
+
+/*
+ * Range allocator with the drm_mm calls the slab code makes. Nodes are kept
+ * sorted by start, the holes are the gaps between them. Only best fit is
+ * modelled, a linear walk is fine for a test.
+ */
+enum drm_mm_insert_mode {
+	DRM_MM_INSERT_BEST = 0,
+};
+
+struct drm_mm {
+	struct list_head	nodes;
+	u64			start;
+	u64			size;
+};
+
+struct drm_mm_node {
+	struct list_head	entry;
+	u64			start;
+	u64			size;
+	bool			allocated;
+};
+
+static inline void drm_mm_init(struct drm_mm *mm, u64 start, u64 size)
+{
+	INIT_LIST_HEAD(&mm->nodes);
+	mm->start = start;
+	mm->size = size;
+}
+
+static inline bool drm_mm_clean(const struct drm_mm *mm)
+{
+	return list_empty(&mm->nodes);
+}
+
+static inline bool drm_mm_node_allocated(const struct drm_mm_node *node)
+{
+	return node->allocated;
+}
+
+/* Lowest aligned address of the hole [hole_start, hole_end) within range */
+static inline bool drm_mm_fit(u64 hole_start, u64 hole_end, u64 size, u64 align,
+			      u64 range_start, u64 range_end, u64 *addr)
+{
+	u64 s = max(hole_start, range_start);
+	u64 e = min(hole_end, range_end);
+
+	if (align > 1)
+		s = (s + align - 1) / align * align;
+	if (s >= e || e - s < size)
+		return false;
+	*addr = s;
+	return true;
+}
+
+static inline int
+drm_mm_insert_node_in_range(struct drm_mm *mm, struct drm_mm_node *node, u64 size,
+			    u64 align, unsigned long color, u64 range_start, u64 range_end,
+			    enum drm_mm_insert_mode mode)
+{
+	struct list_head *best_prev = NULL, *prev = &mm->nodes;
+	u64 best_size = ~0ULL, best_addr = 0, hole_start = mm->start, addr;
+	struct drm_mm_node *n;
+
+	list_for_each_entry(n, &mm->nodes, entry) {
+		if (drm_mm_fit(hole_start, n->start, size, align, range_start, range_end, &addr) &&
+		    n->start - hole_start < best_size) {
+			best_size = n->start - hole_start;
+			best_addr = addr;
+			best_prev = prev;
+		}
+		hole_start = n->start + n->size;
+		prev = &n->entry;
+	}
+	if (drm_mm_fit(hole_start, mm->start + mm->size, size, align, range_start,
+		       range_end, &addr) && mm->start + mm->size - hole_start < best_size) {
+		best_addr = addr;
+		best_prev = prev;
+	}
+	if (!best_prev)
+		return -ENOSPC;
+
+	node->start = best_addr;
+	node->size = size;
+	node->allocated = true;
+	list_add(&node->entry, best_prev);
+	return 0;
+}
+
+static inline void drm_mm_remove_node(struct drm_mm_node *node)
+{
+	list_del(&node->entry);
+	node->allocated = false;
+}
+
+#endif /* _HEAP_TEST_DRM_MM_H_ */
@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#ifndef _HEAP_TEST_LINUX_KERNEL_H_
+#define _HEAP_TEST_LINUX_KERNEL_H_
+
+#include "kernel_shim.h"
+
+#endif /* _HEAP_TEST_LINUX_KERNEL_H_ */
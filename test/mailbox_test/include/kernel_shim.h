@@ -0,0 +1,497 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#ifndef _MAILBOX_TEST_KERNEL_SHIM_H_
+#define _MAILBOX_TEST_KERNEL_SHIM_H_
+
+/*
+ * Minimal user space stand-ins for the kernel APIs used by amdxdna_mailbox.c.
+ * MMIO is plain memory with acquire/release ordering, an IRQ is a direct
+ * call of the registered handler, workqueues and kthreads are pthreads.
+ * The out of line parts live in kernel_shim.c.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;
+typedef int32_t s32;
+typedef long long s64;
+typedef uint32_t __u32;
+typedef unsigned int uint;
+
+#define __iomem
+#define __packed	__attribute__((packed))
+#define __counted_by(member)
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+
+#undef static_assert
+#define static_assert(expr, ...)	_Static_assert(expr, #expr)
+
+#define ARRAY_SIZE(arr)	(sizeof(arr) / sizeof((arr)[0]))
+#define BIT(nr)		(1UL << (nr))
+#define GENMASK(h, l)	(((~0U) << (l)) & (~0U >> (31 - (h))))
+#define FIELD_PREP(mask, val) \
+	(((u32)(val) << __builtin_ctz(mask)) & (mask))
+#define IS_ALIGNED(x, a)	(((x) & ((typeof(x))(a) - 1)) == 0)
+#define min(a, b)	((a) < (b) ? (a) : (b))
+#define max(a, b)	((a) > (b) ? (a) : (b))
+
+static inline bool is_power_of_2(unsigned long n)
+{
+	return n && !(n & (n - 1));
+}
+
+#define KERNEL_VERSION(a, b, c)	(((a) << 16) + ((b) << 8) + (c))
+#define LINUX_VERSION_CODE	KERNEL_VERSION(6, 14, 0)
+
+/* Module parameters are plain globals the tests may set */
+#define module_param(name, type, perm)
+#define MODULE_PARM_DESC(name, desc)
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define READ_ONCE(x)		__atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define WRITE_ONCE(x, val)	__atomic_store_n(&(x), (val), __ATOMIC_RELAXED)
+
+#define WARN_ONCE(cond, fmt, ...) \
+({ \
+	int __ret = !!(cond); \
+	if (__ret) \
+		fprintf(stderr, "WARN: " fmt "\n", ##__VA_ARGS__); \
+	__ret; \
+})
+
+/* Logging */
+struct device {
+	const char	*name;
+	int		verbose;
+};
+
+#define dev_err(dev, fmt, ...) \
+	fprintf(stderr, "[%s] *ERROR* " fmt "\n", (dev)->name, ##__VA_ARGS__)
+#define dev_warn_once(dev, fmt, ...) \
+	fprintf(stderr, "[%s] *WARN* " fmt "\n", (dev)->name, ##__VA_ARGS__)
+#define dev_dbg(dev, fmt, ...) \
+({ \
+	if ((dev)->verbose) \
+		fprintf(stderr, "[%s] " fmt "\n", (dev)->name, ##__VA_ARGS__); \
+})
+#define pr_err(fmt, ...)	fprintf(stderr, fmt "\n", ##__VA_ARGS__)
+
+/* Error pointers */
+#define MAX_ERRNO	4095
+#define IS_ERR_VALUE(x)	unlikely((unsigned long)(void *)(x) >= (unsigned long)-MAX_ERRNO)
+
+static inline void *ERR_PTR(long error)
+{
+	return (void *)error;
+}
+
+static inline long PTR_ERR(const void *ptr)
+{
+	return (long)ptr;
+}
+
+static inline bool IS_ERR(const void *ptr)
+{
+	return IS_ERR_VALUE((unsigned long)ptr);
+}
+
+/* Memory allocation, counted so the tests can report allocations per message */
+typedef unsigned int gfp_t;
+#define GFP_KERNEL	0
+
+extern unsigned long shim_kmalloc_cnt;
+extern unsigned long shim_cache_alloc_cnt;
+
+static inline void *kzalloc(size_t size, gfp_t flags)
+{
+	__atomic_add_fetch(&shim_kmalloc_cnt, 1, __ATOMIC_RELAXED);
+	return calloc(1, size);
+}
+
+static inline void *kmalloc(size_t size, gfp_t flags)
+{
+	__atomic_add_fetch(&shim_kmalloc_cnt, 1, __ATOMIC_RELAXED);
+	return malloc(size);
+}
+
+static inline void *kcalloc(size_t n, size_t size, gfp_t flags)
+{
+	return kzalloc(n * size, flags);
+}
+
+static inline void kfree(const void *p)
+{
+	free((void *)p);
+}
+
+struct kmem_cache {
+	size_t		size;
+};
+
+static inline struct kmem_cache *
+kmem_cache_create(const char *name, unsigned int size, unsigned int align,
+		  unsigned long flags, void (*ctor)(void *))
+{
+	struct kmem_cache *s = malloc(sizeof(*s));
+
+	if (s)
+		s->size = size;
+	return s;
+}
+
+static inline void kmem_cache_destroy(struct kmem_cache *s)
+{
+	free(s);
+}
+
+static inline void *kmem_cache_alloc(struct kmem_cache *s, gfp_t flags)
+{
+	__atomic_add_fetch(&shim_cache_alloc_cnt, 1, __ATOMIC_RELAXED);
+	return malloc(s->size);
+}
+
+static inline void kmem_cache_free(struct kmem_cache *s, void *p)
+{
+	free(p);
+}
+
+/* Doubly linked list */
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void list_add_tail(struct list_head *new, struct list_head *head)
+{
+	struct list_head *prev = head->prev;
+
+	head->prev = new;
+	new->next = head;
+	new->prev = prev;
+	prev->next = new;
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	entry->next = NULL;
+	entry->prev = NULL;
+}
+
+static inline void list_del_init(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	INIT_LIST_HEAD(entry);
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) list_entry((ptr)->next, type, member)
+#define list_first_entry_or_null(ptr, type, member) \
+	(list_empty(ptr) ? NULL : list_first_entry(ptr, type, member))
+#define list_next_entry(pos, member) \
+	list_entry((pos)->member.next, typeof(*(pos)), member)
+
+#define list_for_each_entry(pos, head, member) \
+	for (pos = list_first_entry(head, typeof(*pos), member); \
+	     &pos->member != (head); \
+	     pos = list_next_entry(pos, member))
+
+/* Bitmap */
+#define BITS_PER_LONG		(sizeof(long) * CHAR_BIT)
+#define BITS_TO_LONGS(nr)	(((nr) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define DECLARE_BITMAP(name, bits) unsigned long name[BITS_TO_LONGS(bits)]
+
+static inline bool test_bit(unsigned long nr, const unsigned long *addr)
+{
+	return (addr[nr / BITS_PER_LONG] >> (nr % BITS_PER_LONG)) & 1UL;
+}
+
+static inline void __set_bit(unsigned long nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static inline void __clear_bit(unsigned long nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+
+/* Locking. Firmware and IRQ run in threads, so a mutex is good enough. */
+typedef pthread_mutex_t spinlock_t;
+#define spin_lock_init(l)	pthread_mutex_init(l, NULL)
+#define spin_lock(l)		pthread_mutex_lock(l)
+#define spin_unlock(l)		pthread_mutex_unlock(l)
+#define spin_lock_bh(l)		pthread_mutex_lock(l)
+#define spin_unlock_bh(l)	pthread_mutex_unlock(l)
+#define spin_lock_irq(l)	pthread_mutex_lock(l)
+#define spin_unlock_irq(l)	pthread_mutex_unlock(l)
+#define spin_lock_irqsave(l, flags)	((void)(flags), pthread_mutex_lock(l))
+#define spin_unlock_irqrestore(l, flags)	pthread_mutex_unlock(l)
+
+struct mutex {
+	pthread_mutex_t	lock;
+};
+
+#define mutex_init(m)		pthread_mutex_init(&(m)->lock, NULL)
+#define mutex_lock(m)		pthread_mutex_lock(&(m)->lock)
+#define mutex_unlock(m)		pthread_mutex_unlock(&(m)->lock)
+
+/* MMIO is host memory shared with the firmware thread */
+static inline u32 readl(const void *addr)
+{
+	return __atomic_load_n((const u32 *)addr, __ATOMIC_ACQUIRE);
+}
+
+/* Writes to shim_doorbell are counted, the tests point it at a tail register */
+extern void *shim_doorbell;
+extern unsigned long shim_doorbell_cnt;
+
+static inline void writel(u32 val, void *addr)
+{
+	if (addr == shim_doorbell)
+		__atomic_add_fetch(&shim_doorbell_cnt, 1, __ATOMIC_RELAXED);
+	__atomic_store_n((u32 *)addr, val, __ATOMIC_RELEASE);
+}
+
+#define ioread32(addr)	readl(addr)
+
+static inline void memcpy_toio(void *dst, const void *src, size_t n)
+{
+	memcpy(dst, src, n);
+}
+
+static inline void memcpy_fromio(void *dst, const void *src, size_t n)
+{
+	memcpy(dst, src, n);
+}
+
+static inline u64 shim_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define ktime_get_ns()	shim_now_ns()
+
+#define readx_poll_timeout(op, addr, val, cond, sleep_us, timeout_us) \
+({ \
+	u64 __end = shim_now_ns() + (u64)(timeout_us) * 1000; \
+	int __ret = 0; \
+	for (;;) { \
+		(val) = op(addr); \
+		if (cond) \
+			break; \
+		if (shim_now_ns() > __end) { \
+			(val) = op(addr); \
+			__ret = (cond) ? 0 : -ETIMEDOUT; \
+			break; \
+		} \
+	} \
+	__ret; \
+})
+
+/* PCI and IRQ. The MSI-X vector of index N is IRQ N. */
+struct pci_dev {
+	struct device	dev;
+};
+
+#define to_pci_dev(d)	container_of(d, struct pci_dev, dev)
+
+static inline int pci_irq_vector(struct pci_dev *pdev, unsigned int nr)
+{
+	return nr;
+}
+
+typedef enum irqreturn {
+	IRQ_NONE,
+	IRQ_HANDLED,
+	IRQ_WAKE_THREAD,
+} irqreturn_t;
+
+typedef irqreturn_t (*irq_handler_t)(int irq, void *data);
+
+/* Threaded handlers always run oneshot, the flag is implied */
+#define IRQF_ONESHOT	0x1
+
+int request_irq(unsigned int irq, irq_handler_t handler, unsigned long flags,
+		const char *name, void *data);
+int request_threaded_irq(unsigned int irq, irq_handler_t handler, irq_handler_t thread_fn,
+			 unsigned long flags, const char *name, void *data);
+void free_irq(unsigned int irq, void *data);
+/*
+ * Disabling nests like in the kernel. An interrupt raised while disabled is
+ * delivered when it is enabled again.
+ */
+void disable_irq(unsigned int irq);
+void disable_irq_nosync(unsigned int irq);
+void enable_irq(unsigned int irq);
+/* Called by the firmware model to deliver an interrupt */
+void shim_raise_irq(unsigned int irq);
+
+/* Workqueue, every queue has its own thread so it is always ordered */
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+	work_func_t		func;
+	struct work_struct	*next;
+	bool			pending;
+	bool			running;
+};
+
+struct workqueue_struct;
+
+#define INIT_WORK(w, f) \
+	do { \
+		memset((w), 0, sizeof(*(w))); \
+		(w)->func = (f); \
+	} while (0)
+
+struct workqueue_struct *alloc_ordered_workqueue(const char *name, unsigned int flags);
+void destroy_workqueue(struct workqueue_struct *wq);
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work);
+bool cancel_work_sync(struct work_struct *work);
+
+/* Kthread and wait queue */
+struct task_struct;
+
+struct task_struct *kthread_run(int (*fn)(void *data), void *data, const char *name);
+int kthread_stop(struct task_struct *task);
+bool kthread_should_stop(void);
+
+static inline void schedule(void)
+{
+	sched_yield();
+}
+
+static inline void cond_resched(void)
+{
+	sched_yield();
+}
+
+/* All wait queues share one condition, wakeups are rare in the tests */
+struct wait_queue_head {
+	int	unused;
+};
+
+extern pthread_mutex_t shim_wait_lock;
+extern pthread_cond_t shim_wait_cond;
+
+static inline void init_waitqueue_head(struct wait_queue_head *wq)
+{
+}
+
+void shim_wait_timeout(void);
+
+#define wait_event_interruptible(wq, cond) \
+({ \
+	pthread_mutex_lock(&shim_wait_lock); \
+	while (!(cond)) \
+		shim_wait_timeout(); \
+	pthread_mutex_unlock(&shim_wait_lock); \
+	0; \
+})
+
+static inline void wake_up(struct wait_queue_head *wq)
+{
+	pthread_mutex_lock(&shim_wait_lock);
+	pthread_cond_broadcast(&shim_wait_cond);
+	pthread_mutex_unlock(&shim_wait_lock);
+}
+
+/* hrtimer, fired from one shim thread with about 10us of slack */
+#define NSEC_PER_USEC	1000ULL
+
+typedef s64 ktime_t;
+
+static inline ktime_t ns_to_ktime(u64 ns)
+{
+	return ns;
+}
+
+enum hrtimer_restart {
+	HRTIMER_NORESTART,
+	HRTIMER_RESTART,
+};
+
+enum hrtimer_mode {
+	HRTIMER_MODE_REL_SOFT,
+};
+
+struct hrtimer {
+	enum hrtimer_restart	(*function)(struct hrtimer *timer);
+	u64			expires;
+	bool			armed;
+	bool			running;
+	struct hrtimer		*next;
+};
+
+void hrtimer_setup(struct hrtimer *timer, enum hrtimer_restart (*function)(struct hrtimer *),
+		   clockid_t clock_id, enum hrtimer_mode mode);
+void hrtimer_start(struct hrtimer *timer, ktime_t tim, enum hrtimer_mode mode);
+int hrtimer_try_to_cancel(struct hrtimer *timer);
+int hrtimer_cancel(struct hrtimer *timer);
+
+/*
+ * Trace events are not recorded, except the response latency which is
+ * summed up for the tests to report.
+ */
+extern u64 shim_rx_latency_cnt;
+extern u64 shim_rx_latency_sum;
+extern u64 shim_rx_latency_max;
+
+static inline void shim_rx_latency(u64 ns)
+{
+	u64 max = __atomic_load_n(&shim_rx_latency_max, __ATOMIC_RELAXED);
+
+	__atomic_add_fetch(&shim_rx_latency_cnt, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&shim_rx_latency_sum, ns, __ATOMIC_RELAXED);
+	while (ns > max && !__atomic_compare_exchange_n(&shim_rx_latency_max, &max, ns, false,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+#define trace_mbox_rx_latency_enabled()	true
+#define trace_mbox_rx_latency(name, irq, path, id, ns)	shim_rx_latency(ns)
+
+#define trace_mbox_set_tail(name, irq, opcode, id)	do { } while (0)
+#define trace_mbox_set_head(name, irq, opcode, id)	do { } while (0)
+#define trace_mbox_irq_handle(name, irq)		do { } while (0)
+#define trace_mbox_rx_worker(name, irq)			do { } while (0)
+#define trace_mbox_poll_handle(name, irq)		do { } while (0)
+#define trace_mbox_irq_thread(name, irq)		do { } while (0)
+
+#endif /* _MAILBOX_TEST_KERNEL_SHIM_H_ */
@@ -0,0 +1,4 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2025, Advanced Micro Devices, Inc. */
+/* Also reached from the libc <errno.h>, give it what the uapi header would */
+#include <asm/errno.h>
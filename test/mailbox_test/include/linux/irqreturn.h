@@ -0,0 +1,3 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2025, Advanced Micro Devices, Inc. */
+#include "../kernel_shim.h"
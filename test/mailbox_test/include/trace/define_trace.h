@@ -0,0 +1,3 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Copyright (C) 2025, Advanced Micro Devices, Inc. */
+/* Trace events are stubbed out in kernel_shim.h */
@@ -0,0 +1,472 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#include "kernel_shim.h"
+
+unsigned long shim_kmalloc_cnt;
+unsigned long shim_cache_alloc_cnt;
+void *shim_doorbell;
+unsigned long shim_doorbell_cnt;
+u64 shim_rx_latency_cnt;
+u64 shim_rx_latency_sum;
+u64 shim_rx_latency_max;
+
+pthread_mutex_t shim_wait_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t shim_wait_cond = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Waiters re-check their condition every millisecond as well, so a wakeup
+ * racing with the condition check is never lost for long.
+ */
+void shim_wait_timeout(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(&shim_wait_cond, &shim_wait_lock, &ts);
+}
+
+/* IRQ */
+#define SHIM_MAX_IRQ	16
+
+/*
+ * The handler runs with lock held, like the kernel serializes it per IRQ. A
+ * threaded handler runs in its own pthread with the IRQ disabled, as oneshot.
+ */
+static struct {
+	pthread_mutex_t	lock;
+	irq_handler_t	handler;
+	void		*data;
+	int		depth;
+	bool		pending;
+
+	irq_handler_t	thread_fn;
+	pthread_t	thread;
+	pthread_cond_t	cond;
+	bool		wake;
+	bool		running;
+	bool		stop;
+} shim_irqs[SHIM_MAX_IRQ];
+
+static void shim_irq_init(void)
+{
+	static bool done;
+	int i;
+
+	if (done)
+		return;
+	for (i = 0; i < SHIM_MAX_IRQ; i++) {
+		pthread_mutex_init(&shim_irqs[i].lock, NULL);
+		pthread_cond_init(&shim_irqs[i].cond, NULL);
+	}
+	done = true;
+}
+
+int request_irq(unsigned int irq, irq_handler_t handler, unsigned long flags,
+		const char *name, void *data)
+{
+	shim_irq_init();
+	if (irq >= SHIM_MAX_IRQ || shim_irqs[irq].handler)
+		return -EBUSY;
+
+	shim_irqs[irq].data = data;
+	__atomic_store_n(&shim_irqs[irq].depth, 0, __ATOMIC_RELEASE);
+	shim_irqs[irq].pending = false;
+	__atomic_store_n(&shim_irqs[irq].handler, handler, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static void *shim_irq_thread(void *data)
+{
+	struct sched_param param = { .sched_priority = 50 };
+	unsigned int irq = (uintptr_t)data;
+
+	/* Same policy as kernel IRQ threads, needs privileges in user space */
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	pthread_mutex_lock(&shim_irqs[irq].lock);
+	for (;;) {
+		while (!shim_irqs[irq].wake && !shim_irqs[irq].stop)
+			pthread_cond_wait(&shim_irqs[irq].cond, &shim_irqs[irq].lock);
+		if (shim_irqs[irq].stop)
+			break;
+
+		shim_irqs[irq].wake = false;
+		shim_irqs[irq].running = true;
+		pthread_mutex_unlock(&shim_irqs[irq].lock);
+
+		shim_irqs[irq].thread_fn(irq, shim_irqs[irq].data);
+
+		pthread_mutex_lock(&shim_irqs[irq].lock);
+		shim_irqs[irq].running = false;
+		pthread_cond_broadcast(&shim_irqs[irq].cond);
+		pthread_mutex_unlock(&shim_irqs[irq].lock);
+		/* Unmask the oneshot IRQ */
+		enable_irq(irq);
+		pthread_mutex_lock(&shim_irqs[irq].lock);
+	}
+	pthread_mutex_unlock(&shim_irqs[irq].lock);
+
+	return NULL;
+}
+
+int request_threaded_irq(unsigned int irq, irq_handler_t handler, irq_handler_t thread_fn,
+			 unsigned long flags, const char *name, void *data)
+{
+	int ret;
+
+	shim_irq_init();
+	if (irq >= SHIM_MAX_IRQ || shim_irqs[irq].handler)
+		return -EBUSY;
+
+	shim_irqs[irq].thread_fn = thread_fn;
+	shim_irqs[irq].wake = false;
+	shim_irqs[irq].stop = false;
+	if (pthread_create(&shim_irqs[irq].thread, NULL, shim_irq_thread, (void *)(uintptr_t)irq))
+		return -EAGAIN;
+
+	ret = request_irq(irq, handler, flags, name, data);
+	if (ret)
+		free_irq(irq, data);
+	return ret;
+}
+
+void free_irq(unsigned int irq, void *data)
+{
+	pthread_mutex_lock(&shim_irqs[irq].lock);
+	__atomic_store_n(&shim_irqs[irq].handler, NULL, __ATOMIC_RELEASE);
+	shim_irqs[irq].stop = true;
+	pthread_cond_broadcast(&shim_irqs[irq].cond);
+	pthread_mutex_unlock(&shim_irqs[irq].lock);
+
+	if (shim_irqs[irq].thread_fn) {
+		pthread_join(shim_irqs[irq].thread, NULL);
+		shim_irqs[irq].thread_fn = NULL;
+	}
+}
+
+/* May be called from the handler, so it does not take the IRQ lock */
+void disable_irq_nosync(unsigned int irq)
+{
+	__atomic_add_fetch(&shim_irqs[irq].depth, 1, __ATOMIC_ACQ_REL);
+}
+
+/* Waits for a running handler, threaded or not */
+void disable_irq(unsigned int irq)
+{
+	disable_irq_nosync(irq);
+	pthread_mutex_lock(&shim_irqs[irq].lock);
+	while (shim_irqs[irq].wake || shim_irqs[irq].running)
+		pthread_cond_wait(&shim_irqs[irq].cond, &shim_irqs[irq].lock);
+	pthread_mutex_unlock(&shim_irqs[irq].lock);
+}
+
+static void shim_irq_deliver(unsigned int irq)
+{
+	irq_handler_t handler;
+
+	pthread_mutex_lock(&shim_irqs[irq].lock);
+	handler = __atomic_load_n(&shim_irqs[irq].handler, __ATOMIC_ACQUIRE);
+	if (!handler) {
+		pthread_mutex_unlock(&shim_irqs[irq].lock);
+		return;
+	}
+	if (__atomic_load_n(&shim_irqs[irq].depth, __ATOMIC_ACQUIRE)) {
+		shim_irqs[irq].pending = true;
+		pthread_mutex_unlock(&shim_irqs[irq].lock);
+		return;
+	}
+
+	shim_irqs[irq].pending = false;
+	if (handler(irq, shim_irqs[irq].data) == IRQ_WAKE_THREAD) {
+		disable_irq_nosync(irq);
+		shim_irqs[irq].wake = true;
+		pthread_cond_broadcast(&shim_irqs[irq].cond);
+	}
+	pthread_mutex_unlock(&shim_irqs[irq].lock);
+}
+
+void enable_irq(unsigned int irq)
+{
+	bool pending;
+
+	if (__atomic_sub_fetch(&shim_irqs[irq].depth, 1, __ATOMIC_ACQ_REL))
+		return;
+
+	pthread_mutex_lock(&shim_irqs[irq].lock);
+	pending = shim_irqs[irq].pending;
+	pthread_mutex_unlock(&shim_irqs[irq].lock);
+	if (pending)
+		shim_irq_deliver(irq);
+}
+
+void shim_raise_irq(unsigned int irq)
+{
+	shim_irq_deliver(irq);
+}
+
+/* Workqueue */
+struct workqueue_struct {
+	pthread_t		thread;
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	struct work_struct	*head;
+	struct work_struct	**tail;
+	bool			stop;
+};
+
+static pthread_mutex_t shim_work_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t shim_work_idle = PTHREAD_COND_INITIALIZER;
+
+static void *shim_worker(void *data)
+{
+	struct workqueue_struct *wq = data;
+	struct work_struct *work;
+
+	pthread_mutex_lock(&wq->lock);
+	for (;;) {
+		while (!wq->head && !wq->stop)
+			pthread_cond_wait(&wq->cond, &wq->lock);
+		if (!wq->head)
+			break;
+
+		work = wq->head;
+		wq->head = work->next;
+		if (!wq->head)
+			wq->tail = &wq->head;
+		pthread_mutex_unlock(&wq->lock);
+
+		pthread_mutex_lock(&shim_work_lock);
+		if (!work->pending) {
+			/* Cancelled after it was queued */
+			pthread_mutex_unlock(&shim_work_lock);
+			pthread_mutex_lock(&wq->lock);
+			continue;
+		}
+		work->pending = false;
+		work->running = true;
+		pthread_mutex_unlock(&shim_work_lock);
+
+		work->func(work);
+
+		pthread_mutex_lock(&shim_work_lock);
+		work->running = false;
+		pthread_cond_broadcast(&shim_work_idle);
+		pthread_mutex_unlock(&shim_work_lock);
+
+		pthread_mutex_lock(&wq->lock);
+	}
+	pthread_mutex_unlock(&wq->lock);
+
+	return NULL;
+}
+
+struct workqueue_struct *alloc_ordered_workqueue(const char *name, unsigned int flags)
+{
+	struct workqueue_struct *wq;
+
+	wq = calloc(1, sizeof(*wq));
+	if (!wq)
+		return NULL;
+
+	pthread_mutex_init(&wq->lock, NULL);
+	pthread_cond_init(&wq->cond, NULL);
+	wq->tail = &wq->head;
+	if (pthread_create(&wq->thread, NULL, shim_worker, wq)) {
+		free(wq);
+		return NULL;
+	}
+	return wq;
+}
+
+/* Drains the queue like the kernel version does */
+void destroy_workqueue(struct workqueue_struct *wq)
+{
+	pthread_mutex_lock(&wq->lock);
+	wq->stop = true;
+	pthread_cond_signal(&wq->cond);
+	pthread_mutex_unlock(&wq->lock);
+
+	pthread_join(wq->thread, NULL);
+	free(wq);
+}
+
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work)
+{
+	pthread_mutex_lock(&shim_work_lock);
+	if (work->pending) {
+		pthread_mutex_unlock(&shim_work_lock);
+		return false;
+	}
+	work->pending = true;
+	pthread_mutex_unlock(&shim_work_lock);
+
+	pthread_mutex_lock(&wq->lock);
+	work->next = NULL;
+	*wq->tail = work;
+	wq->tail = &work->next;
+	pthread_cond_signal(&wq->cond);
+	pthread_mutex_unlock(&wq->lock);
+
+	return true;
+}
+
+bool cancel_work_sync(struct work_struct *work)
+{
+	bool pending;
+
+	pthread_mutex_lock(&shim_work_lock);
+	pending = work->pending;
+	work->pending = false;
+	while (work->running)
+		pthread_cond_wait(&shim_work_idle, &shim_work_lock);
+	pthread_mutex_unlock(&shim_work_lock);
+
+	return pending;
+}
+
+/* Kthread */
+struct task_struct {
+	pthread_t	thread;
+	int		(*fn)(void *data);
+	void		*data;
+	bool		should_stop;
+	int		ret;
+};
+
+static __thread struct task_struct *shim_current;
+
+static void *shim_kthread(void *data)
+{
+	struct task_struct *task = data;
+
+	shim_current = task;
+	task->ret = task->fn(task->data);
+	return NULL;
+}
+
+struct task_struct *kthread_run(int (*fn)(void *data), void *data, const char *name)
+{
+	struct task_struct *task;
+
+	task = calloc(1, sizeof(*task));
+	if (!task)
+		return ERR_PTR(-ENOMEM);
+
+	task->fn = fn;
+	task->data = data;
+	if (pthread_create(&task->thread, NULL, shim_kthread, task)) {
+		free(task);
+		return ERR_PTR(-EAGAIN);
+	}
+	return task;
+}
+
+int kthread_stop(struct task_struct *task)
+{
+	int ret;
+
+	__atomic_store_n(&task->should_stop, true, __ATOMIC_RELEASE);
+	pthread_mutex_lock(&shim_wait_lock);
+	pthread_cond_broadcast(&shim_wait_cond);
+	pthread_mutex_unlock(&shim_wait_lock);
+
+	pthread_join(task->thread, NULL);
+	ret = task->ret;
+	free(task);
+	return ret;
+}
+
+bool kthread_should_stop(void)
+{
+	return shim_current && __atomic_load_n(&shim_current->should_stop, __ATOMIC_ACQUIRE);
+}
+
+/* hrtimer */
+static pthread_mutex_t shim_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct hrtimer *shim_timers;
+static bool shim_timer_started;
+
+static void *shim_timer_thread(void *data)
+{
+	struct timespec ts = { .tv_nsec = 10000 };
+	struct hrtimer *timer;
+	u64 now;
+
+	for (;;) {
+		nanosleep(&ts, NULL);
+		now = shim_now_ns();
+		pthread_mutex_lock(&shim_timer_lock);
+		for (timer = shim_timers; timer; timer = timer->next) {
+			if (!__atomic_load_n(&timer->armed, __ATOMIC_ACQUIRE) ||
+			    now < __atomic_load_n(&timer->expires, __ATOMIC_ACQUIRE))
+				continue;
+
+			__atomic_store_n(&timer->running, true, __ATOMIC_RELEASE);
+			__atomic_store_n(&timer->armed, false, __ATOMIC_RELEASE);
+			timer->function(timer);
+			__atomic_store_n(&timer->running, false, __ATOMIC_RELEASE);
+		}
+		pthread_mutex_unlock(&shim_timer_lock);
+	}
+
+	return NULL;
+}
+
+void hrtimer_setup(struct hrtimer *timer, enum hrtimer_restart (*function)(struct hrtimer *),
+		   clockid_t clock_id, enum hrtimer_mode mode)
+{
+	pthread_t thread;
+
+	memset(timer, 0, sizeof(*timer));
+	timer->function = function;
+
+	pthread_mutex_lock(&shim_timer_lock);
+	timer->next = shim_timers;
+	shim_timers = timer;
+	if (!shim_timer_started) {
+		pthread_create(&thread, NULL, shim_timer_thread, NULL);
+		pthread_detach(thread);
+		shim_timer_started = true;
+	}
+	pthread_mutex_unlock(&shim_timer_lock);
+}
+
+void hrtimer_start(struct hrtimer *timer, ktime_t tim, enum hrtimer_mode mode)
+{
+	__atomic_store_n(&timer->expires, shim_now_ns() + tim, __ATOMIC_RELEASE);
+	__atomic_store_n(&timer->armed, true, __ATOMIC_RELEASE);
+}
+
+int hrtimer_try_to_cancel(struct hrtimer *timer)
+{
+	if (__atomic_load_n(&timer->running, __ATOMIC_ACQUIRE))
+		return -1;
+	return __atomic_exchange_n(&timer->armed, false, __ATOMIC_ACQ_REL);
+}
+
+/* Also takes the timer off the list, it is not started again before it is freed */
+int hrtimer_cancel(struct hrtimer *timer)
+{
+	struct hrtimer **p;
+	int ret;
+
+	pthread_mutex_lock(&shim_timer_lock);
+	ret = __atomic_exchange_n(&timer->armed, false, __ATOMIC_ACQ_REL);
+	for (p = &shim_timers; *p; p = &(*p)->next) {
+		if (*p == timer) {
+			*p = timer->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&shim_timer_lock);
+
+	return ret;
+}
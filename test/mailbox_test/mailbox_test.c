@@ -0,0 +1,631 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+/*
+ * User space harness for the mailbox (amdxdna_mailbox.c).
+ *
+ * The mailbox is compiled as is against the kernel API stand-ins in
+ * include/. The ring buffers and mailbox registers live in host memory and a
+ * firmware thread echoes every X2I message back on the I2X ring, raising the
+ * channel interrupt after each response. Test modes,
+ *
+ * echo: Keep a window of messages in flight, check every response against
+ *	 what was sent, report messages per second, allocations per message
+ *	 and messages per doorbell. Messages are sent in batches of -B with one
+ *	 tail update, -M holds the tail after every batch so only the hold
+ *	 timer publishes it.
+ *
+ * random: Echo with payload sizes drawn at random up to -b, so packages end
+ *	   at every offset of the ring. The firmware model checks every head,
+ *	   tail and package it sees and reports how often each ring wrapped.
+ *	   It also pauses now and then so the host fills the ring and has to
+ *	   wrap right behind the reader, the message rate is not comparable
+ *	   to echo mode.
+ *
+ * Both sides of the model use the ring arithmetic of the driver in
+ * amdxdna_mailbox_ring.h.
+ *
+ * Interrupt driven channels complete through the rx workqueue unless -N
+ * selects the adaptive poll thread or -T the threaded IRQ handler. The receive
+ * counters of the channel are reported as interrupts per message and
+ * messages per wakeup, along with the time from an interrupt to the end of
+ * the notify callback of the first response it delivered.
+ */
+
+#include <getopt.h>
+#include <unistd.h>
+
+#include "kernel_shim.h"
+#include "amdxdna_mailbox.h"
+#include "amdxdna_mailbox_ring.h"
+
+/* Module parameters of the mailbox */
+extern bool mailbox_napi;
+extern uint mailbox_napi_spin_us;
+extern bool mailbox_irq_thread;
+
+/* Register layout of the model, one channel */
+#define REG_X2I_HEAD		0x0
+#define REG_X2I_TAIL		0x4
+#define REG_I2X_HEAD		0x8
+#define REG_I2X_TAIL		0xC
+#define REG_IOHUB		0x10
+#define MBOX_REG_SIZE		0x100
+
+#define TEST_MSIX_ID		0
+#define TEST_OPCODE		0x101
+/* Fail when no response arrives for this long */
+#define TEST_STALL_NS		(5ULL * 1000000000)
+
+enum test_mode {
+	MODE_ECHO,
+	MODE_RANDOM,
+};
+
+struct test_config {
+	enum test_mode	mode;
+	u32		nmsgs;
+	u32		window;
+	u32		payload;
+	u32		rb_size;
+	u32		batch;
+	bool		more;
+	bool		poll;
+	u32		seed;
+	u32		hogs;
+	int		verbose;
+};
+
+/* Same layout as struct xdna_msg_header in the driver */
+struct fw_msg_header {
+	u32	total_size;
+	u32	sz_ver;
+	u32	id;
+	u32	opcode;
+};
+
+struct fw_model {
+	pthread_t	thread;
+	u8		*ringbuf;
+	u8		*regs;
+	u32		rb_size;
+	u32		x2i_head;
+	u32		i2x_tail;
+	u64		x2i_wraps;
+	u64		i2x_wraps;
+	u64		pkgs;
+	bool		poll;
+	bool		stall;
+	bool		stop;
+	int		error;
+};
+
+struct echo_state {
+	u32	payload;
+	bool	random;
+	u32	seed;
+	u64	completed;
+	u64	aborted;
+	u64	bad;
+};
+
+static struct echo_state echo;
+
+static u32 *fw_reg(struct fw_model *fw, u32 reg)
+{
+	return (u32 *)(fw->regs + reg);
+}
+
+static u8 *fw_x2i(struct fw_model *fw)
+{
+	return fw->ringbuf;
+}
+
+static u8 *fw_i2x(struct fw_model *fw)
+{
+	return fw->ringbuf + fw->rb_size;
+}
+
+#define FW_ERR(fw, fmt, args...) \
+({ \
+	fprintf(stderr, "fw: " fmt "\n", ##args); \
+	__atomic_store_n(&(fw)->error, -EINVAL, __ATOMIC_RELEASE); \
+})
+
+/*
+ * fw_post_resp() - Put one package on the I2X ring, waiting for the host to
+ * make space.
+ */
+static int fw_post_resp(struct fw_model *fw, const void *pkg, u32 pkg_size)
+{
+	u32 head, tail, offset;
+
+	tail = fw->i2x_tail;
+	for (;;) {
+		if (__atomic_load_n(&fw->stop, __ATOMIC_ACQUIRE))
+			return -EINTR;
+
+		head = readl(fw_reg(fw, REG_I2X_HEAD));
+		if (!mailbox_ring_ptr_valid(head, fw->rb_size)) {
+			FW_ERR(fw, "Invalid I2X head 0x%x", head);
+			return -EINVAL;
+		}
+		if (!mailbox_ring_reserve(head, tail, fw->rb_size, pkg_size, &offset))
+			break;
+	}
+
+	if (offset != tail) {
+		writel(MAILBOX_TOMBSTONE, fw_i2x(fw) + tail);
+		fw->i2x_wraps++;
+	}
+
+	memcpy(fw_i2x(fw) + offset, pkg, pkg_size);
+	fw->i2x_tail = offset + pkg_size;
+	writel(fw->i2x_tail, fw_reg(fw, REG_I2X_TAIL));
+	return 0;
+}
+
+static void *fw_thread(void *data)
+{
+	struct fw_model *fw = data;
+	struct fw_msg_header *hdr;
+	u32 tail, pkg_size;
+
+	while (!__atomic_load_n(&fw->stop, __ATOMIC_ACQUIRE)) {
+		tail = readl(fw_reg(fw, REG_X2I_TAIL));
+		if (fw->x2i_head == tail) {
+			sched_yield();
+			continue;
+		}
+		if (!mailbox_ring_ptr_valid(tail, fw->rb_size)) {
+			FW_ERR(fw, "Invalid X2I tail 0x%x", tail);
+			break;
+		}
+
+		fw->x2i_head = mailbox_ring_read_start(fw->x2i_head, fw->rb_size);
+		if (readl(fw_x2i(fw) + fw->x2i_head) == MAILBOX_TOMBSTONE) {
+			if (!mailbox_ring_tombstone_valid(fw->x2i_head, tail)) {
+				FW_ERR(fw, "Tombstone, head 0x%x tail 0x%x", fw->x2i_head, tail);
+				break;
+			}
+			fw->x2i_head = 0;
+			fw->x2i_wraps++;
+			continue;
+		}
+
+		/* Echo the whole package, the response carries the same ID */
+		hdr = (struct fw_msg_header *)(fw_x2i(fw) + fw->x2i_head);
+		pkg_size = sizeof(*hdr) + hdr->total_size;
+		if (!hdr->total_size || !IS_ALIGNED(hdr->total_size, 4) ||
+		    !mailbox_ring_pkg_valid(fw->x2i_head, tail, fw->rb_size, pkg_size)) {
+			FW_ERR(fw, "Invalid package size 0x%x, head 0x%x tail 0x%x",
+			       pkg_size, fw->x2i_head, tail);
+			break;
+		}
+		if (fw_post_resp(fw, hdr, pkg_size))
+			break;
+
+		fw->x2i_head += pkg_size;
+		writel(fw->x2i_head, fw_reg(fw, REG_X2I_HEAD));
+
+		writel(1, fw_reg(fw, REG_IOHUB));
+		if (!fw->poll)
+			shim_raise_irq(TEST_MSIX_ID);
+
+		/*
+		 * Pause now and then so the host fills the X2I ring and the
+		 * writer has to wrap right behind the reader.
+		 */
+		if (fw->stall && !(++fw->pkgs % 16))
+			usleep(200);
+	}
+
+	return NULL;
+}
+
+static int fw_start(struct fw_model *fw, struct test_config *cfg)
+{
+	fw->rb_size = cfg->rb_size;
+	fw->poll = cfg->poll;
+	fw->stall = cfg->mode == MODE_RANDOM;
+	fw->ringbuf = calloc(2, cfg->rb_size);
+	fw->regs = calloc(1, MBOX_REG_SIZE);
+	if (!fw->ringbuf || !fw->regs)
+		return -ENOMEM;
+
+	if (pthread_create(&fw->thread, NULL, fw_thread, fw))
+		return -EAGAIN;
+	return 0;
+}
+
+static void fw_stop(struct fw_model *fw)
+{
+	__atomic_store_n(&fw->stop, true, __ATOMIC_RELEASE);
+	pthread_join(fw->thread, NULL);
+	free(fw->ringbuf);
+	free(fw->regs);
+}
+
+static struct mailbox_channel *
+test_create_channel(struct mailbox *mb, struct fw_model *fw, struct test_config *cfg)
+{
+	struct xdna_mailbox_chann_info info = {
+		.x2i = {
+			.rb_start_addr = 0,
+			.rb_size = cfg->rb_size,
+			.mb_head_ptr_reg = REG_X2I_HEAD,
+			.mb_tail_ptr_reg = REG_X2I_TAIL,
+		},
+		.i2x = {
+			.rb_start_addr = cfg->rb_size,
+			.rb_size = cfg->rb_size,
+			.mb_head_ptr_reg = REG_I2X_HEAD,
+			.mb_tail_ptr_reg = REG_I2X_TAIL,
+		},
+		.intr_reg = REG_IOHUB,
+		.msix_id = TEST_MSIX_ID,
+	};
+
+	return xdna_mailbox_create_channel(mb, &info, cfg->poll ?
+					   MB_CHANNEL_USER_POLL : MB_CHANNEL_USER_NORMAL);
+}
+
+static u32 echo_word(u32 seq, u32 i)
+{
+	return (seq * 2654435761U) ^ i;
+}
+
+/* Random sizes are a function of the sequence number, the checker needs no state */
+static u32 echo_size(u32 seq)
+{
+	u32 x;
+
+	if (!echo.random)
+		return echo.payload;
+
+	/* lowbias32 hash */
+	x = seq ^ echo.seed;
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return (x % (echo.payload / sizeof(u32)) + 1) * sizeof(u32);
+}
+
+static int echo_notify(void *handle, void __iomem *data, size_t size)
+{
+	u32 seq = (uintptr_t)handle;
+	const u32 *words = data;
+	u32 i;
+
+	if (!data) {
+		__atomic_add_fetch(&echo.aborted, 1, __ATOMIC_RELAXED);
+		return 0;
+	}
+
+	if (size != echo_size(seq))
+		goto bad;
+	for (i = 0; i < size / sizeof(u32); i++) {
+		if (words[i] != echo_word(seq, i))
+			goto bad;
+	}
+	__atomic_add_fetch(&echo.completed, 1, __ATOMIC_RELEASE);
+	return 0;
+
+bad:
+	__atomic_add_fetch(&echo.bad, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&echo.completed, 1, __ATOMIC_RELEASE);
+	return -EINVAL;
+}
+
+/* Wait until @target responses arrived, the firmware model failed or no progress */
+static int echo_wait(struct fw_model *fw, u64 target)
+{
+	u64 done, last = 0, since = 0;
+	int ret;
+
+	for (;;) {
+		done = __atomic_load_n(&echo.completed, __ATOMIC_ACQUIRE);
+		if (done >= target)
+			return 0;
+
+		ret = __atomic_load_n(&fw->error, __ATOMIC_ACQUIRE);
+		if (ret)
+			return ret;
+
+		if (!since || done != last) {
+			last = done;
+			since = shim_now_ns();
+		} else if (shim_now_ns() - since > TEST_STALL_NS) {
+			fprintf(stderr, "No response for %llds, %lld of %lld done\n",
+				TEST_STALL_NS / 1000000000, done, target);
+			return -ETIMEDOUT;
+		}
+		sched_yield();
+	}
+}
+
+static bool hog_stop;
+
+/* Keeps a CPU busy, the completion path has to compete with it */
+static void *hog_thread(void *data)
+{
+	while (!__atomic_load_n(&hog_stop, __ATOMIC_RELAXED))
+		;
+	return NULL;
+}
+
+static int run_echo(struct test_config *cfg)
+{
+	struct pci_dev pdev = { .dev = { .name = "mailbox_test", .verbose = cfg->verbose } };
+	u32 words = cfg->payload / sizeof(u32);
+	u32 flags = cfg->more ? XDNA_MAILBOX_SEND_MORE : 0;
+	struct xdna_mailbox_chann_stats stats;
+	struct xdna_mailbox_msg *msgs;
+	struct mailbox_channel *chann;
+	struct xdna_mailbox_res res;
+	unsigned long kmallocs, cache_allocs, doorbells;
+	u64 lat_cnt, lat_sum;
+	struct fw_model fw = { 0 };
+	pthread_t *hogs = NULL;
+	struct mailbox *mb;
+	u32 *buf, seq, cnt, size, i, j;
+	u64 start, dur, done;
+	int ret;
+
+	buf = calloc(cfg->batch * words, sizeof(u32));
+	msgs = calloc(cfg->batch, sizeof(*msgs));
+	if (!buf || !msgs) {
+		ret = -ENOMEM;
+		goto free_buf;
+	}
+
+	ret = fw_start(&fw, cfg);
+	if (ret)
+		goto free_buf;
+
+	res = (struct xdna_mailbox_res) {
+		.ringbuf_base = fw.ringbuf,
+		.ringbuf_size = 2 * cfg->rb_size,
+		.mbox_base = fw.regs,
+		.mbox_size = MBOX_REG_SIZE,
+		.name = "mailbox_test",
+	};
+	mb = xdna_mailbox_create(&pdev.dev, &res);
+	if (!mb) {
+		ret = -ENOMEM;
+		goto stop_fw;
+	}
+
+	chann = test_create_channel(mb, &fw, cfg);
+	if (!chann) {
+		ret = -EINVAL;
+		goto destroy_mb;
+	}
+
+	hogs = calloc(cfg->hogs, sizeof(*hogs));
+	for (i = 0; hogs && i < cfg->hogs; i++)
+		pthread_create(&hogs[i], NULL, hog_thread, NULL);
+
+	memset(&echo, 0, sizeof(echo));
+	echo.payload = cfg->payload;
+	echo.random = cfg->mode == MODE_RANDOM;
+	echo.seed = cfg->seed;
+	shim_doorbell = fw_reg(&fw, REG_X2I_TAIL);
+	kmallocs = shim_kmalloc_cnt;
+	cache_allocs = shim_cache_alloc_cnt;
+	doorbells = shim_doorbell_cnt;
+	lat_cnt = shim_rx_latency_cnt;
+	lat_sum = shim_rx_latency_sum;
+	shim_rx_latency_max = 0;
+	start = shim_now_ns();
+	for (seq = 0; seq < cfg->nmsgs; seq += ret) {
+		cnt = min(cfg->batch, cfg->nmsgs - seq);
+		ret = seq + cnt > cfg->window ? echo_wait(&fw, seq + cnt - cfg->window) : 0;
+		if (ret)
+			break;
+
+		for (i = 0; i < cnt; i++) {
+			size = echo_size(seq + i);
+			for (j = 0; j < size / sizeof(u32); j++)
+				buf[i * words + j] = echo_word(seq + i, j);
+			msgs[i] = (struct xdna_mailbox_msg) {
+				.opcode = TEST_OPCODE,
+				.handle = (void *)(uintptr_t)(seq + i),
+				.notify_cb = echo_notify,
+				.send_data = (u8 *)&buf[i * words],
+				.send_size = size,
+			};
+		}
+
+		/*
+		 * Part of the batch may be sent when the ring is full. The ring
+		 * only drains as responses come back, wait for one more than had
+		 * arrived before the send then. If all of them had, the ring has
+		 * drained since and the send goes again at once.
+		 */
+		for (;;) {
+			done = __atomic_load_n(&echo.completed, __ATOMIC_ACQUIRE);
+			ret = xdna_mailbox_send_msgs(chann, msgs, cnt, flags, 0);
+			if (ret != -ENOSPC)
+				break;
+			ret = done < seq ? echo_wait(&fw, done + 1) : 0;
+			if (ret)
+				break;
+		}
+		if (ret < 0) {
+			fprintf(stderr, "Send msg %d failed, ret %d\n", seq, ret);
+			break;
+		}
+	}
+	if (ret >= 0)
+		ret = echo_wait(&fw, seq);
+	dur = shim_now_ns() - start;
+	kmallocs = shim_kmalloc_cnt - kmallocs;
+	cache_allocs = shim_cache_alloc_cnt - cache_allocs;
+	doorbells = shim_doorbell_cnt - doorbells;
+	lat_cnt = shim_rx_latency_cnt - lat_cnt;
+	lat_sum = shim_rx_latency_sum - lat_sum;
+	xdna_mailbox_get_stats(chann, &stats);
+
+	__atomic_store_n(&hog_stop, true, __ATOMIC_RELAXED);
+	for (i = 0; hogs && i < cfg->hogs; i++)
+		pthread_join(hogs[i], NULL);
+	free(hogs);
+
+	xdna_mailbox_stop_channel(chann);
+	xdna_mailbox_destroy_channel(chann);
+
+	if (!ret && (echo.bad || echo.aborted)) {
+		fprintf(stderr, "%lld bad responses, %lld aborted\n", echo.bad, echo.aborted);
+		ret = -EIO;
+	}
+
+	printf("%s %s: %d msgs, %s%d bytes, window %d, batch %d%s, %.0f msgs/sec, ",
+	       echo.random ? "Random" : "Echo", cfg->poll ? "poll" : "irq", seq,
+	       echo.random ? "up to " : "", cfg->payload, cfg->window, cfg->batch,
+	       cfg->more ? " held" : "", dur ? seq * 1e9 / dur : 0);
+	printf("%.3f kmalloc/msg, %.3f cache alloc/msg, %.2f msgs/doorbell\n",
+	       seq ? (double)kmallocs / seq : 0, seq ? (double)cache_allocs / seq : 0,
+	       doorbells ? (double)seq / doorbells : 0);
+	printf("Rx %s: %.3f irqs/msg, %.2f msgs/wakeup, %.2f polls/wakeup",
+	       cfg->poll ? "poll" : mailbox_irq_thread ? "irq thread" :
+	       mailbox_napi ? "napi" : "workqueue",
+	       stats.msgs ? (double)stats.irqs / stats.msgs : 0,
+	       stats.wakeups ? (double)stats.msgs / stats.wakeups : 0,
+	       stats.wakeups ? (double)stats.polls / stats.wakeups : 0);
+	if (lat_cnt)
+		printf(", irq to notify avg %.1f us max %.1f us", lat_sum / 1e3 / lat_cnt,
+		       shim_rx_latency_max / 1e3);
+	printf("\n");
+	if (echo.random)
+		printf("Ring wraps: %lld X2I, %lld I2X, seed %d\n",
+		       fw.x2i_wraps, fw.i2x_wraps, cfg->seed);
+
+destroy_mb:
+	xdna_mailbox_destroy(mb);
+stop_fw:
+	fw_stop(&fw);
+free_buf:
+	free(msgs);
+	free(buf);
+	return ret;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [options]\n", prog);
+	printf("  -m <mode>   echo (default), random\n");
+	printf("  -n <msgs>   Number of messages (default 1000000)\n");
+	printf("  -w <num>    Messages in flight (default 16)\n");
+	printf("  -B <num>    Messages per send call (default 1)\n");
+	printf("  -M          Hold the tail after every send call\n");
+	printf("  -b <bytes>  Payload size, maximum for random, multiple of 4 (default 32)\n");
+	printf("  -r <bytes>  Ring buffer size, power of 2 (default 8192)\n");
+	printf("  -p          Use a polling channel\n");
+	printf("  -s <seed>   Seed of the random sizes (default 1)\n");
+	printf("  -N          Complete in the poll thread, not the rx workqueue\n");
+	printf("  -T          Complete in a threaded IRQ handler\n");
+	printf("  -L <num>    Threads spinning on a CPU each during the test (default 0)\n");
+	printf("  -S <us>     Longest spin of the poll thread (default %d)\n",
+	       mailbox_napi_spin_us);
+	printf("  -v          Verbose\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct test_config cfg = {
+		.mode = MODE_ECHO,
+		.nmsgs = 1000000,
+		.window = 16,
+		.payload = 32,
+		.rb_size = 8192,
+		.batch = 1,
+		.seed = 1,
+	};
+	int ret, c;
+
+	while ((c = getopt(argc, argv, "m:n:w:B:Mb:r:ps:NTS:L:vh")) != -1) {
+		switch (c) {
+		case 'm':
+			if (!strcmp(optarg, "echo")) {
+				cfg.mode = MODE_ECHO;
+			} else if (!strcmp(optarg, "random")) {
+				cfg.mode = MODE_RANDOM;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'n':
+			cfg.nmsgs = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			cfg.window = strtoul(optarg, NULL, 0);
+			break;
+		case 'B':
+			cfg.batch = strtoul(optarg, NULL, 0);
+			break;
+		case 'M':
+			cfg.more = true;
+			break;
+		case 'b':
+			cfg.payload = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			cfg.rb_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			cfg.poll = true;
+			break;
+		case 's':
+			cfg.seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'N':
+			mailbox_napi = true;
+			break;
+		case 'T':
+			mailbox_irq_thread = true;
+			break;
+		case 'L':
+			cfg.hogs = strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			mailbox_napi_spin_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			cfg.verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!cfg.payload || !IS_ALIGNED(cfg.payload, 4) ||
+	    cfg.payload + sizeof(struct fw_msg_header) > cfg.rb_size / 2) {
+		fprintf(stderr, "Invalid payload size %d\n", cfg.payload);
+		return 1;
+	}
+	if (!is_power_of_2(cfg.rb_size)) {
+		fprintf(stderr, "Invalid ring buffer size %d\n", cfg.rb_size);
+		return 1;
+	}
+	/* The mailbox has 256 message IDs */
+	if (!cfg.window || cfg.window > 256) {
+		fprintf(stderr, "Invalid window %d\n", cfg.window);
+		return 1;
+	}
+	if (!cfg.batch || cfg.batch > cfg.window) {
+		fprintf(stderr, "Invalid batch %d\n", cfg.batch);
+		return 1;
+	}
+
+	ret = run_echo(&cfg);
+
+	printf("%s\n", ret ? "FAILED" : "PASSED");
+	return ret ? 1 : 0;
+}
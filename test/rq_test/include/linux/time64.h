@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#ifndef _RQ_TEST_LINUX_TIME64_H_
+#define _RQ_TEST_LINUX_TIME64_H_
+
+#include "kernel_shim.h"
+
+#endif /* _RQ_TEST_LINUX_TIME64_H_ */
@@ -0,0 +1,1197 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+/*
+ * User space harness for the AIE2 context runqueue selection
+ * (aie2_prio_list.c) and deadline class (aie2_deadline.c).
+ *
+ * The sched, dispatch and yield work handlers of aie2_ctx_runqueue.c are
+ * modelled on top of a stubbed, single threaded workqueue. Each model runs
+ * twice, once picking contexts from the priority lists and once with the
+ * previous linear list walks, from the same random job submit and complete
+ * sequence. Test modes,
+ *
+ * check: The connect, block, keep and stop decisions of both runs must be
+ *	  identical, runqueue invariants are checked after every step.
+ * bench: Hundreds of contexts competing for the connect limit, report the
+ *	  time spent in the work handlers per step for both runs.
+ * edf:   Synthetic camera frame arrivals, with jitter, next to batch jobs at
+ *	  realtime and normal priority, simulated in 1 ms ticks. Contexts
+ *	  are admitted to the deadline class first, then the frame deadline
+ *	  misses are reported with the class off and on.
+ *
+ * Check mode also runs the minimum residency (aie2_residency.c) through
+ * scripted switch costs, it must grow, stay, and decay as expected.
+ */
+
+#include <getopt.h>
+#include <time.h>
+
+#include "aie2_deadline.h"
+#include "aie2_prio_list.h"
+#include "aie2_residency.h"
+
+#define NUM_PRIORITY	AIE2_PRIO_LEVELS
+#define IDLE_YIELD_PERCENT	5
+#define NO_DEADLINE	U64_MAX
+#define FRAME_QUEUE	16
+
+enum test_mode {
+	MODE_CHECK,
+	MODE_BENCH,
+	MODE_EDF,
+};
+
+enum ctx_state {
+	CTX_STATE_DISCONNECTED,
+	CTX_STATE_DISPATCHED,
+	CTX_STATE_CONNECTED,
+	CTX_STATE_DISCONNECTING,
+};
+
+enum rq_event {
+	EV_CONNECT,
+	EV_BLOCK,
+	EV_KEEP,
+	EV_STOP,
+};
+
+struct test_config {
+	enum test_mode	mode;
+	u32		nctx;
+	u32		hwctx_limit;
+	u32		nops;
+	u32		seed;
+	u32		switch_ms;
+	u32		jitter_ms;
+	int		verbose;
+};
+
+/* Stubbed workqueue, ordered and run to empty after every step */
+struct test_work {
+	struct list_head	entry;
+	void			(*func)(struct test_work *work);
+	bool			pending;
+};
+
+static struct list_head test_wq = LIST_HEAD_INIT(test_wq);
+
+static void init_work(struct test_work *work, void (*func)(struct test_work *work))
+{
+	INIT_LIST_HEAD(&work->entry);
+	work->func = func;
+	work->pending = false;
+}
+
+static bool queue_work(struct test_work *work)
+{
+	if (work->pending)
+		return false;
+
+	work->pending = true;
+	list_add_tail(&work->entry, &test_wq);
+	return true;
+}
+
+static void drain_work(void)
+{
+	struct test_work *work;
+
+	while (!list_empty(&test_wq)) {
+		work = list_first_entry(&test_wq, struct test_work, entry);
+		list_del_init(&work->entry);
+		work->pending = false;
+		work->func(work);
+	}
+}
+
+struct test_rq;
+
+struct test_ctx {
+	u32			id;
+	u32			priority; /* 1 is the highest, as qos.priority */
+	enum ctx_state		status;
+	bool			should_block;
+	bool			busy; /* One job outstanding */
+	bool			waiting; /* Submitted a job, waits for connect */
+	struct list_head	entry;
+	struct list_head	prio_entry;
+	struct test_work	dispatch_work;
+	struct test_work	yield_work;
+	struct test_rq		*rq;
+
+	/* Deadline simulation, times in ms */
+	const char		*name;
+	struct aie2_dl_param	dl;
+	u64			deadline;
+	u32			period; /* 0 for back to back batch jobs */
+	u32			exec;
+	u32			remaining;
+	u64			next_arrival;
+	u64			arrival[FRAME_QUEUE];
+	u32			frames;
+	u64			done;
+	u64			missed;
+	u64			dropped;
+};
+
+/* What the work handlers need from the runqueue lists */
+struct rq_ops {
+	const char *name;
+	void (*dispatch)(struct test_rq *rq, struct test_ctx *ctx);
+	struct test_ctx *(*select_next)(struct test_rq *rq, struct test_ctx *ctx);
+	void (*start)(struct test_rq *rq, struct test_ctx *ctx);
+	void (*connected)(struct test_rq *rq, struct test_ctx *ctx);
+	struct test_ctx *(*select_block)(struct test_rq *rq, struct test_ctx *next);
+	void (*block)(struct test_rq *rq, struct test_ctx *ctx);
+	void (*unblock)(struct test_rq *rq, struct test_ctx *ctx);
+	void (*stop)(struct test_rq *rq, struct test_ctx *ctx);
+	bool (*runqueue_empty)(struct test_rq *rq);
+};
+
+struct test_rq {
+	const struct rq_ops	*ops;
+	struct list_head	conn_list;
+	struct list_head	disconn_list;
+
+	/* Priority lists, as aie2_ctx_rq */
+	struct aie2_prio_list	runqueue;
+	struct aie2_prio_list	conn_prio;
+
+	/* Linear lists, as before the priority lists */
+	struct list_head	lin_q[NUM_PRIORITY];
+	u32			lin_cnt[NUM_PRIORITY];
+	u32			lin_total;
+
+	u32			hwctx_cnt;
+	u32			hwctx_limit;
+	struct test_work	sched_work;
+
+	/* Deadline class on, and the number of contexts admitted to it */
+	bool			edf;
+	u32			dl_cnt;
+	u32			switch_ms;
+
+	struct test_ctx		*ctx;
+	u32			nctx;
+	u32			*trace;
+	u32			trace_len;
+	u32			trace_size;
+	u64			work_ns;
+	int			verbose;
+};
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void rq_trace(struct test_rq *rq, enum rq_event ev, struct test_ctx *ctx)
+{
+	static const char * const names[] = { "connect", "block", "keep", "stop" };
+
+	if (rq->verbose)
+		printf("%s: %s ctx %d prio %d\n", rq->ops->name, names[ev], ctx->id,
+		       ctx->priority);
+	if (!rq->trace)
+		return;
+
+	if (rq->trace_len == rq->trace_size) {
+		rq->trace_size = rq->trace_size ? rq->trace_size * 2 : 4096;
+		rq->trace = realloc(rq->trace, rq->trace_size * sizeof(*rq->trace));
+		if (!rq->trace) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+	rq->trace[rq->trace_len++] = (ev << 24) | ctx->id;
+}
+
+static inline u32 ctx_prio_level(struct test_ctx *ctx)
+{
+	return ctx->priority - 1;
+}
+
+static u64 ctx_deadline(struct test_ctx *ctx)
+{
+	if (!ctx->dl.deadline_ms)
+		return NO_DEADLINE;
+
+	if (!ctx->busy && !ctx->waiting)
+		return NO_DEADLINE;
+
+	return ctx->deadline;
+}
+
+static bool ctx_deadline_before(struct list_head *a, struct list_head *b)
+{
+	return ctx_deadline(list_entry(a, struct test_ctx, entry)) <
+		ctx_deadline(list_entry(b, struct test_ctx, entry));
+}
+
+static bool rq_edf(struct test_rq *rq)
+{
+	return rq->edf && rq->dl_cnt;
+}
+
+/* Priority lists, same as aie2_ctx_runqueue.c */
+static void prio_dispatch(struct test_rq *rq, struct test_ctx *ctx)
+{
+	list_del(&ctx->entry);
+	if (rq_edf(rq) && ctx->priority == 1)
+		aie2_prio_list_add_ordered(&rq->runqueue, &ctx->entry, ctx_prio_level(ctx),
+					   ctx_deadline_before);
+	else
+		aie2_prio_list_add_tail(&rq->runqueue, &ctx->entry, ctx_prio_level(ctx));
+}
+
+static struct test_ctx *prio_select_next(struct test_rq *rq, struct test_ctx *ctx)
+{
+	struct list_head *node;
+
+	if (ctx)
+		node = aie2_prio_list_next(&rq->runqueue, &ctx->entry, ctx_prio_level(ctx));
+	else
+		node = aie2_prio_list_first(&rq->runqueue, 0);
+
+	return node ? list_entry(node, struct test_ctx, entry) : NULL;
+}
+
+static void prio_start(struct test_rq *rq, struct test_ctx *ctx)
+{
+	aie2_prio_list_del(&rq->runqueue, &ctx->entry, ctx_prio_level(ctx));
+}
+
+static void prio_connected(struct test_rq *rq, struct test_ctx *ctx)
+{
+	list_add_tail(&ctx->entry, &rq->conn_list);
+	aie2_prio_list_add(&rq->conn_prio, &ctx->prio_entry, ctx_prio_level(ctx));
+}
+
+static struct test_ctx *prio_select_block(struct test_rq *rq, struct test_ctx *next)
+{
+	struct test_ctx *ctx, *victim = NULL;
+	struct list_head *node;
+	u64 latest;
+
+	node = aie2_prio_list_last(&rq->conn_prio, ctx_prio_level(next));
+	if (!node)
+		return NULL;
+
+	ctx = list_entry(node, struct test_ctx, prio_entry);
+	if (!rq_edf(rq) || ctx_prio_level(ctx) != ctx_prio_level(next))
+		return ctx;
+
+	latest = 0;
+	list_for_each_entry_reverse(ctx, &rq->conn_prio.q[ctx_prio_level(next)], prio_entry) {
+		if (!victim || ctx_deadline(ctx) > latest) {
+			victim = ctx;
+			latest = ctx_deadline(ctx);
+		}
+	}
+
+	if (latest != NO_DEADLINE && latest <= ctx_deadline(next))
+		return NULL;
+
+	return victim;
+}
+
+static void prio_block(struct test_rq *rq, struct test_ctx *ctx)
+{
+	aie2_prio_list_del(&rq->conn_prio, &ctx->prio_entry, ctx_prio_level(ctx));
+}
+
+static void prio_unblock(struct test_rq *rq, struct test_ctx *ctx)
+{
+	aie2_prio_list_add_tail(&rq->conn_prio, &ctx->prio_entry, ctx_prio_level(ctx));
+}
+
+static void prio_stop(struct test_rq *rq, struct test_ctx *ctx)
+{
+	if (!list_empty(&ctx->prio_entry))
+		aie2_prio_list_del(&rq->conn_prio, &ctx->prio_entry, ctx_prio_level(ctx));
+	list_move_tail(&ctx->entry, &rq->disconn_list);
+}
+
+static bool prio_runqueue_empty(struct test_rq *rq)
+{
+	return aie2_prio_list_empty(&rq->runqueue);
+}
+
+static const struct rq_ops prio_ops = {
+	.name = "prio",
+	.dispatch = prio_dispatch,
+	.select_next = prio_select_next,
+	.start = prio_start,
+	.connected = prio_connected,
+	.select_block = prio_select_block,
+	.block = prio_block,
+	.unblock = prio_unblock,
+	.stop = prio_stop,
+	.runqueue_empty = prio_runqueue_empty,
+};
+
+/*
+ * Linear lists. The connected list is ordered by priority from high to low,
+ * newest first within a priority, blocked contexts stay on it.
+ */
+static void lin_dispatch(struct test_rq *rq, struct test_ctx *ctx)
+{
+	list_move_tail(&ctx->entry, &rq->lin_q[ctx_prio_level(ctx)]);
+	rq->lin_cnt[ctx_prio_level(ctx)]++;
+	rq->lin_total++;
+}
+
+static struct test_ctx *lin_select_next(struct test_rq *rq, struct test_ctx *ctx)
+{
+	int i;
+
+	if (!rq->lin_total)
+		return NULL;
+
+	i = 0;
+	if (ctx) {
+		if (list_is_last(&ctx->entry, &rq->lin_q[ctx_prio_level(ctx)]))
+			i = ctx->priority;
+		else
+			return list_next_entry(ctx, entry);
+	}
+
+	for (; i < NUM_PRIORITY; i++) {
+		if (rq->lin_cnt[i])
+			return list_first_entry(&rq->lin_q[i], struct test_ctx, entry);
+	}
+
+	return NULL;
+}
+
+static void lin_start(struct test_rq *rq, struct test_ctx *ctx)
+{
+	list_del_init(&ctx->entry);
+	rq->lin_cnt[ctx_prio_level(ctx)]--;
+	rq->lin_total--;
+}
+
+static void lin_connected(struct test_rq *rq, struct test_ctx *ctx)
+{
+	struct test_ctx *curr;
+	struct list_head *pos = &rq->conn_list;
+
+	list_for_each_entry(curr, &rq->conn_list, entry) {
+		if (curr->priority < ctx->priority)
+			continue;
+
+		pos = &curr->entry;
+		break;
+	}
+	list_add_tail(&ctx->entry, pos);
+}
+
+static struct test_ctx *lin_select_block(struct test_rq *rq, struct test_ctx *next)
+{
+	struct test_ctx *ctx;
+
+	list_for_each_entry_reverse(ctx, &rq->conn_list, entry) {
+		if (ctx->priority < next->priority)
+			continue;
+
+		if (ctx->should_block)
+			continue;
+
+		return ctx;
+	}
+
+	return NULL;
+}
+
+static void lin_block(struct test_rq *rq, struct test_ctx *ctx)
+{
+}
+
+/* Back as the oldest of its priority */
+static void lin_unblock(struct test_rq *rq, struct test_ctx *ctx)
+{
+	struct test_ctx *curr;
+	struct list_head *pos = &rq->conn_list;
+
+	list_del(&ctx->entry);
+	list_for_each_entry(curr, &rq->conn_list, entry) {
+		if (curr->priority <= ctx->priority)
+			continue;
+
+		pos = &curr->entry;
+		break;
+	}
+	list_add_tail(&ctx->entry, pos);
+}
+
+static void lin_stop(struct test_rq *rq, struct test_ctx *ctx)
+{
+	list_move_tail(&ctx->entry, &rq->disconn_list);
+}
+
+static bool lin_runqueue_empty(struct test_rq *rq)
+{
+	return !rq->lin_total;
+}
+
+static const struct rq_ops lin_ops = {
+	.name = "linear",
+	.dispatch = lin_dispatch,
+	.select_next = lin_select_next,
+	.start = lin_start,
+	.connected = lin_connected,
+	.select_block = lin_select_block,
+	.block = lin_block,
+	.unblock = lin_unblock,
+	.stop = lin_stop,
+	.runqueue_empty = lin_runqueue_empty,
+};
+
+/* The job waiting for connect goes, connecting costs switch_ms */
+static void ctx_start_job(struct test_ctx *ctx, u32 cost)
+{
+	ctx->busy = true;
+	ctx->waiting = false;
+	ctx->remaining = ctx->exec + cost;
+}
+
+/* Work handlers, following aie2_ctx_runqueue.c with connect never failing */
+static void rq_ctx_stop(struct test_rq *rq, struct test_ctx *ctx)
+{
+	if (ctx->status != CTX_STATE_CONNECTED && ctx->status != CTX_STATE_DISCONNECTING)
+		return;
+
+	rq->ops->stop(rq, ctx);
+	ctx->should_block = false;
+	rq->hwctx_cnt--;
+	ctx->status = CTX_STATE_DISCONNECTED;
+	rq_trace(rq, EV_STOP, ctx);
+	/* A submit that came in while disconnecting waits for connect again */
+	if (ctx->waiting)
+		queue_work(&ctx->dispatch_work);
+}
+
+static void rq_sched_work(struct test_work *work)
+{
+	struct test_rq *rq = container_of(work, struct test_rq, sched_work);
+	struct test_ctx *next;
+	struct test_ctx *curr;
+
+	do {
+		next = rq->ops->select_next(rq, NULL);
+		if (!next)
+			break;
+
+		if (rq->hwctx_cnt >= rq->hwctx_limit)
+			break;
+
+		rq->ops->start(rq, next);
+		rq->ops->connected(rq, next);
+		rq->hwctx_cnt++;
+		next->status = CTX_STATE_CONNECTED;
+		ctx_start_job(next, rq->switch_ms);
+		rq_trace(rq, EV_CONNECT, next);
+	} while (1);
+
+	if (rq->hwctx_cnt < rq->hwctx_limit)
+		return;
+
+	while (next) {
+		curr = rq->ops->select_block(rq, next);
+		if (!curr)
+			break;
+
+		curr->should_block = true;
+		rq->ops->block(rq, curr);
+		rq_trace(rq, EV_BLOCK, curr);
+		if (!curr->busy) {
+			curr->status = CTX_STATE_DISCONNECTING;
+			queue_work(&curr->yield_work);
+		}
+
+		next = rq->ops->select_next(rq, next);
+	}
+}
+
+static void rq_dispatch_work(struct test_work *work)
+{
+	struct test_ctx *ctx = container_of(work, struct test_ctx, dispatch_work);
+	struct test_rq *rq = ctx->rq;
+
+	if (ctx->status != CTX_STATE_DISCONNECTED)
+		return;
+
+	rq->ops->dispatch(rq, ctx);
+	ctx->status = CTX_STATE_DISPATCHED;
+	queue_work(&rq->sched_work);
+}
+
+static void rq_yield_work(struct test_work *work)
+{
+	struct test_ctx *ctx = container_of(work, struct test_ctx, yield_work);
+	struct test_rq *rq = ctx->rq;
+
+	if (ctx->busy)
+		return;
+
+	if (rq->ops->runqueue_empty(rq)) {
+		if (ctx->should_block)
+			rq->ops->unblock(rq, ctx);
+		ctx->should_block = false;
+		ctx->status = CTX_STATE_CONNECTED;
+		rq_trace(rq, EV_KEEP, ctx);
+		if (ctx->waiting)
+			ctx_start_job(ctx, 0);
+		return;
+	}
+
+	ctx->should_block = false;
+	rq_ctx_stop(rq, ctx);
+	queue_work(&rq->sched_work);
+}
+
+static int rq_init(struct test_rq *rq, const struct rq_ops *ops, struct test_config *cfg,
+		   bool trace)
+{
+	u32 i;
+
+	memset(rq, 0, sizeof(*rq));
+	rq->ops = ops;
+	rq->hwctx_limit = cfg->hwctx_limit;
+	rq->verbose = cfg->verbose;
+	INIT_LIST_HEAD(&rq->conn_list);
+	INIT_LIST_HEAD(&rq->disconn_list);
+	aie2_prio_list_init(&rq->runqueue);
+	aie2_prio_list_init(&rq->conn_prio);
+	for (i = 0; i < NUM_PRIORITY; i++)
+		INIT_LIST_HEAD(&rq->lin_q[i]);
+	init_work(&rq->sched_work, rq_sched_work);
+
+	rq->ctx = calloc(cfg->nctx, sizeof(*rq->ctx));
+	if (!rq->ctx)
+		return -ENOMEM;
+	rq->nctx = cfg->nctx;
+	if (trace) {
+		/* Non NULL so that rq_trace() records */
+		rq->trace = malloc(4096 * sizeof(*rq->trace));
+		if (!rq->trace) {
+			free(rq->ctx);
+			return -ENOMEM;
+		}
+		rq->trace_size = 4096;
+	}
+
+	/* Priorities are spread the same way for every run of a seed */
+	srand(cfg->seed);
+	for (i = 0; i < rq->nctx; i++) {
+		struct test_ctx *ctx = &rq->ctx[i];
+
+		ctx->id = i;
+		ctx->priority = 1 + rand() % NUM_PRIORITY;
+		ctx->status = CTX_STATE_DISCONNECTED;
+		ctx->rq = rq;
+		INIT_LIST_HEAD(&ctx->prio_entry);
+		init_work(&ctx->dispatch_work, rq_dispatch_work);
+		init_work(&ctx->yield_work, rq_yield_work);
+		list_add_tail(&ctx->entry, &rq->disconn_list);
+	}
+
+	return 0;
+}
+
+static void rq_fini(struct test_rq *rq)
+{
+	free(rq->trace);
+	free(rq->ctx);
+}
+
+/*
+ * One random step of the user side. A disconnected context submits and waits
+ * for connect, a connected one completes its job or submits another, now and
+ * then an idle one is asked to yield, like aie2_rq_handle_idle_ctx().
+ */
+static void rq_step(struct test_rq *rq)
+{
+	struct test_ctx *ctx = &rq->ctx[rand() % rq->nctx];
+	u64 start;
+
+	switch (ctx->status) {
+	case CTX_STATE_DISCONNECTED:
+		queue_work(&ctx->dispatch_work);
+		break;
+	case CTX_STATE_DISPATCHED:
+		break;
+	case CTX_STATE_CONNECTED:
+	case CTX_STATE_DISCONNECTING:
+		if (ctx->busy) {
+			ctx->busy = false;
+			if (ctx->should_block) {
+				ctx->status = CTX_STATE_DISCONNECTING;
+				queue_work(&ctx->yield_work);
+			}
+		} else if (!ctx->should_block) {
+			if (rand() % 100 < IDLE_YIELD_PERCENT)
+				queue_work(&ctx->yield_work);
+			else
+				ctx->busy = true;
+		}
+		break;
+	}
+
+	start = now_ns();
+	drain_work();
+	rq->work_ns += now_ns() - start;
+}
+
+static int rq_check_invariants(struct test_rq *rq)
+{
+	u32 dispatched = 0, connected = 0, unblocked = 0;
+	u32 i, cnt = 0;
+	struct test_ctx *ctx;
+
+	for (i = 0; i < rq->nctx; i++) {
+		ctx = &rq->ctx[i];
+		if (ctx->status == CTX_STATE_DISPATCHED)
+			dispatched++;
+		if (ctx->status == CTX_STATE_CONNECTED ||
+		    ctx->status == CTX_STATE_DISCONNECTING) {
+			connected++;
+			if (!ctx->should_block)
+				unblocked++;
+		}
+	}
+
+	list_for_each_entry(ctx, &rq->conn_list, entry)
+		cnt++;
+
+	if (rq->hwctx_cnt > rq->hwctx_limit || rq->hwctx_cnt != connected ||
+	    cnt != connected) {
+		fprintf(stderr, "%s: %d connected, %d on list, limit %d\n",
+			rq->ops->name, rq->hwctx_cnt, cnt, rq->hwctx_limit);
+		return -EINVAL;
+	}
+
+	if (rq->ops != &prio_ops)
+		return 0;
+
+	if (rq->runqueue.total != dispatched || rq->conn_prio.total != unblocked) {
+		fprintf(stderr, "prio: runqueue %d, %d dispatched, conn %d, %d unblocked\n",
+			rq->runqueue.total, dispatched, rq->conn_prio.total, unblocked);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < NUM_PRIORITY; i++) {
+		if (!!rq->runqueue.cnt[i] != !!(rq->runqueue.map & BIT(i)) ||
+		    !!rq->conn_prio.cnt[i] != !!(rq->conn_prio.map & BIT(i))) {
+			fprintf(stderr, "prio: level %d count and bitmap disagree\n", i);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int run_check_one(struct test_config *cfg)
+{
+	struct test_rq prio, lin;
+	u32 i;
+	int ret;
+
+	ret = rq_init(&prio, &prio_ops, cfg, true);
+	if (ret)
+		return ret;
+	ret = rq_init(&lin, &lin_ops, cfg, true);
+	if (ret) {
+		rq_fini(&prio);
+		return ret;
+	}
+
+	srand(cfg->seed + 1);
+	for (i = 0; i < cfg->nops; i++) {
+		rq_step(&prio);
+		ret = rq_check_invariants(&prio);
+		if (ret)
+			goto out;
+	}
+
+	srand(cfg->seed + 1);
+	for (i = 0; i < cfg->nops; i++) {
+		rq_step(&lin);
+		ret = rq_check_invariants(&lin);
+		if (ret)
+			goto out;
+	}
+
+	if (prio.trace_len != lin.trace_len ||
+	    memcmp(prio.trace, lin.trace, prio.trace_len * sizeof(*prio.trace))) {
+		for (i = 0; i < prio.trace_len && i < lin.trace_len; i++) {
+			if (prio.trace[i] != lin.trace[i])
+				break;
+		}
+		fprintf(stderr, "Decision %d differs, prio 0x%x, linear 0x%x\n", i,
+			i < prio.trace_len ? prio.trace[i] : 0,
+			i < lin.trace_len ? lin.trace[i] : 0);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	printf("Check %4d contexts, limit %2d: %d steps, %d decisions identical\n",
+	       cfg->nctx, cfg->hwctx_limit, cfg->nops, prio.trace_len);
+out:
+	rq_fini(&lin);
+	rq_fini(&prio);
+	return ret;
+}
+
+static int run_check(struct test_config *cfg)
+{
+	static const u32 nctx[] = { 1, 8, 64, 300 };
+	static const u32 limit[] = { 1, 4, 16 };
+	struct test_config c = *cfg;
+	int ret;
+	u32 i, j;
+
+	for (i = 0; i < ARRAY_SIZE(nctx); i++) {
+		for (j = 0; j < ARRAY_SIZE(limit); j++) {
+			c.nctx = cfg->nctx ? cfg->nctx : nctx[i];
+			c.hwctx_limit = cfg->hwctx_limit ? cfg->hwctx_limit : limit[j];
+			ret = run_check_one(&c);
+			if (ret)
+				return ret;
+			if (cfg->hwctx_limit)
+				break;
+		}
+		if (cfg->nctx)
+			break;
+	}
+
+	return 0;
+}
+
+#define RES_EXPECT(cond) do {						\
+	if (!(cond)) {							\
+		fprintf(stderr, "%s:%d: %s failed, min residency %lld ns\n",	\
+			__func__, __LINE__, #cond, res.min_ns);		\
+		return -EINVAL;						\
+	}								\
+} while (0)
+
+/*
+ * res_windows() - Contexts yield after running run_ns, or the minimum
+ * residency if that is longer, and switching them costs switch_ns. Run that
+ * for nwin adaptation windows, returns how many changed the minimum.
+ */
+static u32 res_windows(struct aie2_residency *r, u64 switch_ns, u64 run_ns, u32 nwin)
+{
+	u32 changes = 0;
+	u32 i;
+
+	for (i = 0; i < nwin * AIE2_RESIDENCY_WINDOW; i++) {
+		if (aie2_residency_yielded(r, switch_ns, max(run_ns, r->min_ns)))
+			changes++;
+	}
+	return changes;
+}
+
+static int run_residency(void)
+{
+	struct aie2_residency res = { 0 };
+	u32 i;
+
+	/* Nothing changes before a window is complete */
+	for (i = 0; i < AIE2_RESIDENCY_WINDOW - 1; i++)
+		RES_EXPECT(!aie2_residency_yielded(&res, NSEC_PER_MSEC, NSEC_PER_MSEC));
+	RES_EXPECT(res.min_ns == 0);
+
+	/* Switching as long as running, grow to four switches at once */
+	RES_EXPECT(aie2_residency_yielded(&res, NSEC_PER_MSEC, NSEC_PER_MSEC));
+	RES_EXPECT(res.min_ns == 4 * NSEC_PER_MSEC);
+
+	/* A quarter of the residency is switching, that is stable */
+	RES_EXPECT(!res_windows(&res, NSEC_PER_MSEC, 0, 8));
+	RES_EXPECT(res.min_ns == 4 * NSEC_PER_MSEC);
+
+	/* Switching gets costlier, grow to four switches again, up to the cap */
+	RES_EXPECT(res_windows(&res, 10 * NSEC_PER_MSEC, 0, 8) == 1);
+	RES_EXPECT(res.min_ns == 40 * NSEC_PER_MSEC);
+	RES_EXPECT(res_windows(&res, 30 * NSEC_PER_MSEC, 0, 8) == 1);
+	RES_EXPECT(res.min_ns == 100 * NSEC_PER_MSEC);
+	RES_EXPECT(!res_windows(&res, 60 * NSEC_PER_MSEC, 0, 4));
+	RES_EXPECT(res.min_ns == 100 * NSEC_PER_MSEC);
+
+	/*
+	 * Cheap switches, the minimum halves until switching is more than a
+	 * sixteenth of it: 100 ms down to 390 us for 25 us switches.
+	 */
+	RES_EXPECT(res_windows(&res, 25 * NSEC_PER_USEC, 0, 16) == 8);
+	RES_EXPECT(res.min_ns == 100 * NSEC_PER_MSEC >> 8);
+	RES_EXPECT(!res_windows(&res, 25 * NSEC_PER_USEC, 0, 4));
+
+	/* Contexts running long anyway need no minimum */
+	RES_EXPECT(res_windows(&res, 25 * NSEC_PER_USEC, 10 * NSEC_PER_MSEC, 64));
+	RES_EXPECT(res.min_ns < NSEC_PER_USEC);
+
+	printf("Minimum residency growth and decay cases passed\n");
+	return 0;
+}
+
+static int run_bench_one(struct test_config *cfg, const struct rq_ops *ops, u64 *ns)
+{
+	struct test_rq rq;
+	u32 i;
+	int ret;
+
+	ret = rq_init(&rq, ops, cfg, false);
+	if (ret)
+		return ret;
+
+	srand(cfg->seed + 1);
+	for (i = 0; i < cfg->nops; i++)
+		rq_step(&rq);
+
+	*ns = rq.work_ns;
+	rq_fini(&rq);
+	return 0;
+}
+
+static int run_bench(struct test_config *cfg)
+{
+	static const u32 nctx[] = { 100, 200, 400, 800 };
+	struct test_config c = *cfg;
+	u64 prio_ns, lin_ns;
+	int ret;
+	u32 i;
+
+	printf("Bench %d steps, connect limit %d\n", cfg->nops, cfg->hwctx_limit);
+	printf("%10s %14s %14s\n", "contexts", "prio ns/step", "linear ns/step");
+	for (i = 0; i < ARRAY_SIZE(nctx); i++) {
+		c.nctx = cfg->nctx ? cfg->nctx : nctx[i];
+		ret = run_bench_one(&c, &prio_ops, &prio_ns);
+		if (ret)
+			return ret;
+		ret = run_bench_one(&c, &lin_ops, &lin_ns);
+		if (ret)
+			return ret;
+
+		printf("%10d %14.1f %14.1f\n", c.nctx, (double)prio_ns / cfg->nops,
+		       (double)lin_ns / cfg->nops);
+		if (cfg->nctx)
+			break;
+	}
+
+	return 0;
+}
+
+/* Contexts of the deadline simulation, nbatch is from -c */
+struct sim_class {
+	const char	*name;
+	u32		priority;
+	u32		fps;
+	u32		latency;
+	u32		exec;
+	u32		count;
+};
+
+static const struct sim_class sim_classes[] = {
+	{ "camera60",  1, 60, 0,  4, 1 },
+	{ "camera30",  1, 30, 0,  8, 2 },
+	{ "camera15",  1, 15, 0, 20, 1 },
+	{ "camera60l", 1, 60, 8,  3, 1 },
+	{ "overload",  1, 60, 0, 15, 1 },
+	{ "batch-rt",  1,  0, 0, 10, 3 },
+	{ "batch",     3,  0, 0, 10, 0 },
+};
+
+/*
+ * Admit the cameras to the deadline class the way aie2_rq_add() does, the
+ * rejected ones are not created at all.
+ */
+static int sim_init(struct test_rq *rq, struct test_config *cfg, bool edf, u32 *rejected)
+{
+	u32 total = 0, max_util = 0, nctx = 0;
+	struct test_config c = *cfg;
+	struct test_ctx *ctx;
+	u32 i, j, n;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(sim_classes); i++)
+		nctx += sim_classes[i].count ? sim_classes[i].count : cfg->nctx;
+
+	c.nctx = nctx;
+	ret = rq_init(rq, &prio_ops, &c, false);
+	if (ret)
+		return ret;
+
+	rq->edf = edf;
+	rq->switch_ms = cfg->switch_ms;
+	*rejected = 0;
+	n = 0;
+	for (i = 0; i < ARRAY_SIZE(sim_classes); i++) {
+		const struct sim_class *sc = &sim_classes[i];
+		u32 count = sc->count ? sc->count : cfg->nctx;
+
+		for (j = 0; j < count; j++) {
+
+			ctx = &rq->ctx[n++];
+			ctx->name = sc->name;
+			ctx->priority = sc->priority;
+			ctx->exec = sc->exec;
+			if (aie2_dl_param_init(&ctx->dl, sc->fps, sc->latency, sc->exec) ||
+			    (ctx->dl.deadline_ms &&
+			     !aie2_dl_admit(total, max_util, ctx->dl.util, rq->hwctx_limit))) {
+				/* Never created, priority 0 marks it */
+				(*rejected)++;
+				list_del(&ctx->entry);
+				ctx->priority = 0;
+				continue;
+			}
+
+			if (!ctx->dl.deadline_ms)
+				continue;
+
+			total += ctx->dl.util;
+			max_util = max(max_util, ctx->dl.util);
+			rq->dl_cnt++;
+			ctx->period = 1000 / sc->fps;
+			ctx->next_arrival = rand() % ctx->period;
+		}
+	}
+
+	return 0;
+}
+
+static void sim_submit(struct test_ctx *ctx, u64 now)
+{
+	if (ctx->dl.deadline_ms && (!ctx->busy || now > ctx->deadline))
+		ctx->deadline = now + ctx->dl.deadline_ms;
+
+	if (ctx->status == CTX_STATE_CONNECTED) {
+		ctx_start_job(ctx, 0);
+		return;
+	}
+
+	ctx->waiting = true;
+	queue_work(&ctx->dispatch_work);
+}
+
+static void sim_complete(struct test_ctx *ctx, u64 now)
+{
+	ctx->busy = false;
+	ctx->done++;
+	if (ctx->period) {
+		if (now > ctx->arrival[0] + ctx->dl.deadline_ms)
+			ctx->missed++;
+		memmove(ctx->arrival, ctx->arrival + 1, --ctx->frames * sizeof(ctx->arrival[0]));
+	}
+
+	/* As aie2_rq_yield() */
+	if (ctx->should_block) {
+		ctx->status = CTX_STATE_DISCONNECTING;
+		queue_work(&ctx->yield_work);
+	} else if (rq_edf(ctx->rq) && ctx->period && !ctx->frames &&
+		   !aie2_prio_list_empty(&ctx->rq->runqueue)) {
+		queue_work(&ctx->rq->sched_work);
+	}
+
+	if (!ctx->period || ctx->frames)
+		sim_submit(ctx, now);
+}
+
+static void sim_run(struct test_rq *rq, struct test_config *cfg)
+{
+	struct test_ctx *ctx;
+	u64 now;
+	u32 i;
+
+	for (i = 0; i < rq->nctx; i++) {
+		ctx = &rq->ctx[i];
+		if (ctx->priority && !ctx->period)
+			sim_submit(ctx, 0);
+	}
+	drain_work();
+
+	for (now = 0; now < cfg->nops; now++) {
+		for (i = 0; i < rq->nctx; i++) {
+			ctx = &rq->ctx[i];
+			if (!ctx->period || now != ctx->next_arrival)
+				continue;
+
+			ctx->next_arrival += ctx->period;
+			if (cfg->jitter_ms)
+				ctx->next_arrival += rand() % cfg->jitter_ms;
+			if (ctx->frames == FRAME_QUEUE) {
+				ctx->dropped++;
+				continue;
+			}
+			ctx->arrival[ctx->frames++] = now;
+			if (!ctx->busy && !ctx->waiting)
+				sim_submit(ctx, now);
+		}
+		drain_work();
+
+		for (i = 0; i < rq->nctx; i++) {
+			ctx = &rq->ctx[i];
+			if (!ctx->busy || --ctx->remaining)
+				continue;
+
+			sim_complete(ctx, now + 1);
+		}
+		drain_work();
+	}
+}
+
+static void sim_report(struct test_rq *rq)
+{
+	u64 done, missed, dropped;
+	const char *name;
+	u32 i, j, cnt;
+
+	printf("%-10s %8s %10s %10s %10s\n", "class", "contexts", "done", "missed", "dropped");
+	for (i = 0; i < rq->nctx; i = j) {
+		name = rq->ctx[i].name;
+		done = 0;
+		missed = 0;
+		dropped = 0;
+		cnt = 0;
+		for (j = i; j < rq->nctx && rq->ctx[j].name == name; j++) {
+			if (!rq->ctx[j].priority)
+				continue;
+			cnt++;
+			done += rq->ctx[j].done;
+			missed += rq->ctx[j].missed;
+			dropped += rq->ctx[j].dropped;
+		}
+		if (!cnt)
+			printf("%-10s %8s\n", name, "rejected");
+		else
+			printf("%-10s %8d %10lld %10lld %10lld\n", name, cnt, done, missed, dropped);
+	}
+}
+
+static int run_edf(struct test_config *cfg)
+{
+	struct test_rq rq;
+	u32 rejected;
+	int ret, i;
+
+	printf("Deadline simulation %d ms, connect limit %d, switch %d ms, jitter %d ms\n",
+	       cfg->nops, cfg->hwctx_limit, cfg->switch_ms, cfg->jitter_ms);
+	for (i = 0; i < 2; i++) {
+		srand(cfg->seed);
+		ret = sim_init(&rq, cfg, i, &rejected);
+		if (ret)
+			return ret;
+
+		printf("Deadline class %s, %d contexts admitted, %d rejected\n",
+		       i ? "on" : "off", rq.dl_cnt, rejected);
+		sim_run(&rq, cfg);
+		sim_report(&rq);
+		ret = rq_check_invariants(&rq);
+		rq_fini(&rq);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [options]\n", prog);
+	printf("  -m <mode>   check (default), bench or edf\n");
+	printf("  -c <num>    Number of contexts (default, check a matrix, bench 100 to 800)\n");
+	printf("              edf, normal priority batch contexts (default 8)\n");
+	printf("  -l <num>    Connect limit (default, check a matrix, bench 16, edf 2)\n");
+	printf("  -n <ops>    Number of steps, ms for edf (default 100000)\n");
+	printf("  -t <ms>     Context switch cost for edf (default 1)\n");
+	printf("  -j <ms>     Frame arrival jitter for edf (default 2)\n");
+	printf("  -s <seed>   Random seed (default 1)\n");
+	printf("  -v          Verbose\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct test_config cfg = {
+		.mode = MODE_CHECK,
+		.nops = 100000,
+		.seed = 1,
+		.switch_ms = 1,
+		.jitter_ms = 2,
+	};
+	int ret, c;
+
+	while ((c = getopt(argc, argv, "m:c:l:n:s:t:j:vh")) != -1) {
+		switch (c) {
+		case 'm':
+			if (!strcmp(optarg, "check")) {
+				cfg.mode = MODE_CHECK;
+			} else if (!strcmp(optarg, "bench")) {
+				cfg.mode = MODE_BENCH;
+			} else if (!strcmp(optarg, "edf")) {
+				cfg.mode = MODE_EDF;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'c':
+			cfg.nctx = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			cfg.hwctx_limit = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			cfg.nops = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			cfg.seed = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			cfg.switch_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'j':
+			cfg.jitter_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			cfg.verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 1;
+		}
+	}
+
+	if (cfg.nctx > (1 << 24)) {
+		fprintf(stderr, "Invalid context number %d\n", cfg.nctx);
+		return 1;
+	}
+
+	switch (cfg.mode) {
+	case MODE_BENCH:
+		if (!cfg.hwctx_limit)
+			cfg.hwctx_limit = 16;
+		ret = run_bench(&cfg);
+		break;
+	case MODE_EDF:
+		if (!cfg.nctx)
+			cfg.nctx = 8;
+		if (!cfg.hwctx_limit)
+			cfg.hwctx_limit = 2;
+		ret = run_edf(&cfg);
+		break;
+	default:
+		ret = run_check(&cfg);
+		if (!ret)
+			ret = run_residency();
+		break;
+	}
+
+	printf("%s\n", ret ? "FAILED" : "PASSED");
+	return ret ? 1 : 0;
+}
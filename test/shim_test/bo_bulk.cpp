@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2025, Advanced Micro Devices, Inc. All rights reserved.
+
+#include "drm_local/amdxdna_accel.h"
+
+#include "core/common/system.h"
+#include <cerrno>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include "speed.h"
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace xrt_core;
+using arg_type = const std::vector<uint64_t>;
+
+// Raw accel node of the device, the shim does not expose its fd
+class accel_fd {
+public:
+  accel_fd(device::id_type id)
+  {
+    char bdf[32];
+    auto info = get_bdf_info(id);
+
+    snprintf(bdf, sizeof(bdf), "%04x:%02x:%02x.%x",
+      std::get<0>(info), std::get<1>(info), std::get<2>(info), std::get<3>(info));
+    std::filesystem::path dir{std::string("/sys/bus/pci/devices/") + bdf + "/accel"};
+    for (auto& e : std::filesystem::directory_iterator(dir)) {
+      auto node = "/dev/accel/" + e.path().filename().string();
+      m_fd = open(node.c_str(), O_RDWR);
+      if (m_fd >= 0)
+        return;
+    }
+    throw std::runtime_error(std::string("No accel node for ") + bdf);
+  }
+
+  ~accel_fd()
+  {
+    close(m_fd);
+  }
+
+  int
+  ioctl(unsigned long cmd, void *arg) const
+  {
+    return ::ioctl(m_fd, cmd, arg) ? errno : 0;
+  }
+
+  void
+  close_bo(uint32_t handle) const
+  {
+    drm_gem_close arg = { .handle = handle };
+    ioctl(DRM_IOCTL_GEM_CLOSE, &arg);
+  }
+
+private:
+  int m_fd = -1;
+};
+
+std::vector<amdxdna_drm_create_bo>
+bo_specs(size_t count, size_t size)
+{
+  std::vector<amdxdna_drm_create_bo> cbos(count);
+
+  for (size_t i = 0; i < count; i++) {
+    cbos[i].size = size;
+    // Mix of the two types a model load creates in numbers
+    cbos[i].type = (i % 4) ? AMDXDNA_BO_SHARE : AMDXDNA_BO_CMD;
+  }
+  return cbos;
+}
+
+void
+check_bos(const std::vector<amdxdna_drm_create_bo>& cbos, const char *how)
+{
+  std::set<uint32_t> handles;
+
+  for (auto& cbo : cbos) {
+    if (!cbo.handle || !cbo.map_offset)
+      throw std::runtime_error(std::string(how) + ": BO created without handle or offset");
+    if (!handles.insert(cbo.handle).second)
+      throw std::runtime_error(std::string(how) + ": duplicated BO handle");
+  }
+}
+
+}
+
+void
+TEST_create_free_bulk_bo(device::id_type id, std::shared_ptr<device> sdev, arg_type& arg)
+{
+  auto count = static_cast<size_t>(arg[0]);
+  auto size = static_cast<size_t>(arg[1]);
+  accel_fd dev{id};
+
+  // One at a time, as the shim does on drivers without bulk creation
+  auto single = bo_specs(count, size);
+  auto start = clk::now();
+  for (auto& cbo : single) {
+    cbo.flags = AMDXDNA_BO_FLAG_INFO;
+    auto ret = dev.ioctl(DRM_IOCTL_AMDXDNA_CREATE_BO, &cbo);
+    if (ret)
+      throw std::runtime_error("CREATE_BO failed: " + std::to_string(ret));
+  }
+  auto end = clk::now();
+  check_bos(single, "single");
+  auto single_us = std::chrono::duration_cast<us_t>(end - start).count();
+
+  // All at once, in the chunks the driver takes
+  auto bulk = bo_specs(count, size);
+  start = clk::now();
+  for (size_t done = 0; done < bulk.size();) {
+    auto n = std::min<size_t>(bulk.size() - done, AMDXDNA_MAX_CREATE_BOS);
+    amdxdna_drm_create_bos bos = {
+      .bos = reinterpret_cast<uintptr_t>(&bulk[done]),
+      .count = static_cast<uint32_t>(n),
+    };
+    auto ret = dev.ioctl(DRM_IOCTL_AMDXDNA_CREATE_BOS, &bos);
+    if (ret)
+      throw std::runtime_error("CREATE_BOS failed: " + std::to_string(ret));
+    done += n;
+  }
+  end = clk::now();
+  check_bos(bulk, "bulk");
+  auto bulk_us = std::chrono::duration_cast<us_t>(end - start).count();
+
+  for (size_t i = 0; i < count; i++) {
+    if (bulk[i].type != single[i].type || bulk[i].size != single[i].size)
+      throw std::runtime_error("Bulk BO does not match single BO");
+  }
+  std::cout << count << " BOs of " << size << " bytes: one by one " << single_us
+    << "us, bulk " << bulk_us << "us" << std::endl;
+
+  for (auto& cbo : single)
+    dev.close_bo(cbo.handle);
+  for (auto& cbo : bulk)
+    dev.close_bo(cbo.handle);
+
+  // A rejected entry creates nothing, the lowest free handle stays free
+  amdxdna_drm_create_bo probe = { .flags = AMDXDNA_BO_FLAG_INFO, .size = size, .type = AMDXDNA_BO_SHARE };
+  if (dev.ioctl(DRM_IOCTL_AMDXDNA_CREATE_BO, &probe))
+    throw std::runtime_error("CREATE_BO failed");
+  dev.close_bo(probe.handle);
+  auto bad = bo_specs(std::min<size_t>(count, AMDXDNA_MAX_CREATE_BOS), size);
+  bad.back().type = AMDXDNA_BO_DEV_HEAP;
+  amdxdna_drm_create_bos bos = {
+    .bos = reinterpret_cast<uintptr_t>(bad.data()),
+    .count = static_cast<uint32_t>(bad.size()),
+  };
+  if (dev.ioctl(DRM_IOCTL_AMDXDNA_CREATE_BOS, &bos) != EINVAL)
+    throw std::runtime_error("CREATE_BOS with DEV_HEAP entry not rejected");
+  auto handle = probe.handle;
+  probe.handle = 0;
+  if (dev.ioctl(DRM_IOCTL_AMDXDNA_CREATE_BO, &probe))
+    throw std::runtime_error("CREATE_BO failed");
+  dev.close_bo(probe.handle);
+  if (probe.handle != handle)
+    throw std::runtime_error("Failed CREATE_BOS left handles behind");
+}
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2025, Advanced Micro Devices, Inc. All rights reserved.
+
+#include "bo.h"
+#include "io.h"
+#include "hwctx.h"
+#include "dev_info.h"
+#include "exec_buf.h"
+#include "io_param.h"
+
+#include "shim/cmd_graph.h"
+
+#include "core/common/device.h"
+#include "core/common/shim/fence_handle.h"
+#include <cstring>
+#include <dlfcn.h>
+
+using namespace xrt_core;
+using arg_type = const std::vector<uint64_t>;
+
+namespace {
+
+// Graph entry points of the shim library XRT loaded for the device
+struct graph_ops
+{
+  decltype(&xdna_hwq_begin_capture) begin_capture;
+  decltype(&xdna_hwq_end_capture) end_capture;
+  decltype(&xdna_hwq_instantiate) instantiate;
+  decltype(&xdna_graph_destroy) graph_destroy;
+  decltype(&xdna_graph_launch) launch;
+  decltype(&xdna_graph_wait) wait;
+  decltype(&xdna_graph_exec_destroy) exec_destroy;
+
+  graph_ops(hwqueue_handle *hwq)
+  {
+    // The queue object lives in the shim, its vtable tells which library
+    Dl_info info;
+    if (!dladdr(*reinterpret_cast<void**>(hwq), &info) || !info.dli_fname)
+      throw std::runtime_error("Can't find shim library of HW queue");
+    auto lib = dlopen(info.dli_fname, RTLD_LAZY | RTLD_NOLOAD);
+    if (!lib)
+      throw std::runtime_error(std::string("Can't open ") + info.dli_fname);
+
+    lookup(lib, "xdna_hwq_begin_capture", begin_capture);
+    lookup(lib, "xdna_hwq_end_capture", end_capture);
+    lookup(lib, "xdna_hwq_instantiate", instantiate);
+    lookup(lib, "xdna_graph_destroy", graph_destroy);
+    lookup(lib, "xdna_graph_launch", launch);
+    lookup(lib, "xdna_graph_wait", wait);
+    lookup(lib, "xdna_graph_exec_destroy", exec_destroy);
+    // XRT keeps the library loaded, drop the reference taken here
+    dlclose(lib);
+  }
+
+  template <typename F>
+  void
+  lookup(void *lib, const char *name, F& fn)
+  {
+    fn = reinterpret_cast<F>(dlsym(lib, name));
+    if (!fn)
+      throw std::runtime_error(std::string("Can't find ") + name + " in shim library");
+  }
+};
+
+void
+check_ret(int ret, const char *what)
+{
+  if (ret < 0)
+    throw std::runtime_error(std::string(what) + " failed, ret=" + std::to_string(ret));
+}
+
+}
+
+void
+TEST_cmd_graph_replay(device::id_type id, std::shared_ptr<device> sdev, arg_type& arg)
+{
+  unsigned int run_type = static_cast<unsigned int>(arg[0]);
+  unsigned int launches = static_cast<unsigned int>(arg[1]);
+  // More than one chain, with a fence signal in between
+  const int num_cmds = 30;
+  const int signal_after = 10;
+  auto dev = sdev.get();
+
+  std::vector< std::unique_ptr<io_test_bo_set> > bo_set;
+  for (int i = 0; i < num_cmds; i++)
+    bo_set.push_back(std::make_unique<io_test_bo_set>(dev));
+  if (run_type == IO_TEST_NOOP_RUN) {
+    for (auto& boset : bo_set) {
+      auto ibo = boset->get_bos()[IO_TEST_BO_INSTRUCTION].tbo;
+      std::memset(ibo->map(), 0, ibo->size());
+    }
+  }
+  auto fence = dev->create_fence(fence_handle::access_mode::local);
+
+  shim_xdna::cmd_graph_exec *exec = nullptr;
+  std::unique_ptr<graph_ops> ops;
+  {
+    hw_ctx hwctx{dev};
+    auto hwq = hwctx.get()->get_hw_queue();
+    auto kernel = get_kernel_name(dev, nullptr);
+    if (kernel.empty())
+      throw std::runtime_error("No kernel found");
+    auto cu_idx = hwctx.get()->open_cu_context(kernel);
+    std::cout << "Found kernel: " << kernel << " with cu index " << cu_idx.index << std::endl;
+
+    for (auto& boset : bo_set) {
+      boset->init_cmd(cu_idx, false);
+      boset->sync_before_run();
+    }
+
+    ops = std::make_unique<graph_ops>(hwq);
+
+    // Captured, nothing may reach the device yet
+    check_ret(ops->begin_capture(hwq), "begin_capture");
+    if (ops->begin_capture(hwq) != -EBUSY)
+      throw std::runtime_error("Nested capture is not rejected");
+    for (int i = 0; i < num_cmds; i++) {
+      hwq->submit_command(bo_set[i]->get_bos()[IO_TEST_BO_CMD].tbo->get());
+      if (i == signal_after - 1)
+        hwq->submit_signal(fence.get());
+    }
+    shim_xdna::cmd_graph *graph = nullptr;
+    check_ret(ops->end_capture(hwq, &graph), "end_capture");
+    for (auto& boset : bo_set) {
+      auto cpkt = reinterpret_cast<ert_start_kernel_cmd *>(boset->get_bos()[IO_TEST_BO_CMD].tbo->map());
+      if (cpkt->state != ERT_CMD_STATE_NEW)
+        throw std::runtime_error("Command submitted while capturing");
+    }
+
+    check_ret(ops->instantiate(hwq, graph, &exec), "instantiate");
+    ops->graph_destroy(graph);
+
+    for (unsigned int l = 0; l < launches; l++) {
+      if (run_type != IO_TEST_NOOP_RUN) {
+        for (auto& boset : bo_set) {
+          auto ofm = boset->get_bos()[IO_TEST_BO_OUTPUT].tbo;
+          std::memset(ofm->map(), 0, ofm->size());
+          ofm->get()->sync(buffer_handle::direction::host2device, ofm->size(), 0);
+        }
+      }
+
+      check_ret(ops->launch(exec), "launch");
+      fence->wait(5000);
+      auto ret = ops->wait(exec, 5000);
+      check_ret(ret, "wait");
+      if (!ret)
+        throw std::runtime_error("Graph launch " + std::to_string(l) + " timed out");
+
+      if (run_type != IO_TEST_NOOP_RUN) {
+        for (auto& boset : bo_set) {
+          boset->sync_after_run();
+          boset->verify_result();
+        }
+      }
+    }
+    std::cout << launches << " launches of " << num_cmds << " commands finished" << std::endl;
+  }
+
+  // The queue went away with the context, the graph must not reach it
+  auto ret = ops->launch(exec);
+  ops->exec_destroy(exec);
+  if (ret != -ENODEV)
+    throw std::runtime_error("Launch without HW queue returned " + std::to_string(ret));
+}
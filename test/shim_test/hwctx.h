@@ -13,10 +13,10 @@ using namespace xrt_core;
 
 class hw_ctx {
 public:
-  hw_ctx(device* dev, const char *xclbin_name=nullptr)
+  hw_ctx(device* dev, const char *xclbin_name=nullptr, uint32_t queue_depth=0)
   {
     auto path = get_xclbin_path(dev, xclbin_name);
-    hw_ctx_init(dev, path);
+    hw_ctx_init(dev, path, queue_depth);
   }
 
   hwctx_handle *
@@ -29,7 +29,7 @@ private:
   std::unique_ptr<hwctx_handle> m_handle;
 
   void
-  hw_ctx_init(device* dev, const std::string& xclbin_path)
+  hw_ctx_init(device* dev, const std::string& xclbin_path, uint32_t queue_depth)
   {
     xrt::xclbin xclbin;
 
@@ -43,6 +43,8 @@ private:
     dev->record_xclbin(xclbin);
     auto xclbin_uuid = xclbin.get_uuid();
     xrt::hw_context::qos_type qos{ {"gops", 100} };
+    if (queue_depth)
+      qos["queue_depth"] = queue_depth;
     xrt::hw_context::access_mode mode = xrt::hw_context::access_mode::shared;
 
     m_handle = dev->create_hw_context(xclbin_uuid, qos, mode);
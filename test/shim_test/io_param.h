@@ -18,6 +18,8 @@ struct io_test_parameter {
 #define IO_TEST_POLL_WAIT     1
   int wait;
   bool debug;
+  // Max outstanding commands of the context, 0 means driver default
+  uint32_t queue_depth;
 };
 
 #endif // _SHIMTEST_IO_PARAM_H_
@@ -26,6 +26,7 @@ io_test_parameter_init(int perf, int type, int wait, bool debug = false)
   io_test_parameters.type = type;
   io_test_parameters.wait = wait;
   io_test_parameters.debug = debug;
+  io_test_parameters.queue_depth = 0;
 }
 
 std::unique_ptr<io_test_bo_set_base>
@@ -174,7 +175,7 @@ io_test(device::id_type id, device* dev, int total_hwq_submit, int num_cmdlist,
 
   // Creating HW context for cmd submission
   const char *xclbin = is_elf ? elf_xclbin : nullptr;
-  hw_ctx hwctx{dev, xclbin};
+  hw_ctx hwctx{dev, xclbin, io_test_parameters.queue_depth};
   auto hwq = hwctx.get()->get_hw_queue();
   auto ip_name = get_kernel_name(dev, xclbin);
   if (ip_name.empty())
@@ -310,6 +311,37 @@ TEST_io_runlist_throughput(device::id_type id, std::shared_ptr<device> sdev, arg
   }
 }
 
+void
+TEST_io_runlist_replay(device::id_type id, std::shared_ptr<device> sdev, arg_type& arg)
+{
+  unsigned int run_type = static_cast<unsigned int>(arg[0]);
+  unsigned int wait_type = static_cast<unsigned int>(arg[1]);
+  unsigned int total = static_cast<unsigned int>(arg[2]);
+  const int cmds_per_list = 24;
+
+  // One chained command submitted over and over. With Debug.seal_cmd_chains
+  // set in xrt.ini the driver encodes it once and only refreshes the args.
+  io_test_parameter_init(IO_TEST_LATENCY_PERF, run_type, wait_type);
+  io_test(id, sdev.get(), total / cmds_per_list, 1, cmds_per_list, false);
+}
+
+void
+TEST_io_queue_depth_throughput(device::id_type id, std::shared_ptr<device> sdev, arg_type& arg)
+{
+  unsigned int run_type = static_cast<unsigned int>(arg[0]);
+  unsigned int wait_type = static_cast<unsigned int>(arg[1]);
+  unsigned int total = static_cast<unsigned int>(arg[2]);
+  const uint32_t max_queue_depth = 32;
+
+  io_test_parameter_init(IO_TEST_THRUPUT_PERF, run_type, wait_type);
+  for (uint32_t depth = 4; depth <= max_queue_depth; depth *= 2) {
+    // Twice as many commands as the queue can hold keeps it full
+    std::cout << "Queue depth " << depth << std::endl;
+    io_test_parameters.queue_depth = depth;
+    io_test(id, sdev.get(), total, depth * 2, 1, false);
+  }
+}
+
 void
 TEST_noop_io_with_dup_bo(device::id_type id, std::shared_ptr<device> sdev, arg_type& arg)
 {
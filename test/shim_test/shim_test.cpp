@@ -48,6 +48,8 @@ void TEST_io_latency(device::id_type, std::shared_ptr<device>, arg_type&);
 void TEST_io_throughput(device::id_type, std::shared_ptr<device>, arg_type&);
 void TEST_io_runlist_latency(device::id_type, std::shared_ptr<device>, arg_type&);
 void TEST_io_runlist_throughput(device::id_type, std::shared_ptr<device>, arg_type&);
+void TEST_io_queue_depth_throughput(device::id_type, std::shared_ptr<device>, arg_type&);
+void TEST_io_runlist_replay(device::id_type, std::shared_ptr<device>, arg_type&);
 void TEST_noop_io_with_dup_bo(device::id_type, std::shared_ptr<device>, arg_type&);
 void TEST_shim_umq_vadd(device::id_type, std::shared_ptr<device>, arg_type&);
 void TEST_shim_umq_memtiles(device::id_type, std::shared_ptr<device>, arg_type&);
@@ -56,6 +58,8 @@ void TEST_shim_umq_remote_barrier(device::id_type, std::shared_ptr<device>, arg_
 void TEST_elf_io(device::id_type, std::shared_ptr<device>, arg_type&);
 void TEST_cmd_fence_host(device::id_type, std::shared_ptr<device>, arg_type&);
 void TEST_cmd_fence_device(device::id_type, std::shared_ptr<device>, arg_type&);
+void TEST_cmd_graph_replay(device::id_type, std::shared_ptr<device>, arg_type&);
+void TEST_create_free_bulk_bo(device::id_type, std::shared_ptr<device>, arg_type&);
 
 inline void
 set_xrt_path()
@@ -496,6 +500,30 @@ TEST_map_bo(device::id_type id, std::shared_ptr<device> sdev, arg_type& arg)
   //}
 }
 
+// Set Debug.huge_page_bo in xrt.ini to compare with huge page backed BO
+void
+TEST_map_flush_large_bo(device::id_type id, std::shared_ptr<device> sdev, arg_type& arg)
+{
+  auto size = static_cast<size_t>(arg[0]);
+  bo bo{sdev.get(), size, XCL_BO_FLAGS_HOST_ONLY};
+
+  std::vector<int> ref_vec(size/sizeof(int));
+  speed_test_fill_buf(ref_vec);
+  auto ref_buf = ref_vec.data();
+  auto buf = bo.map();
+
+  std::cout << "\tBO *write* speed test start. vector -> bo " << std::endl;
+  speed_test_copy_data(buf, ref_buf, size);
+
+  std::cout << "\tBo *read* speed test start. bo -> vector" << std::endl;
+  speed_test_copy_data(ref_buf, buf, size);
+
+  auto start = clk::now();
+  bo.get()->sync(buffer_handle::direction::host2device, size, 0);
+  auto end = clk::now();
+  get_speed_and_print("flush", size, start, end);
+}
+
 void
 TEST_open_close_cu_context(device::id_type id, std::shared_ptr<device> sdev, arg_type& arg)
 {
@@ -611,6 +639,9 @@ std::vector<test_case> test_list {
   test_case{ "map exec_buf_bo and test perf", {},
     TEST_POSITIVE, dev_filter_xdna, TEST_create_free_bo, {XCL_BO_FLAGS_EXECBUF, 0, 0x1000}
   },
+  test_case{ "create and free BOs in bulk vs one by one", {},
+    TEST_POSITIVE, dev_filter_is_aie2, TEST_create_free_bulk_bo, { 512, 0x1000 }
+  },
   test_case{ "open_close_cu_context", {},
     TEST_POSITIVE, dev_filter_is_aie2, TEST_open_close_cu_context, {}
   },
@@ -732,6 +763,18 @@ std::vector<test_case> test_list {
   test_case{ "Create and destroy devices", {},
     TEST_POSITIVE, dev_filter_is_aie2, TEST_create_destroy_device, {}
   },
+  test_case{ "measure no-op kernel throughput by queue depth", {},
+    TEST_POSITIVE, dev_filter_is_aie2, TEST_io_queue_depth_throughput, { IO_TEST_NOOP_RUN, IO_TEST_IOCTL_WAIT, 32000 }
+  },
+  test_case{ "measure no-op kernel latency replaying one chained command", {},
+    TEST_POSITIVE, dev_filter_is_aie2, TEST_io_runlist_replay, { IO_TEST_NOOP_RUN, IO_TEST_IOCTL_WAIT, 32000 }
+  },
+  test_case{ "io test replaying a captured command graph", {},
+    TEST_POSITIVE, dev_filter_is_aie2, TEST_cmd_graph_replay, { IO_TEST_NORMAL_RUN, 3 }
+  },
+  test_case{ "map and flush 64MiB input_output bo and test perf", {},
+    TEST_POSITIVE, dev_filter_xdna, TEST_map_flush_large_bo, { 0x4000000 }
+  },
 };
 
 // Test case executor implementation
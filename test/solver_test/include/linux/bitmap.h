@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+#ifndef _SOLVER_TEST_LINUX_BITMAP_H_
+#define _SOLVER_TEST_LINUX_BITMAP_H_
+
+#include "kernel_shim.h"
+
+#endif /* _SOLVER_TEST_LINUX_BITMAP_H_ */
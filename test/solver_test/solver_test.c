@@ -0,0 +1,1178 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (C) 2025, Advanced Micro Devices, Inc.
+ */
+
+/*
+ * User space harness for the AIE2 resource solver (aie2_solver.c).
+ *
+ * The solver is compiled as is against the kernel API stand-ins in
+ * include/. Test modes,
+ *
+ * replay: Replay an allocation trace with every placement policy, with and
+ *	   without defragmentation, and report how many requests each one
+ *	   accepts.
+ * fuzz:   Randomized allocate/release sequences, with load failures and busy
+ *	   contexts injected, checking solver invariants after every operation.
+ * bench:  Steady state release/allocate loop, report allocations per second.
+ * dpm:    Clock governor checks on a fake frequency table, scripted cases
+ *	   first, then random QoS requests checked against a reference.
+ *
+ * Trace format, one operation per line, '#' starts a comment:
+ *	alloc <rid> <ncols>
+ *	free <rid>
+ */
+
+#include <getopt.h>
+#include <time.h>
+
+#include "aie2_solver.h"
+
+unsigned long shim_alloc_cnt;
+unsigned long shim_free_cnt;
+u64 shim_ktime_ns;
+
+#define MAX_TRACE_OPS	(1 << 20)
+#define FUZZ_SLOTS	32
+#define FAIL_PERCENT	2
+#define BUSY_PERCENT	10
+
+enum test_mode {
+	MODE_REPLAY,
+	MODE_FUZZ,
+	MODE_BENCH,
+	MODE_DPM,
+};
+
+enum trace_op_type {
+	TRACE_ALLOC,
+	TRACE_FREE,
+};
+
+struct trace_op {
+	enum trace_op_type	type;
+	u64			rid;
+	u32			ncols;
+};
+
+struct trace {
+	struct trace_op		*ops;
+	u32			nops;
+};
+
+/* The solver only handles pointers to this. The layout is harness private. */
+struct amdxdna_ctx {
+	u64	rid;
+	u32	start_col;
+	u32	ncols;
+	bool	loaded;
+
+	/* QoS request, all zero means no QoS */
+	struct aie_qos	qos;
+	u32		opc;
+
+	/* Start columns this context asked for */
+	u32	cols_len;
+	u32	start_cols[XRS_MAX_COL];
+};
+
+struct test_config {
+	enum test_mode	mode;
+	u32		total_col;
+	bool		col_align;
+	bool		oversub;
+	u32		placement;
+	u32		max_migrations;
+	u32		dpm_down_hold_ms;
+	u32		nops;
+	u32		seed;
+	const char	*trace_file;
+	const char	*dump_file;
+	int		verbose;
+};
+
+struct policy_result {
+	u32	alloc_req;
+	u32	alloc_ok;
+	u32	alloc_fail;
+	u64	used_col_sum;	/* Sum of used columns after each operation */
+	u64	migrations;
+};
+
+static const char * const policy_names[XRS_PLACEMENT_MAX] = {
+	[XRS_PLACEMENT_FIRST_FIT] = "first-fit",
+	[XRS_PLACEMENT_BEST_FIT] = "best-fit",
+};
+
+static struct drm_device test_ddev;
+static u32 test_col_ref[XRS_MAX_COL];
+static u32 test_used_cols;
+static bool test_fail_load;
+static u32 test_busy_percent;
+static u32 test_dpm_level;
+static u32 test_dpm_changes;
+static bool test_dpm_deferred;
+static u64 test_dpm_deadline;
+
+/* Fake frequency table for the dpm mode, in MHz */
+static const struct clk_list_info test_dpm_clk = {
+	.num_levels = 8,
+	.cu_clk_list = { 400, 600, 800, 1000, 1200, 1400, 1600, 1800 },
+};
+
+static int test_load_hwctx(struct amdxdna_ctx *ctx, struct xrs_action_load *action)
+{
+	u32 col;
+
+	if (test_fail_load)
+		return -EIO;
+
+	ctx->start_col = action->part.start_col;
+	ctx->ncols = action->part.ncols;
+	ctx->loaded = true;
+	for (col = ctx->start_col; col < ctx->start_col + ctx->ncols; col++) {
+		if (!test_col_ref[col]++)
+			test_used_cols++;
+	}
+	return 0;
+}
+
+static int test_unload_hwctx(struct amdxdna_ctx *ctx)
+{
+	u32 col;
+
+	ctx->loaded = false;
+	for (col = ctx->start_col; col < ctx->start_col + ctx->ncols; col++) {
+		if (!--test_col_ref[col])
+			test_used_cols--;
+	}
+	return 0;
+}
+
+/*
+ * The solver promises the destination is free, check it before moving.
+ * Columns of the context itself are not free, the solver does not move a
+ * context onto its own columns.
+ */
+static int test_migrate_hwctx(struct amdxdna_ctx *ctx, struct xrs_action_load *action)
+{
+	u32 col;
+
+	if (!ctx->loaded) {
+		fprintf(stderr, "rid %llu: migrate unloaded context\n", ctx->rid);
+		abort();
+	}
+
+	for (col = action->part.start_col;
+	     col < action->part.start_col + action->part.ncols; col++) {
+		if (test_col_ref[col]) {
+			fprintf(stderr, "rid %llu: migrate to busy col %d\n", ctx->rid, col);
+			abort();
+		}
+	}
+
+	/* Loading at the new place failed, the context stays where it was */
+	if (test_fail_load)
+		return -EIO;
+
+	if (test_busy_percent && (u32)(rand() % 100) < test_busy_percent)
+		return -EBUSY;
+
+	test_unload_hwctx(ctx);
+	return test_load_hwctx(ctx, action);
+}
+
+static int test_set_dft_dpm_level(struct drm_device *ddev, u32 level)
+{
+	test_dpm_level = level;
+	test_dpm_changes++;
+	return 0;
+}
+
+/* Stands for the delayed work, run by dpm_tick() once the clock is there */
+static void test_defer_dpm_update(struct drm_device *ddev, u64 delay_ns)
+{
+	test_dpm_deferred = true;
+	test_dpm_deadline = shim_ktime_ns + delay_ns;
+}
+
+static struct xrs_action_ops test_actions = {
+	.load_hwctx = test_load_hwctx,
+	.unload_hwctx = test_unload_hwctx,
+	.migrate_hwctx = test_migrate_hwctx,
+	.set_dft_dpm_level = test_set_dft_dpm_level,
+	.defer_dpm_update = test_defer_dpm_update,
+};
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *solver_init(struct test_config *cfg, u32 placement, u32 max_migrations)
+{
+	struct init_config init = { 0 };
+
+	init.total_col = cfg->total_col;
+	init.placement = placement;
+	init.max_migrations = max_migrations;
+	init.dpm_down_hold_ns = (u64)cfg->dpm_down_hold_ms * NSEC_PER_MSEC;
+	init.sys_eff_factor = 1;
+	if (cfg->mode == MODE_DPM) {
+		init.clk_list = test_dpm_clk;
+	} else {
+		init.clk_list.num_levels = 1;
+		init.clk_list.cu_clk_list[0] = 1000;
+	}
+	init.ddev = &test_ddev;
+	init.actions = &test_actions;
+
+	memset(test_col_ref, 0, sizeof(test_col_ref));
+	test_used_cols = 0;
+	test_fail_load = false;
+	test_busy_percent = 0;
+	test_dpm_level = U32_MAX;
+	test_dpm_changes = 0;
+	test_dpm_deferred = false;
+	return xrsm_init(&init);
+}
+
+static void ctx_set_start_cols(struct test_config *cfg, struct amdxdna_ctx *ctx,
+			       u32 ncols, bool col_align)
+{
+	u32 width = col_align ? ncols : 1;
+	u32 col;
+
+	ctx->cols_len = 0;
+	for (col = 0; col + ncols <= cfg->total_col; col += width)
+		ctx->start_cols[ctx->cols_len++] = col;
+}
+
+static int ctx_alloc(void *xrs, struct amdxdna_ctx *ctx, u32 ncols)
+{
+	struct alloc_requests req = { 0 };
+
+	req.rid = ctx->rid;
+	req.cdo.ncols = ncols;
+	req.cdo.start_cols = ctx->start_cols;
+	req.cdo.cols_len = ctx->cols_len;
+	req.cdo.qos_cap.opc = ctx->opc;
+	req.rqos = ctx->qos;
+
+	return xrs_allocate_resource(xrs, &req, ctx);
+}
+
+static int trace_add(struct trace *t, enum trace_op_type type, u64 rid, u32 ncols)
+{
+	if (t->nops == MAX_TRACE_OPS) {
+		fprintf(stderr, "Trace longer than %d operations\n", MAX_TRACE_OPS);
+		return -E2BIG;
+	}
+
+	t->ops[t->nops].type = type;
+	t->ops[t->nops].rid = rid;
+	t->ops[t->nops].ncols = ncols;
+	t->nops++;
+	return 0;
+}
+
+static int trace_load(struct trace *t, const char *path, u32 total_col)
+{
+	unsigned long long rid;
+	char line[256], op[16];
+	u32 ncols, lineno = 0;
+	FILE *fp;
+	int ret = 0;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		perror(path);
+		return -ENOENT;
+	}
+
+	while (!ret && fgets(line, sizeof(line), fp)) {
+		lineno++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		if (sscanf(line, "%15s %llu %u", op, &rid, &ncols) == 3 &&
+		    !strcmp(op, "alloc")) {
+			if (!ncols || ncols > total_col) {
+				fprintf(stderr, "%s:%d: bad ncols %d\n", path, lineno, ncols);
+				ret = -EINVAL;
+				break;
+			}
+			ret = trace_add(t, TRACE_ALLOC, rid, ncols);
+		} else if (sscanf(line, "%15s %llu", op, &rid) == 2 && !strcmp(op, "free")) {
+			ret = trace_add(t, TRACE_FREE, rid, 0);
+		} else {
+			fprintf(stderr, "%s:%d: cannot parse '%s'\n", path, lineno, line);
+			ret = -EINVAL;
+		}
+	}
+
+	fclose(fp);
+	return ret;
+}
+
+static int trace_dump(struct trace *t, const char *path)
+{
+	FILE *fp;
+	u32 i;
+
+	fp = fopen(path, "w");
+	if (!fp) {
+		perror(path);
+		return -ENOENT;
+	}
+
+	for (i = 0; i < t->nops; i++) {
+		if (t->ops[i].type == TRACE_ALLOC)
+			fprintf(fp, "alloc %llu %u\n", t->ops[i].rid, t->ops[i].ncols);
+		else
+			fprintf(fp, "free %llu\n", t->ops[i].rid);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+/*
+ * Mixed long running workload: mostly 1 and 2 column contexts with some
+ * 4 column ones, kept around the array capacity so that holes are created
+ * and later requests compete for them.
+ */
+static int trace_generate(struct trace *t, u32 nops, u32 total_col)
+{
+	static const u32 ncols_tbl[] = { 1, 1, 1, 1, 2, 2, 2, 4, 4, 4 };
+	u32 live_cols = 0, nlive = 0, i, idx;
+	u64 *live, next_rid = 1;
+	u32 *live_ncols;
+	int ret = 0;
+
+	live = calloc(nops, sizeof(*live));
+	live_ncols = calloc(nops, sizeof(*live_ncols));
+	if (!live || !live_ncols) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; !ret && i < nops; i++) {
+		bool do_alloc = rand() % 2;
+
+		if (!nlive || live_cols < total_col / 2)
+			do_alloc = true;
+		else if (live_cols >= total_col + total_col / 4)
+			do_alloc = false;
+
+		if (do_alloc) {
+			u32 ncols = ncols_tbl[rand() % ARRAY_SIZE(ncols_tbl)];
+
+			ncols = min(ncols, total_col);
+			live[nlive] = next_rid;
+			live_ncols[nlive] = ncols;
+			nlive++;
+			live_cols += ncols;
+			ret = trace_add(t, TRACE_ALLOC, next_rid++, ncols);
+			continue;
+		}
+
+		idx = rand() % nlive;
+		ret = trace_add(t, TRACE_FREE, live[idx], 0);
+		live_cols -= live_ncols[idx];
+		nlive--;
+		live[idx] = live[nlive];
+		live_ncols[idx] = live_ncols[nlive];
+	}
+
+out:
+	free(live);
+	free(live_ncols);
+	return ret;
+}
+
+static struct amdxdna_ctx *ctx_lookup(struct amdxdna_ctx *ctxs, u32 cnt, u64 rid)
+{
+	u32 i;
+
+	for (i = 0; i < cnt; i++) {
+		if (ctxs[i].rid == rid)
+			return &ctxs[i];
+	}
+
+	return NULL;
+}
+
+static int run_trace(struct test_config *cfg, struct trace *t, u32 placement,
+		     u32 max_migrations, struct policy_result *res)
+{
+	struct amdxdna_ctx *ctxs, *ctx;
+	struct xrs_stats stats;
+	u32 i, ctx_cnt = 0;
+	void *xrs;
+	int ret;
+
+	xrs = solver_init(cfg, placement, max_migrations);
+	if (!xrs)
+		return -ENOMEM;
+
+	ctxs = calloc(t->nops, sizeof(*ctxs));
+	if (!ctxs)
+		return -ENOMEM;
+
+	memset(res, 0, sizeof(*res));
+	for (i = 0; i < t->nops; i++) {
+		struct trace_op *op = &t->ops[i];
+
+		if (op->type == TRACE_FREE) {
+			ctx = ctx_lookup(ctxs, ctx_cnt, op->rid);
+			if (ctx && ctx->loaded)
+				xrs_release_resource(xrs, ctx->rid);
+			goto next;
+		}
+
+		ctx = &ctxs[ctx_cnt++];
+		ctx->rid = op->rid;
+		ctx_set_start_cols(cfg, ctx, op->ncols, cfg->col_align);
+
+		res->alloc_req++;
+		ret = ctx_alloc(xrs, ctx, op->ncols);
+		if (ret)
+			res->alloc_fail++;
+		else
+			res->alloc_ok++;
+
+		if (cfg->verbose)
+			printf("%s%s: alloc rid %llu ncols %d -> %s col %d\n",
+			       policy_names[placement], max_migrations ? "+defrag" : "", op->rid, op->ncols,
+			       ret ? "reject" : "accept", ctx->start_col);
+next:
+		res->used_col_sum += test_used_cols;
+	}
+
+	/* Drain so the next run starts with an empty array */
+	for (i = 0; i < ctx_cnt; i++) {
+		if (ctxs[i].loaded)
+			xrs_release_resource(xrs, ctxs[i].rid);
+	}
+
+	xrs_get_stats(xrs, &stats);
+	res->migrations = stats.migrations;
+
+	free(ctxs);
+	return 0;
+}
+
+static int run_replay(struct test_config *cfg)
+{
+	struct policy_result res;
+	struct trace t = { 0 };
+	char name[32];
+	u32 p, defrag;
+	int ret;
+
+	t.ops = calloc(MAX_TRACE_OPS, sizeof(*t.ops));
+	if (!t.ops)
+		return -ENOMEM;
+
+	if (cfg->trace_file)
+		ret = trace_load(&t, cfg->trace_file, cfg->total_col);
+	else
+		ret = trace_generate(&t, min(cfg->nops, MAX_TRACE_OPS), cfg->total_col);
+	if (ret)
+		goto out;
+
+	if (cfg->dump_file) {
+		ret = trace_dump(&t, cfg->dump_file);
+		if (ret)
+			goto out;
+	}
+
+	printf("Replay %d operations on %d columns, %s start columns\n",
+	       t.nops, cfg->total_col, cfg->col_align ? "aligned" : "any");
+	printf("%-18s %10s %10s %10s %10s %10s %10s\n", "policy", "requests",
+	       "accepted", "rejected", "accept%", "avg used", "migrated");
+	for (defrag = 0; defrag < 2; defrag++) {
+		for (p = 0; p < XRS_PLACEMENT_MAX; p++) {
+			snprintf(name, sizeof(name), "%s%s", policy_names[p],
+				 defrag ? "+defrag" : "");
+			ret = run_trace(cfg, &t, p, defrag ? cfg->max_migrations : 0, &res);
+			if (ret) {
+				fprintf(stderr, "Run %s failed, ret %d\n", name, ret);
+				goto out;
+			}
+
+			printf("%-18s %10d %10d %10d %9.2f%% %10.2f %10lld\n", name,
+			       res.alloc_req, res.alloc_ok, res.alloc_fail,
+			       res.alloc_req ? 100.0 * res.alloc_ok / res.alloc_req : 0,
+			       t.nops ? (double)res.used_col_sum / t.nops : 0,
+			       res.migrations);
+		}
+	}
+
+out:
+	free(t.ops);
+	return ret;
+}
+
+/*
+ * check_invariants() - Verify solver state against the loaded contexts.
+ *
+ * - A loaded context sits inside the array on one of its start columns.
+ * - Contexts overlap only when they share the exact same partition.
+ * - The solver holds exactly one allocation per loaded context plus one per
+ *   distinct partition.
+ */
+static int check_invariants(struct test_config *cfg, struct amdxdna_ctx *ctxs, u32 cnt)
+{
+	struct amdxdna_ctx *owner[XRS_MAX_COL] = { 0 };
+	u32 nloaded = 0, npart = 0, i, j, col;
+
+	for (i = 0; i < cnt; i++) {
+		struct amdxdna_ctx *ctx = &ctxs[i];
+		bool new_part = true;
+
+		if (!ctx->loaded)
+			continue;
+		nloaded++;
+
+		if (!ctx->ncols || ctx->start_col + ctx->ncols > cfg->total_col) {
+			fprintf(stderr, "rid %llu: bad range %d+%d\n",
+				ctx->rid, ctx->start_col, ctx->ncols);
+			return -EINVAL;
+		}
+
+		for (j = 0; j < ctx->cols_len; j++) {
+			if (ctx->start_cols[j] == ctx->start_col)
+				break;
+		}
+		if (j == ctx->cols_len) {
+			fprintf(stderr, "rid %llu: start col %d not requested\n",
+				ctx->rid, ctx->start_col);
+			return -EINVAL;
+		}
+
+		for (col = ctx->start_col; col < ctx->start_col + ctx->ncols; col++) {
+			struct amdxdna_ctx *o = owner[col];
+
+			if (!o) {
+				owner[col] = ctx;
+				continue;
+			}
+
+			if (o->start_col != ctx->start_col || o->ncols != ctx->ncols) {
+				fprintf(stderr, "rid %llu %d+%d overlaps rid %llu %d+%d\n",
+					ctx->rid, ctx->start_col, ctx->ncols,
+					o->rid, o->start_col, o->ncols);
+				return -EINVAL;
+			}
+			new_part = false;
+		}
+
+		if (new_part)
+			npart++;
+	}
+
+	if (shim_alloc_cnt - shim_free_cnt != nloaded + npart) {
+		fprintf(stderr, "Solver holds %ld objects, expect %d\n",
+			shim_alloc_cnt - shim_free_cnt, nloaded + npart);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static int run_fuzz(struct test_config *cfg)
+{
+	struct amdxdna_ctx ctxs[FUZZ_SLOTS] = { 0 };
+	u32 i, nalloc = 0, nfree = 0;
+	struct xrs_stats stats;
+	u64 start, dur;
+	void *xrs;
+	int ret = 0;
+
+	xrs = solver_init(cfg, cfg->placement, cfg->max_migrations);
+	if (!xrs)
+		return -ENOMEM;
+	test_busy_percent = BUSY_PERCENT;
+
+	for (i = 0; i < FUZZ_SLOTS; i++)
+		ctxs[i].rid = i + 1;
+
+	/* Expected failures are part of the test, keep the log readable */
+	test_ddev.quiet = !cfg->verbose;
+	start = now_ns();
+	for (i = 0; i < cfg->nops; i++) {
+		struct amdxdna_ctx *ctx = &ctxs[rand() % FUZZ_SLOTS];
+		bool rare = !(rand() % 20);
+		int exp;
+
+		if (ctx->loaded && rare) {
+			/* Duplicated request ID */
+			ret = ctx_alloc(xrs, ctx, ctx->ncols);
+			exp = -EEXIST;
+		} else if (ctx->loaded) {
+			ret = xrs_release_resource(xrs, ctx->rid);
+			exp = 0;
+			nfree++;
+		} else if (rare) {
+			/* Release unknown request ID */
+			ret = xrs_release_resource(xrs, ctx->rid);
+			exp = -ENODEV;
+		} else {
+			u32 ncols = 1 + rand() % cfg->total_col;
+			u32 j, n = 0;
+
+			ctx_set_start_cols(cfg, ctx, ncols, rand() % 2);
+			/* Randomly drop some candidates, keep at least one */
+			for (j = 0; j < ctx->cols_len; j++) {
+				if (rand() % 4 || (!n && j == ctx->cols_len - 1))
+					ctx->start_cols[n++] = ctx->start_cols[j];
+			}
+			ctx->cols_len = n;
+
+			test_fail_load = (rand() % 100) < FAIL_PERCENT;
+			ret = ctx_alloc(xrs, ctx, ncols);
+			/* No free partition, or the injected load failure */
+			if (!ret)
+				exp = 0;
+			else if (test_fail_load && ret == -EIO)
+				exp = -EIO;
+			else
+				exp = -ENODEV;
+			test_fail_load = false;
+			if (!ret)
+				nalloc++;
+		}
+
+		if (ret != exp) {
+			fprintf(stderr, "Op %d rid %llu: ret %d, expect %d\n",
+				i, ctx->rid, ret, exp);
+			ret = -EINVAL;
+			goto out;
+		}
+
+		ret = check_invariants(cfg, ctxs, FUZZ_SLOTS);
+		if (ret) {
+			fprintf(stderr, "Invariant broken after op %d\n", i);
+			goto out;
+		}
+	}
+	dur = now_ns() - start;
+
+	for (i = 0; i < FUZZ_SLOTS; i++) {
+		if (ctxs[i].loaded)
+			xrs_release_resource(xrs, ctxs[i].rid);
+	}
+
+	ret = check_invariants(cfg, ctxs, FUZZ_SLOTS);
+	if (ret)
+		goto out;
+
+	xrs_get_stats(xrs, &stats);
+	printf("Fuzz %s: %d ops, %d allocated, %d released, %.0f ops/sec\n",
+	       policy_names[cfg->placement], cfg->nops, nalloc, nfree,
+	       dur ? cfg->nops * 1e9 / dur : 0);
+	printf("Defrag: %lld placed, %lld migrated, %lld migrations refused\n",
+	       stats.defrag, stats.migrations, stats.migrate_fail);
+out:
+	test_ddev.quiet = 0;
+	return ret;
+}
+
+static int run_bench(struct test_config *cfg)
+{
+	static const u32 ncols_tbl[] = { 1, 1, 2, 4 };
+	struct amdxdna_ctx ctxs[FUZZ_SLOTS] = { 0 };
+	u32 i, nslots, nalloc = 0;
+	u64 start, dur;
+	void *xrs;
+	int ret;
+
+	xrs = solver_init(cfg, cfg->placement, cfg->max_migrations);
+	if (!xrs)
+		return -ENOMEM;
+
+	/*
+	 * Roughly one context per column, so the array stays busy. Or all the
+	 * slots, so most requests end up sharing a partition.
+	 */
+	if (cfg->oversub)
+		nslots = FUZZ_SLOTS;
+	else
+		nslots = min(cfg->total_col, (u32)FUZZ_SLOTS);
+	for (i = 0; i < nslots; i++) {
+		u32 ncols = min(ncols_tbl[i % ARRAY_SIZE(ncols_tbl)], cfg->total_col);
+
+		ctxs[i].rid = i + 1;
+		ctxs[i].ncols = ncols;
+		ctx_set_start_cols(cfg, &ctxs[i], ncols, cfg->col_align);
+		ctx_alloc(xrs, &ctxs[i], ncols);
+	}
+
+	test_ddev.quiet = 1;
+	start = now_ns();
+	for (i = 0; i < cfg->nops; i++) {
+		struct amdxdna_ctx *ctx = &ctxs[rand() % nslots];
+
+		if (ctx->loaded)
+			xrs_release_resource(xrs, ctx->rid);
+		if (!ctx_alloc(xrs, ctx, ctx->ncols))
+			nalloc++;
+	}
+	dur = now_ns() - start;
+	test_ddev.quiet = 0;
+
+	for (i = 0; i < nslots; i++) {
+		if (ctxs[i].loaded)
+			xrs_release_resource(xrs, ctxs[i].rid);
+	}
+
+	ret = check_invariants(cfg, ctxs, nslots);
+	if (ret)
+		return ret;
+
+	printf("Bench %s: %d contexts on %d columns, %d/%d allocated, %.0f allocations/sec\n",
+	       policy_names[cfg->placement], nslots, cfg->total_col, nalloc, cfg->nops,
+	       dur ? cfg->nops * 1e9 / dur : 0);
+	return 0;
+}
+
+/*
+ * dpm_reference() - The level the governor should settle on, computed from
+ * the loaded contexts only. Contexts on the same partition add up.
+ */
+static u32 dpm_reference(struct amdxdna_ctx *ctxs, u32 cnt)
+{
+	u32 max_level = test_dpm_clk.num_levels - 1;
+	u32 i, j, level, ret = 0;
+
+	for (i = 0; i < cnt; i++) {
+		u32 opc = U32_MAX;
+		u64 demand = 0;
+		bool no_qos = false;
+
+		if (!ctxs[i].loaded)
+			continue;
+
+		for (j = 0; j < cnt; j++) {
+			struct amdxdna_ctx *c = &ctxs[j];
+			u32 rate;
+
+			if (!c->loaded || c->start_col != ctxs[i].start_col ||
+			    c->ncols != ctxs[i].ncols)
+				continue;
+
+			if (!c->qos.gops || (!c->qos.fps && !c->qos.latency)) {
+				no_qos = true;
+				break;
+			}
+
+			rate = c->qos.latency ? 1000 / c->qos.latency : 0;
+			demand += (u64)c->qos.gops * max(rate, c->qos.fps);
+			opc = min(opc, c->opc);
+		}
+
+		if (no_qos)
+			return max_level;
+
+		for (level = 0; level < max_level; level++) {
+			if (demand <= (u64)opc * test_dpm_clk.cu_clk_list[level] / 1000)
+				break;
+		}
+		ret = max(ret, level);
+	}
+
+	return ret;
+}
+
+static int dpm_ctx_alloc(void *xrs, struct amdxdna_ctx *ctx, u32 ncols, u32 col,
+			 u32 gops, u32 fps)
+{
+	ctx->cols_len = 1;
+	ctx->start_cols[0] = col;
+	ctx->opc = 1000;
+	ctx->qos.gops = gops;
+	ctx->qos.fps = fps;
+	return ctx_alloc(xrs, ctx, ncols);
+}
+
+#define DPM_EXPECT(cond) do {						\
+	if (!(cond)) {							\
+		fprintf(stderr, "%s:%d: %s failed, level %d changes %d\n",	\
+			__func__, __LINE__, #cond, test_dpm_level,	\
+			test_dpm_changes);				\
+		return -EINVAL;						\
+	}								\
+} while (0)
+
+/*
+ * dpm_tick() - Move the clock forward, and run the deferred update if its
+ * time has come. Returns true when the governor was evaluated.
+ */
+static bool dpm_tick(void *xrs, u64 ns)
+{
+	shim_ktime_ns += ns;
+	if (!test_dpm_deferred || shim_ktime_ns < test_dpm_deadline)
+		return false;
+
+	test_dpm_deferred = false;
+	if (xrs_update_dpm(xrs))
+		fprintf(stderr, "deferred dpm update failed\n");
+	return true;
+}
+
+/*
+ * With opc 1000 a level serves as many GOPs as its frequency in MHz,
+ * e.g. 10 GOPs at 100 fps needs 1000, that is level 3.
+ */
+static int dpm_scripted(struct test_config *cfg)
+{
+	u64 hold = (u64)cfg->dpm_down_hold_ms * NSEC_PER_MSEC;
+	struct amdxdna_ctx ctxs[4] = { 0 };
+	void *xrs;
+	u32 i;
+
+	xrs = solver_init(cfg, cfg->placement, 0);
+	if (!xrs)
+		return -ENOMEM;
+	for (i = 0; i < ARRAY_SIZE(ctxs); i++)
+		ctxs[i].rid = i + 1;
+
+	/* Raise at once */
+	DPM_EXPECT(!dpm_ctx_alloc(xrs, &ctxs[0], 1, 0, 10, 100));
+	DPM_EXPECT(test_dpm_level == 3 && test_dpm_changes == 1);
+
+	/* A lighter context does not change anything */
+	DPM_EXPECT(!dpm_ctx_alloc(xrs, &ctxs[1], 1, 1, 10, 30));
+	DPM_EXPECT(test_dpm_level == 3 && test_dpm_changes == 1);
+
+	if (hold) {
+		/* Demand back within the hold, nothing changes */
+		DPM_EXPECT(!xrs_release_resource(xrs, ctxs[0].rid));
+		dpm_tick(xrs, hold / 2);
+		DPM_EXPECT(!dpm_ctx_alloc(xrs, &ctxs[0], 1, 0, 10, 100));
+		dpm_tick(xrs, hold);
+		DPM_EXPECT(test_dpm_level == 3 && test_dpm_changes == 1);
+	}
+
+	/* The demanding context leaves, lower once the hold time is up */
+	DPM_EXPECT(!xrs_release_resource(xrs, ctxs[0].rid));
+	if (hold) {
+		DPM_EXPECT(test_dpm_level == 3 && test_dpm_changes == 1);
+		DPM_EXPECT(!dpm_ctx_alloc(xrs, &ctxs[2], 1, 2, 10, 40));
+		dpm_tick(xrs, hold - 1);
+		DPM_EXPECT(!xrs_release_resource(xrs, ctxs[2].rid));
+		DPM_EXPECT(test_dpm_level == 3 && test_dpm_changes == 1);
+		/* No allocation or release needed for the drop */
+		DPM_EXPECT(dpm_tick(xrs, 1));
+	}
+	DPM_EXPECT(test_dpm_level == 0 && test_dpm_changes == 2);
+	DPM_EXPECT(!xrs_release_resource(xrs, ctxs[1].rid));
+
+	/* Contexts sharing a partition add up, 600 + 600 needs level 4 */
+	xrs = solver_init(cfg, cfg->placement, 0);
+	if (!xrs)
+		return -ENOMEM;
+	DPM_EXPECT(!dpm_ctx_alloc(xrs, &ctxs[0], cfg->total_col, 0, 10, 60));
+	DPM_EXPECT(test_dpm_level == 1);
+	DPM_EXPECT(!dpm_ctx_alloc(xrs, &ctxs[1], cfg->total_col, 0, 10, 60));
+	DPM_EXPECT(ctxs[1].start_col == ctxs[0].start_col);
+	DPM_EXPECT(test_dpm_level == 4);
+
+	/* No QoS means the max level */
+	memset(&ctxs[2].qos, 0, sizeof(ctxs[2].qos));
+	ctxs[2].cols_len = 1;
+	ctxs[2].start_cols[0] = 0;
+	DPM_EXPECT(!ctx_alloc(xrs, &ctxs[2], cfg->total_col));
+	DPM_EXPECT(test_dpm_level == test_dpm_clk.num_levels - 1);
+	for (i = 0; i < 3; i++)
+		DPM_EXPECT(!xrs_release_resource(xrs, ctxs[i].rid));
+
+	printf("DPM scripted cases passed, hold %d ms\n", cfg->dpm_down_hold_ms);
+	return 0;
+}
+
+/*
+ * dpm_thrash() - A demanding context comes and goes every other ms next to
+ * a light one, as a context swapped in and out by the runqueue does.
+ */
+static int dpm_thrash(struct test_config *cfg, u32 hold_ms, u32 *changes)
+{
+	struct amdxdna_ctx ctxs[2] = { { .rid = 1 }, { .rid = 2 } };
+	struct test_config c = *cfg;
+	void *xrs;
+	u32 i;
+
+	c.dpm_down_hold_ms = hold_ms;
+	xrs = solver_init(&c, c.placement, 0);
+	if (!xrs)
+		return -ENOMEM;
+
+	DPM_EXPECT(!dpm_ctx_alloc(xrs, &ctxs[0], 1, 0, 10, 30));
+	for (i = 0; i < 1000; i++) {
+		DPM_EXPECT(!dpm_ctx_alloc(xrs, &ctxs[1], 1, 1, 10, 140));
+		DPM_EXPECT(test_dpm_level == 5);
+		dpm_tick(xrs, NSEC_PER_MSEC);
+		DPM_EXPECT(!xrs_release_resource(xrs, ctxs[1].rid));
+		dpm_tick(xrs, NSEC_PER_MSEC);
+	}
+	DPM_EXPECT(!xrs_release_resource(xrs, ctxs[0].rid));
+	dpm_tick(xrs, (u64)hold_ms * NSEC_PER_MSEC);
+
+	*changes = test_dpm_changes;
+	return 0;
+}
+
+static int dpm_random(struct test_config *cfg)
+{
+	static const u32 fps_tbl[] = { 0, 15, 30, 60, 90, 120 };
+	u64 hold = (u64)cfg->dpm_down_hold_ms * NSEC_PER_MSEC;
+	struct amdxdna_ctx ctxs[FUZZ_SLOTS] = { 0 };
+	u32 i, ref, bound, nevals = 0;
+	u64 *hist_ts, start, window;
+	u32 *hist;
+	bool evaluated;
+	void *xrs;
+	s64 j;
+
+	/* Every evaluation, the ops themselves and the deferred updates */
+	hist = calloc(2 * cfg->nops, sizeof(*hist));
+	hist_ts = calloc(2 * cfg->nops, sizeof(*hist_ts));
+	if (!hist || !hist_ts) {
+		free(hist);
+		free(hist_ts);
+		return -ENOMEM;
+	}
+
+	xrs = solver_init(cfg, cfg->placement, 0);
+	if (!xrs) {
+		free(hist);
+		free(hist_ts);
+		return -ENOMEM;
+	}
+	for (i = 0; i < FUZZ_SLOTS; i++)
+		ctxs[i].rid = i + 1;
+
+	test_ddev.quiet = !cfg->verbose;
+	start = shim_ktime_ns;
+	for (i = 0; i < cfg->nops; i++) {
+		struct amdxdna_ctx *ctx = &ctxs[rand() % FUZZ_SLOTS];
+
+		if (dpm_tick(xrs, rand() % (hold / 8 + 1))) {
+			hist_ts[nevals] = shim_ktime_ns;
+			hist[nevals++] = dpm_reference(ctxs, FUZZ_SLOTS);
+		}
+
+		if (ctx->loaded) {
+			DPM_EXPECT(!xrs_release_resource(xrs, ctx->rid));
+			evaluated = true;
+		} else {
+			u32 ncols = 1 << (rand() % 3);
+
+			ncols = min(ncols, cfg->total_col);
+			ctx_set_start_cols(cfg, ctx, ncols, true);
+			ctx->opc = 1000;
+			ctx->qos.gops = 1 + rand() % 8;
+			ctx->qos.fps = fps_tbl[rand() % ARRAY_SIZE(fps_tbl)];
+			ctx->qos.latency = 0;
+			/* Keep a single request serviceable at the max level */
+			while ((u64)ctx->qos.gops * ctx->qos.fps > 1800)
+				ctx->qos.gops--;
+			/* A request that is not placed is not evaluated */
+			evaluated = !ctx_alloc(xrs, ctx, ncols);
+		}
+
+		/* Never below the demand */
+		ref = dpm_reference(ctxs, FUZZ_SLOTS);
+		if (!evaluated || test_dpm_level == U32_MAX)
+			continue;
+		DPM_EXPECT(test_dpm_level >= ref);
+		hist_ts[nevals] = shim_ktime_ns;
+		hist[nevals++] = ref;
+
+		/*
+		 * And not above it for long. A drop goes to the highest level
+		 * asked during the hold, and is followed by another hold when
+		 * the demand is lower still, so the level is never above every
+		 * level asked in the last two hold times. The deferred update
+		 * runs up to one tick late, hold / 8, per hold.
+		 */
+		window = 2 * hold + hold / 4;
+		if (shim_ktime_ns - start < window)
+			continue;
+		bound = 0;
+		for (j = nevals - 1; j >= 0 && hist_ts[j] + window >= shim_ktime_ns; j--)
+			bound = max(bound, hist[j]);
+		DPM_EXPECT(test_dpm_level <= bound);
+	}
+	free(hist);
+	free(hist_ts);
+	test_ddev.quiet = 0;
+
+	for (i = 0; i < FUZZ_SLOTS; i++) {
+		if (ctxs[i].loaded)
+			xrs_release_resource(xrs, ctxs[i].rid);
+	}
+
+	printf("DPM random: %d ops, %d level changes\n", cfg->nops, test_dpm_changes);
+	return 0;
+}
+
+static int run_dpm(struct test_config *cfg)
+{
+	u32 hold_ms = max(cfg->dpm_down_hold_ms, 2U);
+	u32 changes, held;
+	int ret;
+
+	ret = dpm_scripted(cfg);
+	if (ret)
+		return ret;
+
+	ret = dpm_thrash(cfg, 0, &changes);
+	if (ret)
+		return ret;
+
+	ret = dpm_thrash(cfg, hold_ms, &held);
+	if (ret)
+		return ret;
+
+	printf("DPM thrash: %d level changes without hold, %d with hold %d ms\n",
+	       changes, held, hold_ms);
+	/* Initial level, one raise and the drop once all is released */
+	if (held > 3) {
+		fprintf(stderr, "Hold does not stop thrashing\n");
+		return -EINVAL;
+	}
+
+	return dpm_random(cfg);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [options]\n", prog);
+	printf("  -m <mode>   replay (default), fuzz, bench or dpm\n");
+	printf("  -c <cols>   Number of columns (default 8)\n");
+	printf("  -a          Start columns naturally aligned to ncols\n");
+	printf("  -o          Bench with %d contexts regardless of columns\n", FUZZ_SLOTS);
+	printf("  -p <policy> Placement policy for fuzz and bench, 0 = first fit, 1 = best fit\n");
+	printf("  -g <num>    Migrations per request for defrag (default 2), 0 = disable\n");
+	printf("  -w <ms>     Time before lowering DPM level (default 200)\n");
+	printf("  -f <file>   Replay trace from file\n");
+	printf("  -n <ops>    Number of operations (default 100000)\n");
+	printf("  -s <seed>   Random seed (default 1)\n");
+	printf("  -d <file>   Dump the replayed trace to file\n");
+	printf("  -v          Verbose\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct test_config cfg = {
+		.mode = MODE_REPLAY,
+		.total_col = 8,
+		.placement = XRS_PLACEMENT_BEST_FIT,
+		.max_migrations = 2,
+		.dpm_down_hold_ms = 200,
+		.nops = 100000,
+		.seed = 1,
+	};
+	int ret, c;
+
+	while ((c = getopt(argc, argv, "m:c:aop:g:w:f:n:s:d:vh")) != -1) {
+		switch (c) {
+		case 'm':
+			if (!strcmp(optarg, "replay")) {
+				cfg.mode = MODE_REPLAY;
+			} else if (!strcmp(optarg, "fuzz")) {
+				cfg.mode = MODE_FUZZ;
+			} else if (!strcmp(optarg, "bench")) {
+				cfg.mode = MODE_BENCH;
+			} else if (!strcmp(optarg, "dpm")) {
+				cfg.mode = MODE_DPM;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'c':
+			cfg.total_col = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			cfg.col_align = true;
+			break;
+		case 'o':
+			cfg.oversub = true;
+			break;
+		case 'p':
+			cfg.placement = strtoul(optarg, NULL, 0);
+			break;
+		case 'g':
+			cfg.max_migrations = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			cfg.dpm_down_hold_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			cfg.trace_file = optarg;
+			break;
+		case 'n':
+			cfg.nops = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			cfg.seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			cfg.dump_file = optarg;
+			break;
+		case 'v':
+			cfg.verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!cfg.total_col || cfg.total_col > XRS_MAX_COL) {
+		fprintf(stderr, "Invalid column number %d\n", cfg.total_col);
+		return 1;
+	}
+	if (cfg.placement >= XRS_PLACEMENT_MAX) {
+		fprintf(stderr, "Invalid placement policy %d\n", cfg.placement);
+		return 1;
+	}
+	if (cfg.max_migrations > XRS_MAX_MIGRATIONS) {
+		fprintf(stderr, "Invalid migrations %d, max %d\n",
+			cfg.max_migrations, XRS_MAX_MIGRATIONS);
+		return 1;
+	}
+	test_ddev.verbose = cfg.verbose;
+	srand(cfg.seed);
+
+	switch (cfg.mode) {
+	case MODE_FUZZ:
+		ret = run_fuzz(&cfg);
+		break;
+	case MODE_BENCH:
+		ret = run_bench(&cfg);
+		break;
+	case MODE_DPM:
+		ret = run_dpm(&cfg);
+		break;
+	default:
+		ret = run_replay(&cfg);
+		break;
+	}
+
+	if (!ret && shim_alloc_cnt != shim_free_cnt) {
+		fprintf(stderr, "Memory leak, %ld allocated, %ld freed\n",
+			shim_alloc_cnt, shim_free_cnt);
+		ret = -EFAULT;
+	}
+
+	printf("%s\n", ret ? "FAILED" : "PASSED");
+	return ret ? 1 : 0;
+}